@@ -0,0 +1,19 @@
+/*
+ * FILE = HEADER: /include/archive.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _archive_
+#define _archive_
+
+#include "pipeline.h"
+
+int archive_open(char *path);
+int archive_write_frame(struct frame *frame);
+int archive_close(void);
+
+#endif
@@ -0,0 +1,26 @@
+/*
+ * FILE = HEADER: /include/deflate.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _deflate_
+#define _deflate_
+
+#include <stddef.h>
+
+size_t deflate_bound(size_t length);
+size_t deflate_block(const unsigned char *in, size_t length,
+                     unsigned char *out, int last);
+
+unsigned long adler32_update(unsigned long adler, const unsigned char *data,
+                             size_t length);
+unsigned long adler32_combine(unsigned long adler1, unsigned long adler2,
+                              size_t length2);
+unsigned long crc32_update(unsigned long crc, const unsigned char *data,
+                           size_t length);
+
+#endif
@@ -0,0 +1,83 @@
+/*
+ * FILE = HEADER: /include/pipeline.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _pipeline_
+#define _pipeline_
+
+#include <stddef.h>
+
+#include "sharedSegment.h"
+#include "perfCounters.h"
+
+/*
+ * The struct frame holds one image on its way through the pipeline.
+ */
+
+struct frame
+{
+  unsigned long framenumber;       // number given by the pixelGenerator
+  unsigned long sequence;          // order in which the image was claimed
+  char name[40];                   // name of the image file
+  unsigned char *pixels;           // MAX_DATA bytes of image data
+  char header[64];                 // file header written before the data
+  int headerlength;
+  int format;                      // file format, see encoder.h
+  unsigned char *data;             // encoded image data
+  size_t datalength;
+  unsigned char *buffer;           // work buffer of the encoder
+  size_t buffersize;
+  struct frame_times times;        // stages of the pixelGenerator
+  long long claim;                 // waiting for the image starts
+  long long claimed;               // image claimed
+  long long copied;                // slot released
+  long long encode;                // encoder takes the image
+  long long encoded;
+  long long output;                // sink hands the image to the backend
+};
+
+/*
+ * Time in nanoseconds a pipeline stage spent working, waiting for work from
+ * the stage before and waiting for the stage after to take its work.
+ */
+
+struct stage_stats
+{
+  long long busy;
+  long long waiting;
+  long long blocked;
+  unsigned long frames;
+};
+
+/*
+ * the stages the perf counters are added to (see perfCounters.h)
+ */
+
+#define WRITER_PERF_COPY 0
+#define WRITER_PERF_ENCODE 1
+#define WRITER_PERF_WRITE 2
+#define WRITER_PERF_STAGES 3
+
+long long pipeline_clock(void);
+
+int start_pipeline(void);
+struct frame *pipeline_get_buffer(struct stage_stats *reader);
+void pipeline_submit(struct frame *frame, struct stage_stats *reader);
+int stop_pipeline(void);
+int pipeline_failed(void);
+void print_stage_stats(char *name, struct stage_stats *stats, int threads,
+                       long long elapsed);
+void print_pipeline_stats(struct stage_stats *reader);
+void record_writer_latency(struct frame *frame, long long written);
+void record_writer_perf(int stage, struct perf_counters *counters,
+                        const struct perf_sample *begin,
+                        const struct perf_sample *end);
+void print_writer_latency(void);
+void free_pipeline(void);
+
+#endif
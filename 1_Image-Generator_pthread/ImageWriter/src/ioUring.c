@@ -0,0 +1,643 @@
+/*
+ * FILE = /src/ioUring.c
+ *
+ * RELATED FILES:     *.c                              *.h
+ *                    imageFile.c                      imageFile.h
+ *                    output.c                         output.h
+ *                                                     ioUring.h
+ *
+ * Output backend writing the images with io_uring (Linux 5.15 or newer).
+ *
+ * Every image is written by a chain of three linked requests:
+ *
+ *   OPENAT  opens the image file into a slot of the fixed file table
+ *   WRITEV  writes header and image data into the fixed file
+ *   CLOSE   closes the fixed file
+ *
+ * The three requests are submitted with a single io_uring_enter() call and
+ * the sink returns to the next image right away. Completions are collected
+ * by the next uring_write_frame() or, while the sink waits for an image, by
+ * uring_poll(). Up to frames_in_flight
+ * images are written at the same time, every image uses its own slot of the
+ * fixed file table. If OPENAT or WRITEV fails the rest of the chain is
+ * cancelled.
+ *
+ * With O_DIRECT the page cache is bypassed. Header and image data are copied
+ * into a buffer aligned to DIRECT_ALIGNMENT, the length written is rounded up
+ * to DIRECT_ALIGNMENT and the file is truncated to the length of the image
+ * afterwards.
+ *
+ * liburing is not used, the rings are set up with the raw system calls.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "universalSettings.h"
+#include "ioUring.h"
+#include "imageFile.h"
+
+#if OS_FEDORA
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#define MAX_FRAMES_IN_FLIGHT 64
+#define DIRECT_ALIGNMENT 4096
+
+/*
+ * The user_data of a request holds the index of the image in
+ * g_inflight[] and the operation of the chain.
+ */
+
+#define OP_OPEN 0
+#define OP_WRITE 1
+#define OP_CLOSE 2
+#define OPS_PER_FRAME 3
+
+#define USER_DATA(index, op) ((unsigned long long) (index) * OPS_PER_FRAME + (op))
+
+struct inflight
+{
+  struct frame *frame;             // NULL if the entry is free
+  frame_done_t done;
+  int pending;                     // requests without completion
+  int failed;
+  size_t length;                   // length of the image file
+  struct iovec iov[2];
+  unsigned char *aligned;          // buffer for O_DIRECT
+  size_t aligned_size;
+};
+
+struct uring
+{
+  int fd;
+  void *sq_ring;
+  size_t sq_ring_size;
+  void *cq_ring;
+  size_t cq_ring_size;
+  struct io_uring_sqe *sqes;
+  size_t sqes_size;
+
+  unsigned *sq_head;
+  unsigned *sq_tail;
+  unsigned sqe_tail;               // behind the last filled entry
+  unsigned *sq_mask;
+  unsigned *sq_array;
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned *cq_mask;
+  struct io_uring_cqe *cqes;
+};
+
+static struct uring g_ring = { .fd = -1 };
+static struct inflight g_inflight[MAX_FRAMES_IN_FLIGHT];
+static int g_frames_in_flight = 0;
+static int g_busy = 0;
+static int g_direct = 0;
+static int g_error = 0;
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+  return (int) syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit,
+                              unsigned min_complete, unsigned flags)
+{
+  return (int) syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+                       flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg,
+                                 unsigned nr_args)
+{
+  return (int) syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+/*---------------------------------------------------------------------------*/
+/* R I N G S                                                                 */
+/*---------------------------------------------------------------------------*/
+
+static void unmap_rings(void)
+{
+  if (g_ring.sqes != NULL)
+  {
+    munmap(g_ring.sqes, g_ring.sqes_size);
+  }
+  if (g_ring.cq_ring != NULL && g_ring.cq_ring != g_ring.sq_ring)
+  {
+    munmap(g_ring.cq_ring, g_ring.cq_ring_size);
+  }
+  if (g_ring.sq_ring != NULL)
+  {
+    munmap(g_ring.sq_ring, g_ring.sq_ring_size);
+  }
+  if (g_ring.fd != -1)
+  {
+    close(g_ring.fd);
+  }
+  memset(&g_ring, 0, sizeof(struct uring));
+  g_ring.fd = -1;
+}
+
+static int map_rings(unsigned entries)
+{
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(struct io_uring_params));
+
+  g_ring.fd = sys_io_uring_setup(entries, &p);
+  if (g_ring.fd < 0)
+  {
+    g_ring.fd = -1;
+    return -1;
+  }
+
+  g_ring.sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  g_ring.cq_ring_size = p.cq_off.cqes +
+                        p.cq_entries * sizeof(struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    if (g_ring.cq_ring_size > g_ring.sq_ring_size)
+    {
+      g_ring.sq_ring_size = g_ring.cq_ring_size;
+    }
+    g_ring.cq_ring_size = g_ring.sq_ring_size;
+  }
+
+  g_ring.sq_ring = mmap(NULL, g_ring.sq_ring_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, g_ring.fd,
+                        IORING_OFF_SQ_RING);
+  if (g_ring.sq_ring == MAP_FAILED)
+  {
+    g_ring.sq_ring = NULL;
+    return -1;
+  }
+
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    g_ring.cq_ring = g_ring.sq_ring;
+  }
+  else
+  {
+    g_ring.cq_ring = mmap(NULL, g_ring.cq_ring_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, g_ring.fd,
+                          IORING_OFF_CQ_RING);
+    if (g_ring.cq_ring == MAP_FAILED)
+    {
+      g_ring.cq_ring = NULL;
+      return -1;
+    }
+  }
+
+  g_ring.sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+  g_ring.sqes = mmap(NULL, g_ring.sqes_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, g_ring.fd, IORING_OFF_SQES);
+  if (g_ring.sqes == MAP_FAILED)
+  {
+    g_ring.sqes = NULL;
+    return -1;
+  }
+
+  unsigned char *sq = g_ring.sq_ring;
+  unsigned char *cq = g_ring.cq_ring;
+
+  g_ring.sq_head = (unsigned *) (sq + p.sq_off.head);
+  g_ring.sq_tail = (unsigned *) (sq + p.sq_off.tail);
+  g_ring.sq_mask = (unsigned *) (sq + p.sq_off.ring_mask);
+  g_ring.sq_array = (unsigned *) (sq + p.sq_off.array);
+  g_ring.cq_head = (unsigned *) (cq + p.cq_off.head);
+  g_ring.cq_tail = (unsigned *) (cq + p.cq_off.tail);
+  g_ring.cq_mask = (unsigned *) (cq + p.cq_off.ring_mask);
+  g_ring.cqes = (struct io_uring_cqe *) (cq + p.cq_off.cqes);
+  g_ring.sqe_tail = *g_ring.sq_tail;
+
+  return 0;
+}
+
+/*
+ * get_sqe() returns the next free submission queue entry. The ring has room
+ * for the requests of all images in flight, so it never runs full.
+ * The entries are handed to the kernel by submit() once they are filled.
+ */
+
+static struct io_uring_sqe *get_sqe(void)
+{
+  unsigned index = g_ring.sqe_tail & *g_ring.sq_mask;
+  struct io_uring_sqe *sqe = &g_ring.sqes[index];
+
+  memset(sqe, 0, sizeof(struct io_uring_sqe));
+  g_ring.sq_array[index] = index;
+  g_ring.sqe_tail++;
+
+  return sqe;
+}
+
+static int submit(unsigned to_submit, unsigned wait)
+{
+  int ret;
+
+  __atomic_store_n(g_ring.sq_tail, g_ring.sqe_tail, __ATOMIC_RELEASE);
+
+  do
+  {
+    ret = sys_io_uring_enter(g_ring.fd, to_submit, wait,
+                             wait ? IORING_ENTER_GETEVENTS : 0);
+  } while (ret < 0 && errno == EINTR);
+
+  if (ret < 0)
+  {
+    perror("io_uring_enter");
+    return -1;
+  }
+  return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* C O M P L E T I O N S                                                     */
+/*---------------------------------------------------------------------------*/
+
+static void finish_frame(struct inflight *entry)
+{
+  if (entry->failed == 0 && g_direct)
+  {
+    if (truncate(entry->frame->name, entry->length) != 0)
+    {
+      perror("truncate");
+      entry->failed = 1;
+    }
+  }
+  if (entry->failed)
+  {
+    g_error = 1;
+  }
+
+  struct frame *frame = entry->frame;
+  entry->frame = NULL;
+  g_busy--;
+  entry->done(frame);
+}
+
+static void complete(struct io_uring_cqe *cqe)
+{
+  int index = cqe->user_data / OPS_PER_FRAME;
+  int op = cqe->user_data % OPS_PER_FRAME;
+  struct inflight *entry = &g_inflight[index];
+
+  if (cqe->res < 0 && cqe->res != -ECANCELED)
+  {
+    char *what[OPS_PER_FRAME] = { "open", "write", "close" };
+    printf("Error: could not %s %s: %s\n", what[op], entry->frame->name,
+           strerror(-cqe->res));
+    entry->failed = 1;
+  }
+  else if (op == OP_WRITE && cqe->res >= 0 &&
+           (size_t) cqe->res < entry->iov[0].iov_len + entry->iov[1].iov_len)
+  {
+    printf("Error writing image data to file\n");
+    entry->failed = 1;
+  }
+  else if (cqe->res == -ECANCELED)
+  {
+    entry->failed = 1;
+  }
+
+  entry->pending--;
+  if (entry->pending == 0)
+  {
+    finish_frame(entry);
+  }
+}
+
+/*
+ * reap() handles all completions in the completion queue.
+ */
+
+static void reap(void)
+{
+  unsigned head = *g_ring.cq_head;
+  unsigned tail = __atomic_load_n(g_ring.cq_tail, __ATOMIC_ACQUIRE);
+
+  while (head != tail)
+  {
+    complete(&g_ring.cqes[head & *g_ring.cq_mask]);
+    head++;
+  }
+  __atomic_store_n(g_ring.cq_head, head, __ATOMIC_RELEASE);
+}
+
+static int wait_for_completion(void)
+{
+  if (submit(0, 1) != 0)
+  {
+    return -1;
+  }
+  reap();
+  return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* O P E N  &  C L O S E                                                     */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * probe() opens and closes /dev/null through the fixed file table. Kernels
+ * older than 5.15 cannot open files into the fixed file table.
+ */
+
+static int probe(void)
+{
+  struct io_uring_sqe *sqe = get_sqe();
+  sqe->opcode = IORING_OP_OPENAT;
+  sqe->fd = AT_FDCWD;
+  sqe->addr = (unsigned long) "/dev/null";
+  sqe->open_flags = O_RDONLY;
+  sqe->file_index = 1;
+  sqe->flags = IOSQE_IO_LINK;
+
+  sqe = get_sqe();
+  sqe->opcode = IORING_OP_CLOSE;
+  sqe->file_index = 1;
+
+  if (submit(2, 2) != 0)
+  {
+    return -1;
+  }
+
+  int failed = 0;
+  unsigned head = *g_ring.cq_head;
+  unsigned tail = __atomic_load_n(g_ring.cq_tail, __ATOMIC_ACQUIRE);
+  while (head != tail)
+  {
+    if (g_ring.cqes[head & *g_ring.cq_mask].res < 0)
+    {
+      failed = 1;
+    }
+    head++;
+  }
+  __atomic_store_n(g_ring.cq_head, head, __ATOMIC_RELEASE);
+
+  return failed ? -1 : 0;
+}
+
+int uring_open(int frames_in_flight, int direct)
+{
+  if (frames_in_flight < 1)
+  {
+    frames_in_flight = 1;
+  }
+  if (frames_in_flight > MAX_FRAMES_IN_FLIGHT)
+  {
+    frames_in_flight = MAX_FRAMES_IN_FLIGHT;
+  }
+
+  memset(g_inflight, 0, sizeof(g_inflight));
+  g_frames_in_flight = frames_in_flight;
+  g_busy = 0;
+  g_direct = direct;
+  g_error = 0;
+
+  if (map_rings(frames_in_flight * OPS_PER_FRAME) != 0)
+  {
+    unmap_rings();
+    return -1;
+  }
+
+/*
+ * Register an empty fixed file table with one slot per image in flight.
+ */
+
+  int files[MAX_FRAMES_IN_FLIGHT];
+  for (int i = 0; i < frames_in_flight; i++)
+  {
+    files[i] = -1;
+  }
+  if (sys_io_uring_register(g_ring.fd, IORING_REGISTER_FILES, files,
+                            frames_in_flight) != 0 || probe() != 0)
+  {
+    unmap_rings();
+    return -1;
+  }
+
+  return 0;
+}
+
+void uring_close(void)
+{
+  if (g_ring.fd != -1)
+  {
+    uring_flush();
+    unmap_rings();
+  }
+  for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+  {
+    if (g_inflight[i].aligned != NULL)
+    {
+      free(g_inflight[i].aligned);
+      g_inflight[i].aligned = NULL;
+    }
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+/* W R I T E                                                                 */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * copy_aligned() copies header and image data into the O_DIRECT buffer of the
+ * entry.
+ */
+
+static int copy_aligned(struct inflight *entry, struct frame *frame)
+{
+  size_t size = (entry->length + DIRECT_ALIGNMENT - 1) &
+                ~((size_t) DIRECT_ALIGNMENT - 1);
+
+  if (entry->aligned_size < size)
+  {
+    free(entry->aligned);
+    entry->aligned = NULL;
+    entry->aligned_size = 0;
+    if (posix_memalign((void **) &entry->aligned, DIRECT_ALIGNMENT, size) != 0)
+    {
+      entry->aligned = NULL;
+      perror("posix_memalign");
+      return -1;
+    }
+    entry->aligned_size = size;
+  }
+
+  memcpy(entry->aligned, frame->header, frame->headerlength);
+  memcpy(entry->aligned + frame->headerlength, frame->data, frame->datalength);
+  memset(entry->aligned + entry->length, 0, size - entry->length);
+
+  entry->iov[0].iov_base = entry->aligned;
+  entry->iov[0].iov_len = size;
+  entry->iov[1].iov_base = NULL;
+  entry->iov[1].iov_len = 0;
+  return 0;
+}
+
+/*
+ * uring_write_frame() waits for a free entry if frames_in_flight images are
+ * being written and submits the requests for the image.
+ */
+
+int uring_write_frame(struct frame *frame, frame_done_t done)
+{
+  while (g_busy == g_frames_in_flight)
+  {
+    if (wait_for_completion() != 0)
+    {
+      return -1;
+    }
+  }
+
+  int index = 0;
+  while (g_inflight[index].frame != NULL)
+  {
+    index++;
+  }
+  struct inflight *entry = &g_inflight[index];
+
+  if (make_image_name(frame) != 0)
+  {
+    done(frame);
+    return -1;
+  }
+
+  entry->length = frame->headerlength + frame->datalength;
+  if (g_direct)
+  {
+    if (copy_aligned(entry, frame) != 0)
+    {
+      done(frame);
+      return -1;
+    }
+  }
+  else
+  {
+    entry->iov[0].iov_base = frame->header;
+    entry->iov[0].iov_len = frame->headerlength;
+    entry->iov[1].iov_base = frame->data;
+    entry->iov[1].iov_len = frame->datalength;
+  }
+
+  entry->frame = frame;
+  entry->done = done;
+  entry->pending = OPS_PER_FRAME;
+  entry->failed = 0;
+  g_busy++;
+
+  struct io_uring_sqe *sqe = get_sqe();
+  sqe->opcode = IORING_OP_OPENAT;
+  sqe->fd = AT_FDCWD;
+  sqe->addr = (unsigned long) frame->name;
+  sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC | (g_direct ? O_DIRECT : 0);
+  sqe->len = 0644;
+  sqe->file_index = index + 1;
+  sqe->flags = IOSQE_IO_LINK;
+  sqe->user_data = USER_DATA(index, OP_OPEN);
+
+  sqe = get_sqe();
+  sqe->opcode = IORING_OP_WRITEV;
+  sqe->fd = index;
+  sqe->addr = (unsigned long) entry->iov;
+  sqe->len = entry->iov[1].iov_len ? 2 : 1;
+  sqe->off = 0;
+  sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_LINK;
+  sqe->user_data = USER_DATA(index, OP_WRITE);
+
+  sqe = get_sqe();
+  sqe->opcode = IORING_OP_CLOSE;
+  sqe->file_index = index + 1;
+  sqe->user_data = USER_DATA(index, OP_CLOSE);
+
+  if (submit(OPS_PER_FRAME, 0) != 0)
+  {
+    return -1;
+  }
+  reap();
+
+  if (g_error)
+  {
+    g_error = 0;
+    return -1;
+  }
+  return 0;
+}
+
+int uring_poll(void)
+{
+  reap();
+
+  if (g_error)
+  {
+    g_error = 0;
+    return -1;
+  }
+  return g_busy;
+}
+
+int uring_flush(void)
+{
+  while (g_busy > 0)
+  {
+    if (wait_for_completion() != 0)
+    {
+      return -1;
+    }
+  }
+
+  if (g_error)
+  {
+    g_error = 0;
+    return -1;
+  }
+  return 0;
+}
+
+#else
+
+/*
+ * io_uring is only available on Linux, open_output() falls back to stdio.
+ */
+
+int uring_open(int frames_in_flight, int direct)
+{
+  return -1;
+}
+
+int uring_write_frame(struct frame *frame, frame_done_t done)
+{
+  return -1;
+}
+
+int uring_poll(void)
+{
+  return 0;
+}
+
+int uring_flush(void)
+{
+  return 0;
+}
+
+void uring_close(void)
+{
+}
+
+#endif
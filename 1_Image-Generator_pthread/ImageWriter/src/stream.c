@@ -0,0 +1,176 @@
+/*
+ * FILE = /src/stream.c
+ *
+ * Output backend appending all images to a single file or to stdout, e.g.
+ * to pipe them into a video encoder:
+ *
+ *   ./imageWriter.out | ffmpeg -i - video.mp4
+ *
+ * The sink writes the images in the order they have been claimed, so the
+ * frames of the stream are in order. With the Y4M format the stream starts
+ * with the Y4M header (see stream_header() in encoder.c).
+ *
+ * If the stream is written to stdout, everything the imageWriter prints is
+ * sent to stderr instead. If the reader of a pipe terminates, writing fails
+ * with EPIPE and the imageWriter terminates too.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "stream.h"
+#include "encoder.h"
+#include "install_signal_handler.h"
+
+static int g_stdout_fd = -1;
+static int g_stream_fd = -1;
+static int g_header_written = 0;
+
+/*
+ * redirect_stdout() keeps the original stdout for the stream and sends
+ * everything printed to stdout to stderr. The imageWriter calls it before it
+ * prints its first message.
+ */
+
+int redirect_stdout(void)
+{
+  if (g_stdout_fd != -1)
+  {
+    return 0;
+  }
+
+  fflush(stdout);
+  g_stdout_fd = dup(STDOUT_FILENO);
+  if (g_stdout_fd == -1)
+  {
+    perror("dup");
+    return -1;
+  }
+  if (dup2(STDERR_FILENO, STDOUT_FILENO) == -1)
+  {
+    perror("dup2");
+    close(g_stdout_fd);
+    g_stdout_fd = -1;
+    return -1;
+  }
+  return 0;
+}
+
+int stream_open(char *path)
+{
+  g_header_written = 0;
+
+  if (strcmp(path, "-") == 0)
+  {
+    if (redirect_stdout() != 0)
+    {
+      return -1;
+    }
+    g_stream_fd = g_stdout_fd;
+    g_stdout_fd = -1;
+  }
+  else
+  {
+    g_stream_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (g_stream_fd == -1)
+    {
+      perror(path);
+      return -1;
+    }
+  }
+
+  if (init_signal_handler(SIGPIPE, SIG_IGN) != EXIT_SUCCESS)
+  {
+    stream_close();
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * write_all() writes the buffers completely, a pipe may take only a part
+ * of them at a time. It is used by the direct output backends too
+ * (see direct.c).
+ */
+
+int write_all(int fd, struct iovec *iov, int count)
+{
+  while (count > 0)
+  {
+    ssize_t written = writev(fd, iov, count);
+    if (written < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      perror("write");
+      return -1;
+    }
+
+    while (count > 0 && (size_t) written >= iov->iov_len)
+    {
+      written -= iov->iov_len;
+      iov++;
+      count--;
+    }
+    if (count > 0)
+    {
+      iov->iov_base = (char *) iov->iov_base + written;
+      iov->iov_len -= written;
+    }
+  }
+  return 0;
+}
+
+int stream_write_frame(struct frame *frame)
+{
+  char header[128];
+  struct iovec iov[3];
+  int count = 0;
+
+  if (g_header_written == 0)
+  {
+    int length = stream_header(frame->format, header, sizeof(header));
+    if (length < 0)
+    {
+      return -1;
+    }
+    iov[count].iov_base = header;
+    iov[count].iov_len = length;
+    count++;
+    g_header_written = 1;
+  }
+
+  iov[count].iov_base = frame->header;
+  iov[count].iov_len = frame->headerlength;
+  count++;
+  iov[count].iov_base = frame->data;
+  iov[count].iov_len = frame->datalength;
+  count++;
+
+  return write_all(g_stream_fd, iov, count);
+}
+
+void stream_close(void)
+{
+  if (g_stream_fd != -1)
+  {
+    if (close(g_stream_fd) != 0)
+    {
+      perror("close");
+    }
+    g_stream_fd = -1;
+  }
+}
@@ -12,12 +12,14 @@
 
 #include <pthread.h>
 
+#include "tiles.h"
+#include "statsPage.h"
+
 /*
  * The computation of the mandelbrot set is done by multiple threads. I have
  * set the number of threads to 8 but changing it to 1, 2 or 8 is also possible.
- * If the HEIGHT of the Image (which is set to 600 -> numberOfPixel.c)
- * divided by the number of threads you want to use, results in an integer
- * value, it should be possible to use it.
+ * The threads take the tiles of the image one after another (see tiles.h),
+ * so the number of threads does not have to divide the HEIGHT of the image.
  */
 
 #define number_of_threads 8 // Tested with 1, 2, 4 and 8 threads
@@ -37,7 +39,8 @@ void cleanup_thread_handler(void *p);
 struct threaddata
 {
   unsigned char *buffer;           // the pointer to the imagebuffer
-  unsigned char (*colpalette)[3];  // the pointer to the colorpalette
+  unsigned char *pixels;           // one pixel for every iteration
+  int bpp;                         // bytes per pixel
   double xp;                       // start value of the mandelbrot section
   double yp;                       // start value of the mandelbrot section
   double xmin;                     // start value of the mandelbrot section
@@ -45,10 +48,13 @@ struct threaddata
   double ymin;                     // start value of the mandelbrot section
   double ymax;                     // start value of the mandelbrot section
   double zoom;                     // start value of the mandelbrot section
-  int xy;                          // start pixel for writing to the imagebuffer
-  int start_y;                     // start row for calculating the image
-  int stop_y;                      // stop row for calculating the image
+  int xy;                          // next pixel written to the imagebuffer
+  struct tile_queue *tiles;        // tiles of the image (see tiles.h)
+  struct thread_stats *stats;      // counters of the thread (see statsPage.h)
+  int number;                      // 0 to number_of_threads - 1
   int *am_I_alive;
+  int cancellable;                 // stop if a view_command arrives
+  int cancelled;                   // set if the thread has stopped early
 };
 
 #endif
@@ -24,6 +24,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <pthread.h>
 #include <signal.h>
 
@@ -33,6 +34,12 @@
 #include "universalSettings.h"
 #include "install_signal_handler.h"
 #include "cleanup_thread_handler.h"
+#include "global_ids.h"
+#include "viewCommand.h"
+#include "tiles.h"
+#include "statsPage.h"
+#include "trace.h"
+#include "generator_latency.h"
 
 void *thandler(void *ptr)
 {
@@ -86,26 +93,64 @@ void *thandler(void *ptr)
 
   (*hdata->am_I_alive) = 0;
 
+/*
+ * The main thread has buffer 0 of the trace (see trace.h).
+ */
+
+  trace_thread(hdata->number + 1, "worker");
+
+/*
+ * The perf counters of the thread are added to the compute stage of the
+ * image (see generator_latency.c).
+ */
+
+  struct perf_counters counters;
+  struct perf_sample perf_start, perf_end;
+
+  open_perf_counters(&counters);
+  read_perf_counters(&counters, &perf_start);
+
   const int MAX_ITERATION = 1023;
 
-  for (int pixel_y = hdata->start_y; pixel_y < hdata->stop_y; pixel_y++)
+/*
+ * The threads take tiles of the image until all tiles are taken, the tiles
+ * around the center of the image first (see tiles.c).
+ * The counters (see statsPage.h) are kept in local variables and added to
+ * the thread's struct thread_stats after every tile.
+ */
+
+  int order;
+
+  while ((order = next_tile(hdata->tiles)) != -1)
   {
-    double y0;
-    y0 = ((hdata->ymax - (pixel_y * hdata->yp)) / hdata->zoom);
+    long long tile_start = stats_clock();
+    unsigned long long iterations = 0;
+    unsigned long long cardioid = 0;
+    unsigned long long bulb = 0;
+
+    int start_x, stop_x, start_y, stop_y;
+    tile_bounds(order, &start_x, &stop_x, &start_y, &stop_y);
 
-    for (int pixel_x = 0; pixel_x < WIDTH; pixel_x++)
+    for (int pixel_y = start_y; pixel_y < stop_y; pixel_y++)
     {
-      double x0;
-      x0 = ((hdata->xmin + (pixel_x * hdata->xp)) / hdata->zoom);
+      hdata->xy = (pixel_y * WIDTH + start_x) * hdata->bpp;
 
-      double x;
-      x = 0.0;
+      double y0;
+      y0 = ((hdata->ymax - (pixel_y * hdata->yp)) / hdata->zoom);
 
-      double y;
-      y = 0.0;
+      for (int pixel_x = start_x; pixel_x < stop_x; pixel_x++)
+      {
+        double x0;
+        x0 = ((hdata->xmin + (pixel_x * hdata->xp)) / hdata->zoom);
 
-      int iteration;
-      iteration = 0;
+        double x;
+        x = 0.0;
+
+        double y;
+        y = 0.0;
+
+        int iteration;
+        iteration = 0;
 
 /*---------------------------------------------------------------------------*/
 /* C A R D I O I D  A N D  B U L B  C H E C K I N G                          */
@@ -117,52 +162,80 @@ void *thandler(void *ptr)
  * "One way to improve calculations is to find out beforehand whether the given
  * point lies within the cardioid or in the period-2 bulb."
  */
-      double q;
-      q = (x0 - 0.25) * (x0 - 0.25) + (y0 * y0);
-
-      if (((q * (q + (x0 - 0.25))) < (0.25 * (y0 * y0))) ||
-         (((x0 + 1) * (x0 + 1) + (y0 * y0)) < (0.0625)))
-      {
-        iteration = MAX_ITERATION;
-        hdata->buffer[hdata->xy] = hdata->colpalette[iteration][0];
-        hdata->xy++;
-        hdata->buffer[hdata->xy] = hdata->colpalette[iteration][1];
-        hdata->xy++;
-        hdata->buffer[hdata->xy] = hdata->colpalette[iteration][2];
-        hdata->xy++;
-        continue;
-      }
+        double q;
+        q = (x0 - 0.25) * (x0 - 0.25) + (y0 * y0);
+
+        int in_cardioid;
+        in_cardioid = ((q * (q + (x0 - 0.25))) < (0.25 * (y0 * y0)));
+
+        if (in_cardioid ||
+           (((x0 + 1) * (x0 + 1) + (y0 * y0)) < (0.0625)))
+        {
+          cardioid += in_cardioid;
+          bulb += !in_cardioid;
+          iteration = MAX_ITERATION;
+          memcpy(&hdata->buffer[hdata->xy],
+                 &hdata->pixels[iteration * hdata->bpp], hdata->bpp);
+          hdata->xy += hdata->bpp;
+          continue;
+        }
 
 /*---------------------------------------------------------------------------*/
 /* C A L C U L A T I N G  T H E  M A N D E L B R O T  S E T                  */
 /*---------------------------------------------------------------------------*/
 
-      while ((((x * x) + (y * y)) < 4) && (iteration < MAX_ITERATION))
-      {
-        double xtemp;
-        xtemp = ((x * x) - (y * y) + x0);
+        while ((((x * x) + (y * y)) < 4) && (iteration < MAX_ITERATION))
+        {
+          double xtemp;
+          xtemp = ((x * x) - (y * y) + x0);
+
+          y = ((2 * x * y) + y0);
+          x = xtemp;
 
-        y = ((2 * x * y) + y0);
-        x = xtemp;
+          iteration = iteration + 1;
+        }
+        iterations += iteration;
 
-        iteration = iteration + 1;
+/*
+ * Looking up the pixel for the current iteration in the table of pixels
+ * (generated by make_pixel_table() from the colorpalette) and writing it
+ * into the local imagebuffer in the pixel format the consumers asked for.
+ */
+
+        memcpy(&hdata->buffer[hdata->xy],
+               &hdata->pixels[iteration * hdata->bpp], hdata->bpp);
+        hdata->xy += hdata->bpp;
       }
+    }
+
+    hdata->stats->pixels += (stop_x - start_x) * (stop_y - start_y);
+    hdata->stats->iterations += iterations;
+    hdata->stats->lane_iterations += iterations;
+    hdata->stats->cardioid += cardioid;
+    hdata->stats->bulb += bulb;
+    hdata->stats->tiles++;
+    long long tile_end = stats_clock();
+    hdata->stats->busy_ns += tile_end - tile_start;
+    trace_event("tile", tile_start, tile_end, order);
 
 /*
- * Looking up colors for the current iteration in the colorpalette (generated
- * by the function create_color_palette()) and writing the R G B values of the
- * current computed pixel into the local imagebuffer.
+ * A consumer has sent a new view_command, the image would show the old
+ * section. The thread stops after the tile it has finished, the finished
+ * tiles are published (see mandelbrot.c).
  */
 
-      hdata->buffer[hdata->xy] = hdata->colpalette[iteration][0];
-      hdata->xy++;
-      hdata->buffer[hdata->xy] = hdata->colpalette[iteration][1];
-      hdata->xy++;
-      hdata->buffer[hdata->xy] = hdata->colpalette[iteration][2];
-      hdata->xy++;
+    if (hdata->cancellable && view_commands_pending(g_membuf))
+    {
+      hdata->cancelled = 1;
+      break;
     }
   }
 
+  read_perf_counters(&counters, &perf_end);
+  record_generator_perf(PERF_STAGE_COMPUTE, &counters, &perf_start, &perf_end,
+                        0);
+  close_perf_counters(&counters);
+
   (*hdata->am_I_alive) = -1;
 
 /*
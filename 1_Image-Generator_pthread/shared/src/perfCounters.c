@@ -0,0 +1,229 @@
+/*
+ * FILE = /src/perfCounters.c
+ *
+ * This file opens and reads the hardware performance counters of a thread
+ * and adds them up per stage (see perfCounters.h).
+ * This file is used by the pixelGenerator and the imageWriter program.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "perfCounters.h"
+
+static int g_reported = 0;
+
+#ifdef __linux__
+
+static const unsigned long long g_configs[PERF_EVENTS] =
+{
+  PERF_COUNT_HW_CPU_CYCLES,
+  PERF_COUNT_HW_INSTRUCTIONS,
+  PERF_COUNT_HW_CACHE_MISSES,
+  PERF_COUNT_HW_BRANCH_MISSES
+};
+
+static int open_event(unsigned long long config)
+{
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  // pid 0, cpu -1: the calling thread on any cpu
+  return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+#endif
+
+/*
+ * open_perf_counters() opens the counters of the calling thread. Returns 0 if
+ * at least cycles and instructions can be counted, -1 otherwise (the
+ * counters are closed then, reading them gives 0).
+ */
+
+int open_perf_counters(struct perf_counters *counters)
+{
+  int error = ENOSYS;
+
+  for (int e = 0; e < PERF_EVENTS; e++)
+  {
+    counters->fd[e] = -1;
+  }
+  if (!PERF_COUNTERS)
+  {
+    return -1;
+  }
+
+#ifdef __linux__
+  for (int e = 0; e < PERF_EVENTS; e++)
+  {
+    counters->fd[e] = open_event(g_configs[e]);
+    if (counters->fd[e] < 0)
+    {
+      error = errno;
+    }
+  }
+  if (counters->fd[PERF_CYCLES] >= 0 && counters->fd[PERF_INSTRUCTIONS] >= 0)
+  {
+    return 0;
+  }
+  close_perf_counters(counters);
+#endif
+
+  if (!__sync_lock_test_and_set(&g_reported, 1))
+  {
+    printf("perf counters not available (%s), running without them\n",
+           strerror(error));
+    if (error == EACCES || error == EPERM)
+    {
+      printf("check /proc/sys/kernel/perf_event_paranoid or CAP_PERFMON\n");
+    }
+  }
+  return -1;
+}
+
+void close_perf_counters(struct perf_counters *counters)
+{
+  for (int e = 0; e < PERF_EVENTS; e++)
+  {
+    if (counters->fd[e] >= 0)
+    {
+      close(counters->fd[e]);
+      counters->fd[e] = -1;
+    }
+  }
+}
+
+/*
+ * read_perf_counters() reads the counters, scaled up if the kernel had to
+ * share the hardware counters with other events (time running < time
+ * enabled).
+ */
+
+void read_perf_counters(struct perf_counters *counters,
+                        struct perf_sample *sample)
+{
+  for (int e = 0; e < PERF_EVENTS; e++)
+  {
+    unsigned long long data[3];      // value, time enabled, time running
+
+    sample->value[e] = 0;
+    if (counters->fd[e] < 0 ||
+        read(counters->fd[e], data, sizeof(data)) != sizeof(data))
+    {
+      continue;
+    }
+    if (data[2] > 0 && data[2] < data[1])
+    {
+      data[0] = (unsigned long long) ((double) data[0] * data[1] / data[2]);
+    }
+    sample->value[e] = data[0];
+  }
+}
+
+/*
+ * add_perf() is thread safe, stages are added to by several threads.
+ */
+
+void add_perf(struct perf_stage *stage, struct perf_counters *counters,
+              const struct perf_sample *begin, const struct perf_sample *end,
+              int frames)
+{
+  if (counters->fd[PERF_CYCLES] < 0)
+  {
+    return;
+  }
+
+  for (int e = 0; e < PERF_EVENTS; e++)
+  {
+    if (counters->fd[e] < 0)
+    {
+      stage->missing[e] = 1;
+    }
+    else if (end->value[e] > begin->value[e])
+    {
+      __sync_fetch_and_add(&stage->value[e], end->value[e] - begin->value[e]);
+    }
+  }
+  __sync_fetch_and_add(&stage->frames, frames);
+}
+
+static void print_per_frame(const struct perf_stage *stage, int event)
+{
+  if (stage->missing[event])
+  {
+    printf(" %11s", "n/a");
+  }
+  else
+  {
+    printf(" %11.0f", (double) stage->value[event] / stage->frames);
+  }
+}
+
+void print_perf(const char *title, const char *names[],
+                const struct perf_stage *stages, int number_of_stages)
+{
+  int counted = 0;
+
+  for (int s = 0; s < number_of_stages; s++)
+  {
+    counted |= (stages[s].frames > 0);
+  }
+  if (!counted)
+  {
+    return;
+  }
+
+  printf("\n%s perf counters per image (user space):\n", title);
+  printf("%-11s %8s %6s %11s %11s %11s %8s\n", "stage", "images", "IPC",
+         "cycles", "instr", "cache miss", "br miss");
+  for (int s = 0; s < number_of_stages; s++)
+  {
+    const struct perf_stage *stage = &stages[s];
+
+    if (stage->frames == 0)
+    {
+      continue;
+    }
+
+    printf("%-11s %8llu %6.2f", names[s], stage->frames,
+           (stage->value[PERF_CYCLES] > 0) ? (double)
+           stage->value[PERF_INSTRUCTIONS] / stage->value[PERF_CYCLES] : 0.0);
+    print_per_frame(stage, PERF_CYCLES);
+    print_per_frame(stage, PERF_INSTRUCTIONS);
+    print_per_frame(stage, PERF_CACHE_MISSES);
+
+    // mispredicted branches per 100 instructions, branches are not counted
+    // to leave a hardware counter free
+    if (stage->missing[PERF_BRANCH_MISSES])
+    {
+      printf(" %8s\n", "n/a");
+    }
+    else
+    {
+      printf(" %7.3f%%\n", (stage->value[PERF_INSTRUCTIONS] > 0) ? 100.0 *
+             stage->value[PERF_BRANCH_MISSES] / stage->value[PERF_INSTRUCTIONS]
+             : 0.0);
+    }
+  }
+}
@@ -0,0 +1,369 @@
+/*
+ * FILE = /benchmark/outputBenchmark.c
+ *
+ * Compares the image formats (see encoder.c) and the output backends
+ * (see output.c) of the imageWriter.
+ *
+ * usage: ./outputBenchmark.out [number of images] [directory ...]
+ *
+ * For every directory (default: /dev/shm, which is a tmpfs, and the current
+ * directory) the benchmark writes the images into a temporary subdirectory
+ * with
+ *
+ *   stdio             fopen(), fwrite(), fclose()
+ *   io_uring          IO_URING_FRAMES_IN_FLIGHT images in flight
+ *   io_uring+O_DIRECT the same without page cache
+ *   mmap              preallocated, memory mapped files (see direct.c)
+ *   writev            header and pixels with a single writev()
+ *
+ * and prints images per second and MB per second. The images are the size
+ * of the images of the pixelGenerator (see LARGE_IMAGE) and written as ppm.
+ * The timing includes waiting for the last image, but not the time the
+ * kernel needs to write the page cache back to disk.
+ *
+ * Before that every image format encodes a Mandelbrot image
+ * number_of_images times. The benchmark prints the size of the encoded image
+ * and how many images per second a single encoder thread handles.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "numberOfPixel.h"
+#include "writerSettings.h"
+#include "pipeline.h"
+#include "encoder.h"
+#include "output.h"
+#include "direct.h"
+
+#define DEFAULT_NUMBER_OF_IMAGES 200
+#define MAX_ITERATIONS 256
+
+static struct frame g_frames[number_of_frame_buffers];
+static struct frame *g_free[number_of_frame_buffers];
+static int g_number_free = 0;
+
+static void frame_written(struct frame *frame)
+{
+  g_free[g_number_free] = frame;
+  g_number_free++;
+}
+
+/*
+ * render_mandelbrot() draws the whole Mandelbrot set with a simple color
+ * gradient, so the image has flat areas like the images of the
+ * pixelGenerator.
+ */
+
+static void render_mandelbrot(unsigned char *pixels)
+{
+  for (int y = 0; y < HEIGHT; y++)
+  {
+    for (int x = 0; x < WIDTH; x++)
+    {
+      double c_re = -2.5 + 3.5 * x / WIDTH;
+      double c_im = -1.25 + 2.5 * y / HEIGHT;
+      double z_re = 0.0;
+      double z_im = 0.0;
+      int i = 0;
+
+      while (i < MAX_ITERATIONS && z_re * z_re + z_im * z_im < 4.0)
+      {
+        double t = z_re * z_re - z_im * z_im + c_re;
+        z_im = 2.0 * z_re * z_im + c_im;
+        z_re = t;
+        i++;
+      }
+
+      unsigned char *pixel = pixels + ((size_t) y * WIDTH + x) * 3;
+      if (i == MAX_ITERATIONS)
+      {
+        pixel[0] = pixel[1] = pixel[2] = 0;
+      }
+      else
+      {
+        pixel[0] = (unsigned char) (i * 8);
+        pixel[1] = (unsigned char) (i * 4);
+        pixel[2] = (unsigned char) (255 - i * 2);
+      }
+    }
+  }
+}
+
+static void benchmark_format(int format, int number_of_images)
+{
+  struct frame *frame = &g_frames[0];
+  int failed = 0;
+  long long start = pipeline_clock();
+
+  for (int n = 0; n < number_of_images && failed == 0; n++)
+  {
+    if (encode_frame_as(frame, format) != 0)
+    {
+      failed = 1;
+    }
+  }
+
+  long long elapsed = pipeline_clock() - start;
+  if (failed || elapsed <= 0)
+  {
+    printf("  %-18s failed\n", image_extension(format));
+    return;
+  }
+
+  size_t size = frame->headerlength + frame->datalength;
+  double seconds = elapsed / 1e9;
+
+  printf("  %-18s %10zu bytes (%5.1f%%) %8.1f images/s %8.1f MB/s\n",
+         image_extension(format), size, 100.0 * size / MAX_DATA,
+         number_of_images / seconds,
+         (double) number_of_images * MAX_DATA / 1e6 / seconds);
+}
+
+static void remove_images(char *directory)
+{
+  DIR *dir = opendir(directory);
+  if (dir == NULL)
+  {
+    return;
+  }
+
+  struct dirent *entry;
+  char path[4096];
+  while ((entry = readdir(dir)) != NULL)
+  {
+    if (strncmp(entry->d_name, "image-", 6) == 0)
+    {
+      snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+      unlink(path);
+    }
+  }
+  closedir(dir);
+}
+
+/*
+ * run() writes number_of_images images with the backend and returns the time
+ * needed in nanoseconds, or -1 if the backend is not available.
+ */
+
+static long long run(int backend, int direct, int number_of_images)
+{
+  if (open_output(backend, direct, IO_URING_FRAMES_IN_FLIGHT, "stream") !=
+      backend)
+  {
+    return -1;
+  }
+
+  g_number_free = 0;
+  for (int i = 0; i < number_of_frame_buffers; i++)
+  {
+    g_free[g_number_free] = &g_frames[i];
+    g_number_free++;
+  }
+
+  int failed = 0;
+  long long start = pipeline_clock();
+
+  for (int n = 0; n < number_of_images && failed == 0; n++)
+  {
+/*
+ * output_frame() returns the buffer before it returns or while it is
+ * waiting for a free entry, so there is always a free buffer.
+ */
+
+    g_number_free--;
+    struct frame *frame = g_free[g_number_free];
+    frame->framenumber = n + 1;
+
+    if (output_frame(frame, frame_written) != 0)
+    {
+      failed = 1;
+    }
+  }
+  if (flush_output() != 0)
+  {
+    failed = 1;
+  }
+
+  long long elapsed = pipeline_clock() - start;
+  close_output();
+
+  return failed ? -1 : elapsed;
+}
+
+/*
+ * run_direct() is run() for the direct output backends (see direct.c).
+ */
+
+static long long run_direct(int backend, int number_of_images)
+{
+  if (open_direct(backend) != 0)
+  {
+    return -1;
+  }
+
+  int failed = 0;
+  long long start = pipeline_clock();
+
+  for (int n = 0; n < number_of_images && failed == 0; n++)
+  {
+    struct frame *frame = &g_frames[n % number_of_frame_buffers];
+    frame->framenumber = n + 1;
+
+    if (write_direct(frame) != 0)
+    {
+      failed = 1;
+    }
+  }
+
+  long long elapsed = pipeline_clock() - start;
+  return failed ? -1 : elapsed;
+}
+
+static void print_result(char *name, long long elapsed, int number_of_images)
+{
+  if (elapsed <= 0)
+  {
+    printf("  %-18s not available\n", name);
+    return;
+  }
+
+  double seconds = elapsed / 1e9;
+  double megabytes = (double) number_of_images *
+                     (g_frames[0].headerlength + g_frames[0].datalength) / 1e6;
+
+  printf("  %-18s %10.1f images/s %10.1f MB/s\n", name,
+         number_of_images / seconds, megabytes / seconds);
+}
+
+static void benchmark_directory(char *directory, int number_of_images)
+{
+  char path[4096];
+  char cwd[4096];
+
+  snprintf(path, sizeof(path), "%s/outputBenchmark-%d", directory, getpid());
+  if (mkdir(path, 0755) != 0)
+  {
+    perror(path);
+    return;
+  }
+  if (getcwd(cwd, sizeof(cwd)) == NULL || chdir(path) != 0)
+  {
+    perror("chdir");
+    rmdir(path);
+    return;
+  }
+
+  printf("%s (%d images of %d bytes):\n", directory, number_of_images,
+         g_frames[0].headerlength + (int) g_frames[0].datalength);
+
+  long long elapsed = run(OUTPUT_STDIO, 0, number_of_images);
+  print_result("stdio", elapsed, number_of_images);
+  remove_images(".");
+
+  elapsed = run(OUTPUT_IO_URING, 0, number_of_images);
+  print_result("io_uring", elapsed, number_of_images);
+  remove_images(".");
+
+  elapsed = run(OUTPUT_IO_URING, 1, number_of_images);
+  print_result("io_uring+O_DIRECT", elapsed, number_of_images);
+  remove_images(".");
+
+  elapsed = run_direct(OUTPUT_MMAP, number_of_images);
+  print_result("mmap", elapsed, number_of_images);
+  remove_images(".");
+
+  elapsed = run_direct(OUTPUT_WRITEV, number_of_images);
+  print_result("writev", elapsed, number_of_images);
+  remove_images(".");
+
+  if (chdir(cwd) != 0)
+  {
+    perror("chdir");
+  }
+  if (rmdir(path) != 0)
+  {
+    perror("rmdir");
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  int number_of_images = DEFAULT_NUMBER_OF_IMAGES;
+  int first_directory = 1;
+
+  if (argc > 1 && atoi(argv[1]) > 0)
+  {
+    number_of_images = atoi(argv[1]);
+    first_directory = 2;
+  }
+
+/*
+ * All buffers hold the same image.
+ */
+
+  for (int i = 0; i < number_of_frame_buffers; i++)
+  {
+    g_frames[i].pixels = (unsigned char *) malloc(MAX_DATA);
+    if (g_frames[i].pixels == NULL)
+    {
+      perror("malloc");
+      return EXIT_FAILURE;
+    }
+    if (i == 0)
+    {
+      render_mandelbrot(g_frames[i].pixels);
+    }
+    else
+    {
+      memcpy(g_frames[i].pixels, g_frames[0].pixels, MAX_DATA);
+    }
+  }
+
+  printf("encoding (%d images of %zu bytes):\n", number_of_images, MAX_DATA);
+  benchmark_format(FORMAT_PPM, number_of_images);
+  benchmark_format(FORMAT_QOI, number_of_images);
+  benchmark_format(FORMAT_PNG, number_of_images);
+
+/*
+ * The output backends write the images as ppm.
+ */
+
+  for (int i = 0; i < number_of_frame_buffers; i++)
+  {
+    if (encode_frame_as(&g_frames[i], FORMAT_PPM) != 0)
+    {
+      printf("Error encoding image\n");
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (first_directory < argc)
+  {
+    for (int d = first_directory; d < argc; d++)
+    {
+      benchmark_directory(argv[d], number_of_images);
+    }
+  }
+  else
+  {
+    benchmark_directory("/dev/shm", number_of_images);
+    benchmark_directory(".", number_of_images);
+  }
+
+  for (int i = 0; i < number_of_frame_buffers; i++)
+  {
+    free(g_frames[i].pixels);
+    free(g_frames[i].buffer);
+  }
+  return EXIT_SUCCESS;
+}
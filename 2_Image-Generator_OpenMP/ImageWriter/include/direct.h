@@ -0,0 +1,20 @@
+/*
+ * FILE = HEADER: /include/direct.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _direct_
+#define _direct_
+
+#include "pipeline.h"
+
+int is_direct_backend(int backend);
+int open_direct(int backend);
+int write_direct(struct frame *frame);
+void print_direct_stats(struct stage_stats *writer);
+
+#endif
@@ -0,0 +1,23 @@
+/*
+ * FILE = HEADER: /include/stream.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _stream_
+#define _stream_
+
+#include <sys/uio.h>
+
+#include "pipeline.h"
+
+int redirect_stdout(void);
+int stream_open(char *path);
+int stream_write_frame(struct frame *frame);
+void stream_close(void);
+int write_all(int fd, struct iovec *iov, int count);
+
+#endif
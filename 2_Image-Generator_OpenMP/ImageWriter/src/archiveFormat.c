@@ -0,0 +1,302 @@
+/*
+ * FILE = /src/archiveFormat.c
+ *
+ * Encoding and decoding of the tiles of an archive (see archiveFormat.h).
+ * This file is used by the imageWriter (archive.c) and the archiveDecoder.
+ *
+ * A tile is stored in the smaller of two codecs:
+ *
+ * TILE_RLE: Runs of equal pixels. A control byte with the highest bit set
+ *           is followed by one pixel repeated (control & 0x7f) + 1 times,
+ *           a control byte without it by control + 1 different pixels.
+ * TILE_RAW: The pixels as they are.
+ *
+ * In delta frames the XOR of a tile with the frame before is stored. Pixels
+ * which did not change become runs of zeros, a tile which did not change at
+ * all is stored as TILE_SAME without data.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <string.h>
+
+#include "archiveFormat.h"
+
+#define MAX_RUN 128
+
+void put_le32(unsigned char *out, unsigned long value)
+{
+  for (int i = 0; i < 4; i++)
+  {
+    out[i] = (value >> (8 * i)) & 0xff;
+  }
+}
+
+void put_le64(unsigned char *out, unsigned long long value)
+{
+  for (int i = 0; i < 8; i++)
+  {
+    out[i] = (value >> (8 * i)) & 0xff;
+  }
+}
+
+unsigned long get_le32(const unsigned char *in)
+{
+  unsigned long value = 0;
+  for (int i = 3; i >= 0; i--)
+  {
+    value = (value << 8) | in[i];
+  }
+  return value;
+}
+
+unsigned long long get_le64(const unsigned char *in)
+{
+  unsigned long long value = 0;
+  for (int i = 7; i >= 0; i--)
+  {
+    value = (value << 8) | in[i];
+  }
+  return value;
+}
+
+/*
+ * A tile never takes more than its pixels and the tile header.
+ */
+
+size_t tile_bound(int tile_width, int tile_height)
+{
+  return TILE_HEADER_SIZE + (size_t) tile_width * tile_height * 3;
+}
+
+static int same_pixel(const unsigned char *a, const unsigned char *b)
+{
+  return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+}
+
+/*
+ * run_length() encodes count pixels into out and returns the number of bytes
+ * written or 0 as soon as the result would be larger than limit.
+ */
+
+static size_t run_length(const unsigned char *pixels, int count,
+                         unsigned char *out, size_t limit)
+{
+  size_t length = 0;
+  int i = 0;
+
+  while (i < count)
+  {
+    int run = 1;
+    while (i + run < count && run < MAX_RUN &&
+           same_pixel(pixels + (i + run) * 3, pixels + i * 3))
+    {
+      run++;
+    }
+
+    if (run > 1)
+    {
+      if (length + 4 > limit)
+      {
+        return 0;
+      }
+      out[length] = 0x80 | (run - 1);
+      memcpy(out + length + 1, pixels + i * 3, 3);
+      length += 4;
+      i += run;
+      continue;
+    }
+
+/*
+ * Collect different pixels until the next run starts.
+ */
+
+    int literal = 1;
+    while (i + literal < count && literal < MAX_RUN &&
+           (i + literal + 1 >= count ||
+            !same_pixel(pixels + (i + literal) * 3,
+                        pixels + (i + literal + 1) * 3)))
+    {
+      literal++;
+    }
+
+    if (length + 1 + literal * 3 > limit)
+    {
+      return 0;
+    }
+    out[length] = literal - 1;
+    memcpy(out + length + 1, pixels + i * 3, literal * 3);
+    length += 1 + literal * 3;
+    i += literal;
+  }
+  return length;
+}
+
+/*
+ * encode_tile() writes the tile starting at image into out and returns the
+ * number of bytes written. reference is the same tile of the frame before
+ * for a delta frame or NULL for a keyframe. width is the width of the whole
+ * image. out must hold tile_bound() bytes.
+ */
+
+size_t encode_tile(const unsigned char *image, const unsigned char *reference,
+                   int width, int tile_width, int tile_height,
+                   unsigned char *out)
+{
+  unsigned char pixels[MAX_TILE_SIZE * MAX_TILE_SIZE * 3];
+  size_t row = (size_t) tile_width * 3;
+  size_t stride = (size_t) width * 3;
+  size_t size = row * tile_height;
+  int changed = (reference == NULL);
+
+  for (int y = 0; y < tile_height; y++)
+  {
+    const unsigned char *src = image + y * stride;
+    unsigned char *dst = pixels + y * row;
+
+    if (reference == NULL)
+    {
+      memcpy(dst, src, row);
+    }
+    else
+    {
+      const unsigned char *ref = reference + y * stride;
+      for (size_t i = 0; i < row; i++)
+      {
+        dst[i] = src[i] ^ ref[i];
+        changed |= dst[i];
+      }
+    }
+  }
+
+  if (changed == 0)
+  {
+    out[0] = TILE_SAME;
+    put_le32(out + 1, 0);
+    return TILE_HEADER_SIZE;
+  }
+
+  size_t length = run_length(pixels, tile_width * tile_height,
+                             out + TILE_HEADER_SIZE, size - 1);
+  if (length > 0)
+  {
+    out[0] = TILE_RLE;
+  }
+  else
+  {
+    out[0] = TILE_RAW;
+    memcpy(out + TILE_HEADER_SIZE, pixels, size);
+    length = size;
+  }
+  put_le32(out + 1, length);
+  return TILE_HEADER_SIZE + length;
+}
+
+/*
+ * decode_tile() reads a tile from *in and stores it into image (delta = 0)
+ * or applies it to the frame before stored in image (delta = 1).
+ * Returns -1 if the data is damaged.
+ */
+
+int decode_tile(const unsigned char **in, const unsigned char *end,
+                unsigned char *image, int delta, int width, int tile_width,
+                int tile_height)
+{
+  unsigned char pixels[MAX_TILE_SIZE * MAX_TILE_SIZE * 3];
+  size_t row = (size_t) tile_width * 3;
+  size_t stride = (size_t) width * 3;
+  size_t size = row * tile_height;
+
+  if (end - *in < TILE_HEADER_SIZE)
+  {
+    return -1;
+  }
+  int codec = (*in)[0];
+  size_t length = get_le32(*in + 1);
+  const unsigned char *data = *in + TILE_HEADER_SIZE;
+  if ((size_t) (end - data) < length)
+  {
+    return -1;
+  }
+  *in = data + length;
+
+  if (codec == TILE_SAME)
+  {
+    return delta ? 0 : -1;
+  }
+  else if (codec == TILE_RAW)
+  {
+    if (length != size)
+    {
+      return -1;
+    }
+    memcpy(pixels, data, size);
+  }
+  else if (codec == TILE_RLE)
+  {
+    size_t filled = 0;
+    size_t i = 0;
+    while (i < length)
+    {
+      int control = data[i];
+      int count = (control & 0x7f) + 1;
+
+      if (filled + count * 3 > size)
+      {
+        return -1;
+      }
+      if (control & 0x80)
+      {
+        if (i + 4 > length)
+        {
+          return -1;
+        }
+        for (int n = 0; n < count; n++)
+        {
+          memcpy(pixels + filled + n * 3, data + i + 1, 3);
+        }
+        i += 4;
+      }
+      else
+      {
+        if (i + 1 + count * 3 > length)
+        {
+          return -1;
+        }
+        memcpy(pixels + filled, data + i + 1, count * 3);
+        i += 1 + count * 3;
+      }
+      filled += count * 3;
+    }
+    if (filled != size)
+    {
+      return -1;
+    }
+  }
+  else
+  {
+    return -1;
+  }
+
+  for (int y = 0; y < tile_height; y++)
+  {
+    unsigned char *dst = image + y * stride;
+    const unsigned char *src = pixels + y * row;
+
+    if (delta)
+    {
+      for (size_t i = 0; i < row; i++)
+      {
+        dst[i] ^= src[i];
+      }
+    }
+    else
+    {
+      memcpy(dst, src, row);
+    }
+  }
+  return 0;
+}
@@ -11,10 +11,12 @@
 
 #include "global_ids_W.h"
 #include <stdio.h>
+#include <signal.h>
 
 int g_shmid;
 int g_semid;
-unsigned char *g_buffer;
+int g_slot;
 unsigned char *g_membuf;
-char *g_name;
 FILE *g_pIMAGE;
+volatile sig_atomic_t g_interrupted;
+volatile sig_atomic_t g_pipeline_running;
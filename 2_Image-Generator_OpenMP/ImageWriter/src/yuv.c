@@ -0,0 +1,260 @@
+/*
+ * FILE = /src/yuv.c
+ *
+ * The rgb_to_yuv420() function converts an RGB24 image into planar YUV 4:2:0
+ * (I420): the Y plane with one byte per pixel is followed by the U and the V
+ * plane with one byte per 2x2 pixels. This is the input most video encoders
+ * expect.
+ *
+ * The conversion uses the integer approximation of ITU-R BT.601 with
+ * limited range (Y 16..235, U and V 16..240). U and V are calculated from
+ * the average color of the 2x2 pixels (chroma sited in the center, "420jpeg"
+ * in Y4M).
+ *
+ * On x86 processors with SSSE3 two rows of 16 pixels are converted at once,
+ * the rest of the image is converted by the scalar code. Both give exactly
+ * the same result.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include "yuv.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+  #define YUV_SIMD 1
+  #include <tmmintrin.h>
+#else
+  #define YUV_SIMD 0
+#endif
+
+size_t yuv420_size(int width, int height)
+{
+  size_t chroma = (size_t) ((width + 1) / 2) * ((height + 1) / 2);
+  return (size_t) width * height + 2 * chroma;
+}
+
+static unsigned char luma(int r, int g, int b)
+{
+  return ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+}
+
+/*
+ * r, g and b are the average of the 2x2 pixels.
+ */
+
+static unsigned char chroma_u(int r, int g, int b)
+{
+  return ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+}
+
+static unsigned char chroma_v(int r, int g, int b)
+{
+  return ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+}
+
+/*
+ * convert_scalar() converts the pixels from column first_x to the end of the
+ * rows y and y + 1. first_x is even. At the right and bottom border of an
+ * image with odd size the missing pixels are replaced by their neighbours.
+ */
+
+static void convert_scalar(const unsigned char *rgb, int width, int height,
+                           int y, int first_x, unsigned char *yplane,
+                           unsigned char *uplane, unsigned char *vplane)
+{
+  const unsigned char *row[2];
+  row[0] = rgb + (size_t) y * width * 3;
+  row[1] = (y + 1 < height) ? row[0] + (size_t) width * 3 : row[0];
+
+  for (int x = first_x; x < width; x += 2)
+  {
+    int x1 = (x + 1 < width) ? x + 1 : x;
+    int r = 0;
+    int g = 0;
+    int b = 0;
+
+    for (int i = 0; i < 2; i++)
+    {
+      const unsigned char *p0 = row[i] + x * 3;
+      const unsigned char *p1 = row[i] + x1 * 3;
+
+      if (i == 0 || y + 1 < height)
+      {
+        yplane[(size_t) (y + i) * width + x] = luma(p0[0], p0[1], p0[2]);
+        if (x1 != x)
+        {
+          yplane[(size_t) (y + i) * width + x1] = luma(p1[0], p1[1], p1[2]);
+        }
+      }
+      r += p0[0] + p1[0];
+      g += p0[1] + p1[1];
+      b += p0[2] + p1[2];
+    }
+
+    r = (r + 2) >> 2;
+    g = (g + 2) >> 2;
+    b = (b + 2) >> 2;
+
+    size_t c = (size_t) (y / 2) * ((width + 1) / 2) + x / 2;
+    uplane[c] = chroma_u(r, g, b);
+    vplane[c] = chroma_v(r, g, b);
+  }
+}
+
+#if YUV_SIMD
+
+/*
+ * load8() splits 8 RGB24 pixels (24 bytes) into three vectors of 16 bit
+ * values. Pixels 0..3 are taken from the first 16 bytes, pixels 4..7 from
+ * the 16 bytes starting at byte 8, so no byte behind the pixels is read.
+ */
+
+__attribute__((target("ssse3")))
+static void load8(const unsigned char *p, __m128i *r, __m128i *g, __m128i *b)
+{
+  const __m128i lo_rg = _mm_setr_epi8(0, 3, 6, 9, -1, -1, -1, -1,
+                                      1, 4, 7, 10, -1, -1, -1, -1);
+  const __m128i hi_rg = _mm_setr_epi8(-1, -1, -1, -1, 4, 7, 10, 13,
+                                      -1, -1, -1, -1, 5, 8, 11, 14);
+  const __m128i lo_b = _mm_setr_epi8(2, 5, 8, 11, -1, -1, -1, -1,
+                                     -1, -1, -1, -1, -1, -1, -1, -1);
+  const __m128i hi_b = _mm_setr_epi8(-1, -1, -1, -1, 6, 9, 12, 15,
+                                     -1, -1, -1, -1, -1, -1, -1, -1);
+  const __m128i zero = _mm_setzero_si128();
+
+  __m128i lo = _mm_loadu_si128((const __m128i *) p);
+  __m128i hi = _mm_loadu_si128((const __m128i *) (p + 8));
+
+  __m128i rg = _mm_or_si128(_mm_shuffle_epi8(lo, lo_rg),
+                            _mm_shuffle_epi8(hi, hi_rg));
+  __m128i bb = _mm_or_si128(_mm_shuffle_epi8(lo, lo_b),
+                            _mm_shuffle_epi8(hi, hi_b));
+
+  *r = _mm_unpacklo_epi8(rg, zero);
+  *g = _mm_unpackhi_epi8(rg, zero);
+  *b = _mm_unpacklo_epi8(bb, zero);
+}
+
+/*
+ * The sum 66 * r + 129 * g + 25 * b + 128 is smaller than 65536, it is
+ * calculated with unsigned 16 bit values.
+ */
+
+__attribute__((target("ssse3")))
+static __m128i luma8(__m128i r, __m128i g, __m128i b)
+{
+  __m128i y = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)),
+                            _mm_mullo_epi16(g, _mm_set1_epi16(129)));
+  y = _mm_add_epi16(y, _mm_mullo_epi16(b, _mm_set1_epi16(25)));
+  y = _mm_add_epi16(y, _mm_set1_epi16(128));
+  return _mm_add_epi16(_mm_srli_epi16(y, 8), _mm_set1_epi16(16));
+}
+
+/*
+ * average4() returns the average of the 2x2 blocks of two rows of 8 pixels
+ * each in the low (first) and high (second) half of the result.
+ */
+
+__attribute__((target("ssse3")))
+static __m128i average4(__m128i first0, __m128i first1, __m128i second0,
+                        __m128i second1)
+{
+  const __m128i ones = _mm_set1_epi16(1);
+
+  __m128i first = _mm_madd_epi16(_mm_add_epi16(first0, first1), ones);
+  __m128i second = _mm_madd_epi16(_mm_add_epi16(second0, second1), ones);
+  __m128i sum = _mm_packs_epi32(first, second);
+
+  return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+}
+
+__attribute__((target("ssse3")))
+static __m128i chroma8(__m128i r, __m128i g, __m128i b, short cr, short cg,
+                       short cb)
+{
+  __m128i c = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(cr)),
+                            _mm_mullo_epi16(g, _mm_set1_epi16(cg)));
+  c = _mm_add_epi16(c, _mm_mullo_epi16(b, _mm_set1_epi16(cb)));
+  c = _mm_add_epi16(c, _mm_set1_epi16(128));
+  return _mm_add_epi16(_mm_srai_epi16(c, 8), _mm_set1_epi16(128));
+}
+
+/*
+ * convert_ssse3() converts the rows y and y + 1 in blocks of 16 pixels and
+ * returns the first column it has not converted.
+ */
+
+__attribute__((target("ssse3")))
+static int convert_ssse3(const unsigned char *rgb, int width, int y,
+                         unsigned char *yplane, unsigned char *uplane,
+                         unsigned char *vplane)
+{
+  const unsigned char *row0 = rgb + (size_t) y * width * 3;
+  const unsigned char *row1 = row0 + (size_t) width * 3;
+  unsigned char *y0 = yplane + (size_t) y * width;
+  unsigned char *y1 = y0 + width;
+  size_t c = (size_t) (y / 2) * ((width + 1) / 2);
+  int x = 0;
+
+  for (; x + 16 <= width; x += 16)
+  {
+    __m128i r[4], g[4], b[4];
+
+    load8(row0 + x * 3, &r[0], &g[0], &b[0]);
+    load8(row0 + x * 3 + 24, &r[1], &g[1], &b[1]);
+    load8(row1 + x * 3, &r[2], &g[2], &b[2]);
+    load8(row1 + x * 3 + 24, &r[3], &g[3], &b[3]);
+
+    _mm_storeu_si128((__m128i *) (y0 + x),
+                     _mm_packus_epi16(luma8(r[0], g[0], b[0]),
+                                      luma8(r[1], g[1], b[1])));
+    _mm_storeu_si128((__m128i *) (y1 + x),
+                     _mm_packus_epi16(luma8(r[2], g[2], b[2]),
+                                      luma8(r[3], g[3], b[3])));
+
+    __m128i ra = average4(r[0], r[2], r[1], r[3]);
+    __m128i ga = average4(g[0], g[2], g[1], g[3]);
+    __m128i ba = average4(b[0], b[2], b[1], b[3]);
+
+    __m128i u = chroma8(ra, ga, ba, -38, -74, 112);
+    __m128i v = chroma8(ra, ga, ba, 112, -94, -18);
+
+    _mm_storel_epi64((__m128i *) (uplane + c + x / 2),
+                     _mm_packus_epi16(u, u));
+    _mm_storel_epi64((__m128i *) (vplane + c + x / 2),
+                     _mm_packus_epi16(v, v));
+  }
+  return x;
+}
+
+#endif
+
+void rgb_to_yuv420(const unsigned char *rgb, int width, int height,
+                   unsigned char *yuv)
+{
+  unsigned char *yplane = yuv;
+  unsigned char *uplane = yplane + (size_t) width * height;
+  unsigned char *vplane = uplane + (size_t) ((width + 1) / 2) *
+                                   ((height + 1) / 2);
+
+#if YUV_SIMD
+  int simd = __builtin_cpu_supports("ssse3");
+#endif
+
+  for (int y = 0; y < height; y += 2)
+  {
+    int x = 0;
+
+#if YUV_SIMD
+    if (simd && y + 1 < height)
+    {
+      x = convert_ssse3(rgb, width, y, yplane, uplane, vplane);
+    }
+#endif
+
+    convert_scalar(rgb, width, height, y, x, yplane, uplane, vplane);
+  }
+}
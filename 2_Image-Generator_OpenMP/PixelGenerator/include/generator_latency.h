@@ -0,0 +1,26 @@
+/*
+ * FILE = HEADER: /include/generator_latency.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _generator_latency_
+#define _generator_latency_
+
+#include "sharedSegment.h"
+#include "perfCounters.h"
+
+#define PERF_STAGE_COMPUTE 0
+#define PERF_STAGE_COPY 1
+#define GENERATOR_PERF_STAGES 2
+
+void record_generator_latency(const struct frame_times *times);
+void record_generator_perf(int stage, struct perf_counters *counters,
+                           const struct perf_sample *begin,
+                           const struct perf_sample *end, int frames);
+void print_generator_latency(void);
+
+#endif
@@ -11,10 +11,13 @@
 #define _global_ids_
 
 #include <stdio.h>
+#include "statsPage.h"
 
 extern int g_shmid;
 extern int g_semid;
 extern unsigned char *g_buffer;
 extern unsigned char *g_membuf;
+extern int g_statsid;
+extern struct stats_page *g_stats;
 
 #endif
@@ -10,6 +10,30 @@
 #ifndef _mandelbrot_
 #define _mandelbrot_
 
-int generate_image(unsigned char palette[][3], unsigned char *imagebuffer);
+#include "viewCommand.h"
+#include "statsPage.h"
+
+/*
+ * the name of this image generator in the stats page (see statsPage.h)
+ */
+
+#define GENERATOR_BACKEND "openmp"
+
+int generate_image(unsigned char *pixels, int bpp, unsigned char *imagebuffer,
+                   struct viewport *view);
+
+/*
+ * set_number_of_threads() changes the number of threads generate_image()
+ * uses, for the kernel benchmark. Returns -1 if the number is not possible.
+ */
+
+int set_number_of_threads(int threads);
+
+/*
+ * last_thread_stats() points stats to the counters of the threads for the
+ * last image and returns the number of threads.
+ */
+
+int last_thread_stats(struct thread_stats **stats);
 
 #endif
@@ -10,6 +10,15 @@
  *                    mandelbrot.c                     mandelbrot.h
  *                    install_signal_handler.c         install_signal_handler.h
  *                    global_ids.c                     global_ids.h
+ *                    sharedSegment.c                  sharedSegment.h
+ *                    pixelFormat.c                    pixelFormat.h
+ *                    viewCommand.c                    viewCommand.h
+ *                    tiles.c                          tiles.h
+ *                    statsPage.c                      statsPage.h
+ *                    latency.c                        latency.h
+ *                    generator_latency.c              generator_latency.h
+ *                    tuning.c                         tuning.h
+ *                    hostCache.c                      hostCache.h
  *                                                     universalSettings.h
  *
  * DEPENDS ON:        imageWriter program
@@ -35,13 +44,20 @@
 #include "generateKey.h"
 #include "global_ids.h"
 #include "numberOfPixel.h"
+#include "sharedSegment.h"
+#include "pixelFormat.h"
+#include "viewCommand.h"
+#include "statsPage.h"
 #include "cntrl_c_handler.h"
 #include "universalSettings.h"
 #include "install_signal_handler.h"
 #include "colorpalette.h"
 #include "mandelbrot.h"
 #include "cleanup.h"
-#include "time.h"
+#include "generator_latency.h"
+#include "trace.h"
+#include "tiles.h"
+#include "tuning.h"
 
 #if OS_FEDORA
 
@@ -68,7 +84,7 @@ int main(int argc, char *argv[])
       printf("\nThis program generates an image of the mandlebrot set and\n"
              "writes the picture into a shared memory segmet. This program\n"
              "depends on the imageWriter program reading from the shared memory"
-             "\nsegment and wirting the image into a .ppm file\n"
+             "\nsegment and writing the image into a .png, .qoi or .ppm file\n"
              "\nThis program does not take any cmdline arguments.\n\n");
       exit(EXIT_SUCCESS);
     }
@@ -89,6 +105,8 @@ int main(int argc, char *argv[])
   g_semid = -1;
   g_membuf = NULL;
   g_buffer = NULL;
+  g_statsid = -1;
+  g_stats = NULL;
 
 /*---------------------------------------------------------------------------*/
 /* I N S T A L L  S I G N A L  H A N D L E R                                 */
@@ -109,6 +127,23 @@ int main(int argc, char *argv[])
     return EXIT_FAILURE;
   }
 
+/*
+ * The image generating threads record into the buffers from 1 on (see
+ * trace.h).
+ */
+
+  trace_thread(0, "main");
+
+/*
+ * The perf counters of the main thread (see perfCounters.h), the image
+ * generating threads open their own.
+ */
+
+  struct perf_counters counters;
+  struct perf_sample perf_generate, perf_generated, perf_published;
+
+  open_perf_counters(&counters);
+
 /*---------------------------------------------------------------------------*/
 /* G E N E R A T E  S H A R E D  M E M O R Y  S E G M E N T                  */
 /*---------------------------------------------------------------------------*/
@@ -128,10 +163,12 @@ int main(int argc, char *argv[])
   }
 
 /*
- * Generating a shared memory segment for MAX_DATA (defined in numberOfPixel.c)
+ * Generating a shared memory segment holding NUMBER_OF_SLOTS images of
+ * up to WIDTH * HEIGHT * MAX_BYTES_PER_PIXEL (see numberOfPixel.c and
+ * pixelFormat.h) bytes each (see sharedSegment.c).
  */
 
-  g_shmid = shmget(key, MAX_DATA, IPC_CREAT | 0600);
+  g_shmid = shmget(key, segment_size(), IPC_CREAT | 0600);
   if (g_shmid >= 0)
   {
     g_membuf = shmat(g_shmid, 0, 0);
@@ -153,33 +190,35 @@ int main(int argc, char *argv[])
 /* G E N E R A T E  S E M A P H O R E S                                      */
 /*---------------------------------------------------------------------------*/
 
-  if ((g_semid = semget(key, 2, IPC_CREAT | 0600)) < 0)
+  if ((g_semid = semget(key, NUMBER_OF_SEMAPHORES, IPC_CREAT | 0600)) < 0)
   {
     perror("semget");
     cleanup();
     return EXIT_FAILURE;
   }
-  struct sembuf s1;
-  struct sembuf s2;
 
   union semun semunion;
 
 /*
- * Setting start values for semaphore one and two.
- * The ImageWriter semaphore gets set to 0 at first which blocks the ImageWriter
- * program from reading data out of the shared memory segment.
+ * Setting start values for the semaphores (see sharedSegment.h).
+ * Every slot is free at first. The semaphore counting the images ready to be
+ * claimed gets set to 0 which blocks the consumers from reading data out of
+ * the shared memory segment.
  */
 
-  semunion.val = 1;
-  if ((semctl(g_semid, 0, SETVAL, semunion)) < 0)
+  for (int slot = 0; slot < NUMBER_OF_SLOTS; slot++)
   {
-    perror("semctl");
-    cleanup();
-    return EXIT_FAILURE;
+    semunion.val = 1;
+    if ((semctl(g_semid, SEM_SLOT_FREE(slot), SETVAL, semunion)) < 0)
+    {
+      perror("semctl");
+      cleanup();
+      return EXIT_FAILURE;
+    }
   }
 
   semunion.val = 0;
-  if ((semctl(g_semid, 1, SETVAL, semunion)) < 0)
+  if ((semctl(g_semid, SEM_FRAMES_READY, SETVAL, semunion)) < 0)
   {
     perror("semctl");
     cleanup();
@@ -187,16 +226,13 @@ int main(int argc, char *argv[])
   }
 
 /*
- * prepare semaphore 1
+ * An old segment left behind by a crashed pixelGenerator would still hold
+ * its image counters.
  */
-  s1.sem_num = 0;
-  s1.sem_flg = SEM_UNDO;
 
-/*
- * prepare semaphore 2
- */
-  s2.sem_num = 1;
-  s2.sem_flg = SEM_UNDO;
+  segment_header(g_membuf)->next_frame = 0;
+  segment_header(g_membuf)->next_claim = 0;
+  reset_view_commands(g_membuf);
 
 /*---------------------------------------------------------------------------*/
 /* G E N E R A T E  C O L O R  P A L E T T E  &  I M A G E  B U F F E R      */
@@ -209,7 +245,7 @@ int main(int argc, char *argv[])
  * Each iteration gets assigned a color (RGB values).
  */
 
-  static unsigned char PALETTE[1024][3];
+  static unsigned char PALETTE[PALETTE_SIZE][3];
 
   if (create_color_palette(PALETTE) != 0)
   {
@@ -218,12 +254,26 @@ int main(int argc, char *argv[])
     return EXIT_FAILURE;
   }
 
+/*
+ * The consumers colorize PIXEL_INDEX16 images with the palette in the shared
+ * memory segment. Until a consumer asks for another pixel format the images
+ * are generated as PIXEL_RGB24 (see pixelFormat.h).
+ */
+
+  memcpy(segment_header(g_membuf)->palette, PALETTE, sizeof(PALETTE));
+  request_pixel_format(g_membuf, PIXEL_RGB24);
+
+  static unsigned char PIXELS[PALETTE_SIZE * MAX_BYTES_PER_PIXEL];
+  int format = -1;
+
 /*
  * Generating a local image buffer where the image is stored before it is
- * written to the shared memory segment.
+ * written to the shared memory segment. It is large enough for every pixel
+ * format.
  */
 
-  g_buffer = (unsigned char *) calloc(MAX_DATA, sizeof(unsigned char));
+  g_buffer = (unsigned char *) calloc(pixel_data_size(PIXEL_XRGB8888),
+                                      sizeof(unsigned char));
   if (g_buffer == NULL)
   {
     perror("calloc");
@@ -231,90 +281,176 @@ int main(int argc, char *argv[])
     return EXIT_FAILURE;
   }
 
+/*
+ * The section of the mandelbrot set, changed by generate_image() (automatic
+ * zoom) or by the view_commands of a consumer (see viewCommand.h).
+ */
+
+  static struct viewport view;
+  init_viewport(&view);
+
+/*
+ * An image is cancelled as soon as a view_command arrives and published with
+ * the tiles finished so far, the tiles around the center (see mandelbrot.c).
+ */
+
+  view.cancellable = 1;
+  int slot;
+
+/*
+ * The tile size and number of threads the kernel autotuner has measured on
+ * this host (see tuning.h), the defaults if it has not been run.
+ */
+
+  struct tuning tuning;
+  if (load_tuning(GENERATOR_BACKEND, &tuning) == 0)
+  {
+    if (set_tile_size(tuning.tile_size) != 0 ||
+        (tuning.threads > 0 && set_number_of_threads(tuning.threads) != 0))
+    {
+      printf("Error applying the tuning, run the autotuner again\n");
+      cleanup();
+      return EXIT_FAILURE;
+    }
+  }
+
+/*
+ * The counters of the threads are published after every image in a shared
+ * memory segment of their own (see statsPage.h), read by generatorTop.
+ * Without it the images are generated all the same.
+ */
+
+  g_stats = create_stats_page(GENERATOR_BACKEND, &g_statsid);
+  if (g_stats == NULL)
+  {
+    printf("Error creating the stats page, continuing without stats\n");
+  }
+
 /*---------------------------------------------------------------------------*/
 /* G E N E R A T E  I M A G E  D A T A                                       */
 /*                                                                           */
 /* W R I T E  I M A G E  T O  S H A R E D  M E M O R Y                       */
 /*---------------------------------------------------------------------------*/
 
-  #if TIMER_OUTPUT
-
-  clock_t start;
-  clock_t diff;
-  int countimage = 1;
-
-  #endif
-
-
   while (1)
   {
 
 /*
- * TIMER_OUTPUT can be set to 1 = ON in universalSettings.c
+ * The stages of every image are timed (see generator_latency.c), the
+ * timestamps are passed on to the consumers in the frame_header.
  */
 
-    #if TIMER_OUTPUT
+    struct frame_times times;
 
-    start = clock();
+/*
+ * Fill the table of pixels with the format the consumers asked for, the
+ * image is generated in this format.
+ */
 
-    #endif
+    if (requested_pixel_format(g_membuf) != format)
+    {
+      format = requested_pixel_format(g_membuf);
+      if (make_pixel_table(format, PALETTE, PIXELS) != 0)
+      {
+        cleanup();
+        return EXIT_FAILURE;
+      }
+      printf("Generating images as %s\n", pixel_format_name(format));
+    }
 
 /*
- * generate_image() (defined in mandelbrot.c) creates image data and writes it
- * to the local buffer.
+ * wait until the slot of the next image is free, before the image is
+ * generated, so it shows the latest view_commands sent while waiting
  */
 
-    if (generate_image(PALETTE, g_buffer) == -1)
+    times.acquire = stats_clock();
+    if (acquire_slot(g_semid, g_membuf, &slot) == -1)
     {
-      printf("Error generating image data\n");
+      perror("semop");
       cleanup();
       return EXIT_FAILURE;
     }
+    times.generate = stats_clock();
+    read_perf_counters(&counters, &perf_generate);
 
-    #if TIMER_OUTPUT
+/*
+ * Apply the view_commands a consumer has sent since the last image.
+ */
 
-    diff = clock() - start;
-    int msec = diff * 1000 / CLOCKS_PER_SEC;
-    printf("Time needed for image %d\t%d seconds %d milliseconds\n", countimage,
-           msec/1000, msec%1000);
-    countimage++;
+    struct view_command command;
 
-    #endif
+    while (receive_view_command(g_membuf, &command) == 0)
+    {
+      apply_view_command(&view, &command);
+    }
 
 /*
- * lock semaphore 1
+ * generate_image() (defined in mandelbrot.c) creates image data and writes it
+ * to the local buffer.
  */
 
-    s1.sem_op = -1;
-
-    if (semop(g_semid, &s1, 1) == -1)
+    long long image_start = stats_clock();
+    int generated = generate_image(PIXELS, bytes_per_pixel(format), g_buffer,
+                                   &view);
+    if (generated == -1)
     {
-      perror("semop");
+      printf("Error generating image data\n");
       cleanup();
       return EXIT_FAILURE;
     }
 
+    if (g_stats != NULL)
+    {
+      struct thread_stats *stats;
+      int threads = last_thread_stats(&stats);
+      publish_stats(g_stats, stats, threads, stats_clock() - image_start);
+    }
+
+    times.generated = stats_clock();
+    read_perf_counters(&counters, &perf_generated);
+
 /*
- * Writing the local buffer to the shared memory segment
+ * Writing the local buffer to the slot in the shared memory segment
  */
 
-    for (int i = 0; i < MAX_DATA; i++)
+    unsigned char *slotbuf = slot_data(g_membuf, slot);
+    size_t size = pixel_data_size(format);
+
+    for (int i = 0; i < size; i++)
     {
-        g_membuf[i] = g_buffer[i];
+        slotbuf[i] = g_buffer[i];
     }
+    slot_header(g_membuf, slot)->pixel_format = format;
+    slot_header(g_membuf, slot)->input_time = view.input_time;
+    slot_header(g_membuf, slot)->commands_applied = view.commands;
+    slot_header(g_membuf, slot)->tiles_done = generated;
+    slot_header(g_membuf, slot)->tile_size = tile_size();
+    slot_header(g_membuf, slot)->partial = (generated < number_of_tiles());
+    view.input_time = 0;
+    times.published = stats_clock();
+    read_perf_counters(&counters, &perf_published);
+    slot_header(g_membuf, slot)->times = times;
 
 /*
- * unlock semaphore 2
+ * hand the image to the consumers
  */
 
-    s2.sem_op = 1;
-
-    if (semop(g_semid, &s2, 1) == -1)
+    if (publish_slot(g_semid, g_membuf, slot) == -1)
     {
       perror("semop");
       cleanup();
       return EXIT_FAILURE;
     }
+    record_generator_perf(PERF_STAGE_COMPUTE, &counters, &perf_generate,
+                          &perf_generated, 1);
+    record_generator_perf(PERF_STAGE_COPY, &counters, &perf_generated,
+                          &perf_published, 1);
+    record_generator_latency(&times);
+
+    unsigned long framenumber = slot_header(g_membuf, slot)->framenumber;
+    trace_event("slot wait", times.acquire, times.generate, framenumber);
+    trace_event("compute", times.generate, times.generated, framenumber);
+    trace_event("copy", times.generated, times.published, framenumber);
   }
 
 /*
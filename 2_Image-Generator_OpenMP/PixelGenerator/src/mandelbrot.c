@@ -4,9 +4,17 @@
  * RELATED FILES:     *.c                              *.h
  *                    numberOfPixel.c                  numberOfPixel.h
  *
- * This function takes a colorpalette created by the function
- * create_color_palette() and the unsigned char *pointer to a local imagebuffer
- * as arguments.
+ * This function takes a table holding one pixel for every number of iterations
+ * (see pixelFormat.c), the number of bytes per pixel, the unsigned char
+ * *pointer to a local imagebuffer and the section of the mandelbrot set
+ * (see viewCommand.h) as arguments.
+ *
+ * The image is generated in tiles (see tiles.c), starting at the center of
+ * the image. generate_image returns the number of tiles generated, -1 on
+ * error. If view->cancellable is set the remaining tiles are skipped as soon
+ * as a consumer has sent a new view_command. The image is incomplete, only
+ * the first tiles of the center-out order show the section, the other pixels
+ * still hold the image before.
  *
  * The generate_image function uses OpenMP to generate the mandelbrot set.
  *
@@ -17,7 +25,15 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include "numberOfPixel.h"
+#include "global_ids.h"
+#include "viewCommand.h"
+#include "tiles.h"
+#include "statsPage.h"
+#include "mandelbrot.h"
+#include "trace.h"
+#include "generator_latency.h"
 
 /*
  * A great introduction to OpenMP:
@@ -31,7 +47,73 @@
   #include <omp.h>
 #endif
 
-int generate_image(unsigned char palette[][3], unsigned char *imagebuffer)
+/*
+ * counters of every thread for the last image, one cache line each. Threads
+ * with a number from STATS_MAX_THREADS on are not counted.
+ */
+
+static struct thread_stats g_thread_stats[STATS_MAX_THREADS];
+
+/*
+ * The threads of the team count their tiles with their own perf counters
+ * (see perfCounters.h), opened with their first tile and kept open as the
+ * team is kept. Thread 0 is the main thread, its counters cover the whole
+ * image (see PixelGenerator.c), so it does not count single tiles.
+ */
+
+static __thread struct perf_counters g_counters;
+static __thread int g_counters_opened = 0;
+
+static struct perf_counters *worker_counters(void)
+{
+  #if OPENMP
+  if (!PERF_COUNTERS || omp_get_thread_num() == 0)
+  {
+    return NULL;
+  }
+  if (!g_counters_opened)
+  {
+    open_perf_counters(&g_counters);
+    g_counters_opened = 1;
+  }
+  return &g_counters;
+  #else
+  return NULL;
+  #endif
+}
+
+static int stats_threads(void)
+{
+  #if OPENMP
+  int threads = omp_get_max_threads();
+  return (threads < STATS_MAX_THREADS) ? threads : STATS_MAX_THREADS;
+  #else
+  return 1;
+  #endif
+}
+
+int last_thread_stats(struct thread_stats **stats)
+{
+  *stats = g_thread_stats;
+  return stats_threads();
+}
+
+int set_number_of_threads(int threads)
+{
+  if (threads < 1)
+  {
+    return -1;
+  }
+  #if OPENMP
+  omp_set_num_threads(threads);
+  return 0;
+  #else
+  return (threads == 1) ? 0 : -1;
+  #endif
+}
+
+int generate_image(unsigned char *pixels, int bpp, unsigned char *imagebuffer,
+                   struct viewport *view)
 {
 
 /*
@@ -39,21 +121,33 @@ int generate_image(unsigned char palette[][3], unsigned char *imagebuffer)
  */
 
   const int MAX_ITERATION = 1023;
-  static double xmin = -2.5;
-  static double xmax = 1.5;
-  static double ymin = -1.5;
-  static double ymax = 1.5;
+  double xmin = view->xmin;
+  double xmax = view->xmax;
+  double ymax = view->ymax;
+  double zoom = view->zoom;
 
   int mandel_segment = 2;
 
-  static double e = 1;
-
-  static double zoom = 1;
   double xp;
   xp = ((xmax - xmin) / WIDTH);
   double yp;
-  yp = ((ymax - ymin) / HEIGHT);
+  yp = ((view->ymax - view->ymin) / HEIGHT);
+
+/*
+ * An OpenMP loop can not be left with break, the tiles after a new
+ * view_command are skipped instead. The tile in the center is always
+ * generated, so every image shows a part of the new section. Tiles after
+ * the first skipped one may have been generated, but are not counted.
+ */
+
+  int tiles_done = number_of_tiles();
+
+  if (init_tiles() != 0)
+  {
+    return -1;
+  }
 
+  memset(g_thread_stats, 0, sizeof(struct thread_stats) * stats_threads());
 
   #if OPENMP
   static int numthreads = 0;
@@ -62,27 +156,53 @@ int generate_image(unsigned char palette[][3], unsigned char *imagebuffer)
     numthreads = omp_get_max_threads();
     printf("%d threads\n", numthreads);
   }
-  #pragma omp parallel for
+  #pragma omp parallel for schedule(dynamic) reduction(min:tiles_done)
   #endif
 
-  for (int pixel_y = 0; pixel_y < HEIGHT; pixel_y++)
+  for (int order = 0; order < number_of_tiles(); order++)
   {
-    for (int pixel_x = 0; pixel_x < WIDTH; pixel_x++)
+    if (order > 0 && view->cancellable && view_commands_pending(g_membuf))
     {
-      double x0;
-      x0 = ((xmin + (pixel_x * xp)) / zoom);
+      if (order < tiles_done)
+      {
+        tiles_done = order;
+      }
+      continue;
+    }
 
-      double y0;
-      y0 = ((ymax - (pixel_y * yp)) / zoom);
+    long long tile_start = stats_clock();
+    struct perf_counters *counters = worker_counters();
+    struct perf_sample perf_start, perf_end;
+    unsigned long long iterations = 0;
+    unsigned long long cardioid = 0;
+    unsigned long long bulb = 0;
 
-      double x;
-      x = 0.0;
+    int start_x, stop_x, start_y, stop_y;
+    tile_bounds(order, &start_x, &stop_x, &start_y, &stop_y);
 
-      double y;
-      y = 0.0;
+    if (counters != NULL)
+    {
+      read_perf_counters(counters, &perf_start);
+    }
 
-      int iteration;
-      iteration = 0;
+    for (int pixel_y = start_y; pixel_y < stop_y; pixel_y++)
+    {
+      for (int pixel_x = start_x; pixel_x < stop_x; pixel_x++)
+      {
+        double x0;
+        x0 = ((xmin + (pixel_x * xp)) / zoom);
+
+        double y0;
+        y0 = ((ymax - (pixel_y * yp)) / zoom);
+
+        double x;
+        x = 0.0;
+
+        double y;
+        y = 0.0;
+
+        int iteration;
+        iteration = 0;
 
 /*---------------------------------------------------------------------------*/
 /* C A R D I O I D  A N D  B U L B  C H E C K I N G                          */
@@ -94,69 +214,109 @@ int generate_image(unsigned char palette[][3], unsigned char *imagebuffer)
  * "One way to improve calculations is to find out beforehand whether the given
  * point lies within the cardioid or in the period-2 bulb."
  */
-      double q;
-      q = (x0 - 0.25) * (x0 - 0.25) + (y0 * y0);
+        double q;
+        q = (x0 - 0.25) * (x0 - 0.25) + (y0 * y0);
 
-      if (((q * (q + (x0 - 0.25))) < (0.25 * (y0 * y0))) ||
-         (((x0 + 1) * (x0 + 1) + (y0 * y0)) < (0.0625)))
-      {
-        iteration = MAX_ITERATION;
-        imagebuffer[(pixel_y * WIDTH * 3 + (3 * pixel_x))] =
-                    palette[iteration][0];
-        imagebuffer[(pixel_y * WIDTH * 3 + (3 * pixel_x) + 1)] =
-                    palette[iteration][1];
-        imagebuffer[(pixel_y * WIDTH * 3 + (3 * pixel_x) + 2)] =
-                    palette[iteration][2];
-        continue;
-      }
+        int in_cardioid;
+        in_cardioid = ((q * (q + (x0 - 0.25))) < (0.25 * (y0 * y0)));
+
+        if (in_cardioid ||
+           (((x0 + 1) * (x0 + 1) + (y0 * y0)) < (0.0625)))
+        {
+          cardioid += in_cardioid;
+          bulb += !in_cardioid;
+          iteration = MAX_ITERATION;
+          memcpy(&imagebuffer[(pixel_y * WIDTH + pixel_x) * bpp],
+                 &pixels[iteration * bpp], bpp);
+          continue;
+        }
 
 /*---------------------------------------------------------------------------*/
 /* C A L C U L A T I N G  T H E  M A N D E L B R O T  S E T                  */
 /*---------------------------------------------------------------------------*/
 
-      while ((((x * x) + (y * y)) < 4) && (iteration < MAX_ITERATION))
-      {
-        double xtemp;
-        xtemp = ((x * x) - (y * y) + x0);
+        while ((((x * x) + (y * y)) < 4) && (iteration < MAX_ITERATION))
+        {
+          double xtemp;
+          xtemp = ((x * x) - (y * y) + x0);
 
-        y = ((2 * x * y) + y0);
-        x = xtemp;
-        iteration = iteration + 1;
+          y = ((2 * x * y) + y0);
+          x = xtemp;
+          iteration = iteration + 1;
+        }
+        iterations += iteration;
+        memcpy(&imagebuffer[(pixel_y * WIDTH + pixel_x) * bpp],
+               &pixels[iteration * bpp], bpp);
       }
-      imagebuffer[(pixel_y * WIDTH * 3 + (3 * pixel_x))] =
-                  palette[iteration][0];
-      imagebuffer[(pixel_y * WIDTH * 3 + (3 * pixel_x) + 1)] =
-                  palette[iteration][1];
-      imagebuffer[(pixel_y * WIDTH * 3 + (3 * pixel_x) + 2)] =
-                  palette[iteration][2];
+    }
+
+    #if OPENMP
+    int thread = omp_get_thread_num();
+    #else
+    int thread = 0;
+    #endif
+
+    if (thread < STATS_MAX_THREADS)
+    {
+      struct thread_stats *stats = &g_thread_stats[thread];
+      stats->pixels += (stop_x - start_x) * (stop_y - start_y);
+      stats->iterations += iterations;
+      stats->lane_iterations += iterations;
+      stats->cardioid += cardioid;
+      stats->bulb += bulb;
+      stats->tiles++;
+      stats->busy_ns += stats_clock() - tile_start;
+    }
+
+/*
+ * Thread 0 of the team is the main thread, it keeps buffer 0 of the trace
+ * (see trace.h).
+ */
+
+    if (thread != 0)
+    {
+      trace_thread(thread + 1, "worker");
+    }
+    trace_event("tile", tile_start, stats_clock(), order);
+
+    if (counters != NULL)
+    {
+      read_perf_counters(counters, &perf_end);
+      record_generator_perf(PERF_STAGE_COMPUTE, counters, &perf_start,
+                            &perf_end, 0);
     }
   }
 
+  if (tiles_done < number_of_tiles() || !view->automatic)
+  {
+    return tiles_done;
+  }
+
   if (mandel_segment == 1)
   {
-    xmin = xmin - 0.005 * e;
-    xmax = xmax - 0.005 * e;
-    ymin = ymin - 0.0062 * e;
-    ymax = ymax - 0.0062 * e;
-    zoom = zoom + 0.01 * e;
-    e++;
+    view->xmin = view->xmin - 0.005 * view->e;
+    view->xmax = view->xmax - 0.005 * view->e;
+    view->ymin = view->ymin - 0.0062 * view->e;
+    view->ymax = view->ymax - 0.0062 * view->e;
+    view->zoom = view->zoom + 0.01 * view->e;
+    view->e++;
   }
 
   if (mandel_segment == 2)
   {
-    xmin = xmin - 0.014 * e;
-    xmax = xmax - 0.014 * e;
-    zoom = zoom + 0.01 * e;
-    e++;
+    view->xmin = view->xmin - 0.014 * view->e;
+    view->xmax = view->xmax - 0.014 * view->e;
+    view->zoom = view->zoom + 0.01 * view->e;
+    view->e++;
   }
 
   if (mandel_segment == 3)
   {
-    xmin = xmin - 0.015 * e;
-    xmax = xmax - 0.015 * e;
-    zoom = zoom + 0.01 * e;
-    e++;
+    view->xmin = view->xmin - 0.015 * view->e;
+    view->xmax = view->xmax - 0.015 * view->e;
+    view->zoom = view->zoom + 0.01 * view->e;
+    view->e++;
   }
 
-  return 0;
+  return tiles_done;
 }
@@ -0,0 +1,77 @@
+/*
+ * FILE = HEADER: /include/statsPage.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _statsPage_
+#define _statsPage_
+
+#include <sys/types.h>
+
+/*
+ * Counters of the threads generating the images. Every thread adds to its
+ * own struct thread_stats once per tile (see thread_handler.c), the structs
+ * take a cache line each, so the threads do not slow each other down.
+ *
+ * iterations counts the iterations of the escape loop every pixel needed.
+ * lane_iterations counts the iterations computed, the SIMD versions compute
+ * 2 or 4 pixels until the last of them has escaped, the lanes of the pixels
+ * which escaped earlier are wasted. For one pixel at a time both are equal.
+ * cardioid and bulb count the pixels found by the cardioid and bulb check.
+ */
+
+#define STATS_CACHE_LINE 64
+#define STATS_MAX_THREADS 64
+#define STATS_BACKEND_LENGTH 16
+
+struct thread_stats
+{
+  unsigned long long pixels;
+  unsigned long long iterations;
+  unsigned long long lane_iterations;
+  unsigned long long cardioid;
+  unsigned long long bulb;
+  unsigned long long tiles;
+  unsigned long long busy_ns;      // time spent generating tiles
+} __attribute__((aligned(STATS_CACHE_LINE)));
+
+/*
+ * The pixelGenerator publishes the counters once per image in a shared memory
+ * segment of its own, readers (generatorTop) attach it read only.
+ * last holds the counters of the last image, total the counters since the
+ * pixelGenerator has started.
+ *
+ * sequence is odd while the pixelGenerator writes, a reader copies the page
+ * until sequence is even and has not changed (see read_stats()).
+ */
+
+struct stats_page
+{
+  unsigned long sequence;
+  char backend[STATS_BACKEND_LENGTH];
+  int number_of_threads;           // threads of the last image
+  unsigned long images;
+  long long image_ns;              // wall time of the last image
+  long long total_ns;              // wall time of all images
+  struct thread_stats last[STATS_MAX_THREADS];
+  struct thread_stats total[STATS_MAX_THREADS];
+};
+
+key_t generate_stats_key(void);
+long long stats_clock(void);
+
+struct stats_page *create_stats_page(const char *backend, int *shmid);
+void remove_stats_page(struct stats_page *page, int shmid);
+struct stats_page *attach_stats_page(void);
+
+void set_stats_backend(struct stats_page *page, const char *backend);
+void publish_stats(struct stats_page *page, const struct thread_stats *threads,
+                   int number_of_threads, long long image_ns);
+void read_stats(const struct stats_page *page, struct stats_page *copy);
+void add_thread_stats(struct thread_stats *sum, const struct thread_stats *add);
+
+#endif
@@ -0,0 +1,46 @@
+/*
+ * FILE = HEADER: /include/tiles.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _tiles_
+#define _tiles_
+
+/*
+ * The image is generated in tiles of TILE_SIZE x TILE_SIZE pixels, the tiles
+ * closest to the center of the image first. TILE_SIZE has to be a multiple
+ * of the number of pixels generated at once by the SIMD versions (4), so
+ * has WIDTH. The tiles in the last column and row may be cut off.
+ *
+ * set_tile_size() replaces TILE_SIZE with the size the kernel autotuner has
+ * measured (see tuning.h) before the next image, it returns -1 if size is
+ * not possible. The pixelGenerator puts the size of every image into its
+ * frame_header, so the consumers find the same tiles.
+ */
+
+#define TILE_SIZE 32
+
+/*
+ * The tiles of one image are taken by the threads one after another,
+ * next is the index into the center-out order of the next tile.
+ */
+
+struct tile_queue
+{
+  int next;
+};
+
+int set_tile_size(int size);
+int tile_size(void);
+int init_tiles(void);
+int number_of_tiles(void);
+void reset_tiles(struct tile_queue *queue);
+int next_tile(struct tile_queue *queue);
+void tile_bounds(int order, int *start_x, int *stop_x, int *start_y,
+                 int *stop_y);
+
+#endif
@@ -0,0 +1,197 @@
+/*
+ * FILE = /src/statsPage.c
+ *
+ * This file holds the shared memory segment in which the pixelGenerator
+ * publishes the counters of its threads (see statsPage.h).
+ * This file is used by the pixelGenerator and the generatorTop program.
+ *
+ * The segment has a key of its own (generate_stats_key()), the images do not
+ * wait for it and consumers do not need it. A reader never blocks the
+ * pixelGenerator: the page is published like a seqlock, the reader copies it
+ * again if the pixelGenerator has written to it in the meantime.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include "statsPage.h"
+
+key_t generate_stats_key(void)
+{
+  key_t key;
+  key = ftok("/etc", 's');
+  if (key == -1)
+  {
+    perror("ftok");
+  }
+  return key;
+}
+
+long long stats_clock(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (long long) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/*
+ * create_stats_page() creates and attaches the segment, returns NULL on error.
+ * *shmid is -1 unless the segment has been created.
+ */
+
+struct stats_page *create_stats_page(const char *backend, int *shmid)
+{
+  key_t key = generate_stats_key();
+
+  *shmid = -1;
+  if (key == -1)
+  {
+    return NULL;
+  }
+
+  *shmid = shmget(key, sizeof(struct stats_page), IPC_CREAT | 0644);
+  if (*shmid < 0)
+  {
+    perror("shmget");
+    return NULL;
+  }
+
+  struct stats_page *page = shmat(*shmid, 0, 0);
+  if (page == (struct stats_page *) -1)
+  {
+    perror("shmat");
+    return NULL;
+  }
+
+  memset(page, 0, sizeof(struct stats_page));
+  snprintf(page->backend, sizeof(page->backend), "%s", backend);
+  return page;
+}
+
+void remove_stats_page(struct stats_page *page, int shmid)
+{
+  if (shmid != -1 && shmctl(shmid, IPC_RMID, 0) < 0)
+  {
+    perror("shmctl");
+  }
+  if (page != NULL && shmdt(page) < 0)
+  {
+    perror("shmdt");
+  }
+}
+
+/*
+ * attach_stats_page() attaches the segment of a running pixelGenerator read
+ * only, returns NULL if there is none.
+ */
+
+struct stats_page *attach_stats_page(void)
+{
+  key_t key = generate_stats_key();
+  if (key == -1)
+  {
+    return NULL;
+  }
+
+  int shmid = shmget(key, sizeof(struct stats_page), 0);
+  if (shmid < 0)
+  {
+    return NULL;
+  }
+
+  struct stats_page *page = shmat(shmid, 0, SHM_RDONLY);
+  if (page == (struct stats_page *) -1)
+  {
+    perror("shmat");
+    return NULL;
+  }
+  return page;
+}
+
+void add_thread_stats(struct thread_stats *sum, const struct thread_stats *add)
+{
+  sum->pixels += add->pixels;
+  sum->iterations += add->iterations;
+  sum->lane_iterations += add->lane_iterations;
+  sum->cardioid += add->cardioid;
+  sum->bulb += add->bulb;
+  sum->tiles += add->tiles;
+  sum->busy_ns += add->busy_ns;
+}
+
+/*
+ * set_stats_backend() changes the name of the image generator, when the
+ * pixelGenerator switches its backend (see backend.h).
+ */
+
+void set_stats_backend(struct stats_page *page, const char *backend)
+{
+  page->sequence++;
+  __sync_synchronize();
+  snprintf(page->backend, sizeof(page->backend), "%s", backend);
+  __sync_synchronize();
+  page->sequence++;
+}
+
+/*
+ * publish_stats() is called by the pixelGenerator after every image with the
+ * counters of its threads for this image.
+ */
+
+void publish_stats(struct stats_page *page, const struct thread_stats *threads,
+                   int number_of_threads, long long image_ns)
+{
+  if (number_of_threads > STATS_MAX_THREADS)
+  {
+    number_of_threads = STATS_MAX_THREADS;
+  }
+
+  page->sequence++;
+  __sync_synchronize();
+
+  for (int t = 0; t < number_of_threads; t++)
+  {
+    page->last[t] = threads[t];
+    add_thread_stats(&page->total[t], &threads[t]);
+  }
+  for (int t = number_of_threads; t < page->number_of_threads; t++)
+  {
+    memset(&page->last[t], 0, sizeof(struct thread_stats));
+  }
+  page->number_of_threads = number_of_threads;
+  page->images++;
+  page->image_ns = image_ns;
+  page->total_ns += image_ns;
+
+  __sync_synchronize();
+  page->sequence++;
+}
+
+void read_stats(const struct stats_page *page, struct stats_page *copy)
+{
+  for (;;)
+  {
+    unsigned long sequence = *(volatile unsigned long *) &page->sequence;
+    __sync_synchronize();
+    if ((sequence & 1) == 0)
+    {
+      memcpy(copy, page, sizeof(struct stats_page));
+      __sync_synchronize();
+      if (*(volatile unsigned long *) &page->sequence == sequence)
+      {
+        return;
+      }
+    }
+    sched_yield();
+  }
+}
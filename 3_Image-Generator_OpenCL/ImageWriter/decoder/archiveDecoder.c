@@ -0,0 +1,382 @@
+/*
+ * FILE = /decoder/archiveDecoder.c
+ *
+ * Reads the archives written by the imageWriter with OUTPUT_ARCHIVE
+ * (see archive.c) and exports images as p6 ppm files.
+ *
+ * usage: ./archiveDecoder.out <archive> list
+ *        ./archiveDecoder.out <archive> export <image number> [file]
+ *        ./archiveDecoder.out <archive> export-all
+ *
+ * To export an image the decoder looks up the image in the index, decodes
+ * the keyframe before it and applies the delta frames up to the image.
+ * An archive without index is scanned frame by frame.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "archiveFormat.h"
+
+struct index_entry
+{
+  unsigned long long framenumber;
+  unsigned long long offset;
+  int type;
+};
+
+static FILE *g_archive = NULL;
+static int g_width;
+static int g_height;
+static int g_tile_size;
+static struct index_entry *g_index = NULL;
+static unsigned long g_frames = 0;
+
+static unsigned char *g_image = NULL;
+static unsigned char *g_data = NULL;
+static size_t g_data_size = 0;
+
+static long long clock_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int read_at(unsigned long long offset, void *buffer, size_t length)
+{
+  if (fseeko(g_archive, (off_t) offset, SEEK_SET) != 0 ||
+      fread(buffer, 1, length, g_archive) != length)
+  {
+    return -1;
+  }
+  return 0;
+}
+
+static int add_entry(unsigned long long framenumber, unsigned long long offset,
+                     int type, unsigned long *size)
+{
+  if (g_frames == *size)
+  {
+    *size = *size ? 2 * *size : 1024;
+    struct index_entry *index = (struct index_entry *)
+                                realloc(g_index, *size * sizeof(struct index_entry));
+    if (index == NULL)
+    {
+      perror("realloc");
+      return -1;
+    }
+    g_index = index;
+  }
+  g_index[g_frames].framenumber = framenumber;
+  g_index[g_frames].offset = offset;
+  g_index[g_frames].type = type;
+  g_frames++;
+  return 0;
+}
+
+/*
+ * load_index() reads the index at the end of the archive. If there is none
+ * the frame records are scanned from the start.
+ */
+
+static int load_index(void)
+{
+  unsigned char trailer[ARCHIVE_TRAILER_SIZE];
+  unsigned char entry[ARCHIVE_INDEX_ENTRY_SIZE];
+  unsigned long size = 0;
+
+  if (fseeko(g_archive, 0, SEEK_END) != 0)
+  {
+    perror("fseeko");
+    return -1;
+  }
+  unsigned long long file_size = ftello(g_archive);
+
+  if (file_size >= ARCHIVE_HEADER_SIZE + ARCHIVE_TRAILER_SIZE &&
+      read_at(file_size - ARCHIVE_TRAILER_SIZE, trailer, sizeof(trailer)) == 0 &&
+      memcmp(trailer + 12, ARCHIVE_INDEX_MAGIC, 4) == 0)
+  {
+    unsigned long long offset = get_le64(trailer);
+    unsigned long count = get_le32(trailer + 8);
+
+    if (offset + (unsigned long long) count * ARCHIVE_INDEX_ENTRY_SIZE +
+        ARCHIVE_TRAILER_SIZE == file_size)
+    {
+      for (unsigned long i = 0; i < count; i++)
+      {
+        if (read_at(offset + i * ARCHIVE_INDEX_ENTRY_SIZE, entry,
+                    sizeof(entry)) != 0 ||
+            add_entry(get_le64(entry), get_le64(entry + 8), entry[16],
+                      &size) != 0)
+        {
+          return -1;
+        }
+      }
+      return 0;
+    }
+  }
+
+  printf("Archive has no index, scanning frames\n");
+
+  unsigned char record[ARCHIVE_RECORD_SIZE];
+  unsigned long long offset = ARCHIVE_HEADER_SIZE;
+  while (read_at(offset, record, sizeof(record)) == 0 &&
+         (record[0] == FRAME_KEY || record[0] == FRAME_DELTA))
+  {
+    unsigned long long length = get_le64(record + 12);
+    if (offset + ARCHIVE_RECORD_SIZE + length > file_size)
+    {
+      break;
+    }
+    if (add_entry(get_le64(record + 4), offset, record[0], &size) != 0)
+    {
+      return -1;
+    }
+    offset += ARCHIVE_RECORD_SIZE + length;
+  }
+  return 0;
+}
+
+static int open_archive(char *path)
+{
+  unsigned char header[ARCHIVE_HEADER_SIZE];
+
+  g_archive = fopen(path, "rb");
+  if (g_archive == NULL)
+  {
+    perror(path);
+    return -1;
+  }
+  if (read_at(0, header, sizeof(header)) != 0 ||
+      memcmp(header, ARCHIVE_MAGIC, 4) != 0)
+  {
+    printf("%s is not an image archive\n", path);
+    return -1;
+  }
+
+  g_width = get_le32(header + 4);
+  g_height = get_le32(header + 8);
+  g_tile_size = get_le32(header + 12);
+  if (g_width <= 0 || g_height <= 0 || g_tile_size <= 0 ||
+      g_tile_size > MAX_TILE_SIZE)
+  {
+    printf("Invalid archive header\n");
+    return -1;
+  }
+
+  g_image = (unsigned char *) calloc((size_t) g_width * g_height, 3);
+  if (g_image == NULL)
+  {
+    perror("calloc");
+    return -1;
+  }
+  return load_index();
+}
+
+/*
+ * decode_frame() applies frame i of the index to g_image.
+ */
+
+static int decode_frame(unsigned long i)
+{
+  unsigned char record[ARCHIVE_RECORD_SIZE];
+
+  if (read_at(g_index[i].offset, record, sizeof(record)) != 0)
+  {
+    printf("Error reading image %llu\n", g_index[i].framenumber);
+    return -1;
+  }
+  size_t length = get_le64(record + 12);
+  if (length > g_data_size)
+  {
+    unsigned char *data = (unsigned char *) realloc(g_data, length);
+    if (data == NULL)
+    {
+      perror("realloc");
+      return -1;
+    }
+    g_data = data;
+    g_data_size = length;
+  }
+  if (fread(g_data, 1, length, g_archive) != length)
+  {
+    printf("Error reading image %llu\n", g_index[i].framenumber);
+    return -1;
+  }
+
+  const unsigned char *in = g_data;
+  const unsigned char *end = g_data + length;
+  int delta = (record[0] == FRAME_DELTA);
+  size_t stride = (size_t) g_width * 3;
+
+  for (int y = 0; y < g_height; y += g_tile_size)
+  {
+    int tile_height = g_height - y < g_tile_size ? g_height - y : g_tile_size;
+    for (int x = 0; x < g_width; x += g_tile_size)
+    {
+      int tile_width = g_width - x < g_tile_size ? g_width - x : g_tile_size;
+      if (decode_tile(&in, end, g_image + y * stride + (size_t) x * 3, delta,
+                      g_width, tile_width, tile_height) != 0)
+      {
+        printf("Image %llu is damaged\n", g_index[i].framenumber);
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+static int write_ppm(char *name)
+{
+  FILE *file = fopen(name, "wb");
+  if (file == NULL)
+  {
+    perror(name);
+    return -1;
+  }
+  fprintf(file, "P6\n# Mandelbrot set\n%d %d\n255\n", g_width, g_height);
+  size_t size = (size_t) g_width * g_height * 3;
+  int ret = (fwrite(g_image, 1, size, file) == size) ? 0 : -1;
+  if (fclose(file) != 0 || ret != 0)
+  {
+    printf("Error writing %s\n", name);
+    return -1;
+  }
+  return 0;
+}
+
+static void list(void)
+{
+  unsigned long keyframes = 0;
+
+  printf("%d x %d pixels, tiles of %d x %d pixels\n", g_width, g_height,
+         g_tile_size, g_tile_size);
+  for (unsigned long i = 0; i < g_frames; i++)
+  {
+    printf("image %6llu  %s  offset %llu\n", g_index[i].framenumber,
+           g_index[i].type == FRAME_KEY ? "keyframe" : "delta   ",
+           g_index[i].offset);
+    keyframes += (g_index[i].type == FRAME_KEY);
+  }
+  printf("%lu images, %lu keyframes\n", g_frames, keyframes);
+}
+
+static int export_image(unsigned long long framenumber, char *name)
+{
+  unsigned long i = 0;
+  while (i < g_frames && g_index[i].framenumber != framenumber)
+  {
+    i++;
+  }
+  if (i == g_frames)
+  {
+    printf("Image %llu is not in the archive\n", framenumber);
+    return -1;
+  }
+
+  unsigned long key = i;
+  while (key > 0 && g_index[key].type != FRAME_KEY)
+  {
+    key--;
+  }
+  if (g_index[key].type != FRAME_KEY)
+  {
+    printf("No keyframe before image %llu\n", framenumber);
+    return -1;
+  }
+
+  long long start = clock_ns();
+  for (unsigned long f = key; f <= i; f++)
+  {
+    if (decode_frame(f) != 0)
+    {
+      return -1;
+    }
+  }
+  printf("Decoded %lu frames in %.1f ms\n", i - key + 1,
+         (clock_ns() - start) / 1e6);
+
+  char buffer[64];
+  if (name == NULL)
+  {
+    snprintf(buffer, sizeof(buffer), "image-%03llu.ppm", framenumber);
+    name = buffer;
+  }
+  return write_ppm(name);
+}
+
+static int export_all(void)
+{
+  char name[64];
+
+  for (unsigned long i = 0; i < g_frames; i++)
+  {
+    if (i == 0 && g_index[i].type != FRAME_KEY)
+    {
+      printf("Archive does not start with a keyframe\n");
+      return -1;
+    }
+    snprintf(name, sizeof(name), "image-%03llu.ppm", g_index[i].framenumber);
+    if (decode_frame(i) != 0 || write_ppm(name) != 0)
+    {
+      return -1;
+    }
+  }
+  printf("Exported %lu images\n", g_frames);
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc < 3)
+  {
+    printf("usage: %s <archive> list\n"
+           "       %s <archive> export <image number> [file]\n"
+           "       %s <archive> export-all\n", argv[0], argv[0], argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  int ret = -1;
+  if (open_archive(argv[1]) == 0)
+  {
+    if (strcmp(argv[2], "list") == 0)
+    {
+      list();
+      ret = 0;
+    }
+    else if (strcmp(argv[2], "export") == 0 && argc > 3)
+    {
+      ret = export_image(strtoull(argv[3], NULL, 10),
+                         argc > 4 ? argv[4] : NULL);
+    }
+    else if (strcmp(argv[2], "export-all") == 0)
+    {
+      ret = export_all();
+    }
+    else
+    {
+      printf("Unknown command %s\n", argv[2]);
+    }
+  }
+
+  if (g_archive != NULL)
+  {
+    fclose(g_archive);
+  }
+  free(g_index);
+  free(g_image);
+  free(g_data);
+
+  return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,61 @@
+/*
+ * FILE = HEADER: /include/archiveFormat.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _archiveFormat_
+#define _archiveFormat_
+
+#include <stddef.h>
+
+/*
+ * Layout of an archive file (all numbers little endian):
+ *
+ * file header   "MFA1", width, height, tile size, keyframe interval (u32)
+ * frame record  type ('K' or 'D'), 3 bytes padding, image number (u64),
+ *               length of the tiles (u64), tiles
+ * ...
+ * index         per frame: image number (u64), offset of the record (u64),
+ *               type, 7 bytes padding
+ * trailer       offset of the index (u64), number of frames (u32), "MFAI"
+ *
+ * Every tile starts with its codec (u8) and the length of its data (u32).
+ * A keyframe holds the pixels of every tile, a delta frame the XOR of every
+ * tile with the same tile of the frame before.
+ */
+
+#define ARCHIVE_MAGIC "MFA1"
+#define ARCHIVE_INDEX_MAGIC "MFAI"
+#define ARCHIVE_HEADER_SIZE 20
+#define ARCHIVE_RECORD_SIZE 20
+#define ARCHIVE_INDEX_ENTRY_SIZE 24
+#define ARCHIVE_TRAILER_SIZE 16
+
+#define FRAME_KEY 'K'
+#define FRAME_DELTA 'D'
+
+#define TILE_SAME 0                // delta frames only: tile did not change
+#define TILE_RLE 1                 // run length encoded pixels
+#define TILE_RAW 2                 // pixels as they are
+#define TILE_HEADER_SIZE 5
+
+#define MAX_TILE_SIZE 128
+
+void put_le32(unsigned char *out, unsigned long value);
+void put_le64(unsigned char *out, unsigned long long value);
+unsigned long get_le32(const unsigned char *in);
+unsigned long long get_le64(const unsigned char *in);
+
+size_t tile_bound(int tile_width, int tile_height);
+size_t encode_tile(const unsigned char *image, const unsigned char *reference,
+                   int width, int tile_width, int tile_height,
+                   unsigned char *out);
+int decode_tile(const unsigned char **in, const unsigned char *end,
+                unsigned char *image, int delta, int width, int tile_width,
+                int tile_height);
+
+#endif
@@ -11,12 +11,14 @@
 #define _global_ids_W_
 
 #include <stdio.h>
+#include <signal.h>
 
 extern int g_shmid;
 extern int g_semid;
-extern unsigned char *g_buffer;
+extern int g_slot;
 extern unsigned char *g_membuf;
-extern char *g_name;
 extern FILE *g_pIMAGE;
+extern volatile sig_atomic_t g_interrupted;
+extern volatile sig_atomic_t g_pipeline_running;
 
 #endif
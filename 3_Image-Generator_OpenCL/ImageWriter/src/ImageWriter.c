@@ -8,12 +8,27 @@
  *                    cntrl_c_handler_Writer.c         cntrl_c_handler_Writer.h
  *                    install_signal_handler.C         install_signal_handler.h
  *                    global_ids_W.c                   global_ids_W.h
+ *                    sharedSegment.c                  sharedSegment.h
+ *                    pipeline.c                       pipeline.h
+ *                    encoder.c                        encoder.h
+ *                    imageFile.c                      imageFile.h
+ *                                                     writerSettings.h
  *                                                     universalSettings.h
  *
  * DEPENDS ON:        pixelGenerator program
  *
  * A program that continuously writes images generated by the pixelGenerator
- * program into a p6 ppm file.
+ * program into image files, png by default (OUTPUT_FORMAT), written with
+ * io_uring on Linux (OUTPUT_BACKEND, see writerSettings.h).
+ *
+ * Several imageWriter programs can run at the same time. Each image is
+ * claimed by exactly one of them and written to a file named after the
+ * number the pixelGenerator gave to the image, so the image files stay
+ * numbered without gaps no matter which imageWriter wrote them. Only the
+ * numbers of partial images (see sharedSegment.h) are left out.
+ *
+ * Inside the imageWriter reading, formatting and writing the images is done
+ * by separate threads (see pipeline.c).
  *
  * Copyright (c) 2016 Bernhard Lindner
  *
@@ -30,14 +45,22 @@
 #include <sys/sem.h>
 #include <signal.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #include "numberOfPixel.h"
+#include "sharedSegment.h"
 #include "generateKey.h"
 #include "cleanupWriter.h"
 #include "cntrl_c_handler_Writer.h"
 #include "install_signal_handler.h"
 #include "universalSettings.h"
 #include "global_ids_W.h"
+#include "writerSettings.h"
+#include "pipeline.h"
+#include "trace.h"
+#include "output.h"
+#include "stream.h"
+#include "direct.h"
 
 int main(int argc, char *argv[])
 {
@@ -46,7 +69,9 @@ int main(int argc, char *argv[])
     if ((strncmp(argv[1], "help", 4) == 0) || (strncmp(argv[1], "-h", 2) == 0))
     {
       printf("\nThis program reads image data (RGB pixels) out of an shared\n"
-             "memory segment and writes pictures into p6 .ppm file.\n"
+             "memory segment and writes pictures into .png (default), .qoi\n"
+             "or p6 .ppm files, with io_uring on Linux, or into a y4m video\n"
+             "stream (see writerSettings.h).\n"
              "This program depends on the pixelGenerator program generating\n"
              "image data and writing it into a shared memory segment\n"
              "\nThis program does not take any cmdline arguments.\n\n");
@@ -67,10 +92,23 @@ int main(int argc, char *argv[])
 
   g_shmid = -1;
   g_semid = -1;
+  g_slot = -1;
   g_membuf = NULL;
-  g_buffer = NULL;
-  g_name = NULL;
   g_pIMAGE = NULL;
+  g_interrupted = 0;
+  g_pipeline_running = 0;
+
+/*
+ * If the images are streamed to stdout, all messages are printed to stderr.
+ */
+
+  if (OUTPUT_BACKEND == OUTPUT_STREAM && strcmp(STREAM_FILE, "-") == 0)
+  {
+    if (redirect_stdout() != 0)
+    {
+      return EXIT_FAILURE;
+    }
+  }
 
 /*---------------------------------------------------------------------------*/
 /* I N S T A L L  S I G N A L  H A N D L E R                                 */
@@ -110,7 +148,7 @@ int main(int argc, char *argv[])
  * pixelGenerator does not get started in time.
  */
 
-  if ((g_shmid = shmget(key, MAX_DATA, 0)) < 0)
+  if ((g_shmid = shmget(key, segment_size(), 0)) < 0)
   {
     if (errno == ENOENT)
     {
@@ -137,7 +175,7 @@ int main(int argc, char *argv[])
 
     while (counter != 0)
     {
-      if ((g_shmid = shmget(key, MAX_DATA, 0)) < 0)
+      if ((g_shmid = shmget(key, segment_size(), 0)) < 0)
       {
         if (errno == ENOENT)
         {
@@ -182,15 +220,22 @@ int main(int argc, char *argv[])
     return EXIT_FAILURE;
   }
 
+/*
+ * Ask the pixelGenerator for the pixel format of the images (see
+ * writerSettings.h).
+ */
+
+  request_pixel_format(g_membuf, WRITER_PIXEL_FORMAT);
+
 /*---------------------------------------------------------------------------*/
 /* C H E C K  F O R  E X I S T I N G  S E M A P H O R E S                    */
 /*---------------------------------------------------------------------------*/
 
 /*
- * Both semaphores are created and removed by the pixelGenerator program.
+ * All semaphores are created and removed by the pixelGenerator program.
  */
 
-  if ((g_semid = semget(key, 2 ,0)) < 0)
+  if ((g_semid = semget(key, NUMBER_OF_SEMAPHORES, 0)) < 0)
   {
     if (errno == ENOENT)
     {
@@ -206,66 +251,105 @@ int main(int argc, char *argv[])
     }
   }
 
+/*---------------------------------------------------------------------------*/
+/* S T A R T  P I P E L I N E                                                */
+/*---------------------------------------------------------------------------*/
+
 /*
- * prepare semaphore flags
+ * start_pipeline() is defined in pipeline.c. It allocates the local image
+ * buffers and starts the encoder and sink threads. From now on ctrl-c only
+ * stops claiming new images, all claimed images are still written to disk
+ * (see cntrl_c_handler_Writer.c).
+ *
+ * Direct output backends (see direct.c) write the images straight out of the
+ * shared memory segment, the pipeline is not needed.
  */
 
-  struct sembuf s1;
-  struct sembuf s2;
-
-  s1.sem_num = 0;
-  s1.sem_flg = SEM_UNDO;
-
-  s2.sem_num = 1;
-  s2.sem_flg = SEM_UNDO;
-
-/*---------------------------------------------------------------------------*/
-/* G E N E R A T E  L O C A L  I M A G E  B U F F E R                        */
-/*---------------------------------------------------------------------------*/
+  int direct = is_direct_backend(OUTPUT_BACKEND);
 
 /*
- * After reading from the shared memory segment the image data is stored inside
- * a local buffer before the content of the buffer gets written to a ppm file.
+ * The main thread reads the images, the pipeline threads take the next
+ * buffers of the trace (see trace.h).
  */
 
-  g_buffer = (unsigned char *) calloc(MAX_DATA, sizeof(unsigned char));
-  if (g_buffer == NULL)
+  trace_thread(TRACE_NEXT_THREAD, "reader");
+
+  struct perf_counters counters;
+  struct perf_sample perf_claimed, perf_copied;
+  open_perf_counters(&counters);
+
+  if (direct)
   {
+    if (open_direct(OUTPUT_BACKEND) == -1)
+    {
+      cleanupW();
+      return EXIT_FAILURE;
+    }
+  }
+  else if (start_pipeline() == -1)
+  {
+    printf("Error starting pipeline\n");
     cleanupW();
-    perror("calloc");
     return EXIT_FAILURE;
   }
+  g_pipeline_running = 1;
+
 /*---------------------------------------------------------------------------*/
 /* R E A D  F R O M  S H A R E D  M E M O R Y                                */
 /*---------------------------------------------------------------------------*/
 
+  struct stage_stats reader;
+  memset(&reader, 0, sizeof(struct stage_stats));
+  struct frame slotframe;
+  memset(&slotframe, 0, sizeof(struct frame));
+  int exitcode = EXIT_SUCCESS;
+
 /*
- * Initalize values for image name. Allocate memory for the imagename.
+ * Direct output backends need a buffer for images that are not PIXEL_RGB24.
  */
 
-  int imagenumber = 1;
-  int maxname = 14;
-  int maxnumber = 1000;
-  g_name = (char *) malloc(maxname * sizeof(char));
-  if (g_name == NULL)
+  unsigned char *converted = NULL;
+  if (direct)
   {
-    cleanupW();
-    perror("malloc");
-    return EXIT_FAILURE;
+    converted = (unsigned char *) malloc(MAX_DATA);
+    if (converted == NULL)
+    {
+      perror("malloc");
+      g_interrupted = 1;
+      exitcode = EXIT_FAILURE;
+    }
   }
 
-  while(1)
+  unsigned long skipped = 0;
+  struct frame *frame = NULL;
+
+  while ((g_interrupted == 0) && (pipeline_failed() == 0))
   {
 
 /*
- * lock the ImageWriter semaphore do prevent reading from the shared memory
- * segment while the pixelGenerator is writing to it at the same time.
+ * Take a free local buffer first, so the slot is held only while copying.
+ * The buffer of a skipped image is kept for the next one.
+ */
+
+    if (frame == NULL)
+    {
+      frame = direct ? &slotframe : pipeline_get_buffer(&reader);
+    }
+
+/*
+ * claim the oldest image nobody else has claimed yet. The slot holding it
+ * will not be written by the pixelGenerator until it is released again.
+ * g_slot is global to be able to release the slot from inside cleanupW().
  */
 
-    s2.sem_op = -1;
+    long long start = pipeline_clock();
 
-    if (semop(g_semid, &s2, 1) == -1)
+    if (claim_frame(g_semid, g_membuf, &g_slot) == -1)
     {
+      if (errno == EINTR)
+      {
+        break;
+      }
       if (errno == EIDRM)
       {
         printf("\nSemaphore has been removed\n");
@@ -275,26 +359,78 @@ int main(int argc, char *argv[])
       {
         perror("semop");
       }
-      cleanupW();
-      return EXIT_FAILURE;
+      exitcode = EXIT_FAILURE;
+      break;
     }
 
+    long long claimed = pipeline_clock();
+    reader.waiting += claimed - start;
+    read_perf_counters(&counters, &perf_claimed);
+
+/*
+ * Read data from shared memory into the local buffer or write it directly.
+ */
+
+    unsigned char *slotbuf = slot_data(g_membuf, g_slot);
+    int format = slot_header(g_membuf, g_slot)->pixel_format;
+    int partial = slot_header(g_membuf, g_slot)->partial;
+    unsigned char (*palette)[3] = segment_header(g_membuf)->palette;
+    int written = 0;
+    long long direct_written = 0;
+
+    frame->framenumber = slot_header(g_membuf, g_slot)->framenumber;
+    frame->times = slot_header(g_membuf, g_slot)->times;
+    frame->claim = start;
+    frame->claimed = claimed;
+
 /*
- * Read data from shared memory into the local buffer
+ * A partial image (see sharedSegment.h) is not written, only its slot is
+ * released. Its number is left out of the image files.
  */
 
-    for (int i = 0; i < MAX_DATA; i++)
+    if (partial)
+    {
+      skipped++;
+    }
+    else if (direct)
+    {
+      frame->pixels = slotbuf;
+      if (format != PIXEL_RGB24)
+      {
+        frame->pixels = converted;
+        written = convert_to_rgb24(converted, slotbuf, format, palette);
+      }
+      frame->output = claimed;
+      if (written == 0)
+      {
+        written = write_direct(frame);
+      }
+      direct_written = pipeline_clock();
+      reader.frames++;
+    }
+    else
     {
-        g_buffer[i] = g_membuf[i];
+      written = convert_to_rgb24(frame->pixels, slotbuf, format, palette);
     }
+
 /*
- * Unlock the pixelGenerator semaphore to allow the pixelGenerator to write to
- * the shared memory segment.
+ * Release the slot to allow the pixelGenerator to write the next image into
+ * it. SIGINT is blocked meanwhile, so a second ctrl-c (see
+ * cntrl_c_handler_Writer.c) neither misses the slot nor releases it twice.
  */
 
-    s1.sem_op = 1;
+    sigset_t sigint;
+    sigset_t oldmask;
+    sigemptyset(&sigint);
+    sigaddset(&sigint, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &sigint, &oldmask);
+
+    int released = release_slot(g_semid, g_slot);
+    g_slot = -1;
 
-    if (semop(g_semid, &s1, 1) == -1)
+    pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
+
+    if (released == -1)
     {
       if (errno == EIDRM)
       {
@@ -305,94 +441,86 @@ int main(int argc, char *argv[])
       {
         perror("semop");
       }
-      cleanupW();
-      return EXIT_FAILURE;
+      exitcode = EXIT_FAILURE;
+      break;
     }
 
-/*---------------------------------------------------------------------------*/
-/* W R I T E  I M A G E  T O  F I L E                                        */
-/*---------------------------------------------------------------------------*/
-
 /*
- * Print a sequential number to the imagename.
+ * An image that could not be converted or written is not handed on.
  */
 
-    if (snprintf(g_name, maxname, "image-%03d.ppm", imagenumber) < 0)
+    if (written != 0)
     {
-      perror("sprintf");
-      cleanupW();
-      return EXIT_FAILURE;
+      exitcode = EXIT_FAILURE;
+      break;
     }
-
-    char *COMMENT = "# Mandelbrot set";
-    int BITDEPTH = 255;
-    g_pIMAGE = NULL;
-
-    g_pIMAGE = fopen(g_name, "wb");
-    if (g_pIMAGE == NULL)
+    if (partial)
     {
-      printf("Could not open file.");
-      cleanupW();
-      return EXIT_FAILURE;
+      continue;
     }
+    frame->copied = pipeline_clock();
+    reader.busy += frame->copied - claimed;
+    read_perf_counters(&counters, &perf_copied);
+    record_writer_perf(direct ? WRITER_PERF_WRITE : WRITER_PERF_COPY,
+                       &counters, &perf_claimed, &perf_copied);
+    trace_event("claim wait", start, claimed, frame->framenumber);
+    trace_event(direct ? "write" : "copy", claimed, frame->copied,
+                frame->framenumber);
+
+    if (direct)
+    {
 
 /*
- * Print a header to the image file.
+ * The image has been written before the slot was released, there is no
+ * copy, queue and encode stage.
  */
 
-    if (fprintf(g_pIMAGE,"P6\n%s\n%d %d\n%d\n", COMMENT, WIDTH, HEIGHT,
-        BITDEPTH) < 0)
-    {
-      perror("fprintf");
-      cleanupW();
-      return EXIT_FAILURE;
+      frame->copied = 0;
+      record_writer_latency(frame, direct_written);
+      if ((STATS_INTERVAL != 0) && (reader.frames % STATS_INTERVAL == 0))
+      {
+        print_direct_stats(&reader);
+      }
+      continue;
     }
 
 /*
- * Write the local buffer to the image file.
+ * Hand the image to the encoder threads, the sink thread writes it into
+ * a file (see pipeline.c).
  */
 
-    if (fwrite(g_buffer , 1 , MAX_DATA, g_pIMAGE) != MAX_DATA)
-    {
-      printf("Error writing image data to file\n");
-      cleanupW();
-      return EXIT_FAILURE;
-    }
+    pipeline_submit(frame, &reader);
+    frame = NULL;
 
-    if (g_pIMAGE != NULL)
+    if ((STATS_INTERVAL != 0) && (reader.frames % STATS_INTERVAL == 0))
     {
-      if (fclose(g_pIMAGE) == 0)
-      {
-        g_pIMAGE = NULL;
-      }
-      else
-      {
-        printf("Error: IMAGE File could not be closed.\n");
-        cleanupW();
-        return EXIT_FAILURE;
-      }
+      print_pipeline_stats(&reader);
     }
-
-    imagenumber++;
+  }
 
 /*
- * Check if the imagenumber "is to big for the imagename" and if necessary
- * realloc more memory for the imagename.
+ * Let the pipeline write all claimed images before terminating.
  */
 
-    if (imagenumber == maxnumber)
+  if (direct)
+  {
+    print_direct_stats(&reader);
+    free(converted);
+  }
+  else
+  {
+    if (stop_pipeline() == -1)
     {
-      maxname = maxname + 1;
-      maxnumber = (maxnumber * 10);
-      char *temp = (char *) realloc(g_name, maxname * sizeof(char));
-      if (temp == NULL)
-      {
-        perror("realloc");
-        cleanupW();
-        return EXIT_FAILURE;
-      }
-      g_name = temp;
+      exitcode = EXIT_FAILURE;
     }
+    print_pipeline_stats(&reader);
   }
-  return EXIT_SUCCESS;
+  if (skipped != 0)
+  {
+    printf("%lu partial images skipped\n", skipped);
+  }
+  close_perf_counters(&counters);
+  cleanupW();
+
+  return exitcode;
 }
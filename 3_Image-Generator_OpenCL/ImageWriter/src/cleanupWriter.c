@@ -1,8 +1,9 @@
 /*
  * FILE =  /src/cleanupWriter.c
  *
- * This function frees allocated memory segments, detaches the shared memory
- * segment and closes open imagefiles.
+ * This function stops the pipeline threads, frees allocated memory segments,
+ * releases a claimed slot of the shared memory segment, detaches the shared
+ * memory segment and closes open imagefiles.
  *
  * Copyright (c) 2016 Bernhard Lindner
  *
@@ -14,13 +15,33 @@
 #include <stdlib.h>
 #include <sys/shm.h>
 #include "global_ids_W.h"
+#include "sharedSegment.h"
+#include "pipeline.h"
+#include "trace.h"
 
 void cleanupW(void)
 {
-  if (g_buffer != NULL)
+
+/*
+ * free_pipeline() (defined in pipeline.c) stops the pipeline threads and
+ * frees the local image buffers.
+ */
+
+  free_pipeline();
+  write_trace("imageWriter");
+
+/*
+ * A slot claimed but not yet released would never be written by the
+ * pixelGenerator again.
+ */
+
+  if (g_slot != -1)
   {
-    free(g_buffer);
-    g_buffer = NULL;
+    if (release_slot(g_semid, g_slot) < 0)
+    {
+      perror("semop");
+    }
+    g_slot = -1;
   }
   if (g_membuf != NULL)
   {
@@ -29,11 +50,6 @@ void cleanupW(void)
       perror("shmdt");
     }
   }
-  if (g_name != NULL)
-  {
-    free(g_name);
-    g_name = NULL;
-  }
   if (g_pIMAGE != NULL)
   {
     if (fclose(g_pIMAGE) == 0)
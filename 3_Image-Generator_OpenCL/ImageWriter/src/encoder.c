@@ -0,0 +1,251 @@
+/*
+ * FILE = /src/encoder.c
+ *
+ * RELATED FILES:     *.c                              *.h
+ *                    qoi.c                            qoi.h
+ *                    png.c                            png.h
+ *                    yuv.c                            yuv.h
+ *                                                     encoder.h
+ *
+ * The encode_frame() function prepares an image for being written to disk.
+ * It is called by the encoder threads of the pipeline (see pipeline.c).
+ *
+ * For a p6 ppm file the image data is written as it is, only the header
+ * needs to be printed. QOI and PNG images are compressed in strips of
+ * STRIP_HEIGHT rows. Every strip is compressed by its own thread, the strips
+ * are joined into one file afterwards.
+ *
+ * Y4M and YUV images are frames of a video stream (see stream.c). The image
+ * is converted to YUV 4:2:0, a Y4M frame starts with a "FRAME" line, a YUV
+ * frame is written without header.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "numberOfPixel.h"
+#include "writerSettings.h"
+#include "encoder.h"
+#include "qoi.h"
+#include "png.h"
+#include "yuv.h"
+
+static int encode_ppm(struct frame *frame)
+{
+  char *COMMENT = "# Mandelbrot set";
+  int BITDEPTH = 255;
+
+  frame->headerlength = snprintf(frame->header, sizeof(frame->header),
+                                 "P6\n%s\n%d %d\n%d\n", COMMENT, WIDTH, HEIGHT,
+                                 BITDEPTH);
+  if ((frame->headerlength < 0) ||
+      (frame->headerlength >= sizeof(frame->header)))
+  {
+    perror("snprintf");
+    return -1;
+  }
+
+  frame->data = frame->pixels;
+  frame->datalength = MAX_DATA;
+
+  return 0;
+}
+
+static int encode_yuv(struct frame *frame, int format)
+{
+  size_t size = yuv420_size(WIDTH, HEIGHT);
+
+  if (reserve_buffer(frame, size) != 0)
+  {
+    return -1;
+  }
+  rgb_to_yuv420(frame->pixels, WIDTH, HEIGHT, frame->buffer);
+
+  if (format == FORMAT_Y4M)
+  {
+    frame->headerlength = snprintf(frame->header, sizeof(frame->header),
+                                   "FRAME\n");
+  }
+  else
+  {
+    frame->headerlength = 0;
+  }
+
+  frame->data = frame->buffer;
+  frame->datalength = size;
+
+  return 0;
+}
+
+int encode_frame(struct frame *frame)
+{
+  return encode_frame_as(frame, OUTPUT_FORMAT);
+}
+
+int encode_frame_as(struct frame *frame, int format)
+{
+  frame->format = format;
+
+  switch (format)
+  {
+    case FORMAT_PPM:
+      return encode_ppm(frame);
+    case FORMAT_QOI:
+      return encode_qoi(frame);
+    case FORMAT_PNG:
+      return encode_png(frame);
+    case FORMAT_Y4M:
+    case FORMAT_YUV:
+      return encode_yuv(frame, format);
+    default:
+      printf("Error: unknown image format %d\n", format);
+      return -1;
+  }
+}
+
+char *image_extension(int format)
+{
+  switch (format)
+  {
+    case FORMAT_QOI:
+      return "qoi";
+    case FORMAT_PNG:
+      return "png";
+    case FORMAT_Y4M:
+      return "y4m";
+    case FORMAT_YUV:
+      return "yuv";
+    default:
+      return "ppm";
+  }
+}
+
+/*
+ * stream_header() prints the header written once at the start of a video
+ * stream into header and returns its length. Only Y4M streams have a header.
+ * A stream of YUV frames can be read with
+ * "ffmpeg -f rawvideo -pix_fmt yuv420p -s WIDTHxHEIGHT -i -".
+ */
+
+int stream_header(int format, char *header, size_t size)
+{
+  if (format != FORMAT_Y4M)
+  {
+    return 0;
+  }
+
+  int length = snprintf(header, size, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 "
+                        "C420jpeg\n", WIDTH, HEIGHT, STREAM_FRAME_RATE);
+  if ((length < 0) || (length >= size))
+  {
+    perror("snprintf");
+    return -1;
+  }
+  return length;
+}
+
+/*
+ * reserve_buffer() makes sure that the work buffer of the frame holds at
+ * least size bytes. The buffer is kept for the next image.
+ */
+
+int reserve_buffer(struct frame *frame, size_t size)
+{
+  if (frame->buffersize >= size)
+  {
+    return 0;
+  }
+
+  unsigned char *buffer = (unsigned char *) realloc(frame->buffer, size);
+  if (buffer == NULL)
+  {
+    perror("realloc");
+    return -1;
+  }
+  frame->buffer = buffer;
+  frame->buffersize = size;
+  return 0;
+}
+
+/*
+ * split_into_strips() divides the rows of the image into strips of
+ * STRIP_HEIGHT rows and returns the number of strips.
+ */
+
+int split_into_strips(struct frame *frame, struct strip *strips)
+{
+  int number_of_strips = (HEIGHT + STRIP_HEIGHT - 1) / STRIP_HEIGHT;
+  if (number_of_strips > MAX_STRIPS)
+  {
+    number_of_strips = MAX_STRIPS;
+  }
+  if (number_of_strips < 1)
+  {
+    number_of_strips = 1;
+  }
+
+  for (int s = 0; s < number_of_strips; s++)
+  {
+    strips[s].frame = frame;
+    strips[s].first_row = s * HEIGHT / number_of_strips;
+    strips[s].rows = (s + 1) * HEIGHT / number_of_strips - strips[s].first_row;
+    strips[s].last = (s == number_of_strips - 1);
+    strips[s].out = NULL;
+    strips[s].length = 0;
+    strips[s].adler = 1;
+    strips[s].result = 0;
+  }
+  return number_of_strips;
+}
+
+/*
+ * encode_strips() runs handler() for every strip. The first strip is
+ * compressed by the calling encoder thread, the others by threads started
+ * for this image. If a thread cannot be started its strip is compressed by
+ * the calling thread.
+ */
+
+int encode_strips(struct strip *strips, int number_of_strips,
+                  void *(*handler)(void *))
+{
+  pthread_t thread[MAX_STRIPS];
+  int started[MAX_STRIPS];
+
+  for (int s = 1; s < number_of_strips; s++)
+  {
+    started[s] = (pthread_create(&thread[s], NULL, handler, &strips[s]) == 0);
+  }
+
+  handler(&strips[0]);
+
+  for (int s = 1; s < number_of_strips; s++)
+  {
+    if (started[s])
+    {
+      if (pthread_join(thread[s], NULL) != 0)
+      {
+        perror("pthread_join");
+        return -1;
+      }
+    }
+    else
+    {
+      handler(&strips[s]);
+    }
+  }
+
+  for (int s = 0; s < number_of_strips; s++)
+  {
+    if (strips[s].result != 0)
+    {
+      return -1;
+    }
+  }
+  return 0;
+}
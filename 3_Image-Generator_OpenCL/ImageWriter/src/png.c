@@ -0,0 +1,221 @@
+/*
+ * FILE = /src/png.c
+ *
+ * RELATED FILES:     *.c                              *.h
+ *                    deflate.c                        deflate.h
+ *                    encoder.c                        encoder.h
+ *                                                     png.h
+ *
+ * Encoder for PNG images (RGB, 8 bits per channel, no interlacing).
+ *
+ * Every strip of the image is filtered and compressed into its own deflate
+ * block by its own thread (see deflate.c). The blocks are joined into a
+ * single zlib stream stored in one IDAT chunk. The adler32 of the stream is
+ * combined from the adler32 of the strips.
+ *
+ * Every row is filtered with the "Sub" or the "Up" filter, whichever leaves
+ * the smaller differences. In the flat areas of a Mandelbrot image both
+ * filters leave rows of zeros.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "numberOfPixel.h"
+#include "encoder.h"
+#include "deflate.h"
+#include "png.h"
+
+#define FILTER_SUB 1
+#define FILTER_UP 2
+
+/*
+ * The file header holds signature, IHDR chunk and the length and type of the
+ * IDAT chunk.
+ */
+
+#define PNG_HEADER_SIZE 41
+
+static const unsigned char PNG_SIGNATURE[8] = {
+  0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'
+};
+static const unsigned char PNG_IEND[12] = {
+  0, 0, 0, 0, 'I', 'E', 'N', 'D', 0xae, 0x42, 0x60, 0x82
+};
+
+static void put_be32(unsigned char *out, unsigned long value)
+{
+  out[0] = (value >> 24) & 0xff;
+  out[1] = (value >> 16) & 0xff;
+  out[2] = (value >> 8) & 0xff;
+  out[3] = value & 0xff;
+}
+
+static size_t row_length(void)
+{
+  return 1 + (size_t) WIDTH * 3;
+}
+
+static int difference(int value)
+{
+  signed char d = (signed char) value;
+  return d < 0 ? -d : d;
+}
+
+static void filter_row(unsigned char *out, const unsigned char *row,
+                       const unsigned char *above)
+{
+  size_t length = (size_t) WIDTH * 3;
+  long sub = 0;
+  long up = 0;
+
+  for (size_t i = 0; i < length; i++)
+  {
+    sub += difference(row[i] - (i >= 3 ? row[i - 3] : 0));
+    if (above != NULL)
+    {
+      up += difference(row[i] - above[i]);
+    }
+  }
+
+  if (above != NULL && up < sub)
+  {
+    out[0] = FILTER_UP;
+    for (size_t i = 0; i < length; i++)
+    {
+      out[1 + i] = row[i] - above[i];
+    }
+  }
+  else
+  {
+    out[0] = FILTER_SUB;
+    for (size_t i = 0; i < 3 && i < length; i++)
+    {
+      out[1 + i] = row[i];
+    }
+    for (size_t i = 3; i < length; i++)
+    {
+      out[1 + i] = row[i] - row[i - 3];
+    }
+  }
+}
+
+/*
+ * The filtered rows of all strips are stored at the start of the work
+ * buffer, the compressed strips behind them.
+ */
+
+static void *encode_strip(void *ptr)
+{
+  struct strip *strip = (struct strip *) ptr;
+  struct frame *frame = strip->frame;
+  size_t stride = (size_t) WIDTH * 3;
+  unsigned char *filtered = frame->buffer +
+                            (size_t) strip->first_row * row_length();
+
+  for (int y = strip->first_row; y < strip->first_row + strip->rows; y++)
+  {
+    unsigned char *row = frame->pixels + y * stride;
+    filter_row(frame->buffer + y * row_length(), row,
+               y > 0 ? row - stride : NULL);
+  }
+
+  size_t length = (size_t) strip->rows * row_length();
+  strip->adler = adler32_update(1, filtered, length);
+  strip->length = deflate_block(filtered, length, strip->out, strip->last);
+  strip->result = (strip->length == 0) ? -1 : 0;
+
+  return NULL;
+}
+
+int encode_png(struct frame *frame)
+{
+  struct strip strips[MAX_STRIPS];
+  int number_of_strips = split_into_strips(frame, strips);
+
+  size_t filtered = (size_t) HEIGHT * row_length();
+  size_t bound = 0;
+  for (int s = 0; s < number_of_strips; s++)
+  {
+    size_t b = deflate_bound((size_t) strips[s].rows * row_length());
+    if (b > bound)
+    {
+      bound = b;
+    }
+  }
+
+/*
+ * zlib header, the strips, adler32, crc32 of the IDAT chunk, IEND chunk
+ */
+
+  if (reserve_buffer(frame, filtered + 2 + number_of_strips * bound + 4 + 4 +
+                     sizeof(PNG_IEND)) != 0)
+  {
+    return -1;
+  }
+
+  unsigned char *stream = frame->buffer + filtered;
+  for (int s = 0; s < number_of_strips; s++)
+  {
+    strips[s].out = stream + 2 + s * bound;
+  }
+
+  if (encode_strips(strips, number_of_strips, encode_strip) != 0)
+  {
+    printf("Error compressing image\n");
+    return -1;
+  }
+
+/*
+ * zlib header: deflate with a 32K window, no dictionary, fastest compression
+ */
+
+  stream[0] = 0x78;
+  stream[1] = 0x01;
+  size_t length = 2;
+
+  unsigned long adler = 1;
+  for (int s = 0; s < number_of_strips; s++)
+  {
+    memmove(stream + length, strips[s].out, strips[s].length);
+    length += strips[s].length;
+    adler = adler32_combine(adler, strips[s].adler,
+                            (size_t) strips[s].rows * row_length());
+  }
+  put_be32(stream + length, adler);
+  length += 4;
+
+  unsigned char *header = (unsigned char *) frame->header;
+  memcpy(header, PNG_SIGNATURE, sizeof(PNG_SIGNATURE));
+  put_be32(header + 8, 13);
+  memcpy(header + 12, "IHDR", 4);
+  put_be32(header + 16, WIDTH);
+  put_be32(header + 20, HEIGHT);
+  header[24] = 8;                  // bit depth
+  header[25] = 2;                  // color type: RGB
+  header[26] = 0;                  // compression: deflate
+  header[27] = 0;                  // filter method
+  header[28] = 0;                  // no interlacing
+  put_be32(header + 29, crc32_update(0, header + 12, 17));
+  put_be32(header + 33, length);
+  memcpy(header + 37, "IDAT", 4);
+  frame->headerlength = PNG_HEADER_SIZE;
+
+  unsigned long crc = crc32_update(0, header + 37, 4);
+  crc = crc32_update(crc, stream, length);
+  put_be32(stream + length, crc);
+  length += 4;
+
+  memcpy(stream + length, PNG_IEND, sizeof(PNG_IEND));
+  length += sizeof(PNG_IEND);
+
+  frame->data = stream;
+  frame->datalength = length;
+
+  return 0;
+}
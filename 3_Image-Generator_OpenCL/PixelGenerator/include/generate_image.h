@@ -11,7 +11,33 @@
  #define _generate_image_
 
 #include "setup_OpenCL.h"
+#include "viewCommand.h"
 
-int generate_image(unsigned char *imagebuffer, void *OpenCLdata);
+#define GENERATOR_BACKEND "opencl"
+
+int generate_image(unsigned char *imagebuffer, void *OpenCLdata,
+                   struct viewport *view);
+
+/*
+ * enqueue_image() queues the kernel of an image and the read or map of its
+ * buffer and returns at once, finish_image() waits for the image and hands
+ * the buffer back. generate_image() does both. An image queued into the
+ * buffer of a slot (see use_slot_buffers()) waits only for the last read or
+ * unmap of this buffer, so the images of several slots can be queued at
+ * once. The events of the image are kept in struct cl_frame.
+ */
+
+struct cl_frame
+{
+  unsigned char *imagebuffer;
+  int slot;                        // buffer of the image, -1 = imgb
+  size_t size;                     // bytes of the image
+  unsigned char *mapped;           // OPENCL_ZERO_COPY: the mapped buffer
+  cl_event done;                   // read or map of the image
+};
+
+int enqueue_image(unsigned char *imagebuffer, void *OpenCLdata,
+                  struct viewport *view, struct cl_frame *frame);
+int finish_image(void *OpenCLdata, struct cl_frame *frame);
 
 #endif
@@ -11,12 +11,14 @@
 #define _global_ids_
 
 #include <stdio.h>
+#include "statsPage.h"
 #include "setup_OpenCL.h"
 
 extern int g_shmid;
 extern int g_semid;
-extern unsigned char *g_buffer;
 extern unsigned char *g_membuf;
+extern int g_statsid;
+extern struct stats_page *g_stats;
 extern struct cl_mem_data g_data;
 
 #endif
@@ -0,0 +1,54 @@
+/*
+ * FILE = HEADER: /include/program_cache.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+
+#ifndef _program_cache_
+#define _program_cache_
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef __APPLE__
+#include <OpenCL/opencl.h>
+#include <unistd.h>
+#else
+#include <CL/cl.h>
+#endif
+
+/*
+ * read_kernel_source() returns the contents of the file path as a string,
+ * to be freed by the caller. NULL if the file can not be read.
+ */
+
+char *read_kernel_source(const char *path);
+
+/*
+ * The program built for a device is kept in a file of the host (see
+ * hostCache.h) named PROGRAM_CACHE-<key>. The key is a hash of the name,
+ * version and driver version of the device, the build options and the kernel
+ * source, a new driver or a changed kernel builds the program again.
+ *
+ * program_cache_name() writes the name of the file to name, -1 if the
+ * device can not be queried.
+ * load_program() returns the program built from the file, NULL if there is
+ * none or the device does not take it.
+ * save_program() writes the binary of a program built from source to the
+ * file. Failing to write it is not an error, the next start builds again.
+ */
+
+#define PROGRAM_CACHE "opencl"
+#define PROGRAM_CACHE_NAME 64
+
+int program_cache_name(cl_device_id device, const char *options,
+                       const char *source, char *name, size_t size);
+cl_program load_program(cl_context context, cl_device_id device,
+                        const char *options, const char *name);
+void save_program(cl_program program, const char *name);
+
+#endif
@@ -22,12 +22,62 @@
 #include <CL/cl.h>
 #endif
 
+#include "sharedSegment.h"
+
 /*
  * COMPUTE_DEVICE can be set to 0 = CPU, 1 = integrated GPU, 2 = dedicated GPU
  */
 
 #define COMPUTE_DEVICE 0
 
+/*
+ * The kernel is built from OPENCL_KERNEL_FILE (the makefiles give its full
+ * path) with WIDTH, HEIGHT and MAX_ITERATION defined and
+ * OPENCL_BUILD_OPTIONS. The program is kept in a file of the host and loaded
+ * at the next start (see program_cache.h).
+ *
+ * -cl-fast-relaxed-math lets the compiler reorder and contract the floating
+ * point operations, the number of iterations of a pixel close to the border
+ * of the mandelbrot set may differ from the other image generators.
+ */
+
+#ifndef OPENCL_KERNEL_FILE
+#define OPENCL_KERNEL_FILE "kernelsource_OpenCL/mandelbrot_openCL.cl"
+#endif
+
+#define OPENCL_BUILD_OPTIONS "-cl-fast-relaxed-math"
+#define OPENCL_OPTIONS_SIZE 256
+
+/*
+ * use_slot_buffers() creates an image buffer for every slot of the shared
+ * memory segment, the kernel of an image written into a slot uses the buffer
+ * of the slot (see generate_image.c).
+ *
+ * OPENCL_ZERO_COPY 0 makes them buffers of the device, which are read into
+ * the slot.
+ *
+ * OPENCL_ZERO_COPY 1 makes them CL_MEM_USE_HOST_PTR buffers over the image
+ * data of the slots (page aligned, see sharedSegment.c), mapped and unmapped
+ * after the kernel, which copies nothing on CPU devices. Any other
+ * imagebuffer is filled from a CL_MEM_ALLOC_HOST_PTR buffer by mapping it,
+ * one copy instead of two.
+ */
+
+#define OPENCL_ZERO_COPY 1
+
+/*
+ * The pixelGenerator queues the kernel of the next OPENCL_PIPELINE_DEPTH - 1
+ * images before it hands an image to the consumers, so the device starts
+ * the next image while the host waits for the last one (see
+ * enqueue_image()). Every image in the pipeline holds a slot.
+ */
+
+#define OPENCL_PIPELINE_DEPTH 2
+
+#if OPENCL_PIPELINE_DEPTH < 1 || OPENCL_PIPELINE_DEPTH >= NUMBER_OF_SLOTS
+  #error "OPENCL_PIPELINE_DEPTH has to be between 1 and NUMBER_OF_SLOTS - 1"
+#endif
+
 struct cl_mem_data
 {
   cl_mem           imgb;
@@ -36,8 +86,28 @@ struct cl_mem_data
   cl_command_queue commands;
   cl_program       program;
   cl_kernel        kernel;
+  cl_device_id     device;
+  int              bpp;            // bytes per pixel of the image
+  size_t           local[2];       // work group size (rows, columns),
+                                   // 0 = chosen by the OpenCL driver
+  cl_mem           slotb[NUMBER_OF_SLOTS];  // buffers of the slots
+  unsigned char   *slot[NUMBER_OF_SLOTS];   // image data of the slots
+  cl_event         slot_free[NUMBER_OF_SLOTS];  // last read or unmap of
+                                            // the buffer, NULL if done
+  int              slots;          // number of slot buffers created
 };
 
-int setup_OpenCL(unsigned char *palette, void *OpenCLdata);
+int setup_OpenCL(void *OpenCLdata);
+int set_pixel_format(unsigned char *pixels, int bpp, void *OpenCLdata);
+
+/*
+ * set_local_size() sets the work group size of the kernel to local_x x
+ * local_y work items (see tuning.h), 0 lets the OpenCL driver choose.
+ * Returns -1 if the image can not be split into work groups of this size
+ * or the device does not run as many work items in one group.
+ */
+
+int set_local_size(void *OpenCLdata, int local_x, int local_y);
+int use_slot_buffers(unsigned char *segment, void *OpenCLdata);
 
 #endif
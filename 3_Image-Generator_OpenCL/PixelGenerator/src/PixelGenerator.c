@@ -12,6 +12,15 @@
  *                    install_signal_handler.c         install_signal_handler.h
  *                    mem_cleanup_opencl.c             mem_cleanup_opencl.h
  *                    global_ids.c                     global_ids.h
+ *                    sharedSegment.c                  sharedSegment.h
+ *                    pixelFormat.c                    pixelFormat.h
+ *                    viewCommand.c                    viewCommand.h
+ *                    statsPage.c                      statsPage.h
+ *                    latency.c                        latency.h
+ *                    generator_latency.c              generator_latency.h
+ *                    tuning.c                         tuning.h
+ *                    hostCache.c                      hostCache.h
+ *                    program_cache.c                  program_cache.h
  *                                                     universalSettings.h
  *
  * DEPENDS ON:        imageWriter program
@@ -37,6 +46,10 @@
 #include "generateKey.h"
 #include "global_ids.h"
 #include "numberOfPixel.h"
+#include "sharedSegment.h"
+#include "pixelFormat.h"
+#include "viewCommand.h"
+#include "statsPage.h"
 #include "cntrl_c_handler.h"
 #include "universalSettings.h"
 #include "generate_image.h"
@@ -44,7 +57,10 @@
 #include "colorpalette.h"
 #include "setup_OpenCL.h"
 #include "cleanup.h"
-#include "time.h"
+#include "generator_latency.h"
+#include "trace.h"
+#include "tiles.h"
+#include "tuning.h"
 
 #if OS_FEDORA
 
@@ -71,7 +87,7 @@ int main(int argc, char *argv[])
       printf("\nThis program generates an image of the mandlebrot set and\n"
              "writes the picture into a shared memory segmet. This program\n"
              "depends on the imageWriter program reading from the shared memory"
-             "\nsegment and wirting the image into a .ppm file\n"
+             "\nsegment and writing the image into a .png, .qoi or .ppm file\n"
              "\nThis program does not take any cmdline arguments.\n\n");
       exit(EXIT_SUCCESS);
     }
@@ -91,7 +107,27 @@ int main(int argc, char *argv[])
   g_shmid = -1;
   g_semid = -1;
   g_membuf = NULL;
-  g_buffer = NULL;
+  g_statsid = -1;
+  g_stats = NULL;
+
+/*
+ * Only the main thread records into the trace (see trace.h), the work items
+ * of the device can not be traced.
+ */
+
+  trace_thread(0, "main");
+
+/*
+ * The perf counters of the main thread (see perfCounters.h). They count the
+ * host only, the compute stage runs from queueing an image until it is back
+ * and overlaps the compute stage of the image before (see
+ * OPENCL_PIPELINE_DEPTH).
+ */
+
+  struct perf_counters counters;
+  struct perf_sample perf_generated, perf_published;
+
+  open_perf_counters(&counters);
 
 /*---------------------------------------------------------------------------*/
 /* I N S T A L L  S I G N A L  H A N D L E R                                 */
@@ -131,10 +167,12 @@ int main(int argc, char *argv[])
   }
 
 /*
- * Generating a shared memory segment for MAX_DATA (defined in numberOfPixel.c)
+ * Generating a shared memory segment holding NUMBER_OF_SLOTS images of
+ * up to WIDTH * HEIGHT * MAX_BYTES_PER_PIXEL (see numberOfPixel.c and
+ * pixelFormat.h) bytes each (see sharedSegment.c).
  */
 
-  g_shmid = shmget(key, MAX_DATA, IPC_CREAT | 0600);
+  g_shmid = shmget(key, segment_size(), IPC_CREAT | 0600);
   if (g_shmid >= 0)
   {
     g_membuf = shmat(g_shmid, 0, 0);
@@ -156,33 +194,35 @@ int main(int argc, char *argv[])
 /* G E N E R A T E  S E M A P H O R E S                                      */
 /*---------------------------------------------------------------------------*/
 
-  if ((g_semid = semget(key, 2, IPC_CREAT | 0600)) < 0)
+  if ((g_semid = semget(key, NUMBER_OF_SEMAPHORES, IPC_CREAT | 0600)) < 0)
   {
     perror("semget");
     cleanup();
     return EXIT_FAILURE;
   }
-  struct sembuf s1;
-  struct sembuf s2;
 
   union semun semunion;
 
 /*
- * Setting start values for semaphore one and two.
- * The ImageWriter semaphore gets set to 0 at first which blocks the ImageWriter
- * program from reading data out of the shared memory segment.
+ * Setting start values for the semaphores (see sharedSegment.h).
+ * Every slot is free at first. The semaphore counting the images ready to be
+ * claimed gets set to 0 which blocks the consumers from reading data out of
+ * the shared memory segment.
  */
 
-  semunion.val = 1;
-  if ((semctl(g_semid, 0, SETVAL, semunion)) < 0)
+  for (int slot = 0; slot < NUMBER_OF_SLOTS; slot++)
   {
-    perror("semctl");
-    cleanup();
-    return EXIT_FAILURE;
+    semunion.val = 1;
+    if ((semctl(g_semid, SEM_SLOT_FREE(slot), SETVAL, semunion)) < 0)
+    {
+      perror("semctl");
+      cleanup();
+      return EXIT_FAILURE;
+    }
   }
 
   semunion.val = 0;
-  if ((semctl(g_semid, 1, SETVAL, semunion)) < 0)
+  if ((semctl(g_semid, SEM_FRAMES_READY, SETVAL, semunion)) < 0)
   {
     perror("semctl");
     cleanup();
@@ -190,16 +230,13 @@ int main(int argc, char *argv[])
   }
 
 /*
- * prepare semaphore 1
+ * An old segment left behind by a crashed pixelGenerator would still hold
+ * its image counters.
  */
-  s1.sem_num = 0;
-  s1.sem_flg = SEM_UNDO;
 
-/*
- * prepare semaphore 2
- */
-  s2.sem_num = 1;
-  s2.sem_flg = SEM_UNDO;
+  segment_header(g_membuf)->next_frame = 0;
+  segment_header(g_membuf)->next_claim = 0;
+  reset_view_commands(g_membuf);
 
 /*---------------------------------------------------------------------------*/
 /* G E N E R A T E  C O L O R  P A L E T T E  &  I M A G E  B U F F E R      */
@@ -212,7 +249,7 @@ int main(int argc, char *argv[])
  * Each iteration gets assigned a color (RGB values).
  */
 
-  static unsigned char PALETTE[1024][3];
+  static unsigned char PALETTE[PALETTE_SIZE][3];
 
   if (create_color_palette(PALETTE) != 0)
   {
@@ -222,136 +259,252 @@ int main(int argc, char *argv[])
   }
 
 /*
- * Saving the colorpalette inside a onedimensional buffer to be able to copy it
- * to openCL memory.
+ * The consumers colorize PIXEL_INDEX16 images with the palette in the shared
+ * memory segment. Until a consumer asks for another pixel format the images
+ * are generated as PIXEL_RGB24 (see pixelFormat.h).
  */
 
-  static unsigned char palette_for_openCL[3072];
-  int cp = 0;
-  for (int i = 0; i < 1024; i++)
+  memcpy(segment_header(g_membuf)->palette, PALETTE, sizeof(PALETTE));
+  request_pixel_format(g_membuf, PIXEL_RGB24);
+
+/*
+ * The table holding one pixel for every iteration is a onedimensional buffer
+ * which can be copied to openCL memory (see set_pixel_format()).
+ */
+
+  static unsigned char PIXELS[PALETTE_SIZE * MAX_BYTES_PER_PIXEL];
+  int format = -1;
+
+/*---------------------------------------------------------------------------*/
+/* S E T U P  O P E N C L                                                    */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Select OpenCL device, build OpenCL program from kernelsource or load the
+ * program built before.
+ */
+
+  if (setup_OpenCL(&g_data) == -1)
   {
-    palette_for_openCL[cp] = PALETTE[i][0];
-    cp++;
-    palette_for_openCL[cp] = PALETTE[i][1];
-    cp++;
-    palette_for_openCL[cp] = PALETTE[i][2];
-    cp++;
+    printf("Error setting up OpenCL\n");
+    cleanup();
+    return EXIT_FAILURE;
   }
 
 /*
- * Generating a local image buffer where the image is stored before it is
- * written to the shared memory segment.
+ * The kernel writes into a buffer of every slot of the shared memory segment,
+ * the slots themselves unless OPENCL_ZERO_COPY is 0 (see setup_OpenCL.h).
  */
 
-  g_buffer = (unsigned char *) calloc(MAX_DATA, sizeof(unsigned char));
-  if (g_buffer == NULL)
+  if (use_slot_buffers(g_membuf, &g_data) != EXIT_SUCCESS)
   {
-    perror("calloc");
     cleanup();
     return EXIT_FAILURE;
   }
 
-/*---------------------------------------------------------------------------*/
-/* S E T U P  O P E N C L                                                    */
-/*---------------------------------------------------------------------------*/
-
 /*
- * Select OpenCL device, build OpenCL program from kernelsource.
+ * The work group size the kernel autotuner has measured on this host (see
+ * tuning.h), chosen by the OpenCL driver if it has not been run.
  */
 
-  if (setup_OpenCL(palette_for_openCL, &g_data) == -1)
+  struct tuning tuning;
+  if (load_tuning(GENERATOR_BACKEND, &tuning) == 0 &&
+      set_local_size(&g_data, tuning.local_x, tuning.local_y) != 0)
   {
-    printf("Error setting up OpenCL\n");
+    printf("Error applying the tuning, run the autotuner again\n");
     cleanup();
     return EXIT_FAILURE;
   }
 
+/*
+ * The section of the mandelbrot set, changed by generate_image() (automatic
+ * zoom) or by the view_commands of a consumer (see viewCommand.h).
+ */
+
+  static struct viewport view;
+  init_viewport(&view);
+
+/*
+ * The counters are published in a shared memory segment of their own after
+ * every image (see statsPage.h), read by generatorTop. The work items of the
+ * device can not be counted, the device is listed as a single thread with
+ * the pixels and the time of the image.
+ */
+
+  g_stats = create_stats_page(GENERATOR_BACKEND, &g_statsid);
+  if (g_stats == NULL)
+  {
+    printf("Error creating the stats page, continuing without stats\n");
+  }
+
 /*---------------------------------------------------------------------------*/
 /* G E N E R A T E  I M A G E  D A T A                                       */
 /*                                                                           */
 /* W R I T E  I M A G E  T O  S H A R E D  M E M O R Y                       */
 /*---------------------------------------------------------------------------*/
 
-  #if TIMER_OUTPUT
-
-  clock_t start;
-  clock_t diff;
-  int countimage = 1;
-
-  #endif
+/*
+ * The images in the OpenCL pipeline, oldest first (see OPENCL_PIPELINE_DEPTH
+ * in setup_OpenCL.h). Every image keeps its slot, pixel format, view_commands
+ * and timestamps until it is handed to the consumers.
+ */
 
+  struct pipeline_image
+  {
+    int slot;
+    int format;
+    long long input_time;
+    unsigned long commands;
+    struct frame_times times;
+    struct perf_sample perf_generate;
+    struct cl_frame frame;
+  };
+
+  static struct pipeline_image pipeline[OPENCL_PIPELINE_DEPTH];
+  int oldest = 0;
+  int queued = 0;
 
   while (1)
   {
 
 /*
- * TIMER_OUTPUT can be set to 1 = ON in universalSettings.c
+ * Queue images until the pipeline is full, the device generates them one
+ * after another while the host waits for the oldest one.
  */
 
-    #if TIMER_OUTPUT
+    while (queued < OPENCL_PIPELINE_DEPTH)
+    {
+      struct pipeline_image *image =
+        &pipeline[(oldest + queued) % OPENCL_PIPELINE_DEPTH];
 
-    start = clock();
+/*
+ * Fill the table of pixels with the format the consumers asked for and copy
+ * it to the OpenCL device, the image is generated in this format.
+ */
 
-    #endif
+      if (requested_pixel_format(g_membuf) != format)
+      {
+        format = requested_pixel_format(g_membuf);
+        if ((make_pixel_table(format, PALETTE, PIXELS) != 0) ||
+            (set_pixel_format(PIXELS, bytes_per_pixel(format), &g_data) != 0))
+        {
+          cleanup();
+          return EXIT_FAILURE;
+        }
+        printf("Generating images as %s\n", pixel_format_name(format));
+      }
 
 /*
- * generate_image() (defined in generate_image.c) creates image data and
- * writes it into the local buffer.
- * Executing the OpenCL kernel generated by setup_OpenCL()
- * g_data (struct cl_mem_data) holds the OpenCL kernel.
+ * wait until the slot of the next image is free, before the image is
+ * generated, so it shows the latest view_commands sent while waiting
  */
 
-    if (generate_image(g_buffer, &g_data) == -1)
-    {
-      printf("Error generating image data\n");
-      cleanup();
-      return EXIT_FAILURE;
-    }
+      image->times.acquire = stats_clock();
+      if (acquire_slot_ahead(g_semid, g_membuf, queued, &image->slot) == -1)
+      {
+        perror("semop");
+        cleanup();
+        return EXIT_FAILURE;
+      }
+      image->times.generate = stats_clock();
+      read_perf_counters(&counters, &image->perf_generate);
 
-    #if TIMER_OUTPUT
+/*
+ * Apply the view_commands a consumer has sent since the last image. A queued
+ * kernel is not cancelled, the commands take effect with the next image.
+ */
 
-    diff = clock() - start;
-    int msec = diff * 1000 / CLOCKS_PER_SEC;
-    printf("Time needed for image %d\t%d seconds %d milliseconds\n", countimage,
-           msec/1000, msec%1000);
-    countimage++;
+      struct view_command command;
 
-    #endif
+      while (receive_view_command(g_membuf, &command) == 0)
+      {
+        apply_view_command(&view, &command);
+      }
+      image->format = format;
+      image->input_time = view.input_time;
+      image->commands = view.commands;
+      view.input_time = 0;
 
 /*
- * lock semaphore 1
+ * enqueue_image() (defined in generate_image.c) queues the OpenCL kernel
+ * generated by setup_OpenCL() writing the image into the buffer of the slot
+ * and returns at once.
+ * g_data (struct cl_mem_data) holds the OpenCL kernel.
  */
 
-    s1.sem_op = -1;
+      if (enqueue_image(slot_data(g_membuf, image->slot), &g_data, &view,
+                        &image->frame) != EXIT_SUCCESS)
+      {
+        printf("Error generating image data\n");
+        cleanup();
+        return EXIT_FAILURE;
+      }
+      queued++;
+    }
 
-    if (semop(g_semid, &s1, 1) == -1)
+/*
+ * Wait for the oldest image only, the kernels of the images queued after it
+ * keep the device busy meanwhile. The stages of every image are timed (see
+ * generator_latency.c), the timestamps are passed on to the consumers in the
+ * frame_header.
+ */
+
+    struct pipeline_image *image = &pipeline[oldest];
+    struct frame_times *times = &image->times;
+    int slot = image->slot;
+
+    if (finish_image(&g_data, &image->frame) != EXIT_SUCCESS)
     {
-      perror("semop");
+      printf("Error generating image data\n");
       cleanup();
       return EXIT_FAILURE;
     }
+    times->generated = stats_clock();
+    read_perf_counters(&counters, &perf_generated);
 
-/*
- * Writing the local buffer to the shared memory segment
- */
-
-    for (int i = 0; i < MAX_DATA; i++)
+    if (g_stats != NULL)
     {
-        g_membuf[i] = g_buffer[i];
+      struct thread_stats device;
+      memset(&device, 0, sizeof(device));
+      device.pixels = (unsigned long long) WIDTH * HEIGHT;
+      device.tiles = 1;
+      device.busy_ns = times->generated - times->generate;
+      publish_stats(g_stats, &device, 1, device.busy_ns);
     }
 
+    slot_header(g_membuf, slot)->pixel_format = image->format;
+    slot_header(g_membuf, slot)->input_time = image->input_time;
+    slot_header(g_membuf, slot)->commands_applied = image->commands;
+    slot_header(g_membuf, slot)->tiles_done = number_of_tiles();
+    slot_header(g_membuf, slot)->tile_size = tile_size();
+    slot_header(g_membuf, slot)->partial = 0;
+    times->published = stats_clock();
+    read_perf_counters(&counters, &perf_published);
+    slot_header(g_membuf, slot)->times = *times;
+
 /*
- * unlock semaphore 2
+ * hand the image to the consumers
  */
 
-    s2.sem_op = 1;
-
-    if (semop(g_semid, &s2, 1) == -1)
+    if (publish_slot(g_semid, g_membuf, slot) == -1)
     {
       perror("semop");
       cleanup();
       return EXIT_FAILURE;
     }
+    oldest = (oldest + 1) % OPENCL_PIPELINE_DEPTH;
+    queued--;
+
+    record_generator_perf(PERF_STAGE_COMPUTE, &counters, &image->perf_generate,
+                          &perf_generated, 1);
+    record_generator_perf(PERF_STAGE_COPY, &counters, &perf_generated,
+                          &perf_published, 1);
+    record_generator_latency(times);
+
+    unsigned long framenumber = slot_header(g_membuf, slot)->framenumber;
+    trace_event("slot wait", times->acquire, times->generate, framenumber);
+    trace_event("compute", times->generate, times->generated, framenumber);
+    trace_event("copy", times->generated, times->published, framenumber);
   }
 
 /*
@@ -20,6 +20,8 @@
 #include <errno.h>
 #include "global_ids.h"
 #include "universalSettings.h"
+#include "generator_latency.h"
+#include "trace.h"
 
 void cleanup(void)
 {
@@ -29,6 +31,8 @@ void cleanup(void)
 
   #endif
 
+  print_generator_latency();
+
   if (g_shmid != -1)
   {
     if ((shmctl(g_shmid, IPC_RMID, 0)) < 0)
@@ -51,11 +55,6 @@ void cleanup(void)
       g_semid = -1;
     }
   }
-  if (g_buffer != NULL)
-  {
-    free(g_buffer);
-    g_buffer = NULL;
-  }
   if (g_membuf != NULL)
   {
     if (shmdt(g_membuf) < 0)
@@ -67,6 +66,13 @@ void cleanup(void)
       g_membuf = NULL;
     }
   }
+  if (g_stats != NULL || g_statsid != -1)
+  {
+    remove_stats_page(g_stats, g_statsid);
+    g_stats = NULL;
+    g_statsid = -1;
+  }
+  write_trace("pixelGenerator");
   #if DEBUG
 
   printf("\nCleanup completed.\n");
@@ -13,7 +13,13 @@
  * with the use of OpenCL.
  *
  * Executing the OpenCL kernel build inside the setup_OpenCL() function and
- * changing the start parameters of the mandelbrot set.
+ * changing the start parameters of the mandelbrot set (see viewCommand.h),
+ * unless a consumer has taken over the section.
+ *
+ * If imagebuffer is the image data of a slot the kernel writes into the
+ * buffer of the slot (see use_slot_buffers()). enqueue_image() only queues
+ * the kernel and the read or map of the image, so the pixelGenerator queues
+ * the next image before it waits for this one with finish_image().
  *
  * Copyright (c) 2016 Bernhard Lindner
  *
@@ -21,50 +27,102 @@
  * See /LICENSE for details.
  */
 
+#include <string.h>
+
 #include "generate_image.h"
 #include "numberOfPixel.h"
 #include "universalSettings.h"
 #include "mem_cleanup_opencl.h"
 
-int generate_image(unsigned char *imagebuffer, void *OpenCLdata)
-{
-
 /*
- * struct cl_mem_data defined in mandelbrot.h
+ * int mandel_segment can be set to 1, 2 or 3 to zoom into three different
+ * segments of the mandelbrot set.
  */
 
-  struct cl_mem_data *data = (struct cl_mem_data *) OpenCLdata;
+static const int mandel_segment = 2;
 
 /*
- * int mandel_segment can be set to 1, 2 or 3 to zoom into three different
- * segments of the mandelbrot set.
+ * altering the start parameter to zoom into the madelbrot set.
  */
 
-  int mandel_segment = 2;
+static void zoom_view(struct viewport *view)
+{
+  if (!view->automatic)
+  {
+    return;
+  }
+
+  if (mandel_segment == 1)
+  {
+    view->xmin = view->xmin - 0.005 * view->e;
+    view->xmax = view->xmax - 0.005 * view->e;
+    view->ymin = view->ymin - 0.0062 * view->e;
+    view->ymax = view->ymax - 0.0062 * view->e;
+    view->zoom = view->zoom + 0.01 * view->e;
+    view->e++;
+  }
+
+  if (mandel_segment == 2)
+  {
+    view->xmin = view->xmin - 0.014 * view->e;
+    view->xmax = view->xmax - 0.014 * view->e;
+    view->zoom = view->zoom + 0.01 * view->e;
+    view->e++;
+  }
+
+  if (mandel_segment == 3)
+  {
+    view->xmin = view->xmin - 0.015 * view->e;
+    view->xmax = view->xmax - 0.015 * view->e;
+    view->zoom = view->zoom + 0.01 * view->e;
+    view->e++;
+  }
+}
+
+int enqueue_image(unsigned char *imagebuffer, void *OpenCLdata,
+                  struct viewport *view, struct cl_frame *frame)
+{
 
 /*
- * start parameter for the madelbrot set
+ * struct cl_mem_data defined in mandelbrot.h
  */
 
-  static double xmin = -2.5;
-  static double xmax = 1.5;
-  static double ymin = -1.5;
-  static double ymax = 1.5;
-  static double e = 1;
-  static double zoom = 1;
-
+  struct cl_mem_data *data = (struct cl_mem_data *) OpenCLdata;
 
 /*---------------------------------------------------------------------------*/
 /* S E T  K E R N E L  A R G U M E N T S                                     */
 /*---------------------------------------------------------------------------*/
 
+  cl_mem image = data->imgb;
+
+  frame->imagebuffer = imagebuffer;
+  frame->slot = -1;
+  frame->size = (size_t) WIDTH * HEIGHT * data->bpp;
+  frame->mapped = NULL;
+  frame->done = NULL;
+
+  for (int s = 0; s < data->slots; s++)
+  {
+    if (data->slot[s] == imagebuffer)
+    {
+      image = data->slotb[s];
+      frame->slot = s;
+    }
+  }
+
+/*
+ * The kernel arguments are copied when the kernel is queued, the next image
+ * may set them again at once.
+ */
+
   cl_int err;
-  err  = clSetKernelArg(data->kernel, 1, sizeof(double), &xmin);
-  err |= clSetKernelArg(data->kernel, 2, sizeof(double), &xmax);
-  err |= clSetKernelArg(data->kernel, 3, sizeof(double), &ymin);
-  err |= clSetKernelArg(data->kernel, 4, sizeof(double), &ymax);
-  err |= clSetKernelArg(data->kernel, 5, sizeof(double), &e);
-  err |= clSetKernelArg(data->kernel, 6, sizeof(double), &zoom);
+  err  = clSetKernelArg(data->kernel, 0, sizeof(cl_mem), &image);
+  err |= clSetKernelArg(data->kernel, 1, sizeof(double), &view->xmin);
+  err |= clSetKernelArg(data->kernel, 2, sizeof(double), &view->xmax);
+  err |= clSetKernelArg(data->kernel, 3, sizeof(double), &view->ymin);
+  err |= clSetKernelArg(data->kernel, 4, sizeof(double), &view->ymax);
+  err |= clSetKernelArg(data->kernel, 5, sizeof(double), &view->e);
+  err |= clSetKernelArg(data->kernel, 6, sizeof(double), &view->zoom);
 
   if (err != CL_SUCCESS)
   {
@@ -77,71 +135,165 @@ int generate_image(unsigned char *imagebuffer, void *OpenCLdata)
 /* E X E C U T E  T H E  K E R N E L                                         */
 /*---------------------------------------------------------------------------*/
 
+/*
+ * The kernel waits for the last read or unmap of the buffer only, on an out
+ * of order queue (see setup_OpenCL()) the images of other slots go on. The
+ * work group size of the kernel autotuner (see set_local_size()), NULL lets
+ * the OpenCL driver choose.
+ */
+
+  cl_event *slot_free = (frame->slot != -1) ? &data->slot_free[frame->slot]
+                                              : NULL;
+  cl_uint waits = (slot_free != NULL && *slot_free != NULL) ? 1 : 0;
+  cl_event kernel_done;
+
   const size_t global[2] = {HEIGHT, WIDTH};
+  const size_t *local = (data->local[0] > 0) ? data->local : NULL;
   err = clEnqueueNDRangeKernel(data->commands, data->kernel, 2, NULL, global,
-                               NULL, 0, NULL, NULL);
+                               local, waits, waits ? slot_free : NULL,
+                               &kernel_done);
   if (err)
   {
     printf("Error: Failed to execute kernel!\n");
     mem_cleanup_opencl(data);
     return EXIT_FAILURE;
   }
+  if (waits)
+  {
+    clReleaseEvent(*slot_free);
+    *slot_free = NULL;
+  }
 
 /*
- * Wait for the kernel to finish
+ * Queue the way of the calculated image back into the imagebuffer, frame->done
+ * is set when it is there.
  */
 
-  err = clFinish(data->commands);
-  if (err)
+  #if OPENCL_ZERO_COPY
+
+/*
+ * Mapping a CL_MEM_USE_HOST_PTR buffer returns imagebuffer itself, a CPU
+ * device has written into it already, other devices copy the image into it.
+ * The CL_MEM_ALLOC_HOST_PTR buffer of the device is copied after mapping
+ * (see finish_image()).
+ */
+
+  frame->mapped = clEnqueueMapBuffer(data->commands, image, CL_FALSE,
+                                     CL_MAP_READ, 0, frame->size, 1,
+                                     &kernel_done, &frame->done, &err);
+  if (err != CL_SUCCESS)
   {
-    printf("Error: Waiting for commands to finish!\n");
+    printf("Error: Failed to map the image buffer!\n");
+    clReleaseEvent(kernel_done);
     mem_cleanup_opencl(data);
     return EXIT_FAILURE;
   }
 
-/*
- * Write the calculated image back into the imagebuffer
- */
+  #else
 
-  err = clEnqueueReadBuffer(data->commands, data->imgb, CL_TRUE, 0,
-                            sizeof(unsigned char) * MAX_DATA, imagebuffer,
-                            0, NULL, NULL);
+  err = clEnqueueReadBuffer(data->commands, image, CL_FALSE, 0, frame->size,
+                            imagebuffer, 1, &kernel_done, &frame->done);
   if (err != CL_SUCCESS)
   {
     printf("Error: Failed to read image back into imagebuffer!\n");
+    clReleaseEvent(kernel_done);
     mem_cleanup_opencl(data);
     return EXIT_FAILURE;
   }
 
+  #endif
+
+  clReleaseEvent(kernel_done);
+
 /*
- * altering the start parameter to zoom into the madelbrot set.
+ * Start the device without waiting for it
  */
 
-  if (mandel_segment == 1)
+  err = clFlush(data->commands);
+  if (err)
   {
-    xmin = xmin - 0.005 * e;
-    xmax = xmax - 0.005 * e;
-    ymin = ymin - 0.0062 * e;
-    ymax = ymax - 0.0062 * e;
-    zoom = zoom + 0.01 * e;
-    e++;
+    printf("Error: Failed to flush the command queue!\n");
+    mem_cleanup_opencl(data);
+    return EXIT_FAILURE;
   }
 
-  if (mandel_segment == 2)
+  zoom_view(view);
+
+  return EXIT_SUCCESS;
+}
+
+int finish_image(void *OpenCLdata, struct cl_frame *frame)
+{
+  struct cl_mem_data *data = (struct cl_mem_data *) OpenCLdata;
+
+  cl_int err = clWaitForEvents(1, &frame->done);
+  clReleaseEvent(frame->done);
+  frame->done = NULL;
+  if (err != CL_SUCCESS)
   {
-    xmin = xmin - 0.014 * e;
-    xmax = xmax - 0.014 * e;
-    zoom = zoom + 0.01 * e;
-    e++;
+    printf("Error: Waiting for the image!\n");
+    mem_cleanup_opencl(data);
+    return EXIT_FAILURE;
   }
 
-  if (mandel_segment == 3)
+  #if OPENCL_ZERO_COPY
+
+/*
+ * The unmap of a slot buffer is waited for by the next kernel writing into
+ * it, the unmap of imgb here.
+ */
+
+  cl_mem image = data->imgb;
+  cl_event unmapped;
+
+  if (frame->slot == -1)
+  {
+    memcpy(frame->imagebuffer, frame->mapped, frame->size);
+  }
+  else
+  {
+    image = data->slotb[frame->slot];
+  }
+  err = clEnqueueUnmapMemObject(data->commands, image, frame->mapped, 0, NULL,
+                                &unmapped);
+  if (err != CL_SUCCESS)
+  {
+    printf("Error: Failed to unmap the image buffer!\n");
+    mem_cleanup_opencl(data);
+    return EXIT_FAILURE;
+  }
+  frame->mapped = NULL;
+
+  if (frame->slot != -1)
+  {
+    data->slot_free[frame->slot] = unmapped;
+    clFlush(data->commands);
+  }
+  else
   {
-    xmin = xmin - 0.015 * e;
-    xmax = xmax - 0.015 * e;
-    zoom = zoom + 0.01 * e;
-    e++;
+    err = clWaitForEvents(1, &unmapped);
+    clReleaseEvent(unmapped);
+    if (err != CL_SUCCESS)
+    {
+      printf("Error: Failed to unmap the image buffer!\n");
+      mem_cleanup_opencl(data);
+      return EXIT_FAILURE;
+    }
   }
 
+  #endif
+
   return EXIT_SUCCESS;
 }
+
+int generate_image(unsigned char *imagebuffer, void *OpenCLdata,
+                   struct viewport *view)
+{
+  struct cl_frame frame;
+
+  if (enqueue_image(imagebuffer, OpenCLdata, view, &frame) != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  return finish_image(OpenCLdata, &frame);
+}
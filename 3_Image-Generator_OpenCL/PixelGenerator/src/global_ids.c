@@ -15,6 +15,7 @@
 
 int g_shmid;
 int g_semid;
-unsigned char *g_buffer;
 unsigned char *g_membuf;
+int g_statsid;
+struct stats_page *g_stats;
 struct cl_mem_data g_data;
@@ -24,6 +24,20 @@ void mem_cleanup_opencl(struct cl_mem_data *data)
   {
     printf("Error: Failed to release memory object colpb!\n");
   }
+  for (int s = 0; s < data->slots; s++)
+  {
+    if (data->slot_free[s] != NULL)
+    {
+      clReleaseEvent(data->slot_free[s]);
+      data->slot_free[s] = NULL;
+    }
+    err = clReleaseMemObject(data->slotb[s]);
+    if (err != CL_SUCCESS)
+    {
+      printf("Error: Failed to release memory object of slot %d!\n", s);
+    }
+  }
+  data->slots = 0;
   err = clReleaseProgram(data->program);
   if (err != CL_SUCCESS)
   {
@@ -0,0 +1,211 @@
+/*
+ * FILE = /src/program_cache.c
+ *
+ * RELATED FILES:     *.c                              *.h
+ *                    hostCache.c                      hostCache.h
+ *                                                     program_cache.h
+ *
+ * Reads the kernel source and keeps the OpenCL program built from it in a
+ * file of the host (see program_cache.h), so the next start loads the
+ * binary instead of compiling the kernel again.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "program_cache.h"
+#include "hostCache.h"
+
+#define DEVICE_INFO 256
+
+/*
+ * read_file() returns the contents of the file path with a '\0' appended
+ * and its length without it in *length.
+ */
+
+static char *read_file(const char *path, size_t *length)
+{
+  FILE *file = fopen(path, "rb");
+  if (file == NULL)
+  {
+    return NULL;
+  }
+
+  char *contents = NULL;
+  long size = -1;
+
+  if (fseek(file, 0, SEEK_END) == 0)
+  {
+    size = ftell(file);
+  }
+  if (size >= 0 && fseek(file, 0, SEEK_SET) == 0)
+  {
+    contents = malloc(size + 1);
+  }
+  if (contents != NULL && fread(contents, 1, size, file) != size)
+  {
+    free(contents);
+    contents = NULL;
+  }
+  fclose(file);
+
+  if (contents != NULL)
+  {
+    contents[size] = '\0';
+    *length = size;
+  }
+  return contents;
+}
+
+char *read_kernel_source(const char *path)
+{
+  size_t length;
+  char *source = read_file(path, &length);
+
+  if (source == NULL)
+  {
+    perror(path);
+  }
+  return source;
+}
+
+/*
+ * FNV-1a, the key only has to change whenever one of its strings changes.
+ */
+
+static unsigned long long hash_string(unsigned long long hash,
+                                      const char *string)
+{
+  for (const unsigned char *c = (const unsigned char *) string; ; c++)
+  {
+    hash ^= *c;
+    hash *= 1099511628211ULL;
+    if (*c == '\0')
+    {
+      return hash;
+    }
+  }
+}
+
+int program_cache_name(cl_device_id device, const char *options,
+                       const char *source, char *name, size_t size)
+{
+  const cl_device_info key_info[] =
+  {
+    CL_DEVICE_NAME, CL_DEVICE_VERSION, CL_DRIVER_VERSION
+  };
+  unsigned long long hash = 14695981039346656037ULL;
+  char info[DEVICE_INFO];
+
+  for (int i = 0; i < sizeof(key_info) / sizeof(key_info[0]); i++)
+  {
+    if (clGetDeviceInfo(device, key_info[i], sizeof(info), info, NULL)
+        != CL_SUCCESS)
+    {
+      return -1;
+    }
+    info[sizeof(info) - 1] = '\0';
+    hash = hash_string(hash, info);
+  }
+  hash = hash_string(hash, options);
+  hash = hash_string(hash, source);
+
+  int length = snprintf(name, size, "%s-%016llx", PROGRAM_CACHE, hash);
+  return (length < 0 || length >= size) ? -1 : 0;
+}
+
+cl_program load_program(cl_context context, cl_device_id device,
+                        const char *options, const char *name)
+{
+  char path[HOST_CACHE_PATH];
+  size_t size;
+
+  if (host_cache_path(name, path, sizeof(path)) != 0)
+  {
+    return NULL;
+  }
+  unsigned char *binary = (unsigned char *) read_file(path, &size);
+  if (binary == NULL)
+  {
+    return NULL;
+  }
+
+/*
+ * A binary has to be built as well, the device checks that it can run it.
+ */
+
+  cl_int status;
+  cl_int err;
+  cl_program program = clCreateProgramWithBinary(context, 1, &device, &size,
+                                                 (const unsigned char **)
+                                                 &binary, &status, &err);
+  free(binary);
+  if (err != CL_SUCCESS || status != CL_SUCCESS)
+  {
+    if (program != NULL)
+    {
+      clReleaseProgram(program);
+    }
+    return NULL;
+  }
+  if (clBuildProgram(program, 1, &device, options, NULL, NULL) != CL_SUCCESS)
+  {
+    clReleaseProgram(program);
+    return NULL;
+  }
+  return program;
+}
+
+void save_program(cl_program program, const char *name)
+{
+  char path[HOST_CACHE_PATH];
+  char temporary[HOST_CACHE_PATH + 16];
+  size_t size = 0;
+
+  if (host_cache_path(name, path, sizeof(path)) != 0)
+  {
+    return;
+  }
+  if (clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size), &size,
+                       NULL) != CL_SUCCESS || size == 0)
+  {
+    return;
+  }
+  unsigned char *binary = malloc(size);
+  if (binary == NULL)
+  {
+    return;
+  }
+  if (clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(binary), &binary,
+                       NULL) != CL_SUCCESS)
+  {
+    free(binary);
+    return;
+  }
+
+/*
+ * Several pixelGenerators may start at once, the file is written under
+ * another name and renamed so none of them reads half a binary.
+ */
+
+  snprintf(temporary, sizeof(temporary), "%s.%d", path, (int) getpid());
+  FILE *file = fopen(temporary, "wb");
+  if (file == NULL)
+  {
+    perror(temporary);
+    free(binary);
+    return;
+  }
+  int written = (fwrite(binary, 1, size, file) == size);
+  if (fclose(file) != 0 || !written || rename(temporary, path) != 0)
+  {
+    perror(path);
+    remove(temporary);
+  }
+  free(binary);
+}
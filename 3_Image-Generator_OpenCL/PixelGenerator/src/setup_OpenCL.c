@@ -4,17 +4,27 @@
  * RELATED FILES:     *.c                              *.h
  *                    numberOfPixel.c                  numberOfPixel.h
  *                    mem_cleanup_opencl.c             mem_cleanup_opencl.h
+ *                    program_cache.c                  program_cache.h
  *                                                     setup_OpenCL.h
  *                                                     universalSettings.h
  *
- * This function takes a colorpalette created by the function
- * create_color_palette() as an arguments.
- *
  * The setup_OpenCL() function creates an OpenCL program and kernel for
- * the generation of an image of the mandelbrot set.
+ * the generation of an image of the mandelbrot set. The program is built
+ * from the kernelsource once per device and loaded from the file of the
+ * host afterwards (see program_cache.h).
+ *
+ * The set_pixel_format() function takes a table holding one pixel for every
+ * number of iterations (see pixelFormat.c) and copies it to the device. The
+ * kernel writes the pixels of the image in this format.
  * The image generation and execution of the kernel happens inside
  * the generate_image() function.
  *
+ * The set_local_size() function sets the work group size the kernel autotuner
+ * has measured (see tuning.h).
+ *
+ * The use_slot_buffers() function lets the kernel write into the slots of the
+ * shared memory segment (see OPENCL_ZERO_COPY in setup_OpenCL.h).
+ *
  * By changing COMPUTE_DEVICE defined in setup_OpenCL.h the image can be
  * calculated either on the CPU or if available on a GPU.
  *
@@ -28,6 +38,8 @@
 #include "numberOfPixel.h"
 #include "universalSettings.h"
 #include "mem_cleanup_opencl.h"
+#include "pixelFormat.h"
+#include "program_cache.h"
 
 /*
  * The following sources are great starting points on OpenCL.
@@ -41,101 +53,7 @@
  * https://handsonopencl.github.io
  */
 
-/*---------------------------------------------------------------------------*/
-/* K E R N E L S O U R C E S                                                 */
-/*---------------------------------------------------------------------------*/
-
-/*
- * the kernelsource can be found inside kernelsource_OpenCL/mandelbrot_openCL.cl
- *
- * Use the script:
- * https://github.com/UoB-HPC/SNAP_MPI_OpenCL/blob/master/src/stringify_opencl
- * to convert the .cl kernelsource into a char *kernelsource string.
- *
- * Alternatively the .cl file could be opened with fopen() and read into a
- * char *string with fread().
- */
-
-char * kernelsource =
-"__kernel void mandelbrot(__global unsigned char *imagebuffer,\n"
-"                          double xmin,\n"
-"                          double xmax,\n"
-"                          double ymin,\n"
-"                          double ymax,\n"
-"                          double e,\n"
-"                          double zoom,\n"
-"                          __global unsigned char *palette,\n"
-"                          int WIDTH,\n"
-"                          int HEIGHT)\n"
-"{\n"
-"  const int MAX_ITERATION = 1023;\n"
-"\n"
-"  double xp;\n"
-"  xp = ((xmax - xmin) / WIDTH);\n"
-"  double yp;\n"
-"  yp = ((ymax - ymin) / HEIGHT);\n"
-"\n"
-"  int pixel_y = get_global_id(0);\n"
-"  int pixel_x = get_global_id(1);\n"
-"\n"
-"  if ((pixel_y < HEIGHT) && (pixel_x < WIDTH))\n"
-"  {\n"
-"    double x0;\n"
-"    x0 = ((xmin + (pixel_x * xp)) / zoom);\n"
-"\n"
-"    double y0;\n"
-"    y0 = ((ymax - (pixel_y * yp)) / zoom);\n"
-"\n"
-"    double x;\n"
-"    x = 0.0;\n"
-"\n"
-"    double y;\n"
-"    y = 0.0;\n"
-"\n"
-"    int iteration;\n"
-"    iteration = 0;\n"
-"\n"
-"    double q;\n"
-"    q = (x0 - 0.25) * (x0 - 0.25) + (y0 * y0);\n"
-"\n"
-"    if (((q * (q + (x0 - 0.25))) < (0.25 * (y0 * y0))) ||\n"
-"      (((x0 + 1) * (x0 + 1) + (y0 * y0)) < (0.0625)))\n"
-"    {\n"
-"      iteration = MAX_ITERATION;\n"
-"      imagebuffer[(pixel_y * WIDTH * 3 + (3 * pixel_x))] =\n"
-"      palette[iteration * 3];\n"
-"\n"
-"      imagebuffer[(pixel_y * WIDTH * 3 + (3 * pixel_x) + 1)] =\n"
-"      palette[iteration * 3 + 1];\n"
-"\n"
-"      imagebuffer[(pixel_y * WIDTH * 3 + (3 * pixel_x) + 2)] =\n"
-"      palette[iteration * 3 + 2];\n"
-"    }\n"
-"    else\n"
-"    {\n"
-"      while ((((x * x) + (y * y)) < 4) && (iteration < MAX_ITERATION))\n"
-"      {\n"
-"        double xtemp;\n"
-"        xtemp = ((x * x) - (y * y) + x0);\n"
-"\n"
-"        y = ((2 * x * y) + y0);\n"
-"        x = xtemp;\n"
-"        iteration = iteration + 1;\n"
-"      }\n"
-"      imagebuffer[(pixel_y * WIDTH * 3 + (3 * pixel_x))] =\n"
-"      palette[iteration * 3];\n"
-"\n"
-"      imagebuffer[(pixel_y * WIDTH * 3 + (3 * pixel_x) + 1)] =\n"
-"      palette[iteration * 3 + 1];\n"
-"\n"
-"      imagebuffer[(pixel_y * WIDTH * 3 + (3 * pixel_x) + 2)] =\n"
-"      palette[iteration * 3 + 2];\n"
-"    }\n"
-"  }\n"
-"}\n"
-;
-
-int setup_OpenCL(unsigned char *palette, void *OpenCLdata)
+int setup_OpenCL(void *OpenCLdata)
 {
 
 /*
@@ -179,6 +97,7 @@ int setup_OpenCL(unsigned char *palette, void *OpenCLdata)
   }
 
   device = devices[COMPUTE_DEVICE];
+  data->device = device;
 
   char devicename[256];
   cl_device_info info = CL_DEVICE_NAME;
@@ -211,11 +130,27 @@ int setup_OpenCL(unsigned char *palette, void *OpenCLdata)
 /* C R E A T E  A  C O M M A N D  Q U E U E                                  */
 /*---------------------------------------------------------------------------*/
 
+/*
+ * An out of order queue runs the kernel of the next image while the last one
+ * is read or mapped, the order is kept by the events of generate_image.c.
+ * Devices without it get an in order queue.
+ */
+
   /* OpenCL 2 */
   #if OS_FEDORA
 
+  const cl_queue_properties properties[] =
+  {
+    CL_QUEUE_PROPERTIES, CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE, 0
+  };
+
   data->commands = clCreateCommandQueueWithProperties(data->context, device,
-                                                      0, &err);
+                                                      properties, &err);
+  if (err != CL_SUCCESS)
+  {
+    data->commands = clCreateCommandQueueWithProperties(data->context, device,
+                                                        0, &err);
+  }
   if (err != CL_SUCCESS)
   {
     printf("Error: Failed to create a command commands!\n");
@@ -226,7 +161,13 @@ int setup_OpenCL(unsigned char *palette, void *OpenCLdata)
   /* OpenCL 1.2 */
   #else
 
-  data->commands = clCreateCommandQueue(data->context, device, 0, &err);
+  data->commands = clCreateCommandQueue(data->context, device,
+                                        CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE,
+                                        &err);
+  if (err != CL_SUCCESS)
+  {
+    data->commands = clCreateCommandQueue(data->context, device, 0, &err);
+  }
   if (err != CL_SUCCESS)
   {
     printf("Error: Failed to create a command commands!\n");
@@ -240,8 +181,13 @@ int setup_OpenCL(unsigned char *palette, void *OpenCLdata)
 /* C R E A T E  M E M O R Y  B U F F E R S                                   */
 /*---------------------------------------------------------------------------*/
 
-  data->imgb = clCreateBuffer(data->context, CL_MEM_READ_WRITE,
-                             sizeof(unsigned char) * MAX_DATA, NULL, &err);
+  cl_mem_flags image_flags = CL_MEM_READ_WRITE;
+  #if OPENCL_ZERO_COPY
+  image_flags |= CL_MEM_ALLOC_HOST_PTR;
+  #endif
+
+  data->imgb = clCreateBuffer(data->context, image_flags,
+                             pixel_data_size(PIXEL_XRGB8888), NULL, &err);
   if (err != CL_SUCCESS)
   {
     printf("Error: creating Buffer for imagedata!\n");
@@ -250,45 +196,101 @@ int setup_OpenCL(unsigned char *palette, void *OpenCLdata)
   }
 
   data->colpb = clCreateBuffer(data->context, CL_MEM_READ_WRITE,
-                              sizeof(unsigned char) * 3072, NULL, &err);
+                              PALETTE_SIZE * MAX_BYTES_PER_PIXEL, NULL, &err);
   if (err != CL_SUCCESS)
   {
-    printf("Error: creating Buffer for colorpalette!\n");
+    printf("Error: creating Buffer for table of pixels!\n");
     mem_cleanup_opencl(data);
     return EXIT_FAILURE;
   }
 
 /*---------------------------------------------------------------------------*/
-/* C R E A T E  A  P R O G R A M  F R O M  K E R N E L S O U R C E           */
+/* R E A D  T H E  K E R N E L S O U R C E                                   */
 /*---------------------------------------------------------------------------*/
 
-  data->program = clCreateProgramWithSource(data->context, 1,
-                                           (const char **) &kernelsource,
-                                            NULL, &err);
-  if (err != CL_SUCCESS)
+/*
+ * The kernelsource can be found inside kernelsource_OpenCL/mandelbrot_openCL.cl
+ * (see OPENCL_KERNEL_FILE in setup_OpenCL.h). The size of the image and the
+ * number of iterations are compiled in, the loops of the kernel are built
+ * for them.
+ */
+
+  char *kernelsource = read_kernel_source(OPENCL_KERNEL_FILE);
+  if (kernelsource == NULL)
   {
-    printf("Error: Creating program from kernelsource!\n");
+    printf("Error: Reading the kernelsource!\n");
     mem_cleanup_opencl(data);
     return EXIT_FAILURE;
   }
 
+  char options[OPENCL_OPTIONS_SIZE];
+  snprintf(options, sizeof(options),
+           "-D WIDTH=%d -D HEIGHT=%d -D MAX_ITERATION=%d %s", WIDTH, HEIGHT,
+           PALETTE_SIZE - 1, OPENCL_BUILD_OPTIONS);
+
 /*---------------------------------------------------------------------------*/
-/* B U I L D  T H E  P R O G R A M  E X E C U T A B L E                      */
+/* L O A D  T H E  P R O G R A M  B U I L T  B E F O R E                     */
 /*---------------------------------------------------------------------------*/
 
-  err = clBuildProgram(data->program, 0, NULL, NULL, NULL, NULL);
-  if (err != CL_SUCCESS)
+  char cache_name[PROGRAM_CACHE_NAME];
+  int cached = (program_cache_name(device, options, kernelsource, cache_name,
+                                   sizeof(cache_name)) == 0);
+
+  data->program = NULL;
+  if (cached)
   {
-    size_t len;
-    char buffer[2048];
+    data->program = load_program(data->context, device, options, cache_name);
+  }
 
-    printf("Error: Failed to build program executable!\n");
-    clGetProgramBuildInfo(data->program, device, CL_PROGRAM_BUILD_LOG,
-                          sizeof(buffer), buffer, &len);
-    printf("%s\n", buffer);
-    mem_cleanup_opencl(data);
-    return EXIT_FAILURE;
+  #if DEBUG
+
+  printf("%s the OpenCL program\n",
+         (data->program != NULL) ? "Loaded" : "Building");
+
+  #endif
+
+/*---------------------------------------------------------------------------*/
+/* C R E A T E  A  P R O G R A M  F R O M  K E R N E L S O U R C E           */
+/*---------------------------------------------------------------------------*/
+
+  if (data->program == NULL)
+  {
+    data->program = clCreateProgramWithSource(data->context, 1,
+                                              (const char **) &kernelsource,
+                                              NULL, &err);
+    if (err != CL_SUCCESS)
+    {
+      printf("Error: Creating program from kernelsource!\n");
+      free(kernelsource);
+      mem_cleanup_opencl(data);
+      return EXIT_FAILURE;
+    }
+
+/*---------------------------------------------------------------------------*/
+/* B U I L D  T H E  P R O G R A M  E X E C U T A B L E                      */
+/*---------------------------------------------------------------------------*/
+
+    err = clBuildProgram(data->program, 1, &device, options, NULL, NULL);
+    if (err != CL_SUCCESS)
+    {
+      size_t len;
+      char buffer[2048];
+
+      printf("Error: Failed to build program executable!\n");
+      clGetProgramBuildInfo(data->program, device, CL_PROGRAM_BUILD_LOG,
+                            sizeof(buffer), buffer, &len);
+      printf("%s\n", buffer);
+      free(kernelsource);
+      mem_cleanup_opencl(data);
+      return EXIT_FAILURE;
+    }
+
+    if (cached)
+    {
+      save_program(data->program, cache_name);
+    }
   }
+  free(kernelsource);
 
 /*---------------------------------------------------------------------------*/
 /* C R E A T E  T H E  C O M P U T E  K E R N E L                            */
@@ -303,34 +305,147 @@ int setup_OpenCL(unsigned char *palette, void *OpenCLdata)
   }
 
 /*---------------------------------------------------------------------------*/
-/* W R I T E  C O L O R P A L E T T E  I N T O  B U F F E R                  */
+/* S E T  K E R N E L  A R G U M E N T S                                     */
 /*---------------------------------------------------------------------------*/
 
-  err = clEnqueueWriteBuffer(data->commands, data->colpb, CL_TRUE, 0,
-                             sizeof(unsigned char) * 3072, palette,
-                             0, NULL, NULL);
+  err =  clSetKernelArg(data->kernel, 0, sizeof(cl_mem), &data->imgb);
+  err |= clSetKernelArg(data->kernel, 7, sizeof(cl_mem), &data->colpb);
+
   if (err != CL_SUCCESS)
   {
-    printf("Error: Failed to write colorpalette to buffer!\n");
+    printf("Error: Failed to set kernel arguments! %d\n", err);
     mem_cleanup_opencl(data);
     return EXIT_FAILURE;
   }
 
+  return EXIT_SUCCESS;
+}
+
+/*
+ * set_pixel_format() is called before the first image and whenever a consumer
+ * asks for another pixel format. The kernels queued before still use the old
+ * table, so it waits for them.
+ */
+
+int set_pixel_format(unsigned char *pixels, int bpp, void *OpenCLdata)
+{
+  struct cl_mem_data *data = (struct cl_mem_data *) OpenCLdata;
+
 /*---------------------------------------------------------------------------*/
-/* S E T  K E R N E L  A R G U M E N T S                                     */
+/* W R I T E  T A B L E  O F  P I X E L S  I N T O  B U F F E R              */
 /*---------------------------------------------------------------------------*/
 
-  err =  clSetKernelArg(data->kernel, 0, sizeof(cl_mem), &data->imgb);
-  err |= clSetKernelArg(data->kernel, 7, sizeof(cl_mem), &data->colpb);
-  err |= clSetKernelArg(data->kernel, 8, sizeof(int), &WIDTH);
-  err |= clSetKernelArg(data->kernel, 9, sizeof(int), &HEIGHT);
+  cl_int err = clFinish(data->commands);
+  if (err != CL_SUCCESS)
+  {
+    printf("Error: Waiting for commands to finish!\n");
+    return EXIT_FAILURE;
+  }
+
+  err = clEnqueueWriteBuffer(data->commands, data->colpb, CL_TRUE, 0,
+                             PALETTE_SIZE * bpp, pixels, 0, NULL, NULL);
+  if (err != CL_SUCCESS)
+  {
+    printf("Error: Failed to write table of pixels to buffer!\n");
+    return EXIT_FAILURE;
+  }
 
+  err = clSetKernelArg(data->kernel, 8, sizeof(int), &bpp);
   if (err != CL_SUCCESS)
   {
     printf("Error: Failed to set kernel arguments! %d\n", err);
-    mem_cleanup_opencl(data);
     return EXIT_FAILURE;
   }
 
+  data->bpp = bpp;
+  return EXIT_SUCCESS;
+}
+
+int set_local_size(void *OpenCLdata, int local_x, int local_y)
+{
+  struct cl_mem_data *data = (struct cl_mem_data *) OpenCLdata;
+
+  if (local_x == 0 || local_y == 0)
+  {
+    data->local[0] = 0;
+    data->local[1] = 0;
+    return 0;
+  }
+  if (local_x < 0 || local_y < 0 || WIDTH % local_x != 0 ||
+      HEIGHT % local_y != 0)
+  {
+    printf("Error: %dx%d pixels can not be split into work groups of %dx%d\n",
+           WIDTH, HEIGHT, local_x, local_y);
+    return -1;
+  }
+
+/*
+ * The largest work group the device runs this kernel with, it depends on the
+ * registers and local memory the kernel needs.
+ */
+
+  size_t max_items;
+  cl_int err;
+  err = clGetKernelWorkGroupInfo(data->kernel, data->device,
+                                 CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t),
+                                 &max_items, NULL);
+  if (err != CL_SUCCESS)
+  {
+    printf("Error: Failed to get the work group size! %d\n", err);
+    return -1;
+  }
+  if ((size_t) local_x * local_y > max_items)
+  {
+    printf("Error: Work group of %dx%d is larger than %zu work items\n",
+           local_x, local_y, max_items);
+    return -1;
+  }
+
+  data->local[0] = local_y;
+  data->local[1] = local_x;
+  return 0;
+}
+
+/*
+ * use_slot_buffers() creates a buffer for every slot of the shared memory
+ * segment. With OPENCL_ZERO_COPY the host memory of the slot stays the memory
+ * of the buffer (CL_MEM_USE_HOST_PTR), without it the buffer is memory of the
+ * device read into the slot. Each slot having its own buffer lets the kernel
+ * of the next image run while the last one is read.
+ */
+
+int use_slot_buffers(unsigned char *segment, void *OpenCLdata)
+{
+  struct cl_mem_data *data = (struct cl_mem_data *) OpenCLdata;
+
+  for (int s = 0; s < NUMBER_OF_SLOTS; s++)
+  {
+    cl_int err;
+    data->slot[s] = slot_data(segment, s);
+    data->slot_free[s] = NULL;
+
+    #if OPENCL_ZERO_COPY
+
+    data->slotb[s] = clCreateBuffer(data->context,
+                                    CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR,
+                                    pixel_data_size(PIXEL_XRGB8888),
+                                    data->slot[s], &err);
+
+    #else
+
+    data->slotb[s] = clCreateBuffer(data->context, CL_MEM_WRITE_ONLY,
+                                    pixel_data_size(PIXEL_XRGB8888), NULL,
+                                    &err);
+
+    #endif
+
+    if (err != CL_SUCCESS)
+    {
+      printf("Error: creating Buffer for slot %d! %d\n", s, err);
+      return EXIT_FAILURE;
+    }
+    data->slots = s + 1;
+  }
+
   return EXIT_SUCCESS;
 }
@@ -1,3 +1,12 @@
+/*
+ * The kernel of the OpenCL image generator, read and built by setup_OpenCL()
+ * (see setup_OpenCL.c). WIDTH, HEIGHT and MAX_ITERATION are given as build
+ * options (-D WIDTH=800 ...), so the compiler knows the loop bounds.
+ *
+ * Every work item writes the pixel of the table pixels (see pixelFormat.c)
+ * for the number of iterations of one point, bpp bytes each.
+ */
+
 __kernel void mandelbrot(__global unsigned char *imagebuffer,
                           double xmin,
                           double xmax,
@@ -5,12 +14,9 @@ __kernel void mandelbrot(__global unsigned char *imagebuffer,
                           double ymax,
                           double e,
                           double zoom,
-                          __global unsigned char *palette,
-                          int WIDTH,
-                          int HEIGHT)
+                          __global unsigned char *pixels,
+                          int bpp)
 {
-  const int MAX_ITERATION = 1023;
-
   double xp;
   xp = ((xmax - xmin) / WIDTH);
   double yp;
@@ -43,14 +49,6 @@ __kernel void mandelbrot(__global unsigned char *imagebuffer,
       (((x0 + 1) * (x0 + 1) + (y0 * y0)) < (0.0625)))
     {
       iteration = MAX_ITERATION;
-      imagebuffer[(pixel_y * WIDTH * 3 + (3 * pixel_x))] =
-      palette[iteration * 3];
-
-      imagebuffer[(pixel_y * WIDTH * 3 + (3 * pixel_x) + 1)] =
-      palette[iteration * 3 + 1];
-
-      imagebuffer[(pixel_y * WIDTH * 3 + (3 * pixel_x) + 2)] =
-      palette[iteration * 3 + 2];
     }
     else
     {
@@ -63,14 +61,12 @@ __kernel void mandelbrot(__global unsigned char *imagebuffer,
         x = xtemp;
         iteration = iteration + 1;
       }
-      imagebuffer[(pixel_y * WIDTH * 3 + (3 * pixel_x))] =
-      palette[iteration * 3];
-
-      imagebuffer[(pixel_y * WIDTH * 3 + (3 * pixel_x) + 1)] =
-      palette[iteration * 3 + 1];
+    }
 
-      imagebuffer[(pixel_y * WIDTH * 3 + (3 * pixel_x) + 2)] =
-      palette[iteration * 3 + 2];
+    for (int b = 0; b < bpp; b++)
+    {
+      imagebuffer[(pixel_y * WIDTH + pixel_x) * bpp + b] =
+      pixels[iteration * bpp + b];
     }
   }
 }
@@ -0,0 +1,32 @@
+/*
+ * FILE = HEADER: /include/hostCache.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _hostCache_
+#define _hostCache_
+
+#include <stddef.h>
+
+/*
+ * Results measured on a host (the fastest backend, see backend.h, and the
+ * settings of the kernel autotuner, see tuning.h) and the OpenCL programs
+ * built for its device (see program_cache.h) are kept in files named
+ * <hostname>-<name> in $XDG_CACHE_HOME/mandelbrot or ~/.cache/mandelbrot,
+ * so hosts sharing a home directory keep their own.
+ *
+ * host_cache_path() writes the path of the file to path and creates the
+ * directory if it is missing. Returns -1 if there is no home directory or
+ * the path does not fit, the caller measures again then.
+ */
+
+#define HOST_CACHE_DIR "mandelbrot"
+#define HOST_CACHE_PATH 512
+
+int host_cache_path(const char *name, char *path, size_t size);
+
+#endif
@@ -15,9 +15,14 @@
 /*
  * LARGE_IMAGE 0 sets image width and height to 800x600
  * LARGE_IMAGE 1 sets image width and height to 2560x1920
+ *
+ * It can also be given to the compiler (-DLARGE_IMAGE=1), the kernel
+ * benchmark is built for both sizes this way.
  */
 
+#ifndef LARGE_IMAGE
 #define LARGE_IMAGE 0
+#endif
 
 extern const int WIDTH;
 extern const int HEIGHT;
@@ -0,0 +1,74 @@
+/*
+ * FILE = HEADER: /include/perfCounters.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _perfCounters_
+#define _perfCounters_
+
+#include "universalSettings.h"
+
+/*
+ * Hardware performance counters of the calling thread (perf_event_open(),
+ * Linux only), enabled with PERF_COUNTERS in universalSettings.h.
+ *
+ * Every thread opens its own counters with open_perf_counters() and reads
+ * them before and after a stage, add_perf() adds the difference to the
+ * totals of the stage. Only user space is counted, which is allowed with the
+ * default perf_event_paranoid setting of 2.
+ *
+ * Without perf events (containers without CAP_PERFMON, virtual machines
+ * without a PMU, other systems) open_perf_counters() fails, a message is
+ * printed once and the programs run without counters. A single counter the
+ * cpu does not support is left out and shown as n/a.
+ */
+
+#define PERF_CYCLES 0
+#define PERF_INSTRUCTIONS 1
+#define PERF_CACHE_MISSES 2
+#define PERF_BRANCH_MISSES 3
+#define PERF_EVENTS 4
+
+struct perf_counters
+{
+  int fd[PERF_EVENTS];             // -1 if the counter is not available
+};
+
+struct perf_sample
+{
+  unsigned long long value[PERF_EVENTS];
+};
+
+/*
+ * The totals of one stage, added up by all threads running the stage.
+ */
+
+struct perf_stage
+{
+  unsigned long long value[PERF_EVENTS];
+  unsigned long long frames;
+  int missing[PERF_EVENTS];        // set if a thread could not count it
+};
+
+int open_perf_counters(struct perf_counters *counters);
+void close_perf_counters(struct perf_counters *counters);
+void read_perf_counters(struct perf_counters *counters,
+                        struct perf_sample *sample);
+void add_perf(struct perf_stage *stage, struct perf_counters *counters,
+              const struct perf_sample *begin, const struct perf_sample *end,
+              int frames);
+
+/*
+ * print_perf() prints one line per stage: IPC, cycles, instructions, cache
+ * misses per image and mispredicted branches per 100 instructions. Nothing is
+ * printed if no stage has been counted.
+ */
+
+void print_perf(const char *title, const char *names[],
+                const struct perf_stage *stages, int number_of_stages);
+
+#endif
@@ -0,0 +1,47 @@
+/*
+ * FILE = HEADER: /include/pixelFormat.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _pixelFormat_
+#define _pixelFormat_
+
+#include <stddef.h>
+
+/*
+ * Pixel formats of the images in the shared memory segment. Every consumer
+ * asks the pixelGenerator for the format it needs (see sharedSegment.h).
+ *
+ * PIXEL_RGB24:    3 bytes per pixel, red, green and blue (ppm)
+ * PIXEL_XRGB8888: one 32 bit value per pixel, 0x00RRGGBB in host byte order
+ *                 (the pixel format of an SDL surface)
+ * PIXEL_INDEX16:  one 16 bit value per pixel in host byte order, the index
+ *                 into the palette of the shared memory segment (the number
+ *                 of iterations), the consumer colorizes the image itself
+ */
+
+#define PIXEL_RGB24 0
+#define PIXEL_XRGB8888 1
+#define PIXEL_INDEX16 2
+
+#define MAX_BYTES_PER_PIXEL 4
+
+/*
+ * One color for every number of iterations (see colorpalette.c)
+ */
+
+#define PALETTE_SIZE 1024
+
+int bytes_per_pixel(int format);
+size_t pixel_data_size(int format);
+char *pixel_format_name(int format);
+int make_pixel_table(int format, unsigned char palette[][3],
+                     unsigned char *table);
+int convert_to_rgb24(unsigned char *rgb, unsigned char *pixels, int format,
+                     unsigned char palette[][3]);
+
+#endif
@@ -0,0 +1,54 @@
+/*
+ * FILE = HEADER: /include/trace.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _trace_
+#define _trace_
+
+#include "universalSettings.h"
+
+/*
+ * With TRACE_OUTPUT set to 1 (universalSettings.h) the pixelGenerator and
+ * the imageWriter record what every thread does and when, and write it to a
+ * Chrome trace file (trace-<program>.json) when they terminate. The file can
+ * be opened in chrome://tracing or https://ui.perfetto.dev.
+ *
+ * Every thread records its events into a buffer of its own, no locks and no
+ * atomic operations are needed. A buffer holds the last TRACE_EVENTS events
+ * of its thread, older events are overwritten.
+ *
+ * An event covers the time from begin to end (CLOCK_MONOTONIC nanoseconds,
+ * see stats_clock() and pipeline_clock()), arg is shown with the event
+ * (number of the tile or the image). The name has to be a string constant.
+ *
+ * The timestamps of both programs are taken with the same clock, their files
+ * can be joined to a single timeline:
+ *
+ * jq -s '{traceEvents: map(.traceEvents) | add}' trace-*.json > trace.json
+ *
+ * With TRACE_OUTPUT set to 0 trace_event() compiles to nothing.
+ */
+
+#define TRACE_MAX_THREADS 64
+#define TRACE_NEXT_THREAD -1
+
+int trace_thread(int id, const char *name);
+void record_trace_event(const char *name, long long begin, long long end,
+                        long arg);
+int write_trace(const char *program);
+
+static inline void trace_event(const char *name, long long begin,
+                               long long end, long arg)
+{
+  if (TRACE_OUTPUT)
+  {
+    record_trace_event(name, begin, end, arg);
+  }
+}
+
+#endif
@@ -0,0 +1,94 @@
+/*
+ * FILE = HEADER: /include/viewCommand.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _viewCommand_
+#define _viewCommand_
+
+/*
+ * Commands sent by a consumer (the SDL_Viewer) to the pixelGenerator to
+ * change the section of the mandelbrot set shown by the following images.
+ * Positions and distances are given in pixels of the image.
+ *
+ * VIEW_PAN:  move the image content by x, y pixels
+ * VIEW_ZOOM: zoom by factor, the point at pixel x, y stays where it is
+ * VIEW_AUTO: restart the automatic zoom of the pixelGenerator
+ *
+ * sent is the view_clock() time of the first input that led to the command,
+ * the image showing its result carries it in its frame_header.
+ */
+
+#define VIEW_PAN 1
+#define VIEW_ZOOM 2
+#define VIEW_AUTO 3
+
+struct view_command
+{
+  int type;
+  double x;
+  double y;
+  double factor;
+  long long sent;
+};
+
+/*
+ * The commands are passed through a ring buffer in the segment_header
+ * (see sharedSegment.h) without locks. head is only written by the consumer
+ * sending the commands, tail only by the pixelGenerator, so only one consumer
+ * may send commands at a time.
+ */
+
+#define COMMAND_QUEUE_SIZE 16
+
+struct command_queue
+{
+  unsigned long head;              // index of the next command to be sent
+  unsigned long tail;              // index of the next command to be applied
+  struct view_command command[COMMAND_QUEUE_SIZE];
+};
+
+/*
+ * The section of the mandelbrot set the pixelGenerator generates. A pixel
+ * x, y of the image shows the point
+ *   ((xmin + x * (xmax - xmin) / WIDTH) / zoom,
+ *    (ymax - y * (ymax - ymin) / HEIGHT) / zoom)
+ *
+ * automatic is 1 while the pixelGenerator zooms along its own path (e is its
+ * step), the first command from a consumer ends it. input_time is the sent
+ * time of the oldest command not yet shown in an image, 0 if there is none.
+ * commands counts the commands applied so far, a consumer knows which of the
+ * commands it has sent an image shows.
+ * cancellable tells generate_image() it may stop as soon as a new command
+ * arrives, because the image would show an old section.
+ */
+
+struct viewport
+{
+  double xmin;
+  double xmax;
+  double ymin;
+  double ymax;
+  double zoom;
+  double e;
+  int automatic;
+  long long input_time;
+  unsigned long commands;
+  int cancellable;
+};
+
+long long view_clock(void);
+
+void reset_view_commands(unsigned char *segment);
+int send_view_command(unsigned char *segment, struct view_command *command);
+int receive_view_command(unsigned char *segment, struct view_command *command);
+int view_commands_pending(unsigned char *segment);
+
+void init_viewport(struct viewport *view);
+void apply_view_command(struct viewport *view, struct view_command *command);
+
+#endif
@@ -0,0 +1,199 @@
+/*
+ * FILE = /src/sharedSegment.c
+ *
+ * This file holds the layout of the shared memory segment and the functions
+ * used to hand images from the pixelGenerator to its consumers.
+ * This file is used by the imageWriter and pixelGenerator program.
+ *
+ * The segment starts with a struct segment_header followed by NUMBER_OF_SLOTS
+ * slots. Each slot holds a struct frame_header and the image data.
+ * Header and image data start at a page boundary. The image data of a slot
+ * is large enough for every pixel format (see pixelFormat.h).
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <stddef.h>
+#include <sys/ipc.h>
+#include <sys/sem.h>
+
+#include "numberOfPixel.h"
+#include "sharedSegment.h"
+
+#define SEGMENT_ALIGNMENT 4096
+
+_Static_assert(sizeof(struct segment_header) <= SEGMENT_ALIGNMENT,
+               "struct segment_header does not fit into its page");
+
+static size_t align_up(size_t size)
+{
+  return (size + SEGMENT_ALIGNMENT - 1) & ~((size_t) SEGMENT_ALIGNMENT - 1);
+}
+
+static size_t slot_size(void)
+{
+  return SEGMENT_ALIGNMENT +
+         align_up((size_t) WIDTH * HEIGHT * MAX_BYTES_PER_PIXEL);
+}
+
+size_t segment_size(void)
+{
+  return SEGMENT_ALIGNMENT + NUMBER_OF_SLOTS * slot_size();
+}
+
+struct segment_header *segment_header(unsigned char *segment)
+{
+  return (struct segment_header *) segment;
+}
+
+struct frame_header *slot_header(unsigned char *segment, int slot)
+{
+  return (struct frame_header *) (segment + SEGMENT_ALIGNMENT +
+                                  slot * slot_size());
+}
+
+unsigned char *slot_data(unsigned char *segment, int slot)
+{
+  return segment + SEGMENT_ALIGNMENT + slot * slot_size() + SEGMENT_ALIGNMENT;
+}
+
+/*
+ * The semaphore operations below do not use SEM_UNDO. A consumer exiting
+ * after having handled n images would otherwise add n images to the
+ * semaphore counting the images that are ready to be claimed.
+ * A consumer holding a slot has to call release_slot() before it exits.
+ */
+
+static int semaphore_op(int semid, int semnum, int op)
+{
+  struct sembuf s;
+
+  s.sem_num = semnum;
+  s.sem_op = op;
+  s.sem_flg = 0;
+
+  return semop(semid, &s, 1);
+}
+
+/*
+ * acquire_slot() blocks until the slot of the next image is free and returns
+ * it in *slot. Only used by the pixelGenerator.
+ */
+
+int acquire_slot(int semid, unsigned char *segment, int *slot)
+{
+  return acquire_slot_ahead(semid, segment, 0, slot);
+}
+
+/*
+ * acquire_slot_ahead() is acquire_slot() for the image following the queued
+ * images acquired but not published yet, so a pixelGenerator can generate
+ * the next images while the last one is finished.
+ */
+
+int acquire_slot_ahead(int semid, unsigned char *segment, int queued,
+                       int *slot)
+{
+  struct segment_header *header = segment_header(segment);
+
+  *slot = (header->next_frame + queued) % NUMBER_OF_SLOTS;
+
+  return semaphore_op(semid, SEM_SLOT_FREE(*slot), -1);
+}
+
+/*
+ * publish_slot() numbers the image stored in the slot and hands it to the
+ * consumers. Only used by the pixelGenerator.
+ */
+
+int publish_slot(int semid, unsigned char *segment, int slot)
+{
+  struct segment_header *header = segment_header(segment);
+
+  header->next_frame++;
+  slot_header(segment, slot)->framenumber = header->next_frame;
+  __sync_synchronize();
+
+  return semaphore_op(semid, SEM_FRAMES_READY, 1);
+}
+
+/*
+ * claim_frame() blocks until an image is ready and claims the oldest
+ * unclaimed image for the calling consumer.
+ * The semaphore guarantees that there is one ready image for every successful
+ * semop(), so the index taken from next_claim afterwards always belongs to an
+ * image that has already been published. Two consumers can never claim the
+ * same image.
+ * Returns -1 with errno EPROTO if the slot holds another image than the one
+ * claimed. The slot is released again, the consumer has to stop instead of
+ * writing the image under a wrong number.
+ */
+
+int claim_frame(int semid, unsigned char *segment, int *slot)
+{
+  struct segment_header *header = segment_header(segment);
+
+  if (semaphore_op(semid, SEM_FRAMES_READY, -1) == -1)
+  {
+    return -1;
+  }
+
+  unsigned long claim = __sync_fetch_and_add(&header->next_claim, 1);
+  *slot = claim % NUMBER_OF_SLOTS;
+  __sync_synchronize();
+
+  if (slot_header(segment, *slot)->framenumber != claim + 1)
+  {
+    printf("Error: slot %d holds image %lu instead of image %lu\n", *slot,
+           slot_header(segment, *slot)->framenumber, claim + 1);
+
+    int claimed = *slot;
+    *slot = -1;
+    release_slot(semid, claimed);
+    errno = EPROTO;
+    return -1;
+  }
+
+  return 0;
+}
+
+/*
+ * release_slot() hands the slot back to the pixelGenerator.
+ */
+
+int release_slot(int semid, int slot)
+{
+  return semaphore_op(semid, SEM_SLOT_FREE(slot), 1);
+}
+
+/*
+ * request_pixel_format() asks the pixelGenerator to generate the following
+ * images in format. Used by the consumers.
+ */
+
+void request_pixel_format(unsigned char *segment, int format)
+{
+  segment_header(segment)->pixel_format = format;
+  __sync_synchronize();
+}
+
+/*
+ * requested_pixel_format() returns the format the pixelGenerator has to
+ * generate the next image in. Only used by the pixelGenerator.
+ */
+
+int requested_pixel_format(unsigned char *segment)
+{
+  int format = *(volatile int *) &segment_header(segment)->pixel_format;
+
+  if (bytes_per_pixel(format) == -1)
+  {
+    return PIXEL_RGB24;
+  }
+  return format;
+}
@@ -0,0 +1,22 @@
+/*
+ * FILE = HEADER: /include/ioUring.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _ioUring_
+#define _ioUring_
+
+#include "pipeline.h"
+#include "output.h"
+
+int uring_open(int frames_in_flight, int direct);
+int uring_write_frame(struct frame *frame, frame_done_t done);
+int uring_poll(void);
+int uring_flush(void);
+void uring_close(void);
+
+#endif
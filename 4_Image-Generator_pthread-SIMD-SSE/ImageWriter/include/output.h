@@ -0,0 +1,47 @@
+/*
+ * FILE = HEADER: /include/output.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _output_
+#define _output_
+
+#include "pipeline.h"
+
+/*
+ * Output backends (see OUTPUT_BACKEND in writerSettings.h)
+ */
+
+#define OUTPUT_STDIO 0
+#define OUTPUT_IO_URING 1
+#define OUTPUT_STREAM 2
+#define OUTPUT_ARCHIVE 3
+#define OUTPUT_MMAP 4             // direct output backends, see direct.h
+#define OUTPUT_WRITEV 5
+
+/*
+ * output_frame() calls done() once the image has been written and its
+ * buffer can be used again. Depending on the backend this happens before
+ * output_frame() returns or later from inside output_frame() or
+ * flush_output().
+ */
+
+typedef void (*frame_done_t)(struct frame *frame);
+
+int open_output(int backend, int direct, int frames_in_flight,
+                char *file);
+/*
+ * poll_output() calls done() for the images written in the meantime without
+ * waiting and returns the number of images still in flight, -1 on an error.
+ */
+
+int output_frame(struct frame *frame, frame_done_t done);
+int poll_output(void);
+int flush_output(void);
+void close_output(void);
+
+#endif
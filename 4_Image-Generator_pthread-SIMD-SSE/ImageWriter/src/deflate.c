@@ -0,0 +1,377 @@
+/*
+ * FILE = /src/deflate.c
+ *
+ * A small deflate compressor (RFC 1951) and the checksums needed for PNG
+ * files (adler32 of the zlib stream, crc32 of the chunks).
+ *
+ * deflate_block() compresses its input into one block with the fixed Huffman
+ * codes of deflate. Matches are found with a hash table holding the last
+ * position of every 4 byte sequence, there is only one candidate per
+ * position. This is much faster than zlib and still compresses the large
+ * flat areas of a Mandelbrot image very well: a run of equal bytes costs
+ * 13 bits per 258 bytes.
+ *
+ * A block never refers to data before its input. Blocks compressed
+ * independently can be concatenated into one stream: every block but the
+ * last one ends with an empty stored block, which aligns the stream to a
+ * byte boundary (like Z_SYNC_FLUSH of zlib).
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "deflate.h"
+
+#define HASH_BITS 15
+#define WINDOW_SIZE 32768
+#define MIN_MATCH 4
+#define MAX_MATCH 258
+#define END_OF_BLOCK 256
+
+/*
+ * Bit reversed fixed Huffman codes and their lengths
+ */
+
+static unsigned short g_literal_code[288];
+static unsigned char g_literal_bits[288];
+static unsigned char g_distance_code[30];
+static unsigned long g_crc_table[256];
+static pthread_once_t g_tables_once = PTHREAD_ONCE_INIT;
+
+static unsigned reverse_bits(unsigned code, int bits)
+{
+  unsigned reversed = 0;
+  for (int i = 0; i < bits; i++)
+  {
+    reversed = (reversed << 1) | ((code >> i) & 1);
+  }
+  return reversed;
+}
+
+static void init_tables(void)
+{
+  for (int symbol = 0; symbol < 288; symbol++)
+  {
+    unsigned code;
+    int bits;
+
+    if (symbol < 144)
+    {
+      code = 0x30 + symbol;
+      bits = 8;
+    }
+    else if (symbol < 256)
+    {
+      code = 0x190 + symbol - 144;
+      bits = 9;
+    }
+    else if (symbol < 280)
+    {
+      code = symbol - 256;
+      bits = 7;
+    }
+    else
+    {
+      code = 0xc0 + symbol - 280;
+      bits = 8;
+    }
+    g_literal_code[symbol] = reverse_bits(code, bits);
+    g_literal_bits[symbol] = bits;
+  }
+
+  for (int symbol = 0; symbol < 30; symbol++)
+  {
+    g_distance_code[symbol] = reverse_bits(symbol, 5);
+  }
+
+  for (unsigned long n = 0; n < 256; n++)
+  {
+    unsigned long c = n;
+    for (int k = 0; k < 8; k++)
+    {
+      c = (c & 1) ? 0xedb88320UL ^ (c >> 1) : c >> 1;
+    }
+    g_crc_table[n] = c;
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+/* B I T  W R I T E R                                                        */
+/*---------------------------------------------------------------------------*/
+
+struct bit_writer
+{
+  unsigned char *out;
+  unsigned long long bits;
+  int count;
+};
+
+static void put_bits(struct bit_writer *w, unsigned value, int bits)
+{
+  w->bits |= (unsigned long long) value << w->count;
+  w->count += bits;
+  if (w->count >= 32)
+  {
+    w->out[0] = w->bits & 0xff;
+    w->out[1] = (w->bits >> 8) & 0xff;
+    w->out[2] = (w->bits >> 16) & 0xff;
+    w->out[3] = (w->bits >> 24) & 0xff;
+    w->out += 4;
+    w->bits >>= 32;
+    w->count -= 32;
+  }
+}
+
+/*
+ * flush_bits() writes the remaining bits, the last byte is filled up with
+ * zeros.
+ */
+
+static void flush_bits(struct bit_writer *w)
+{
+  while (w->count > 0)
+  {
+    *w->out++ = w->bits & 0xff;
+    w->bits >>= 8;
+    w->count -= 8;
+  }
+  w->bits = 0;
+  w->count = 0;
+}
+
+static void put_literal(struct bit_writer *w, int symbol)
+{
+  put_bits(w, g_literal_code[symbol], g_literal_bits[symbol]);
+}
+
+/*
+ * Length codes 257..285 and distance codes 0..29 are followed by extra bits.
+ * Both are calculated from the position of the highest bit.
+ */
+
+static void put_match(struct bit_writer *w, int length, int distance)
+{
+  int x = length - 3;
+
+  if (x < 8)
+  {
+    put_literal(w, 257 + x);
+  }
+  else if (length == MAX_MATCH)
+  {
+    put_literal(w, 285);
+  }
+  else
+  {
+    int l = 31 - __builtin_clz(x);
+    put_literal(w, 257 + 4 * (l - 1) + ((x >> (l - 2)) & 3));
+    put_bits(w, x & ((1 << (l - 2)) - 1), l - 2);
+  }
+
+  x = distance - 1;
+  if (x < 4)
+  {
+    put_bits(w, g_distance_code[x], 5);
+  }
+  else
+  {
+    int l = 31 - __builtin_clz(x);
+    put_bits(w, g_distance_code[2 * l + ((x >> (l - 1)) & 1)], 5);
+    put_bits(w, x & ((1 << (l - 1)) - 1), l - 1);
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+/* C O M P R E S S I O N                                                     */
+/*---------------------------------------------------------------------------*/
+
+static unsigned read32(const unsigned char *p)
+{
+  unsigned value;
+  memcpy(&value, p, 4);
+  return value;
+}
+
+static unsigned hash32(unsigned value)
+{
+  return (value * 2654435761U) >> (32 - HASH_BITS);
+}
+
+/*
+ * A literal costs at most 9 bits.
+ */
+
+size_t deflate_bound(size_t length)
+{
+  return length + length / 8 + 64;
+}
+
+/*
+ * deflate_block() compresses length bytes of in into out and returns the
+ * number of bytes written. out must hold deflate_bound(length) bytes.
+ * The last block of a stream has to be compressed with last set to 1.
+ */
+
+size_t deflate_block(const unsigned char *in, size_t length,
+                     unsigned char *out, int last)
+{
+  pthread_once(&g_tables_once, init_tables);
+
+  int *head = (int *) malloc(sizeof(int) << HASH_BITS);
+  if (head == NULL)
+  {
+    return 0;
+  }
+  memset(head, 0xff, sizeof(int) << HASH_BITS);
+
+  struct bit_writer w = { out, 0, 0 };
+
+  put_bits(&w, last ? 1 : 0, 1);   // BFINAL
+  put_bits(&w, 1, 2);              // BTYPE: fixed Huffman codes
+
+  size_t i = 0;
+  while (i + MIN_MATCH <= length)
+  {
+    unsigned value = read32(in + i);
+    unsigned h = hash32(value);
+    int candidate = head[h];
+    head[h] = (int) i;
+
+    if (candidate >= 0 && i - candidate <= WINDOW_SIZE &&
+        read32(in + candidate) == value)
+    {
+      size_t max = length - i < MAX_MATCH ? length - i : MAX_MATCH;
+      size_t match = MIN_MATCH;
+      while (match < max && in[candidate + match] == in[i + match])
+      {
+        match++;
+      }
+      put_match(&w, match, i - candidate);
+      i += match;
+    }
+    else
+    {
+      put_literal(&w, in[i]);
+      i++;
+    }
+  }
+  while (i < length)
+  {
+    put_literal(&w, in[i]);
+    i++;
+  }
+  put_literal(&w, END_OF_BLOCK);
+
+  if (last == 0)
+  {
+/*
+ * Empty stored block: BFINAL 0, BTYPE 00, fill up to a byte boundary,
+ * LEN 0x0000, NLEN 0xffff
+ */
+
+    put_bits(&w, 0, 3);
+    flush_bits(&w);
+    *w.out++ = 0x00;
+    *w.out++ = 0x00;
+    *w.out++ = 0xff;
+    *w.out++ = 0xff;
+  }
+  else
+  {
+    flush_bits(&w);
+  }
+
+  free(head);
+  return w.out - out;
+}
+
+/*---------------------------------------------------------------------------*/
+/* C H E C K S U M S                                                         */
+/*---------------------------------------------------------------------------*/
+
+#define ADLER_BASE 65521UL
+#define ADLER_NMAX 5552
+
+unsigned long adler32_update(unsigned long adler, const unsigned char *data,
+                             size_t length)
+{
+  unsigned long a = adler & 0xffff;
+  unsigned long b = (adler >> 16) & 0xffff;
+
+/*
+ * ADLER_NMAX bytes can be added before b overflows 32 bits.
+ */
+
+  while (length > 0)
+  {
+    size_t n = length < ADLER_NMAX ? length : ADLER_NMAX;
+    length -= n;
+    while (n > 0)
+    {
+      a += *data++;
+      b += a;
+      n--;
+    }
+    a %= ADLER_BASE;
+    b %= ADLER_BASE;
+  }
+  return (b << 16) | a;
+}
+
+/*
+ * adler32_combine() returns the adler32 of two pieces of data from the
+ * adler32 of each piece and the length of the second piece.
+ */
+
+unsigned long adler32_combine(unsigned long adler1, unsigned long adler2,
+                              size_t length2)
+{
+  unsigned long rem = length2 % ADLER_BASE;
+  unsigned long sum1 = adler1 & 0xffff;
+  unsigned long sum2 = (rem * sum1) % ADLER_BASE;
+
+  sum1 += (adler2 & 0xffff) + ADLER_BASE - 1;
+  sum2 += ((adler1 >> 16) & 0xffff) + ((adler2 >> 16) & 0xffff) +
+          ADLER_BASE - rem;
+  if (sum1 >= ADLER_BASE)
+  {
+    sum1 -= ADLER_BASE;
+  }
+  if (sum1 >= ADLER_BASE)
+  {
+    sum1 -= ADLER_BASE;
+  }
+  if (sum2 >= (ADLER_BASE << 1))
+  {
+    sum2 -= (ADLER_BASE << 1);
+  }
+  if (sum2 >= ADLER_BASE)
+  {
+    sum2 -= ADLER_BASE;
+  }
+  return sum1 | (sum2 << 16);
+}
+
+/*
+ * crc32_update() starts with crc = 0.
+ */
+
+unsigned long crc32_update(unsigned long crc, const unsigned char *data,
+                           size_t length)
+{
+  pthread_once(&g_tables_once, init_tables);
+
+  crc = crc ^ 0xffffffffUL;
+  while (length > 0)
+  {
+    crc = g_crc_table[(crc ^ *data++) & 0xff] ^ (crc >> 8);
+    length--;
+  }
+  return crc ^ 0xffffffffUL;
+}
@@ -0,0 +1,200 @@
+/*
+ * FILE = /src/direct.c
+ *
+ * RELATED FILES:     *.c                              *.h
+ *                    ImageWriter.c
+ *                    encoder.c                        encoder.h
+ *                    stream.c                         stream.h
+ *                                                     direct.h
+ *
+ * Direct output backends write a p6 ppm image straight out of its slot of
+ * the shared memory segment. The main thread holds the slot until the image
+ * has been written, there are no local buffers and no pipeline threads.
+ * Run several imageWriters to write several images at the same time.
+ *
+ * OUTPUT_MMAP: The size of a ppm file is known in advance. The file is
+ *              preallocated with fallocate() and mapped, header and pixels
+ *              are copied from the slot into the mapping. No stdio buffer
+ *              and no local buffer are involved.
+ *
+ * OUTPUT_WRITEV: Header and pixels are handed to the kernel with a single
+ *                writev() straight from the slot. The pixels are copied only
+ *                once, into the page cache.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+
+#include "universalSettings.h"
+#include "output.h"
+#include "direct.h"
+#include "encoder.h"
+#include "imageFile.h"
+#include "stream.h"
+
+static int g_direct_backend = OUTPUT_MMAP;
+static long long g_start_time;
+
+int is_direct_backend(int backend)
+{
+  return backend == OUTPUT_MMAP || backend == OUTPUT_WRITEV;
+}
+
+int open_direct(int backend)
+{
+  if (is_direct_backend(backend) == 0)
+  {
+    printf("Error: %d is not a direct output backend\n", backend);
+    return -1;
+  }
+  g_direct_backend = backend;
+  g_start_time = pipeline_clock();
+  return 0;
+}
+
+/*
+ * preallocate() reserves the blocks of the file. Filesystems without
+ * fallocate() get a sparse file of the right size.
+ */
+
+static int preallocate(int fd, size_t size)
+{
+#if OS_FEDORA
+  if (fallocate(fd, 0, 0, size) == 0)
+  {
+    return 0;
+  }
+  if (errno != EOPNOTSUPP)
+  {
+    perror("fallocate");
+    return -1;
+  }
+#endif
+
+  if (ftruncate(fd, size) != 0)
+  {
+    perror("ftruncate");
+    return -1;
+  }
+  return 0;
+}
+
+static int write_mmap(struct frame *frame)
+{
+  size_t size = frame->headerlength + frame->datalength;
+
+  int fd = open(frame->name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1)
+  {
+    perror(frame->name);
+    return -1;
+  }
+  if (preallocate(fd, size) != 0)
+  {
+    close(fd);
+    return -1;
+  }
+
+/*
+ * MAP_POPULATE maps all pages at once instead of one page fault per page.
+ */
+
+  unsigned char *map = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, fd, 0);
+  if (map == MAP_FAILED)
+  {
+    perror("mmap");
+    close(fd);
+    return -1;
+  }
+
+  memcpy(map, frame->header, frame->headerlength);
+  memcpy(map + frame->headerlength, frame->data, frame->datalength);
+
+  int ret = 0;
+  if (munmap(map, size) != 0)
+  {
+    perror("munmap");
+    ret = -1;
+  }
+  if (close(fd) != 0)
+  {
+    printf("Error: IMAGE File could not be closed.\n");
+    ret = -1;
+  }
+  return ret;
+}
+
+static int write_writev(struct frame *frame)
+{
+  int fd = open(frame->name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1)
+  {
+    perror(frame->name);
+    return -1;
+  }
+
+  struct iovec iov[2];
+  iov[0].iov_base = frame->header;
+  iov[0].iov_len = frame->headerlength;
+  iov[1].iov_base = frame->data;
+  iov[1].iov_len = frame->datalength;
+
+  int ret = write_all(fd, iov, 2);
+  if (close(fd) != 0)
+  {
+    printf("Error: IMAGE File could not be closed.\n");
+    ret = -1;
+  }
+  return ret;
+}
+
+/*
+ * write_direct() writes the image frame->pixels points to (the slot of the
+ * shared memory segment).
+ */
+
+int write_direct(struct frame *frame)
+{
+  if (encode_frame_as(frame, FORMAT_PPM) != 0 || make_image_name(frame) != 0)
+  {
+    return -1;
+  }
+
+  if (g_direct_backend == OUTPUT_WRITEV)
+  {
+    return write_writev(frame);
+  }
+  return write_mmap(frame);
+}
+
+/*
+ * writer: busy = writing, waiting = waiting for the pixelGenerator
+ */
+
+void print_direct_stats(struct stage_stats *writer)
+{
+  long long elapsed = pipeline_clock() - g_start_time;
+  if (elapsed <= 0)
+  {
+    return;
+  }
+
+  printf("\nDirect output after %.1f seconds:\n", elapsed / 1e9);
+  printf("%-9s %8s %9s %9s %9s\n", "stage", "images", "busy", "waiting",
+         "blocked");
+  print_stage_stats("writer", writer, 1, elapsed);
+  print_writer_latency();
+}
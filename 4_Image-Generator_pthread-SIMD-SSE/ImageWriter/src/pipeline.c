@@ -0,0 +1,667 @@
+/*
+ * FILE = /src/pipeline.c
+ *
+ * RELATED FILES:     *.c                              *.h
+ *                    encoder.c                        encoder.h
+ *                    imageFile.c                      imageFile.h
+ *                    numberOfPixel.c                  numberOfPixel.h
+ *                    output.c                         output.h
+ *                    latency.c                        latency.h
+ *                                                     writerSettings.h
+ *                                                     pipeline.h
+ *
+ * The imageWriter is split into three pipeline stages connected by bounded
+ * queues:
+ *
+ * reader:   The main thread claims an image from the shared memory segment,
+ *           copies it into a free local buffer and releases the slot right
+ *           away (see ImageWriter.c).
+ * encoders: number_of_encoders threads format and compress the images
+ *           (encode_frame()).
+ * sink:     One thread hands the images to the output backend in the order
+ *           they have been claimed (output_frame(), see output.c).
+ *
+ * The local buffers circulate from the free queue through the encoder queue
+ * and the sink queue back into the free queue. The output backend returns a
+ * buffer to the free queue once its image has been written. The number of buffers limits
+ * the number of images in flight.
+ *
+ * Every stage measures the time it spends working (busy), waiting for the
+ * stage before (waiting) and waiting for the stage after (blocked). This
+ * shows if the imageWriter is limited by the CPU (encoders), by copying
+ * (reader) or by the disk (sink).
+ *
+ * In addition every image carries the timestamps of its stages, from the
+ * pixelGenerator acquiring its slot up to the image file being written. The
+ * latency of each stage is kept in a histogram (see latency.h):
+ *
+ * in slot     published by the pixelGenerator until claimed
+ * claim wait  imageWriter waiting for the image (semop)
+ * copy        copying the image out of the slot until the slot is released
+ * queue       waiting for an encoder
+ * encode      encode_frame()
+ * write       handed to the output backend until written (fwrite() and
+ *             fclose(), io_uring completion)
+ * end to end  generation started by the pixelGenerator until written
+ *
+ * With PERF_COUNTERS set the reader and the encoders count the cycles,
+ * instructions, cache and branch misses of the copy (converting the pixels
+ * to RGB24 and copying them out of the slot), encode and, with a direct
+ * output backend, write stage (see perfCounters.h).
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "numberOfPixel.h"
+#include "writerSettings.h"
+#include "pipeline.h"
+#include "encoder.h"
+#include "output.h"
+#include "latency.h"
+#include "perfCounters.h"
+#include "trace.h"
+
+#if OUTPUT_BACKEND == OUTPUT_IO_URING && \
+    IO_URING_FRAMES_IN_FLIGHT >= number_of_frame_buffers
+  #error "IO_URING_FRAMES_IN_FLIGHT has to be smaller than number_of_frame_buffers"
+#endif
+
+#if (OUTPUT_FORMAT == FORMAT_Y4M || OUTPUT_FORMAT == FORMAT_YUV) && \
+    OUTPUT_BACKEND != OUTPUT_STREAM
+  #error "FORMAT_Y4M and FORMAT_YUV can only be written with OUTPUT_STREAM"
+#endif
+
+#if OUTPUT_BACKEND == OUTPUT_ARCHIVE && OUTPUT_FORMAT != FORMAT_PPM
+  #error "OUTPUT_ARCHIVE stores the pixels, set OUTPUT_FORMAT to FORMAT_PPM"
+#endif
+
+#if (OUTPUT_BACKEND == OUTPUT_MMAP || OUTPUT_BACKEND == OUTPUT_WRITEV) && \
+    OUTPUT_FORMAT != FORMAT_PPM
+  #error "direct output backends need OUTPUT_FORMAT FORMAT_PPM"
+#endif
+
+#define MAX_QUEUE_LENGTH (number_of_frame_buffers + number_of_encoders)
+
+/*
+ * A bounded FIFO queue of frames. A NULL entry tells the receiving stage to
+ * terminate.
+ */
+
+struct frame_queue
+{
+  struct frame *items[MAX_QUEUE_LENGTH];
+  int capacity;
+  int head;
+  int count;
+  pthread_mutex_t lock;
+  pthread_cond_t not_empty;
+  pthread_cond_t not_full;
+};
+
+static struct frame g_frames[number_of_frame_buffers];
+static struct frame_queue g_free_queue;
+static struct frame_queue g_encoder_queue;
+static struct frame_queue g_sink_queue;
+
+static pthread_t g_encoder_thread[number_of_encoders];
+static pthread_t g_sink_thread;
+static int g_threads_started = 0;
+static int g_queues_initialized = 0;
+
+static pthread_mutex_t g_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct stage_stats g_encoder_stats;
+static struct stage_stats g_sink_stats;
+static long long g_start_time;
+
+#define WRITER_STAGES 7
+
+static const char *g_stage_names[WRITER_STAGES] =
+{
+  "in slot", "claim wait", "copy", "queue", "encode", "write", "end to end"
+};
+
+static struct latency_histogram g_latency[WRITER_STAGES];
+
+static const char *g_perf_names[WRITER_PERF_STAGES] =
+{
+  "copy", "encode", "write"
+};
+
+static struct perf_stage g_perf[WRITER_PERF_STAGES];
+
+static volatile int g_failed = 0;
+static unsigned long g_next_sequence = 0;
+
+long long pipeline_clock(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*---------------------------------------------------------------------------*/
+/* B O U N D E D  Q U E U E                                                  */
+/*---------------------------------------------------------------------------*/
+
+static void init_queue(struct frame_queue *queue, int capacity)
+{
+  queue->capacity = capacity;
+  queue->head = 0;
+  queue->count = 0;
+  pthread_mutex_init(&queue->lock, NULL);
+  pthread_cond_init(&queue->not_empty, NULL);
+  pthread_cond_init(&queue->not_full, NULL);
+}
+
+static void destroy_queue(struct frame_queue *queue)
+{
+  pthread_mutex_destroy(&queue->lock);
+  pthread_cond_destroy(&queue->not_empty);
+  pthread_cond_destroy(&queue->not_full);
+}
+
+/*
+ * queue_push() and queue_pop() add the time spent waiting for the queue to
+ * *blocked and *waiting.
+ */
+
+static void queue_push(struct frame_queue *queue, struct frame *frame,
+                       long long *blocked)
+{
+  long long start = pipeline_clock();
+
+  pthread_mutex_lock(&queue->lock);
+  while (queue->count == queue->capacity)
+  {
+    pthread_cond_wait(&queue->not_full, &queue->lock);
+  }
+  if (blocked != NULL)
+  {
+    *blocked += pipeline_clock() - start;
+  }
+  queue->items[(queue->head + queue->count) % queue->capacity] = frame;
+  queue->count++;
+  pthread_cond_signal(&queue->not_empty);
+  pthread_mutex_unlock(&queue->lock);
+}
+
+/*
+ * queue_wait() waits at most timeout nanoseconds for an item and returns 1 if
+ * there is one. Only the thread popping the queue may rely on it.
+ */
+
+static int queue_wait(struct frame_queue *queue, long long timeout,
+                      long long *waiting)
+{
+  long long start = pipeline_clock();
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += (deadline.tv_nsec + timeout) / 1000000000LL;
+  deadline.tv_nsec = (deadline.tv_nsec + timeout) % 1000000000LL;
+
+  pthread_mutex_lock(&queue->lock);
+  while (queue->count == 0)
+  {
+    if (pthread_cond_timedwait(&queue->not_empty, &queue->lock, &deadline)
+        != 0)
+    {
+      break;
+    }
+  }
+  int available = (queue->count != 0);
+  pthread_mutex_unlock(&queue->lock);
+
+  *waiting += pipeline_clock() - start;
+  return available;
+}
+
+static struct frame *queue_pop(struct frame_queue *queue, long long *waiting)
+{
+  long long start = pipeline_clock();
+
+  pthread_mutex_lock(&queue->lock);
+  while (queue->count == 0)
+  {
+    pthread_cond_wait(&queue->not_empty, &queue->lock);
+  }
+  if (waiting != NULL)
+  {
+    *waiting += pipeline_clock() - start;
+  }
+  struct frame *frame = queue->items[queue->head];
+  queue->head = (queue->head + 1) % queue->capacity;
+  queue->count--;
+  pthread_cond_signal(&queue->not_full);
+  pthread_mutex_unlock(&queue->lock);
+
+  return frame;
+}
+
+static void add_stats(struct stage_stats *total, struct stage_stats *delta)
+{
+  pthread_mutex_lock(&g_stats_lock);
+  total->busy += delta->busy;
+  total->waiting += delta->waiting;
+  total->blocked += delta->blocked;
+  total->frames += delta->frames;
+  pthread_mutex_unlock(&g_stats_lock);
+  memset(delta, 0, sizeof(struct stage_stats));
+}
+
+/*---------------------------------------------------------------------------*/
+/* E N C O D E R  S T A G E                                                  */
+/*---------------------------------------------------------------------------*/
+
+static void *encoder_handler(void *ptr)
+{
+  struct stage_stats delta;
+  memset(&delta, 0, sizeof(struct stage_stats));
+  trace_thread(TRACE_NEXT_THREAD, "encoder");
+
+  struct perf_counters counters;
+  struct perf_sample perf_start, perf_end;
+  open_perf_counters(&counters);
+
+  while (1)
+  {
+    struct frame *frame = queue_pop(&g_encoder_queue, &delta.waiting);
+
+    if (frame == NULL)
+    {
+      queue_push(&g_sink_queue, NULL, NULL);
+      break;
+    }
+
+    long long start = pipeline_clock();
+    read_perf_counters(&counters, &perf_start);
+    if (g_failed == 0)
+    {
+      if (encode_frame(frame) != 0)
+      {
+        printf("Error encoding image %lu\n", frame->framenumber);
+        g_failed = 1;
+      }
+    }
+    read_perf_counters(&counters, &perf_end);
+    record_writer_perf(WRITER_PERF_ENCODE, &counters, &perf_start, &perf_end);
+    frame->encode = start;
+    frame->encoded = pipeline_clock();
+    delta.busy += frame->encoded - start;
+    trace_event("encode", start, frame->encoded, frame->framenumber);
+    delta.frames++;
+
+    queue_push(&g_sink_queue, frame, &delta.blocked);
+    add_stats(&g_encoder_stats, &delta);
+  }
+
+  add_stats(&g_encoder_stats, &delta);
+  close_perf_counters(&counters);
+  return NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+/* S I N K  S T A G E                                                        */
+/*---------------------------------------------------------------------------*/
+
+static void frame_written(struct frame *frame)
+{
+  if (g_failed == 0)
+  {
+    long long written = pipeline_clock();
+    record_writer_latency(frame, written);
+    trace_event("write", frame->output, written, frame->framenumber);
+  }
+  queue_push(&g_free_queue, frame, NULL);
+}
+
+/*
+ * The encoders finish images in any order. The sink keeps images that arrive
+ * early in pending[] until all images claimed before them have been written.
+ * There are never more than number_of_frame_buffers images in flight, so
+ * sequence % number_of_frame_buffers is unique for every pending image.
+ */
+
+static void *sink_handler(void *ptr)
+{
+  struct frame *pending[number_of_frame_buffers];
+  unsigned long next = 0;
+  int finished_encoders = 0;
+  int in_flight = 0;
+  struct stage_stats delta;
+
+  memset(pending, 0, sizeof(pending));
+  memset(&delta, 0, sizeof(struct stage_stats));
+  trace_thread(TRACE_NEXT_THREAD, "sink");
+
+  while (finished_encoders < number_of_encoders)
+  {
+
+/*
+ * While images are in flight (OUTPUT_IO_URING) the sink collects the
+ * finished ones whenever the encoders keep it waiting, their buffers are
+ * free again and their latency is recorded right away.
+ */
+
+    while (in_flight > 0 &&
+           queue_wait(&g_sink_queue, OUTPUT_POLL_INTERVAL, &delta.waiting) == 0)
+    {
+      in_flight = poll_output();
+      if (in_flight < 0)
+      {
+        g_failed = 1;
+        in_flight = 0;
+      }
+    }
+
+    struct frame *frame = queue_pop(&g_sink_queue, &delta.waiting);
+
+    if (frame == NULL)
+    {
+      finished_encoders++;
+      continue;
+    }
+    pending[frame->sequence % number_of_frame_buffers] = frame;
+
+    while ((frame = pending[next % number_of_frame_buffers]) != NULL)
+    {
+      pending[next % number_of_frame_buffers] = NULL;
+
+      long long start = pipeline_clock();
+      frame->output = start;
+      if (g_failed == 0)
+      {
+        if (output_frame(frame, frame_written) != 0)
+        {
+          g_failed = 1;
+        }
+        in_flight = 1;
+      }
+      else
+      {
+        frame_written(frame);
+      }
+      delta.busy += pipeline_clock() - start;
+      delta.frames++;
+      next++;
+
+      add_stats(&g_sink_stats, &delta);
+    }
+  }
+
+  long long start = pipeline_clock();
+  if (flush_output() != 0)
+  {
+    g_failed = 1;
+  }
+  delta.busy += pipeline_clock() - start;
+
+  add_stats(&g_sink_stats, &delta);
+  return NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+/* S T A R T  &  S T O P                                                     */
+/*---------------------------------------------------------------------------*/
+
+int start_pipeline(void)
+{
+  init_queue(&g_free_queue, number_of_frame_buffers);
+  init_queue(&g_encoder_queue, ENCODER_QUEUE_LENGTH);
+  init_queue(&g_sink_queue, MAX_QUEUE_LENGTH);
+  g_queues_initialized = 1;
+
+  if (open_output(OUTPUT_BACKEND, IO_URING_O_DIRECT, IO_URING_FRAMES_IN_FLIGHT,
+                  OUTPUT_BACKEND == OUTPUT_ARCHIVE ? ARCHIVE_FILE : STREAM_FILE)
+      < 0)
+  {
+    return -1;
+  }
+
+  for (int i = 0; i < number_of_frame_buffers; i++)
+  {
+    memset(&g_frames[i], 0, sizeof(struct frame));
+    g_frames[i].pixels = (unsigned char *) malloc(MAX_DATA);
+    if (g_frames[i].pixels == NULL)
+    {
+      perror("malloc");
+      return -1;
+    }
+    queue_push(&g_free_queue, &g_frames[i], NULL);
+  }
+
+/*
+ * SIGINT is blocked inside the pipeline threads, so ctrl-c always interrupts
+ * the main thread waiting for the next image. The threads inherit the signal
+ * mask of the thread creating them.
+ */
+
+  sigset_t sigint;
+  sigset_t oldmask;
+  sigemptyset(&sigint);
+  sigaddset(&sigint, SIGINT);
+  pthread_sigmask(SIG_BLOCK, &sigint, &oldmask);
+
+  g_start_time = pipeline_clock();
+
+  for (int t = 0; t < number_of_encoders; t++)
+  {
+    if (pthread_create(&g_encoder_thread[t], NULL, encoder_handler, NULL) != 0)
+    {
+      perror("pthread_create");
+      pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
+      return -1;
+    }
+    g_threads_started++;
+  }
+  if (pthread_create(&g_sink_thread, NULL, sink_handler, NULL) != 0)
+  {
+    perror("pthread_create");
+    pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
+    return -1;
+  }
+  g_threads_started++;
+
+  pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
+  return 0;
+}
+
+/*
+ * pipeline_get_buffer() blocks until a local buffer is free.
+ */
+
+struct frame *pipeline_get_buffer(struct stage_stats *reader)
+{
+  return queue_pop(&g_free_queue, &reader->blocked);
+}
+
+/*
+ * pipeline_submit() hands a filled buffer to the encoders. The images are
+ * written in the order they have been submitted.
+ */
+
+void pipeline_submit(struct frame *frame, struct stage_stats *reader)
+{
+  frame->sequence = g_next_sequence;
+  g_next_sequence++;
+  reader->frames++;
+
+  queue_push(&g_encoder_queue, frame, &reader->blocked);
+}
+
+int pipeline_failed(void)
+{
+  return g_failed;
+}
+
+/*
+ * stop_pipeline() lets all submitted images pass through the pipeline and
+ * waits for the threads to terminate.
+ */
+
+int stop_pipeline(void)
+{
+/*
+ * If start_pipeline() failed only some of the threads are running.
+ * The sink is started last, it is only running if all encoders are running.
+ */
+
+  int encoders = g_threads_started < number_of_encoders ?
+                 g_threads_started : number_of_encoders;
+
+  for (int t = 0; t < encoders; t++)
+  {
+    queue_push(&g_encoder_queue, NULL, NULL);
+  }
+  for (int t = 0; t < encoders; t++)
+  {
+    if (pthread_join(g_encoder_thread[t], NULL) != 0)
+    {
+      perror("pthread_join");
+    }
+  }
+  if (g_threads_started > number_of_encoders)
+  {
+    if (pthread_join(g_sink_thread, NULL) != 0)
+    {
+      perror("pthread_join");
+    }
+  }
+  g_threads_started = 0;
+  close_output();
+
+  return g_failed ? -1 : 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* S T A T I S T I C S                                                       */
+/*---------------------------------------------------------------------------*/
+
+void print_stage_stats(char *name, struct stage_stats *stats, int threads,
+                       long long elapsed)
+{
+  double total = (double) elapsed * threads / 100.0;
+
+  printf("%-9s %8lu %8.1f%% %8.1f%% %8.1f%%\n", name, stats->frames,
+         stats->busy / total, stats->waiting / total, stats->blocked / total);
+}
+
+/*
+ * reader: waiting = waiting for the pixelGenerator,
+ *         blocked = waiting for a free buffer or for the encoders
+ * encoders (all threads together): waiting = waiting for the reader,
+ *         blocked = waiting for the sink
+ * sink:   waiting = waiting for the encoders
+ */
+
+void print_pipeline_stats(struct stage_stats *reader)
+{
+  long long elapsed = pipeline_clock() - g_start_time;
+  if (elapsed <= 0)
+  {
+    return;
+  }
+
+  pthread_mutex_lock(&g_stats_lock);
+  struct stage_stats encoders = g_encoder_stats;
+  struct stage_stats sink = g_sink_stats;
+  pthread_mutex_unlock(&g_stats_lock);
+
+  printf("\nPipeline after %.1f seconds:\n", elapsed / 1e9);
+  printf("%-9s %8s %9s %9s %9s\n", "stage", "images", "busy", "waiting",
+         "blocked");
+  print_stage_stats("reader", reader, 1, elapsed);
+  print_stage_stats("encoders", &encoders, number_of_encoders, elapsed);
+  print_stage_stats("sink", &sink, 1, elapsed);
+  print_writer_latency();
+}
+
+/*
+ * record_stage() records the time between two stages, stages the image has
+ * not passed (timestamp 0) are left out. The direct output backends and the
+ * outputBenchmark skip some of them.
+ */
+
+static void record_stage(int stage, long long start, long long end)
+{
+  if (start != 0 && end != 0)
+  {
+    record_latency(&g_latency[stage], end - start);
+  }
+}
+
+/*
+ * record_writer_latency() is called once the image file has been written,
+ * by the sink or by an io_uring completion.
+ */
+
+void record_writer_latency(struct frame *frame, long long written)
+{
+  pthread_mutex_lock(&g_stats_lock);
+  record_stage(0, frame->times.published, frame->claimed);
+  record_stage(1, frame->claim, frame->claimed);
+  record_stage(2, frame->claimed, frame->copied);
+  record_stage(3, frame->copied, frame->encode);
+  record_stage(4, frame->encode, frame->encoded);
+  record_stage(5, frame->output, written);
+  record_stage(6, frame->times.generate, written);
+  pthread_mutex_unlock(&g_stats_lock);
+}
+
+/*
+ * record_writer_perf() adds the perf counters of the thread between begin
+ * and end to one of the WRITER_PERF stages (see pipeline.h).
+ */
+
+void record_writer_perf(int stage, struct perf_counters *counters,
+                        const struct perf_sample *begin,
+                        const struct perf_sample *end)
+{
+  add_perf(&g_perf[stage], counters, begin, end, 1);
+}
+
+void print_writer_latency(void)
+{
+  pthread_mutex_lock(&g_stats_lock);
+  print_latency("imageWriter", g_stage_names, g_latency, WRITER_STAGES);
+  pthread_mutex_unlock(&g_stats_lock);
+  print_perf("imageWriter", g_perf_names, g_perf, WRITER_PERF_STAGES);
+}
+
+void free_pipeline(void)
+{
+  if (g_threads_started != 0)
+  {
+    stop_pipeline();
+  }
+  for (int i = 0; i < number_of_frame_buffers; i++)
+  {
+    if (g_frames[i].pixels != NULL)
+    {
+      free(g_frames[i].pixels);
+      g_frames[i].pixels = NULL;
+    }
+    if (g_frames[i].buffer != NULL)
+    {
+      free(g_frames[i].buffer);
+      g_frames[i].buffer = NULL;
+      g_frames[i].buffersize = 0;
+    }
+  }
+  if (g_queues_initialized)
+  {
+    destroy_queue(&g_free_queue);
+    destroy_queue(&g_encoder_queue);
+    destroy_queue(&g_sink_queue);
+    g_queues_initialized = 0;
+  }
+}
@@ -16,3 +16,5 @@ int g_shmid;
 int g_semid;
 unsigned char *g_buffer;
 unsigned char *g_membuf;
+int g_statsid;
+struct stats_page *g_stats;
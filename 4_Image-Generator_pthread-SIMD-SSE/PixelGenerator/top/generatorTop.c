@@ -0,0 +1,256 @@
+/*
+ * FILE = /top/generatorTop.c
+ *
+ * Shows the counters a running pixelGenerator publishes after every image
+ * (see statsPage.h) like top, one line per thread, and optionally writes
+ * them to a file in the Prometheus text format.
+ *
+ * usage: ./generatorTop.out [interval in ms] [prometheus file]
+ *
+ * The rates are computed from the totals of two snapshots interval ms apart.
+ * Per thread:
+ *
+ *   tiles      tiles generated in the interval
+ *   Mpixel/s   pixels generated per second
+ *   Giter/s    iterations of the escape loop per second
+ *   lanes      iterations / lane_iterations, the share of the SIMD lanes
+ *              doing useful work (100% for one pixel at a time)
+ *   cardioid   pixels found by the cardioid check
+ *   bulb       pixels found by the period-2 bulb check
+ *   busy       time spent generating tiles / interval
+ *
+ * imbalance is the busy time of the slowest thread of the last image divided
+ * by the mean busy time, 1.00 means every thread had the same amount of work.
+ *
+ * The Prometheus file is written to <file>.tmp and renamed, so the node
+ * exporter's textfile collector never reads half a file.
+ *
+ * The program ends on ctrl-c or when the pixelGenerator has removed the
+ * segment.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include "statsPage.h"
+
+#define DEFAULT_INTERVAL 1000      // ms
+#define MAX_PATH 256
+
+static volatile sig_atomic_t g_running = 1;
+
+static void stop(int signal)
+{
+  g_running = 0;
+}
+
+static double percent(unsigned long long part, unsigned long long whole)
+{
+  return (whole > 0) ? 100.0 * part / whole : 0.0;
+}
+
+/*
+ * The segment is removed when the pixelGenerator ends, an attached segment
+ * stays until it is detached, so shmget() is asked if it is still there.
+ */
+
+static int generator_running(void)
+{
+  key_t key = generate_stats_key();
+  return (key != -1) && (shmget(key, sizeof(struct stats_page), 0) >= 0);
+}
+
+static void show(const struct stats_page *now, const struct stats_page *before,
+                 double seconds)
+{
+  struct thread_stats sum;
+  double busy_max = 0.0;
+  double busy_sum = 0.0;
+
+  memset(&sum, 0, sizeof(sum));
+  printf("\x1B[1;1H\x1B[2J");
+  printf("pixelGenerator (%s), %d threads, %lu images, last image %.1f ms, "
+         "%.1f images/s\n\n", now->backend, now->number_of_threads, now->images,
+         now->image_ns / 1000000.0, (now->images - before->images) / seconds);
+  printf("%6s %8s %10s %10s %7s %9s %7s %7s\n", "thread", "tiles", "Mpixel/s",
+         "Giter/s", "lanes", "cardioid", "bulb", "busy");
+
+  for (int t = 0; t < now->number_of_threads; t++)
+  {
+    struct thread_stats delta = now->total[t];
+    const struct thread_stats *old = &before->total[t];
+
+    delta.pixels -= old->pixels;
+    delta.iterations -= old->iterations;
+    delta.lane_iterations -= old->lane_iterations;
+    delta.cardioid -= old->cardioid;
+    delta.bulb -= old->bulb;
+    delta.tiles -= old->tiles;
+    delta.busy_ns -= old->busy_ns;
+    add_thread_stats(&sum, &delta);
+
+    printf("%6d %8llu %10.2f %10.3f %6.1f%% %8.1f%% %6.1f%% %6.1f%%\n", t,
+           delta.tiles, delta.pixels / seconds / 1e6,
+           delta.iterations / seconds / 1e9,
+           percent(delta.iterations, delta.lane_iterations),
+           percent(delta.cardioid, delta.pixels), percent(delta.bulb, delta.pixels),
+           delta.busy_ns / seconds / 1e7);
+
+    busy_sum += now->last[t].busy_ns;
+    if (now->last[t].busy_ns > busy_max)
+    {
+      busy_max = now->last[t].busy_ns;
+    }
+  }
+
+  printf("%6s %8llu %10.2f %10.3f %6.1f%% %8.1f%% %6.1f%%\n\n", "all", sum.tiles,
+         sum.pixels / seconds / 1e6, sum.iterations / seconds / 1e9,
+         percent(sum.iterations, sum.lane_iterations),
+         percent(sum.cardioid, sum.pixels), percent(sum.bulb, sum.pixels));
+  if (busy_sum > 0)
+  {
+    printf("imbalance %.2f (slowest thread / mean busy time of the last image)\n",
+           busy_max * now->number_of_threads / busy_sum);
+  }
+  fflush(stdout);
+}
+
+/*
+ * write_prometheus() writes the totals as counters and the time of the last
+ * image as gauge, returns -1 on error.
+ */
+
+static int write_prometheus(const char *path, const struct stats_page *page)
+{
+  static const char *names[] = { "pixels", "iterations", "lane_iterations",
+                                 "cardioid", "bulb", "tiles" };
+  char tmp[MAX_PATH + 8];
+
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  FILE *file = fopen(tmp, "w");
+  if (file == NULL)
+  {
+    perror(tmp);
+    return -1;
+  }
+
+  fprintf(file, "# TYPE mandelbrot_info gauge\n"
+          "mandelbrot_info{backend=\"%s\",threads=\"%d\"} 1\n",
+          page->backend, page->number_of_threads);
+  fprintf(file, "# TYPE mandelbrot_images_total counter\n"
+          "mandelbrot_images_total %lu\n", page->images);
+  fprintf(file, "# TYPE mandelbrot_image_seconds gauge\n"
+          "mandelbrot_image_seconds %.6f\n", page->image_ns / 1e9);
+
+  for (int n = 0; n < sizeof(names) / sizeof(names[0]); n++)
+  {
+    fprintf(file, "# TYPE mandelbrot_thread_%s_total counter\n", names[n]);
+    for (int t = 0; t < page->number_of_threads; t++)
+    {
+      const struct thread_stats *total = &page->total[t];
+      unsigned long long counters[] = { total->pixels, total->iterations,
+                                        total->lane_iterations, total->cardioid,
+                                        total->bulb, total->tiles };
+      fprintf(file, "mandelbrot_thread_%s_total{thread=\"%d\"} %llu\n", names[n],
+              t, counters[n]);
+    }
+  }
+
+  fprintf(file, "# TYPE mandelbrot_thread_busy_seconds_total counter\n");
+  for (int t = 0; t < page->number_of_threads; t++)
+  {
+    fprintf(file, "mandelbrot_thread_busy_seconds_total{thread=\"%d\"} %.6f\n", t,
+            page->total[t].busy_ns / 1e9);
+  }
+
+  if (fclose(file) != 0)
+  {
+    perror(tmp);
+    return -1;
+  }
+  if (rename(tmp, path) != 0)
+  {
+    perror(path);
+    return -1;
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  int interval = DEFAULT_INTERVAL;
+  const char *prometheus = NULL;
+
+  if (argc > 1 && atoi(argv[1]) > 0)
+  {
+    interval = atoi(argv[1]);
+  }
+  if (argc > 2)
+  {
+    if (strlen(argv[2]) >= MAX_PATH)
+    {
+      printf("Path of the prometheus file too long\n");
+      return EXIT_FAILURE;
+    }
+    prometheus = argv[2];
+  }
+
+  struct stats_page *page = attach_stats_page();
+  if (page == NULL)
+  {
+    printf("No pixelGenerator running\n");
+    return EXIT_FAILURE;
+  }
+
+  signal(SIGINT, stop);
+
+  static struct stats_page before;
+  static struct stats_page now;
+  struct timespec wait = { interval / 1000, (interval % 1000) * 1000000L };
+
+  read_stats(page, &before);
+  long long start = stats_clock();
+
+  while (g_running)
+  {
+    nanosleep(&wait, NULL);
+    if (!g_running)
+    {
+      break;
+    }
+    if (!generator_running())
+    {
+      printf("pixelGenerator has ended\n");
+      break;
+    }
+
+    read_stats(page, &now);
+    long long end = stats_clock();
+
+    show(&now, &before, (end - start) / 1e9);
+    if (prometheus != NULL && write_prometheus(prometheus, &now) != 0)
+    {
+      shmdt(page);
+      return EXIT_FAILURE;
+    }
+
+    before = now;
+    start = end;
+  }
+
+  if (shmdt(page) < 0)
+  {
+    perror("shmdt");
+  }
+  return EXIT_SUCCESS;
+}
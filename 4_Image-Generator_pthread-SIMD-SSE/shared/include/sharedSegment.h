@@ -0,0 +1,116 @@
+/*
+ * FILE = HEADER: /include/sharedSegment.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _sharedSegment_
+#define _sharedSegment_
+
+#include <stddef.h>
+
+#include "pixelFormat.h"
+#include "viewCommand.h"
+#include "tiles.h"
+
+/*
+ * The shared memory segment holds NUMBER_OF_SLOTS images at a time. The
+ * pixelGenerator fills the slots one after another, every consumer
+ * (ImageWriter, SDL_Viewer) claims one whole image at a time.
+ * Several ImageWriter programs can be started at the same time, each of them
+ * writes the images it has claimed under the number the pixelGenerator gave
+ * to the image.
+ */
+
+#define NUMBER_OF_SLOTS 4
+
+/*
+ * Semaphore 0 to NUMBER_OF_SLOTS - 1 tell if a slot is free to be written by
+ * the pixelGenerator, semaphore NUMBER_OF_SLOTS counts the images ready to be
+ * claimed by a consumer.
+ */
+
+#define SEM_SLOT_FREE(slot) (slot)
+#define SEM_FRAMES_READY NUMBER_OF_SLOTS
+#define NUMBER_OF_SEMAPHORES (NUMBER_OF_SLOTS + 1)
+
+/*
+ * The header at the start of the shared memory segment.
+ * next_frame is only written by the pixelGenerator, next_claim is incremented
+ * atomically by every consumer claiming an image.
+ *
+ * A consumer asks for the pixel format it needs by writing pixel_format
+ * (request_pixel_format()), the pixelGenerator generates the following images
+ * in this format. If consumers ask for different formats the last one wins,
+ * every image carries its format in its frame_header. The palette is written
+ * once by the pixelGenerator and is used to colorize PIXEL_INDEX16 images.
+ *
+ * commands passes view_commands from one consumer to the pixelGenerator
+ * (see viewCommand.h).
+ */
+
+struct segment_header
+{
+  unsigned long next_frame;        // index of the next image to be generated
+  unsigned long next_claim;        // index of the next image to be claimed
+  int pixel_format;                // format requested by the consumers
+  unsigned char palette[PALETTE_SIZE][3];
+  struct command_queue commands;
+};
+
+/*
+ * CLOCK_MONOTONIC timestamps in nanoseconds of the stages the pixelGenerator
+ * has taken the image through (see latency.h). The consumers add their own
+ * stages, so the latency of every stage up to the image file is known.
+ */
+
+struct frame_times
+{
+  long long acquire;               // waiting for a free slot starts
+  long long generate;              // slot acquired, generation starts
+  long long generated;             // copying into the slot starts
+  long long published;             // image handed to the consumers
+};
+
+/*
+ * Every slot starts with a frame_header followed by the image data, which
+ * takes up to WIDTH * HEIGHT * MAX_BYTES_PER_PIXEL bytes. Image number n
+ * (starting at 0) is always stored in slot n % NUMBER_OF_SLOTS.
+ */
+
+struct frame_header
+{
+  unsigned long framenumber;       // sequential number of the image (from 1)
+  int pixel_format;                // format of the image data
+  long long input_time;            // sent time of the oldest view_command
+                                   // shown first by this image, 0 if none
+  unsigned long commands_applied;  // number of view_commands applied
+  int tiles_done;                  // the first tiles_done tiles of the
+                                   // center-out order (see tiles.h) are new
+  int tile_size;                   // size of the tiles (see tiles.h)
+  int partial;                     // 1 if the generation was cancelled, only
+                                   // the tiles around the center are new.
+                                   // The imageWriter skips these images and
+                                   // writes no file for their number
+  struct frame_times times;
+};
+
+size_t segment_size(void);
+struct segment_header *segment_header(unsigned char *segment);
+struct frame_header *slot_header(unsigned char *segment, int slot);
+unsigned char *slot_data(unsigned char *segment, int slot);
+
+int acquire_slot(int semid, unsigned char *segment, int *slot);
+int acquire_slot_ahead(int semid, unsigned char *segment, int queued,
+                       int *slot);
+int publish_slot(int semid, unsigned char *segment, int slot);
+int claim_frame(int semid, unsigned char *segment, int *slot);
+int release_slot(int semid, int slot);
+
+void request_pixel_format(unsigned char *segment, int format);
+int requested_pixel_format(unsigned char *segment);
+
+#endif
@@ -17,7 +17,29 @@
 #endif
 
 #define DEBUG 0
-#define TIMER_OUTPUT 0
+
+/*
+ * The pixelGenerator prints the latency of its stages every LATENCY_INTERVAL
+ * images (0 = only when it terminates), see latency.h.
+ */
+
+#define LATENCY_INTERVAL 100
+
+/*
+ * Record a timeline of all threads and write it to a Chrome trace file
+ * (see trace.h). TRACE_EVENTS is the number of events kept per thread.
+ */
+
+#define TRACE_OUTPUT 0
+#define TRACE_EVENTS (1 << 16)
+
+/*
+ * Count cycles, instructions, cache and branch misses of every thread with
+ * perf events and print them per stage next to the latencies (see
+ * perfCounters.h).
+ */
+
+#define PERF_COUNTERS 0
 
 
 #endif
@@ -0,0 +1,81 @@
+/*
+ * FILE = /src/hostCache.c
+ *
+ * This file finds the files results measured on a host are kept in
+ * (see hostCache.h).
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "hostCache.h"
+
+#define MAX_HOSTNAME 256
+
+/*
+ * make_directory() creates a directory unless it exists already.
+ */
+
+static int make_directory(const char *path)
+{
+  if (mkdir(path, 0755) != 0 && errno != EEXIST)
+  {
+    perror(path);
+    return -1;
+  }
+  return 0;
+}
+
+int host_cache_path(const char *name, char *path, size_t size)
+{
+  char directory[HOST_CACHE_PATH];
+  char hostname[MAX_HOSTNAME];
+  const char *base = getenv("XDG_CACHE_HOME");
+  int length;
+
+  if (base != NULL && base[0] != '\0')
+  {
+    length = snprintf(directory, sizeof(directory), "%s", base);
+  }
+  else
+  {
+    const char *home = getenv("HOME");
+    if (home == NULL || home[0] == '\0')
+    {
+      return -1;
+    }
+    length = snprintf(directory, sizeof(directory), "%s/.cache", home);
+  }
+  if (length < 0 || (size_t) length >= sizeof(directory) ||
+      make_directory(directory))
+  {
+    return -1;
+  }
+
+  int appended = snprintf(directory + length, sizeof(directory) - length,
+                          "/%s", HOST_CACHE_DIR);
+  if (appended < 0 || (size_t) (length + appended) >= sizeof(directory) ||
+      make_directory(directory))
+  {
+    return -1;
+  }
+
+  if (gethostname(hostname, sizeof(hostname)) != 0)
+  {
+    perror("gethostname");
+    return -1;
+  }
+  hostname[sizeof(hostname) - 1] = '\0';
+
+  length = snprintf(path, size, "%s/%s-%s", directory, hostname, name);
+  return (length < 0 || (size_t) length >= size) ? -1 : 0;
+}
@@ -0,0 +1,17 @@
+/*
+ * FILE = HEADER: /include/png.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _png_
+#define _png_
+
+#include "pipeline.h"
+
+int encode_png(struct frame *frame);
+
+#endif
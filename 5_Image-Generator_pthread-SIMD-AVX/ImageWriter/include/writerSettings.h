@@ -0,0 +1,117 @@
+/*
+ * FILE = HEADER: /include/writerSettings.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _writerSettings_
+#define _writerSettings_
+
+/*
+ * The imageWriter works as a pipeline (see pipeline.c):
+ * The main thread claims an image, copies it into one of
+ * number_of_frame_buffers local buffers and releases the slot of the shared
+ * memory segment right away. number_of_encoders threads format the images and
+ * one thread writes them to disk in the order they have been claimed.
+ *
+ * Every local buffer holds MAX_DATA bytes, so with LARGE_IMAGE set to 1
+ * 8 buffers need about 118 MB.
+ */
+
+#define number_of_encoders 4
+#define number_of_frame_buffers 8
+
+/*
+ * Maximum number of images waiting for an encoder thread.
+ */
+
+#define ENCODER_QUEUE_LENGTH 4
+
+/*
+ * Print the utilization of each pipeline stage every STATS_INTERVAL images
+ * (0 = only when the imageWriter terminates).
+ */
+
+#define STATS_INTERVAL 100
+
+/*
+ * Pixel format the imageWriter asks the pixelGenerator for (see
+ * pixelFormat.h). With PIXEL_INDEX16 the pixelGenerator writes 2 instead of
+ * 3 bytes per pixel into the shared memory segment and the main thread
+ * colorizes the image while copying it out of the slot. Images in a format
+ * asked for by another consumer (SDL_Viewer) are converted to PIXEL_RGB24.
+ */
+
+#define WRITER_PIXEL_FORMAT PIXEL_RGB24
+
+/*
+ * File format of the images (see encoder.c):
+ * FORMAT_PPM writes the pixels as they are (p6 ppm).
+ * FORMAT_QOI and FORMAT_PNG compress the images without loss.
+ * FORMAT_Y4M and FORMAT_YUV need OUTPUT_STREAM (see below).
+ *
+ * Images higher than STRIP_HEIGHT rows are split into strips of STRIP_HEIGHT
+ * rows, the strips of an image are compressed in parallel.
+ */
+
+#define OUTPUT_FORMAT FORMAT_PNG
+#define STRIP_HEIGHT 256
+
+/*
+ * Output backend of the sink (see output.c):
+ * OUTPUT_STDIO writes one image after the other with fopen(), fwrite() and
+ * fclose(). OUTPUT_IO_URING keeps up to IO_URING_FRAMES_IN_FLIGHT images in
+ * flight and falls back to OUTPUT_STDIO if io_uring is not available.
+ * IO_URING_FRAMES_IN_FLIGHT has to be smaller than number_of_frame_buffers.
+ * While the sink waits for the next image it collects finished images every
+ * OUTPUT_POLL_INTERVAL nanoseconds.
+ *
+ * With IO_URING_O_DIRECT set to 1 the images bypass the page cache. This only
+ * pays off for large images (LARGE_IMAGE) on a real disk, tmpfs supports
+ * O_DIRECT since Linux 6.6.
+ */
+
+#define OUTPUT_BACKEND OUTPUT_IO_URING
+#define IO_URING_FRAMES_IN_FLIGHT 4
+#define OUTPUT_POLL_INTERVAL 1000000
+#define IO_URING_O_DIRECT 0
+
+/*
+ * OUTPUT_STREAM appends all images to the file STREAM_FILE ("-" = stdout)
+ * instead of writing one file per image. Together with FORMAT_Y4M (or
+ * FORMAT_YUV for raw YUV 4:2:0 frames) the stream can be piped into a video
+ * encoder:
+ *
+ *   ./imageWriter.out | ffmpeg -i - mandelbrot.mp4
+ *
+ * STREAM_FRAME_RATE is the frame rate written into the Y4M header.
+ */
+
+#define STREAM_FILE "-"
+#define STREAM_FRAME_RATE 25
+
+/*
+ * OUTPUT_ARCHIVE stores all images in the archive ARCHIVE_FILE (%d is
+ * replaced by the process id). Every ARCHIVE_KEYFRAME_INTERVAL-th image is a
+ * keyframe, the images in between are stored as difference to the image
+ * before, in tiles of ARCHIVE_TILE_SIZE x ARCHIVE_TILE_SIZE pixels.
+ * OUTPUT_FORMAT has to be FORMAT_PPM. Use the archiveDecoder to export
+ * images from the archive.
+ */
+
+#define ARCHIVE_FILE "images-%d.mfa"
+#define ARCHIVE_KEYFRAME_INTERVAL 30
+#define ARCHIVE_TILE_SIZE 64
+
+/*
+ * OUTPUT_MMAP writes ppm images straight out of the shared memory segment
+ * into preallocated, memory mapped files (see direct.c). OUTPUT_WRITEV
+ * writes header and pixels out of the segment with a single writev(). The
+ * encoder and sink threads are not started. OUTPUT_FORMAT has to be
+ * FORMAT_PPM.
+ */
+
+#endif
@@ -0,0 +1,19 @@
+/*
+ * FILE = HEADER: /include/yuv.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _yuv_
+#define _yuv_
+
+#include <stddef.h>
+
+size_t yuv420_size(int width, int height);
+void rgb_to_yuv420(const unsigned char *rgb, int width, int height,
+                   unsigned char *yuv);
+
+#endif
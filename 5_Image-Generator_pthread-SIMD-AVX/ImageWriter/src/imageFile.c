@@ -0,0 +1,85 @@
+/*
+ * FILE = /src/imageFile.c
+ *
+ * The make_image_name() function names the image file after the number the
+ * pixelGenerator gave to the image and its file format.
+ *
+ * The write_image_file() function writes an image into its file with
+ * fopen(), fwrite() and fclose(). It is the stdio output backend
+ * (see output.c).
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "global_ids_W.h"
+#include "imageFile.h"
+#include "encoder.h"
+
+int make_image_name(struct frame *frame)
+{
+
+/*
+ * Print the number of the image to the imagename.
+ */
+
+  int length = snprintf(frame->name, sizeof(frame->name), "image-%03lu.%s",
+                        frame->framenumber, image_extension(frame->format));
+  if ((length < 0) || (length >= sizeof(frame->name)))
+  {
+    perror("sprintf");
+    return -1;
+  }
+  return 0;
+}
+
+int write_image_file(struct frame *frame)
+{
+  if (make_image_name(frame) != 0)
+  {
+    return -1;
+  }
+
+  g_pIMAGE = fopen(frame->name, "wb");
+  if (g_pIMAGE == NULL)
+  {
+    printf("Could not open file.");
+    return -1;
+  }
+
+/*
+ * Write the header and the image data to the image file.
+ */
+
+  if (fwrite(frame->header, 1, frame->headerlength, g_pIMAGE) !=
+      frame->headerlength)
+  {
+    perror("fwrite");
+    return -1;
+  }
+
+  if (fwrite(frame->data, 1, frame->datalength, g_pIMAGE) !=
+      frame->datalength)
+  {
+    printf("Error writing image data to file\n");
+    return -1;
+  }
+
+  if (fclose(g_pIMAGE) == 0)
+  {
+    g_pIMAGE = NULL;
+  }
+  else
+  {
+    g_pIMAGE = NULL;
+    printf("Error: IMAGE File could not be closed.\n");
+    return -1;
+  }
+
+  return 0;
+}
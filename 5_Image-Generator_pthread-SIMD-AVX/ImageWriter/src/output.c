@@ -0,0 +1,152 @@
+/*
+ * FILE = /src/output.c
+ *
+ * RELATED FILES:     *.c                              *.h
+ *                    imageFile.c                      imageFile.h
+ *                    ioUring.c                        ioUring.h
+ *                    stream.c                         stream.h
+ *                    archive.c                        archive.h
+ *                                                     output.h
+ *
+ * The sink thread of the pipeline (see pipeline.c) hands every image to
+ * output_frame(), which writes it with the output backend selected by
+ * open_output():
+ *
+ * OUTPUT_STDIO:    write_image_file() (imageFile.c) writes the image with
+ *                  fopen(), fwrite() and fclose() and returns when the file
+ *                  has been closed.
+ * OUTPUT_IO_URING: uring_write_frame() (ioUring.c) submits open, write and
+ *                  close of the image to the kernel and returns right away.
+ *                  Several images are written at the same time.
+ * OUTPUT_STREAM:   stream_write_frame() (stream.c) appends the image to a
+ *                  single file or to stdout.
+ * OUTPUT_ARCHIVE:  archive_write_frame() (archive.c) stores the image as
+ *                  keyframe or as delta to the image before in an archive.
+ *
+ * If io_uring is not available open_output() falls back to stdio.
+ *
+ * OUTPUT_MMAP and OUTPUT_WRITEV are direct output backends and bypass the
+ * pipeline and output.c (see direct.c).
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+
+#include "output.h"
+#include "imageFile.h"
+#include "ioUring.h"
+#include "stream.h"
+#include "archive.h"
+
+static int g_backend = OUTPUT_STDIO;
+
+/*
+ * open_output() returns the backend in use or -1 if the stream or archive
+ * could not be opened. file is the name of the stream ("-" is stdout) or the
+ * archive, the other backends ignore it.
+ */
+
+int open_output(int backend, int direct, int frames_in_flight, char *file)
+{
+  g_backend = OUTPUT_STDIO;
+
+  if (backend == OUTPUT_STREAM)
+  {
+    if (stream_open(file) != 0)
+    {
+      return -1;
+    }
+    g_backend = OUTPUT_STREAM;
+  }
+
+  if (backend == OUTPUT_ARCHIVE)
+  {
+    if (archive_open(file) != 0)
+    {
+      return -1;
+    }
+    g_backend = OUTPUT_ARCHIVE;
+  }
+
+  if (backend == OUTPUT_IO_URING)
+  {
+    if (uring_open(frames_in_flight, direct) == 0)
+    {
+      g_backend = OUTPUT_IO_URING;
+    }
+    else
+    {
+      printf("io_uring is not available, writing images with stdio\n");
+    }
+  }
+  return g_backend;
+}
+
+int output_frame(struct frame *frame, frame_done_t done)
+{
+  if (g_backend == OUTPUT_IO_URING)
+  {
+    return uring_write_frame(frame, done);
+  }
+
+  int ret;
+  if (g_backend == OUTPUT_STREAM)
+  {
+    ret = stream_write_frame(frame);
+  }
+  else if (g_backend == OUTPUT_ARCHIVE)
+  {
+    ret = archive_write_frame(frame);
+  }
+  else
+  {
+    ret = write_image_file(frame);
+  }
+
+  done(frame);
+  return ret;
+}
+
+int poll_output(void)
+{
+  if (g_backend == OUTPUT_IO_URING)
+  {
+    return uring_poll();
+  }
+  return 0;
+}
+
+/*
+ * flush_output() waits until all images handed to output_frame() have been
+ * written.
+ */
+
+int flush_output(void)
+{
+  if (g_backend == OUTPUT_IO_URING)
+  {
+    return uring_flush();
+  }
+  return 0;
+}
+
+void close_output(void)
+{
+  if (g_backend == OUTPUT_IO_URING)
+  {
+    uring_close();
+  }
+  if (g_backend == OUTPUT_STREAM)
+  {
+    stream_close();
+  }
+  if (g_backend == OUTPUT_ARCHIVE)
+  {
+    archive_close();
+  }
+  g_backend = OUTPUT_STDIO;
+}
@@ -22,6 +22,8 @@
 #include "global_ids.h"
 #include "thread_handler.h"
 #include "universalSettings.h"
+#include "generator_latency.h"
+#include "trace.h"
 
 void cleanup(void)
 {
@@ -31,6 +33,8 @@ void cleanup(void)
 
   #endif
 
+  print_generator_latency();
+
   if (g_shmid != -1)
   {
     if ((shmctl(g_shmid, IPC_RMID, 0)) < 0)
@@ -115,6 +119,13 @@ void cleanup(void)
       g_membuf = NULL;
     }
   }
+  if (g_stats != NULL || g_statsid != -1)
+  {
+    remove_stats_page(g_stats, g_statsid);
+    g_stats = NULL;
+    g_statsid = -1;
+  }
+  write_trace("pixelGenerator");
   #if DEBUG
 
   printf("\nCleanup completed.\n");
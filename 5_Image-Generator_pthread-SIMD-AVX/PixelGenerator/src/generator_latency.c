@@ -0,0 +1,81 @@
+/*
+ * FILE =  /src/generator_latency.c
+ *
+ * This file holds the latency histograms (see latency.h) of the stages the
+ * pixelGenerator takes every image through:
+ *
+ * slot wait  waiting for a consumer to release the slot of the image
+ *            (semaphore SEM_SLOT_FREE, see sharedSegment.h)
+ * compute    applying the view_commands and generate_image()
+ * copy       copying the image into the shared memory segment
+ * total      all of the above
+ *
+ * The histograms are printed every LATENCY_INTERVAL images (see
+ * universalSettings.h) and by cleanup(), with the perf counters (see
+ * perfCounters.h) of the compute and copy stage if PERF_COUNTERS is set.
+ * The colors are looked up inside the escape loop, so the compute stage
+ * includes colorizing.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+
+#include "latency.h"
+#include "perfCounters.h"
+#include "universalSettings.h"
+#include "generator_latency.h"
+
+#define GENERATOR_STAGES 4
+
+static const char *g_stage_names[GENERATOR_STAGES] =
+{
+  "slot wait", "compute", "copy", "total"
+};
+
+static struct latency_histogram g_latency[GENERATOR_STAGES];
+
+static const char *g_perf_names[GENERATOR_PERF_STAGES] =
+{
+  "compute", "copy"
+};
+
+static struct perf_stage g_perf[GENERATOR_PERF_STAGES];
+
+void record_generator_latency(const struct frame_times *times)
+{
+  record_latency(&g_latency[0], times->generate - times->acquire);
+  record_latency(&g_latency[1], times->generated - times->generate);
+  record_latency(&g_latency[2], times->published - times->generated);
+  record_latency(&g_latency[3], times->published - times->acquire);
+
+  if ((LATENCY_INTERVAL != 0) && (g_latency[3].count % LATENCY_INTERVAL == 0))
+  {
+    print_generator_latency();
+  }
+}
+
+/*
+ * record_generator_perf() adds the counters of a thread between begin and end
+ * to a stage. The main thread counts frames, the worker threads add their
+ * counters to the image of the main thread with frames = 0.
+ */
+
+void record_generator_perf(int stage, struct perf_counters *counters,
+                           const struct perf_sample *begin,
+                           const struct perf_sample *end, int frames)
+{
+  add_perf(&g_perf[stage], counters, begin, end, frames);
+}
+
+void print_generator_latency(void)
+{
+  if (g_latency[3].count > 0)
+  {
+    print_latency("pixelGenerator", g_stage_names, g_latency, GENERATOR_STAGES);
+    print_perf("pixelGenerator", g_perf_names, g_perf, GENERATOR_PERF_STAGES);
+  }
+}
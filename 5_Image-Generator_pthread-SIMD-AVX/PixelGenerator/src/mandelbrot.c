@@ -5,19 +5,26 @@
  *                    thread_handler.c                 thread_handler.h
  *                    numberOfPixel.c                  numberOfPixel.h
  *
- * This function takes a colorpalette created by the function
- * create_color_palette() and the unsigned char *pointer to a local imagebuffer
- * as arguments.
- * The generate_image function sets the start parameters for creating the
- * madelbrot set and alters them everytime the function gets invoked.
+ * This function takes a table holding one pixel for every number of iterations
+ * (see pixelFormat.c), the number of bytes per pixel, the unsigned char
+ * *pointer to a local imagebuffer and the section of the mandelbrot set
+ * (see viewCommand.h) as arguments.
+ * The generate_image function generates the section and alters it everytime
+ * the function gets invoked, unless a consumer has taken over the section.
+ *
+ * generate_image returns the number of tiles generated, -1 on error.
+ * If view->cancellable is set the threads stop after their current tile as
+ * soon as a consumer has sent a new view_command. The image is incomplete,
+ * only the first tiles of the center-out order show the section, the other
+ * pixels still hold the image before.
  *
  * Depending on the number of threads specified in thread_handler.h this
  * function can split the computation of one image on several threads.
- * e.g.: If number_of_threads in thread_handler.h is set to 4, every thread
- * generates a quarter of the image.
+ * The image is split into tiles (see tiles.c), every thread takes the next
+ * tile until all tiles are taken, starting at the center of the image.
  *
- * the struct threaddata holds the start and stop parameters for each thread,
- * the pointer to the local imagebuffer and colorpalette.
+ * the struct threaddata holds the start parameters for each thread, the tiles
+ * of the image, the pointer to the local imagebuffer and table of pixels.
  *
  * Copyright (c) 2016 Bernhard Lindner
  *
@@ -26,9 +33,13 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <pthread.h>
 #include "numberOfPixel.h"
 #include "thread_handler.h"
+#include "mandelbrot.h"
+#include "viewCommand.h"
+#include "tiles.h"
 
 /*
  * GLOBALS that need to be accessed by the SIGINT handler
@@ -38,26 +49,45 @@
 pthread_t g_thread[number_of_threads];
 int g_thread_aliveness[number_of_threads];
 
-int generate_image(unsigned char palette[][3], unsigned char *imagebuffer)
-{
+/*
+ * counters of every thread for the last image, one cache line each
+ */
+
+static struct thread_stats g_thread_stats[number_of_threads];
 
 /*
- * int mandel_segment can be set to 1, 2 or 3 to zoom into three different
- * segments of the mandelbrot set.
+ * number of threads started by generate_image(), number_of_threads unless
+ * the kernel benchmark has changed it
  */
 
-  int mandel_segment = 2;
+static int g_threads = number_of_threads;
+
+int set_number_of_threads(int threads)
+{
+  if (threads < 1 || threads > number_of_threads)
+  {
+    return -1;
+  }
+  g_threads = threads;
+  return 0;
+}
+
+int last_thread_stats(struct thread_stats **stats)
+{
+  *stats = g_thread_stats;
+  return g_threads;
+}
+
+int generate_image(unsigned char *pixels, int bpp, unsigned char *imagebuffer,
+                   struct viewport *view)
+{
 
 /*
- * start parameter for the madelbrot set
+ * int mandel_segment can be set to 1, 2 or 3 to zoom into three different
+ * segments of the mandelbrot set.
  */
 
-  static double xmin = -2.5;
-  static double xmax = 1.5;
-  static double ymin = -1.5;
-  static double ymax = 1.5;
-  static double zoom = 1;
-  static double e = 1;
+  int mandel_segment = 2;
 
 /*
  * generating start parameters depending on the number of threads that are
@@ -65,22 +95,34 @@ int generate_image(unsigned char palette[][3], unsigned char *imagebuffer)
  */
 
   struct threaddata tdata[number_of_threads];
+  struct tile_queue tiles;
+
+  if (init_tiles() != 0)
+  {
+    return -1;
+  }
+  reset_tiles(&tiles);
 
   for (int n = 0; n < number_of_threads; n++)
   {
     tdata[n].buffer = imagebuffer;
-    tdata[n].colpalette = palette;
-    tdata[n].xp = ((xmax - xmin) / WIDTH);
-    tdata[n].yp = ((ymax - ymin) / HEIGHT);
-    tdata[n].xmin = xmin;
-    tdata[n].xmax = xmax;
-    tdata[n].ymin = ymin;
-    tdata[n].ymax = ymax;
-    tdata[n].zoom = zoom;
-    tdata[n].xy = (HEIGHT * WIDTH/number_of_threads * 3 * n);
-    tdata[n].start_y = (n * HEIGHT/number_of_threads);
-    tdata[n].stop_y = ((n + 1) * HEIGHT/number_of_threads);
+    tdata[n].pixels = pixels;
+    tdata[n].bpp = bpp;
+    tdata[n].xp = ((view->xmax - view->xmin) / WIDTH);
+    tdata[n].yp = ((view->ymax - view->ymin) / HEIGHT);
+    tdata[n].xmin = view->xmin;
+    tdata[n].xmax = view->xmax;
+    tdata[n].ymin = view->ymin;
+    tdata[n].ymax = view->ymax;
+    tdata[n].zoom = view->zoom;
+    tdata[n].xy = 0;
+    tdata[n].tiles = &tiles;
+    tdata[n].stats = &g_thread_stats[n];
+    tdata[n].number = n;
+    memset(&g_thread_stats[n], 0, sizeof(struct thread_stats));
     tdata[n].am_I_alive = &g_thread_aliveness[n];
+    tdata[n].cancellable = view->cancellable;
+    tdata[n].cancelled = 0;
   }
 
 /*
@@ -90,7 +132,7 @@ int generate_image(unsigned char palette[][3], unsigned char *imagebuffer)
  * The function starts the threads.
  */
 
-  for (int t = 0; t < number_of_threads; t++)
+  for (int t = 0; t < g_threads; t++)
   {
     if (pthread_create(&g_thread[t], NULL, thandler, &tdata[t]) != 0)
     {
@@ -105,7 +147,7 @@ int generate_image(unsigned char palette[][3], unsigned char *imagebuffer)
  * The function waits for the specified thread to terminate.
  */
 
-  for (int j = 0; j < number_of_threads; j++)
+  for (int j = 0; j < g_threads; j++)
   {
     if (pthread_join(g_thread[j], NULL) != 0)
     {
@@ -114,35 +156,53 @@ int generate_image(unsigned char palette[][3], unsigned char *imagebuffer)
     }
   }
 
+/*
+ * Every tile taken from the queue has been finished, a thread stops only
+ * between two tiles.
+ */
+
+  for (int n = 0; n < g_threads; n++)
+  {
+    if (tdata[n].cancelled)
+    {
+      return (tiles.next < number_of_tiles()) ? tiles.next : number_of_tiles();
+    }
+  }
+
 /*
  * altering the start parameter to zoom into the madelbrot set.
  */
 
+  if (!view->automatic)
+  {
+    return number_of_tiles();
+  }
+
   if (mandel_segment == 1)
   {
-    xmin = xmin - 0.005 * e;
-    xmax = xmax - 0.005 * e;
-    ymin = ymin - 0.0062 * e;
-    ymax = ymax - 0.0062 * e;
-    zoom = zoom + 0.01 * e;
-    e++;
+    view->xmin = view->xmin - 0.005 * view->e;
+    view->xmax = view->xmax - 0.005 * view->e;
+    view->ymin = view->ymin - 0.0062 * view->e;
+    view->ymax = view->ymax - 0.0062 * view->e;
+    view->zoom = view->zoom + 0.01 * view->e;
+    view->e++;
   }
 
   if (mandel_segment == 2)
   {
-    xmin = xmin - 0.014 * e;
-    xmax = xmax - 0.014 * e;
-    zoom = zoom + 0.01 * e;
-    e++;
+    view->xmin = view->xmin - 0.014 * view->e;
+    view->xmax = view->xmax - 0.014 * view->e;
+    view->zoom = view->zoom + 0.01 * view->e;
+    view->e++;
   }
 
   if (mandel_segment == 3)
   {
-    xmin = xmin - 0.015 * e;
-    xmax = xmax - 0.015 * e;
-    zoom = zoom + 0.01 * e;
-    e++;
+    view->xmin = view->xmin - 0.015 * view->e;
+    view->xmax = view->xmax - 0.015 * view->e;
+    view->zoom = view->zoom + 0.01 * view->e;
+    view->e++;
   }
 
-  return 0;
+  return number_of_tiles();
 }
@@ -23,6 +23,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <pthread.h>
 #include <math.h>
 #include <signal.h>
@@ -33,6 +34,12 @@
 #include "universalSettings.h"
 #include "install_signal_handler.h"
 #include "cleanup_thread_handler.h"
+#include "global_ids.h"
+#include "viewCommand.h"
+#include "tiles.h"
+#include "statsPage.h"
+#include "trace.h"
+#include "generator_latency.h"
 
 #include "xmmintrin.h"
 #include "emmintrin.h"
@@ -90,6 +97,23 @@ void *thandler(void *ptr)
 
   (*hdata->am_I_alive) = 0;
 
+/*
+ * The main thread has buffer 0 of the trace (see trace.h).
+ */
+
+  trace_thread(hdata->number + 1, "worker");
+
+/*
+ * The perf counters of the thread are added to the compute stage of the
+ * image (see generator_latency.c).
+ */
+
+  struct perf_counters counters;
+  struct perf_sample perf_start, perf_end;
+
+  open_perf_counters(&counters);
+  read_perf_counters(&counters, &perf_start);
+
 /*
  * The follwing section contains Intel Intrinsics instructions for SIMD AVX
  * The Intel Intrinsics Guide provides detailed information on below used
@@ -104,31 +128,53 @@ void *thandler(void *ptr)
 
   __m256d one = _mm256_set_pd(1, 1, 1, 1);
 
-  for (int pixel_y = hdata->start_y; pixel_y < hdata->stop_y; pixel_y++)
+/*
+ * The threads take tiles of the image until all tiles are taken, the tiles
+ * around the center of the image first (see tiles.c).
+ * The counters (see statsPage.h) are kept in local variables and added to
+ * the thread's struct thread_stats after every tile.
+ */
+
+  int order;
+
+  while ((order = next_tile(hdata->tiles)) != -1)
   {
-    double h1y0;
-    h1y0 = ((hdata->ymax - (pixel_y * hdata->yp)) / hdata->zoom);
+    long long tile_start = stats_clock();
+    unsigned long long iterations = 0;
+    unsigned long long lane_iterations = 0;
+    unsigned long long cardioid = 0;
+    unsigned long long bulb = 0;
 
-    __m256d y0 = _mm256_set_pd(h1y0, h1y0, h1y0, h1y0);
-    __m256d h3y0 = _mm256_mul_pd(y0, y0);
+    int start_x, stop_x, start_y, stop_y;
+    tile_bounds(order, &start_x, &stop_x, &start_y, &stop_y);
 
-    for (int pixel_x = 0; pixel_x < WIDTH; pixel_x = pixel_x + 4)
+    for (int pixel_y = start_y; pixel_y < stop_y; pixel_y++)
     {
-      double x10 = ((hdata->xmin + (pixel_x * hdata->xp)) / hdata->zoom);
-      double x20 = ((hdata->xmin + ((pixel_x + 1) * hdata->xp)) / hdata->zoom);
-      double x30 = ((hdata->xmin + ((pixel_x + 2) * hdata->xp)) / hdata->zoom);
-      double x40 = ((hdata->xmin + ((pixel_x + 3) * hdata->xp)) / hdata->zoom);
+      hdata->xy = (pixel_y * WIDTH + start_x) * hdata->bpp;
+
+      double h1y0;
+      h1y0 = ((hdata->ymax - (pixel_y * hdata->yp)) / hdata->zoom);
+
+      __m256d y0 = _mm256_set_pd(h1y0, h1y0, h1y0, h1y0);
+      __m256d h3y0 = _mm256_mul_pd(y0, y0);
 
-      __m256d x0 = _mm256_set_pd(x10, x20, x30, x40);
+      for (int pixel_x = start_x; pixel_x < stop_x; pixel_x = pixel_x + 4)
+      {
+        double x10 = ((hdata->xmin + (pixel_x * hdata->xp)) / hdata->zoom);
+        double x20 = ((hdata->xmin + ((pixel_x + 1) * hdata->xp)) / hdata->zoom);
+        double x30 = ((hdata->xmin + ((pixel_x + 2) * hdata->xp)) / hdata->zoom);
+        double x40 = ((hdata->xmin + ((pixel_x + 3) * hdata->xp)) / hdata->zoom);
+
+        __m256d x0 = _mm256_set_pd(x10, x20, x30, x40);
 
-      __m256d x = _mm256_set_pd(0, 0, 0, 0);
+        __m256d x = _mm256_set_pd(0, 0, 0, 0);
 
-      __m256d y = _mm256_set_pd(0, 0, 0, 0);
+        __m256d y = _mm256_set_pd(0, 0, 0, 0);
 
-      __m256d rememberiteration = _mm256_set_pd(0, 0, 0, 0);
+        __m256d rememberiteration = _mm256_set_pd(0, 0, 0, 0);
 
-      int iteration;
-      iteration = 0;
+        int iteration;
+        iteration = 0;
 
 /*---------------------------------------------------------------------------*/
 /* C A R D I O I D  A N D  B U L B  C H E C K I N G                          */
@@ -157,12 +203,12 @@ void *thandler(void *ptr)
  *  q = (x0 - 0.25) * (x0 - 0.25) + (y0 * y0);
  */
 
-      __m256d h1 = _mm256_set_pd(0.25, 0.25, 0.25, 0.25);
-      __m256d h2 = _mm256_set_pd(0, 0, 0, 0);
-      h2 = _mm256_sub_pd(x0, h1);
-      __m256d h3 = _mm256_set_pd(0, 0, 0, 0);
-      h3 = _mm256_mul_pd(h2, h2);
-      __m256d q = _mm256_add_pd(h3, h3y0);
+        __m256d h1 = _mm256_set_pd(0.25, 0.25, 0.25, 0.25);
+        __m256d h2 = _mm256_set_pd(0, 0, 0, 0);
+        h2 = _mm256_sub_pd(x0, h1);
+        __m256d h3 = _mm256_set_pd(0, 0, 0, 0);
+        h3 = _mm256_mul_pd(h2, h2);
+        __m256d q = _mm256_add_pd(h3, h3y0);
 
 /*
  *
@@ -173,22 +219,19 @@ void *thandler(void *ptr)
  *    (((x0 + 1) * (x0 + 1) + (y0 * y0)) < (0.0625)))
  * {
  *   iteration = MAX_ITERATION;
- *   hdata->buffer[hdata->xy] = hdata->colpalette[iteration][0];
- *   hdata->xy++;
- *   hdata->buffer[hdata->xy] = hdata->colpalette[iteration][1];
- *   hdata->xy++;
- *   hdata->buffer[hdata->xy] = hdata->colpalette[iteration][2];
- *   hdata->xy++;
+ *   memcpy(&hdata->buffer[hdata->xy],
+ *          &hdata->pixels[iteration * hdata->bpp], hdata->bpp);
+ *   hdata->xy += hdata->bpp;
  *   continue;
  * }
  */
 
-      __m256d h1q = _mm256_set_pd(0, 0, 0, 0);
-      h1q = _mm256_add_pd(q, h2);
-      __m256d h2q = _mm256_set_pd(0, 0, 0, 0);
-      h2q = _mm256_mul_pd(q, h1q);
-      __m256d h3q = _mm256_set_pd(0, 0, 0, 0);
-      h3q = _mm256_mul_pd(h1, h3y0);
+        __m256d h1q = _mm256_set_pd(0, 0, 0, 0);
+        h1q = _mm256_add_pd(q, h2);
+        __m256d h2q = _mm256_set_pd(0, 0, 0, 0);
+        h2q = _mm256_mul_pd(q, h1q);
+        __m256d h3q = _mm256_set_pd(0, 0, 0, 0);
+        h3q = _mm256_mul_pd(h1, h3y0);
 
 /*
  * __m256d _mm256_cmp_pd(__m256d a, __m256d b, const int imm8)
@@ -200,18 +243,18 @@ void *thandler(void *ptr)
  * https://software.intel.com/sites/landingpage/IntrinsicsGuide/
  */
 
-      __m256d c1 = _mm256_cmp_pd(h2q, h3q, _CMP_GE_OS);
+        __m256d c1 = _mm256_cmp_pd(h2q, h3q, _CMP_GE_OS);
 
-      __m256d h1x0 = _mm256_set_pd(1, 1, 1, 1);
-      __m256d h2x0 = _mm256_set_pd(0, 0, 0, 0);
-      h2x0 = _mm256_add_pd(x0, h1x0);
-      __m256d h3x0 = _mm256_set_pd(0, 0, 0, 0);
-      h3x0 = _mm256_mul_pd(h2x0, h2x0);
-      __m256d h4x0 = _mm256_set_pd(0, 0, 0, 0);
-      h4x0 = _mm256_add_pd(h3x0, h3y0);
-      __m256d h5 = _mm256_set_pd(0.0625, 0.0625, 0.0625, 0.0625);
+        __m256d h1x0 = _mm256_set_pd(1, 1, 1, 1);
+        __m256d h2x0 = _mm256_set_pd(0, 0, 0, 0);
+        h2x0 = _mm256_add_pd(x0, h1x0);
+        __m256d h3x0 = _mm256_set_pd(0, 0, 0, 0);
+        h3x0 = _mm256_mul_pd(h2x0, h2x0);
+        __m256d h4x0 = _mm256_set_pd(0, 0, 0, 0);
+        h4x0 = _mm256_add_pd(h3x0, h3y0);
+        __m256d h5 = _mm256_set_pd(0.0625, 0.0625, 0.0625, 0.0625);
 
-      __m256d c2 = _mm256_cmp_pd(h4x0, h5, _CMP_GE_OS);
+        __m256d c2 = _mm256_cmp_pd(h4x0, h5, _CMP_GE_OS);
 
 /*
  * int _mm256_testz_pd(__m256d a, __m256d b) computes the biwise AND of
@@ -225,20 +268,22 @@ void *thandler(void *ptr)
  * for more details.
  */
 
-      if ((_mm256_testz_pd(c1, _mm256_set1_pd(-1)) == 1) ||
-          (_mm256_testz_pd(c2, _mm256_set1_pd(-1)) == 1))
-      {
-        for (int c = 0; c < 4; c++)
+        int in_cardioid;
+        in_cardioid = (_mm256_testz_pd(c1, _mm256_set1_pd(-1)) == 1);
+
+        if (in_cardioid ||
+            (_mm256_testz_pd(c2, _mm256_set1_pd(-1)) == 1))
         {
-          hdata->buffer[hdata->xy] = 0;
-          hdata->xy++;
-          hdata->buffer[hdata->xy] = 0;
-          hdata->xy++;
-          hdata->buffer[hdata->xy] = 0;
-          hdata->xy++;
+          cardioid += 4 * in_cardioid;
+          bulb += 4 * !in_cardioid;
+          for (int c = 0; c < 4; c++)
+          {
+            memcpy(&hdata->buffer[hdata->xy],
+                   &hdata->pixels[MAX_ITERATION * hdata->bpp], hdata->bpp);
+            hdata->xy += hdata->bpp;
+          }
+          continue;
         }
-        continue;
-      }
 /*
  *
  ******************************************************************************/
@@ -262,17 +307,17 @@ void *thandler(void *ptr)
  *
  */
 
-      while ((iteration < MAX_ITERATION))
-      {
-        __m256d h1x = _mm256_set_pd(0, 0, 0, 0);
-        h1x = _mm256_mul_pd(x, x);
-        __m256d h1y = _mm256_set_pd(0, 0, 0, 0);
-        h1y = _mm256_mul_pd(y, y);
-        __m256d hxy = _mm256_set_pd(0, 0, 0, 0);
-        hxy = _mm256_add_pd(h1x, h1y);
-        __m256d h1xy = _mm256_set_pd(4, 4, 4, 4);
+        while ((iteration < MAX_ITERATION))
+        {
+          __m256d h1x = _mm256_set_pd(0, 0, 0, 0);
+          h1x = _mm256_mul_pd(x, x);
+          __m256d h1y = _mm256_set_pd(0, 0, 0, 0);
+          h1y = _mm256_mul_pd(y, y);
+          __m256d hxy = _mm256_set_pd(0, 0, 0, 0);
+          hxy = _mm256_add_pd(h1x, h1y);
+          __m256d h1xy = _mm256_set_pd(4, 4, 4, 4);
 
-        __m256d c3 = _mm256_cmp_pd(hxy, h1xy, _CMP_LT_OS);
+          __m256d c3 = _mm256_cmp_pd(hxy, h1xy, _CMP_LT_OS);
 
 /*
  * To design the termination condition two other mandelbrot SIMD examples
@@ -293,41 +338,41 @@ void *thandler(void *ptr)
  * significant bit will be 1 all other bits will be set to zero.
  */
 
-        __m256d c3h1 = _mm256_and_pd(c3, one);
-        rememberiteration = _mm256_add_pd(c3h1, rememberiteration);
+          __m256d c3h1 = _mm256_and_pd(c3, one);
+          rememberiteration = _mm256_add_pd(c3h1, rememberiteration);
 
-        if (_mm256_testz_pd(c3, _mm256_set1_pd(-1)) == 1)
-        {
-          break;
-        }
+          if (_mm256_testz_pd(c3, _mm256_set1_pd(-1)) == 1)
+          {
+            break;
+          }
 
-        __m256d temp1x = _mm256_set_pd(0, 0, 0, 0);
-        temp1x = _mm256_sub_pd(h1x, h1y);
+          __m256d temp1x = _mm256_set_pd(0, 0, 0, 0);
+          temp1x = _mm256_sub_pd(h1x, h1y);
 
-        __m256d temp2x = _mm256_set_pd(0, 0, 0, 0);
-        temp2x = _mm256_add_pd(temp1x, x0);
+          __m256d temp2x = _mm256_set_pd(0, 0, 0, 0);
+          temp2x = _mm256_add_pd(temp1x, x0);
 
-        __m256d temp1y = _mm256_set_pd(0, 0, 0, 0);
-        temp1y = _mm256_mul_pd(x, y);
+          __m256d temp1y = _mm256_set_pd(0, 0, 0, 0);
+          temp1y = _mm256_mul_pd(x, y);
 
-        __m256d temph2y = _mm256_set_pd(2, 2, 2, 2);
+          __m256d temph2y = _mm256_set_pd(2, 2, 2, 2);
 
-        __m256d temp2y = _mm256_set_pd(0, 0, 0, 0);
-        temp2y = _mm256_mul_pd(temp1y, temph2y);
+          __m256d temp2y = _mm256_set_pd(0, 0, 0, 0);
+          temp2y = _mm256_mul_pd(temp1y, temph2y);
 
-        __m256d temp3y = _mm256_set_pd(0, 0, 0, 0);
-        temp3y = _mm256_add_pd(temp2y, y0);
-        y = temp3y;
-        x = temp2x;
+          __m256d temp3y = _mm256_set_pd(0, 0, 0, 0);
+          temp3y = _mm256_add_pd(temp2y, y0);
+          y = temp3y;
+          x = temp2x;
 
-        iteration = iteration + 1;
-      }
+          iteration = iteration + 1;
+        }
 
 /*
  *
  ******************************************************************************/
 
-      double position[4];
+        double position[4];
 
 /*
  * void _mm256_storeu_pd(double * mem_addr, __m256d a)
@@ -337,37 +382,64 @@ void *thandler(void *ptr)
  *
  * https://software.intel.com/sites/landingpage/IntrinsicsGuide/
  */
-      _mm256_storeu_pd(position, rememberiteration);
+        _mm256_storeu_pd(position, rememberiteration);
 
 /*
  * The information belonging to the fist of four "pixels" will be stored
  * at the highest memory address.
  * MEM[mem_addr+255:mem_addr] := a[255:0]
  */
-      int pos[4];
-      pos[0] = position[3];
-      pos[1] = position[2];
-      pos[2] = position[1];
-      pos[3] = position[0];
+        int pos[4];
+        pos[0] = position[3];
+        pos[1] = position[2];
+        pos[2] = position[1];
+        pos[3] = position[0];
 
 /*
- * Looking up colors for the current iteration in the colorpalette (generated
- * by the function create_color_palette()) and writing the R G B values of the
- * current computed pixel into the local imagebuffer.
+ * Looking up the pixels for the current iterations in the table of pixels
+ * (generated by make_pixel_table() from the colorpalette) and writing them
+ * into the local imagebuffer in the pixel format the consumers asked for.
  */
 
-      for (int c = 0; c < 4; c++)
-      {
-        hdata->buffer[hdata->xy] = hdata->colpalette[pos[c]][0];
-        hdata->xy++;
-        hdata->buffer[hdata->xy] = hdata->colpalette[pos[c]][1];
-        hdata->xy++;
-        hdata->buffer[hdata->xy] = hdata->colpalette[pos[c]][2];
-        hdata->xy++;
+        for (int c = 0; c < 4; c++)
+        {
+          memcpy(&hdata->buffer[hdata->xy],
+                 &hdata->pixels[pos[c] * hdata->bpp], hdata->bpp);
+          hdata->xy += hdata->bpp;
+          iterations += pos[c];
+        }
+        lane_iterations += 4 * iteration;
       }
     }
+
+    hdata->stats->pixels += (stop_x - start_x) * (stop_y - start_y);
+    hdata->stats->iterations += iterations;
+    hdata->stats->lane_iterations += lane_iterations;
+    hdata->stats->cardioid += cardioid;
+    hdata->stats->bulb += bulb;
+    hdata->stats->tiles++;
+    long long tile_end = stats_clock();
+    hdata->stats->busy_ns += tile_end - tile_start;
+    trace_event("tile", tile_start, tile_end, order);
+
+/*
+ * A consumer has sent a new view_command, the image would show the old
+ * section. The thread stops after the tile it has finished, the finished
+ * tiles are published (see mandelbrot.c).
+ */
+
+    if (hdata->cancellable && view_commands_pending(g_membuf))
+    {
+      hdata->cancelled = 1;
+      break;
+    }
   }
 
+  read_perf_counters(&counters, &perf_end);
+  record_generator_perf(PERF_STAGE_COMPUTE, &counters, &perf_start, &perf_end,
+                        0);
+  close_perf_counters(&counters);
+
   (*hdata->am_I_alive) = -1;
 
 /*
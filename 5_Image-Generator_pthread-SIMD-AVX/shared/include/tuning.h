@@ -0,0 +1,41 @@
+/*
+ * FILE = HEADER: /include/tuning.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _tuning_
+#define _tuning_
+
+/*
+ * The settings of an image generator (backend) the kernel autotuner
+ * (98_Kernel_Benchmark/src/kernelTune.c) has measured to be the fastest on
+ * this host. They are kept in the file tuning-<backend>-<width>x<height> of
+ * the host (see hostCache.h), the pixelGenerator loads them at startup and
+ * keeps its defaults if the autotuner has not been run.
+ *
+ * threads            set_number_of_threads() of the image generator,
+ *                    0 = its default
+ * local_x, local_y   OpenCL work group size (see setup_OpenCL.h),
+ *                    0 = chosen by the OpenCL driver
+ */
+
+#define TUNING_CACHE "tuning"
+
+struct tuning
+{
+  int tile_size;                   // see tiles.h
+  int threads;
+  int local_x;
+  int local_y;
+};
+
+void default_tuning(struct tuning *tuning);
+int load_tuning(const char *backend, struct tuning *tuning);
+int save_tuning(const char *backend, const struct tuning *tuning);
+void print_tuning(const struct tuning *tuning);
+
+#endif
@@ -0,0 +1,141 @@
+/*
+ * FILE = /src/pixelFormat.c
+ *
+ * This file holds the pixel formats of the images in the shared memory
+ * segment (see pixelFormat.h).
+ * This file is used by the imageWriter and pixelGenerator program.
+ *
+ * The pixelGenerator does not convert the images it has generated. Before
+ * generating an image it fills a table with the value of one pixel in the
+ * requested format for every number of iterations (make_pixel_table()) and
+ * copies the value out of the table for every pixel.
+ *
+ * Consumers getting an image in a format they can not use turn it into
+ * PIXEL_RGB24 with convert_to_rgb24().
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "numberOfPixel.h"
+#include "pixelFormat.h"
+
+int bytes_per_pixel(int format)
+{
+  switch (format)
+  {
+    case PIXEL_RGB24:
+      return 3;
+    case PIXEL_XRGB8888:
+      return 4;
+    case PIXEL_INDEX16:
+      return 2;
+  }
+  return -1;
+}
+
+size_t pixel_data_size(int format)
+{
+  return (size_t) WIDTH * HEIGHT * bytes_per_pixel(format);
+}
+
+char *pixel_format_name(int format)
+{
+  switch (format)
+  {
+    case PIXEL_RGB24:
+      return "RGB24";
+    case PIXEL_XRGB8888:
+      return "XRGB8888";
+    case PIXEL_INDEX16:
+      return "INDEX16";
+  }
+  return "unknown";
+}
+
+/*
+ * make_pixel_table() writes the pixel of every palette entry into table,
+ * which has to hold PALETTE_SIZE * MAX_BYTES_PER_PIXEL bytes. Pixel i starts
+ * at table + i * bytes_per_pixel(format).
+ */
+
+int make_pixel_table(int format, unsigned char palette[][3],
+                     unsigned char *table)
+{
+  for (int i = 0; i < PALETTE_SIZE; i++)
+  {
+    if (format == PIXEL_RGB24)
+    {
+      memcpy(table + i * 3, palette[i], 3);
+    }
+    else if (format == PIXEL_XRGB8888)
+    {
+      uint32_t pixel = ((uint32_t) palette[i][0] << 16) |
+                       ((uint32_t) palette[i][1] << 8) | palette[i][2];
+      memcpy(table + i * 4, &pixel, 4);
+    }
+    else if (format == PIXEL_INDEX16)
+    {
+      uint16_t pixel = i;
+      memcpy(table + i * 2, &pixel, 2);
+    }
+    else
+    {
+      printf("Error: unknown pixel format %d\n", format);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/*
+ * convert_to_rgb24() turns the WIDTH x HEIGHT pixels of an image in format
+ * into MAX_DATA bytes of PIXEL_RGB24.
+ */
+
+int convert_to_rgb24(unsigned char *rgb, unsigned char *pixels, int format,
+                     unsigned char palette[][3])
+{
+  size_t number_of_pixels = (size_t) WIDTH * HEIGHT;
+
+  if (format == PIXEL_RGB24)
+  {
+    memcpy(rgb, pixels, MAX_DATA);
+  }
+  else if (format == PIXEL_XRGB8888)
+  {
+    for (size_t i = 0; i < number_of_pixels; i++)
+    {
+      uint32_t pixel;
+      memcpy(&pixel, pixels + i * 4, 4);
+      rgb[i * 3] = pixel >> 16;
+      rgb[i * 3 + 1] = pixel >> 8;
+      rgb[i * 3 + 2] = pixel;
+    }
+  }
+  else if (format == PIXEL_INDEX16)
+  {
+    for (size_t i = 0; i < number_of_pixels; i++)
+    {
+      uint16_t index;
+      memcpy(&index, pixels + i * 2, 2);
+      if (index >= PALETTE_SIZE)
+      {
+        index = PALETTE_SIZE - 1;
+      }
+      memcpy(rgb + i * 3, palette[index], 3);
+    }
+  }
+  else
+  {
+    printf("Error: unknown pixel format %d\n", format);
+    return -1;
+  }
+  return 0;
+}
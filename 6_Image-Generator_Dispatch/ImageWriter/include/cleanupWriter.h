@@ -0,0 +1,15 @@
+/*
+ * FILE = HEADER: /include/cleanupWriter.h
+ *
+ * Copyright (c) 2016 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _cleanupWriter_
+#define _cleanupWriter_
+
+void cleanupW(void);
+
+#endif
@@ -0,0 +1,15 @@
+/*
+ * FILE = HEADER: /include/cntrl_c_handler_Writer.h
+ *
+ * Copyright (c) 2016 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _cntrl_c_handler_Writer_
+#define _cntrl_c_handler_Writer_
+
+void cntrl_c_handler_W(int signum);
+
+#endif
@@ -0,0 +1,55 @@
+/*
+ * FILE = HEADER: /include/encoder.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _encoder_
+#define _encoder_
+
+#include <stddef.h>
+
+#include "pipeline.h"
+
+/*
+ * File formats (see OUTPUT_FORMAT in writerSettings.h)
+ */
+
+#define FORMAT_PPM 0
+#define FORMAT_QOI 1
+#define FORMAT_PNG 2
+#define FORMAT_Y4M 3
+#define FORMAT_YUV 4
+
+#define MAX_STRIPS 64
+
+/*
+ * One strip of an image compressed by its own thread.
+ */
+
+struct strip
+{
+  struct frame *frame;
+  int first_row;
+  int rows;
+  int last;                        // 1 for the last strip of the image
+  unsigned char *out;              // output buffer of the strip
+  size_t length;                   // bytes written to out
+  unsigned long adler;             // adler32 of the filtered rows (PNG)
+  int result;
+};
+
+int encode_frame(struct frame *frame);
+int encode_frame_as(struct frame *frame, int format);
+char *image_extension(int format);
+int stream_header(int format, char *header, size_t size);
+
+int reserve_buffer(struct frame *frame, size_t size);
+int split_into_strips(struct frame *frame, struct strip *strips);
+int encode_strips(struct strip *strips, int number_of_strips,
+                  void *(*handler)(void *));
+
+#endif
@@ -0,0 +1,24 @@
+/*
+ * FILE = HEADER: /include/global_ids_W.h
+ *
+ * Copyright (c) 2016 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _global_ids_W_
+#define _global_ids_W_
+
+#include <stdio.h>
+#include <signal.h>
+
+extern int g_shmid;
+extern int g_semid;
+extern int g_slot;
+extern unsigned char *g_membuf;
+extern FILE *g_pIMAGE;
+extern volatile sig_atomic_t g_interrupted;
+extern volatile sig_atomic_t g_pipeline_running;
+
+#endif
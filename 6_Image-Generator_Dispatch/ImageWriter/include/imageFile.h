@@ -0,0 +1,18 @@
+/*
+ * FILE = HEADER: /include/imageFile.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _imageFile_
+#define _imageFile_
+
+#include "pipeline.h"
+
+int make_image_name(struct frame *frame);
+int write_image_file(struct frame *frame);
+
+#endif
@@ -0,0 +1,17 @@
+/*
+ * FILE = HEADER: /include/qoi.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _qoi_
+#define _qoi_
+
+#include "pipeline.h"
+
+int encode_qoi(struct frame *frame);
+
+#endif
@@ -0,0 +1,526 @@
+/*
+ * FILE = MAIN:       /src/ImageWriter.c
+ *
+ * RELATED FILES:     *.c                              *.h
+ *                    generateKey.c                    generateKey.h
+ *                    numberOfPixel.c                  numberOfPixel.h
+ *                    cleanupWriter.c                  cleanupWriter.h
+ *                    cntrl_c_handler_Writer.c         cntrl_c_handler_Writer.h
+ *                    install_signal_handler.C         install_signal_handler.h
+ *                    global_ids_W.c                   global_ids_W.h
+ *                    sharedSegment.c                  sharedSegment.h
+ *                    pipeline.c                       pipeline.h
+ *                    encoder.c                        encoder.h
+ *                    imageFile.c                      imageFile.h
+ *                                                     writerSettings.h
+ *                                                     universalSettings.h
+ *
+ * DEPENDS ON:        pixelGenerator program
+ *
+ * A program that continuously writes images generated by the pixelGenerator
+ * program into image files, png by default (OUTPUT_FORMAT), written with
+ * io_uring on Linux (OUTPUT_BACKEND, see writerSettings.h).
+ *
+ * Several imageWriter programs can run at the same time. Each image is
+ * claimed by exactly one of them and written to a file named after the
+ * number the pixelGenerator gave to the image, so the image files stay
+ * numbered without gaps no matter which imageWriter wrote them. Only the
+ * numbers of partial images (see sharedSegment.h) are left out.
+ *
+ * Inside the imageWriter reading, formatting and writing the images is done
+ * by separate threads (see pipeline.c).
+ *
+ * Copyright (c) 2016 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/sem.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "numberOfPixel.h"
+#include "sharedSegment.h"
+#include "generateKey.h"
+#include "cleanupWriter.h"
+#include "cntrl_c_handler_Writer.h"
+#include "install_signal_handler.h"
+#include "universalSettings.h"
+#include "global_ids_W.h"
+#include "writerSettings.h"
+#include "pipeline.h"
+#include "trace.h"
+#include "output.h"
+#include "stream.h"
+#include "direct.h"
+
+int main(int argc, char *argv[])
+{
+  if (argc > 1)
+  {
+    if ((strncmp(argv[1], "help", 4) == 0) || (strncmp(argv[1], "-h", 2) == 0))
+    {
+      printf("\nThis program reads image data (RGB pixels) out of an shared\n"
+             "memory segment and writes pictures into .png (default), .qoi\n"
+             "or p6 .ppm files, with io_uring on Linux, or into a y4m video\n"
+             "stream (see writerSettings.h).\n"
+             "This program depends on the pixelGenerator program generating\n"
+             "image data and writing it into a shared memory segment\n"
+             "\nThis program does not take any cmdline arguments.\n\n");
+      exit(EXIT_SUCCESS);
+    }
+    else
+    {
+      printf("\nThis program does not take any cmdline arguments.\n\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+/*
+ * Initalize values for global variables (declared in global_ids_W.h)
+ * to determine if a segment should be freed or removed from inside
+ * the cleanupW() function.
+ */
+
+  g_shmid = -1;
+  g_semid = -1;
+  g_slot = -1;
+  g_membuf = NULL;
+  g_pIMAGE = NULL;
+  g_interrupted = 0;
+  g_pipeline_running = 0;
+
+/*
+ * If the images are streamed to stdout, all messages are printed to stderr.
+ */
+
+  if (OUTPUT_BACKEND == OUTPUT_STREAM && strcmp(STREAM_FILE, "-") == 0)
+  {
+    if (redirect_stdout() != 0)
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
+/*---------------------------------------------------------------------------*/
+/* I N S T A L L  S I G N A L  H A N D L E R                                 */
+/*---------------------------------------------------------------------------*/
+
+  if (init_signal_handler(SIGINT, cntrl_c_handler_W) == EXIT_FAILURE)
+  {
+    printf("Error Installing Singnal Handler\n");
+    return EXIT_FAILURE;
+  }
+
+/*---------------------------------------------------------------------------*/
+/* C H E C K  I F  S H A R E D  M E M O R Y  S E G M E N T  E X I S T S      */
+/*---------------------------------------------------------------------------*/
+
+  key_t key = -1;
+  int nosharedmem = 0;
+
+/*
+ * The generateKey() functions is defined in generateKey.c
+ * This function is used by the imageWriter and pixelGenerator to receive a key.
+ */
+
+  key = generateKey();
+  if (key == -1)
+  {
+    printf("Error generating key\n");
+    return EXIT_FAILURE;
+  }
+
+/*
+ * Checking if the shared memory segment exists. The shared memory segment is
+ * created by the pixelGenerator program and therefore depends on the
+ * pixelGenerator programing running.
+ * If the pixelGenerator has not been started the ImageWriter tries to access
+ * the shared memory segment for about 10 seconds and then terminates if the
+ * pixelGenerator does not get started in time.
+ */
+
+  if ((g_shmid = shmget(key, segment_size(), 0)) < 0)
+  {
+    if (errno == ENOENT)
+    {
+      printf("\nShared Memory Segment does not exist\n");
+      printf("Please start the pixelGenerator program\n");
+      printf("Otherwise this program will terminate in 10 seconds\n");
+      nosharedmem = 1;
+      if (sleep(1) != 0)
+      {
+        perror("sleep");
+        return EXIT_FAILURE;
+      }
+      printf("\x1B[1;1H\x1B[2J");
+    }
+    else
+    {
+      perror("shmget");
+      return EXIT_FAILURE;
+    }
+  }
+  if (nosharedmem == 1)
+  {
+    int counter = 10;
+
+    while (counter != 0)
+    {
+      if ((g_shmid = shmget(key, segment_size(), 0)) < 0)
+      {
+        if (errno == ENOENT)
+        {
+          if (counter == 1)
+          {
+            printf("Shared Memory Segment does not exist\n");
+            return EXIT_FAILURE;
+          }
+        }
+        else
+        {
+          perror("shmget");
+          return EXIT_FAILURE;
+        }
+      }
+      else
+      {
+        break;
+      }
+      counter--;
+      if (sleep(1) != 0)
+      {
+        perror("sleep");
+        return EXIT_FAILURE;
+      }
+    }
+    printf("pixelGenerator has been started!\n");
+  }
+
+/*
+ * Attaching the global pointer unsigend char* g_membuf to
+ * the shared memory segment. The variable is global to be able to access it
+ * from inside the signal handler and detach it from the shared segment
+ * when the program terminates.
+ */
+
+  g_membuf = shmat(g_shmid, 0, 0);
+  if (g_membuf == (unsigned char *) -1)
+  {
+    perror("shmat");
+    cleanupW();
+    return EXIT_FAILURE;
+  }
+
+/*
+ * Ask the pixelGenerator for the pixel format of the images (see
+ * writerSettings.h).
+ */
+
+  request_pixel_format(g_membuf, WRITER_PIXEL_FORMAT);
+
+/*---------------------------------------------------------------------------*/
+/* C H E C K  F O R  E X I S T I N G  S E M A P H O R E S                    */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * All semaphores are created and removed by the pixelGenerator program.
+ */
+
+  if ((g_semid = semget(key, NUMBER_OF_SEMAPHORES, 0)) < 0)
+  {
+    if (errno == ENOENT)
+    {
+      printf("Semaphore does not exist\n");
+      cleanupW();
+      return EXIT_FAILURE;
+    }
+    else
+    {
+      perror("semget");
+      cleanupW();
+      return EXIT_FAILURE;
+    }
+  }
+
+/*---------------------------------------------------------------------------*/
+/* S T A R T  P I P E L I N E                                                */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * start_pipeline() is defined in pipeline.c. It allocates the local image
+ * buffers and starts the encoder and sink threads. From now on ctrl-c only
+ * stops claiming new images, all claimed images are still written to disk
+ * (see cntrl_c_handler_Writer.c).
+ *
+ * Direct output backends (see direct.c) write the images straight out of the
+ * shared memory segment, the pipeline is not needed.
+ */
+
+  int direct = is_direct_backend(OUTPUT_BACKEND);
+
+/*
+ * The main thread reads the images, the pipeline threads take the next
+ * buffers of the trace (see trace.h).
+ */
+
+  trace_thread(TRACE_NEXT_THREAD, "reader");
+
+  struct perf_counters counters;
+  struct perf_sample perf_claimed, perf_copied;
+  open_perf_counters(&counters);
+
+  if (direct)
+  {
+    if (open_direct(OUTPUT_BACKEND) == -1)
+    {
+      cleanupW();
+      return EXIT_FAILURE;
+    }
+  }
+  else if (start_pipeline() == -1)
+  {
+    printf("Error starting pipeline\n");
+    cleanupW();
+    return EXIT_FAILURE;
+  }
+  g_pipeline_running = 1;
+
+/*---------------------------------------------------------------------------*/
+/* R E A D  F R O M  S H A R E D  M E M O R Y                                */
+/*---------------------------------------------------------------------------*/
+
+  struct stage_stats reader;
+  memset(&reader, 0, sizeof(struct stage_stats));
+  struct frame slotframe;
+  memset(&slotframe, 0, sizeof(struct frame));
+  int exitcode = EXIT_SUCCESS;
+
+/*
+ * Direct output backends need a buffer for images that are not PIXEL_RGB24.
+ */
+
+  unsigned char *converted = NULL;
+  if (direct)
+  {
+    converted = (unsigned char *) malloc(MAX_DATA);
+    if (converted == NULL)
+    {
+      perror("malloc");
+      g_interrupted = 1;
+      exitcode = EXIT_FAILURE;
+    }
+  }
+
+  unsigned long skipped = 0;
+  struct frame *frame = NULL;
+
+  while ((g_interrupted == 0) && (pipeline_failed() == 0))
+  {
+
+/*
+ * Take a free local buffer first, so the slot is held only while copying.
+ * The buffer of a skipped image is kept for the next one.
+ */
+
+    if (frame == NULL)
+    {
+      frame = direct ? &slotframe : pipeline_get_buffer(&reader);
+    }
+
+/*
+ * claim the oldest image nobody else has claimed yet. The slot holding it
+ * will not be written by the pixelGenerator until it is released again.
+ * g_slot is global to be able to release the slot from inside cleanupW().
+ */
+
+    long long start = pipeline_clock();
+
+    if (claim_frame(g_semid, g_membuf, &g_slot) == -1)
+    {
+      if (errno == EINTR)
+      {
+        break;
+      }
+      if (errno == EIDRM)
+      {
+        printf("\nSemaphore has been removed\n");
+        printf("Check if the pixelGenerator program has terminated\n\n");
+      }
+      else
+      {
+        perror("semop");
+      }
+      exitcode = EXIT_FAILURE;
+      break;
+    }
+
+    long long claimed = pipeline_clock();
+    reader.waiting += claimed - start;
+    read_perf_counters(&counters, &perf_claimed);
+
+/*
+ * Read data from shared memory into the local buffer or write it directly.
+ */
+
+    unsigned char *slotbuf = slot_data(g_membuf, g_slot);
+    int format = slot_header(g_membuf, g_slot)->pixel_format;
+    int partial = slot_header(g_membuf, g_slot)->partial;
+    unsigned char (*palette)[3] = segment_header(g_membuf)->palette;
+    int written = 0;
+    long long direct_written = 0;
+
+    frame->framenumber = slot_header(g_membuf, g_slot)->framenumber;
+    frame->times = slot_header(g_membuf, g_slot)->times;
+    frame->claim = start;
+    frame->claimed = claimed;
+
+/*
+ * A partial image (see sharedSegment.h) is not written, only its slot is
+ * released. Its number is left out of the image files.
+ */
+
+    if (partial)
+    {
+      skipped++;
+    }
+    else if (direct)
+    {
+      frame->pixels = slotbuf;
+      if (format != PIXEL_RGB24)
+      {
+        frame->pixels = converted;
+        written = convert_to_rgb24(converted, slotbuf, format, palette);
+      }
+      frame->output = claimed;
+      if (written == 0)
+      {
+        written = write_direct(frame);
+      }
+      direct_written = pipeline_clock();
+      reader.frames++;
+    }
+    else
+    {
+      written = convert_to_rgb24(frame->pixels, slotbuf, format, palette);
+    }
+
+/*
+ * Release the slot to allow the pixelGenerator to write the next image into
+ * it. SIGINT is blocked meanwhile, so a second ctrl-c (see
+ * cntrl_c_handler_Writer.c) neither misses the slot nor releases it twice.
+ */
+
+    sigset_t sigint;
+    sigset_t oldmask;
+    sigemptyset(&sigint);
+    sigaddset(&sigint, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &sigint, &oldmask);
+
+    int released = release_slot(g_semid, g_slot);
+    g_slot = -1;
+
+    pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
+
+    if (released == -1)
+    {
+      if (errno == EIDRM)
+      {
+        printf("\nSemaphore has been removed.\n");
+        printf("Check if the pixelGenerator program has terminated\n\n");
+      }
+      else
+      {
+        perror("semop");
+      }
+      exitcode = EXIT_FAILURE;
+      break;
+    }
+
+/*
+ * An image that could not be converted or written is not handed on.
+ */
+
+    if (written != 0)
+    {
+      exitcode = EXIT_FAILURE;
+      break;
+    }
+    if (partial)
+    {
+      continue;
+    }
+    frame->copied = pipeline_clock();
+    reader.busy += frame->copied - claimed;
+    read_perf_counters(&counters, &perf_copied);
+    record_writer_perf(direct ? WRITER_PERF_WRITE : WRITER_PERF_COPY,
+                       &counters, &perf_claimed, &perf_copied);
+    trace_event("claim wait", start, claimed, frame->framenumber);
+    trace_event(direct ? "write" : "copy", claimed, frame->copied,
+                frame->framenumber);
+
+    if (direct)
+    {
+
+/*
+ * The image has been written before the slot was released, there is no
+ * copy, queue and encode stage.
+ */
+
+      frame->copied = 0;
+      record_writer_latency(frame, direct_written);
+      if ((STATS_INTERVAL != 0) && (reader.frames % STATS_INTERVAL == 0))
+      {
+        print_direct_stats(&reader);
+      }
+      continue;
+    }
+
+/*
+ * Hand the image to the encoder threads, the sink thread writes it into
+ * a file (see pipeline.c).
+ */
+
+    pipeline_submit(frame, &reader);
+    frame = NULL;
+
+    if ((STATS_INTERVAL != 0) && (reader.frames % STATS_INTERVAL == 0))
+    {
+      print_pipeline_stats(&reader);
+    }
+  }
+
+/*
+ * Let the pipeline write all claimed images before terminating.
+ */
+
+  if (direct)
+  {
+    print_direct_stats(&reader);
+    free(converted);
+  }
+  else
+  {
+    if (stop_pipeline() == -1)
+    {
+      exitcode = EXIT_FAILURE;
+    }
+    print_pipeline_stats(&reader);
+  }
+  if (skipped != 0)
+  {
+    printf("%lu partial images skipped\n", skipped);
+  }
+  close_perf_counters(&counters);
+  cleanupW();
+
+  return exitcode;
+}
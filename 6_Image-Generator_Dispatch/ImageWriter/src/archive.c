@@ -0,0 +1,354 @@
+/*
+ * FILE = /src/archive.c
+ *
+ * RELATED FILES:     *.c                              *.h
+ *                    archiveFormat.c                  archiveFormat.h
+ *                    output.c                         output.h
+ *                                                     archive.h
+ *
+ * Output backend writing all images into one archive file (see
+ * archiveFormat.h for the layout).
+ *
+ * Every ARCHIVE_KEYFRAME_INTERVAL-th image is stored as a keyframe, the
+ * images in between as delta frames against the image before. The image is
+ * divided into tiles of ARCHIVE_TILE_SIZE x ARCHIVE_TILE_SIZE pixels. The
+ * rows of tiles are split into bands, every band is encoded by its own
+ * thread (encode_strips(), see encoder.c). Each band compares its tiles with
+ * the reference image (the image before) and replaces them in the reference
+ * image afterwards.
+ *
+ * The index of all frames is written when the archive is closed. An archive
+ * without index (e.g. the imageWriter has been killed) can still be read,
+ * the archiveDecoder then scans the frame records.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include "numberOfPixel.h"
+#include "writerSettings.h"
+#include "encoder.h"
+#include "archive.h"
+#include "archiveFormat.h"
+
+#define MAX_BANDS 16
+
+#if ARCHIVE_TILE_SIZE > MAX_TILE_SIZE
+  #error "ARCHIVE_TILE_SIZE is larger than MAX_TILE_SIZE"
+#endif
+
+struct index_entry
+{
+  unsigned long long framenumber;
+  unsigned long long offset;
+  int type;
+};
+
+static FILE *g_archive = NULL;
+static unsigned char *g_reference = NULL;
+static unsigned char *g_band_buffer[MAX_BANDS];
+static size_t g_band_size = 0;
+static int g_number_of_bands = 0;
+static int g_delta = 0;
+
+static struct index_entry *g_index = NULL;
+static unsigned long g_frames = 0;
+static unsigned long g_index_size = 0;
+static unsigned long g_keyframes = 0;
+static unsigned long long g_bytes = 0;
+
+static int tiles_x(void)
+{
+  return (WIDTH + ARCHIVE_TILE_SIZE - 1) / ARCHIVE_TILE_SIZE;
+}
+
+static int tiles_y(void)
+{
+  return (HEIGHT + ARCHIVE_TILE_SIZE - 1) / ARCHIVE_TILE_SIZE;
+}
+
+static int write_bytes(const void *data, size_t length)
+{
+  if (fwrite(data, 1, length, g_archive) != length)
+  {
+    perror("fwrite");
+    return -1;
+  }
+  g_bytes += length;
+  return 0;
+}
+
+int archive_open(char *path)
+{
+  char name[256];
+
+/*
+ * Every imageWriter writes its own archive, path contains the process id.
+ */
+
+  snprintf(name, sizeof(name), path, (int) getpid());
+
+  g_archive = fopen(name, "wb");
+  if (g_archive == NULL)
+  {
+    perror(name);
+    return -1;
+  }
+
+  g_reference = (unsigned char *) malloc(MAX_DATA);
+  if (g_reference == NULL)
+  {
+    perror("malloc");
+    archive_close();
+    return -1;
+  }
+
+/*
+ * Each band gets an equal share of the rows of tiles and its own buffer
+ * large enough for all tiles of the band.
+ */
+
+  g_number_of_bands = tiles_y() < MAX_BANDS ? tiles_y() : MAX_BANDS;
+  int rows_per_band = (tiles_y() + g_number_of_bands - 1) / g_number_of_bands;
+  g_band_size = rows_per_band * tiles_x() *
+                tile_bound(ARCHIVE_TILE_SIZE, ARCHIVE_TILE_SIZE);
+  for (int b = 0; b < g_number_of_bands; b++)
+  {
+    g_band_buffer[b] = (unsigned char *) malloc(g_band_size);
+    if (g_band_buffer[b] == NULL)
+    {
+      perror("malloc");
+      archive_close();
+      return -1;
+    }
+  }
+
+  g_delta = 0;
+  g_frames = 0;
+  g_keyframes = 0;
+  g_bytes = 0;
+
+  unsigned char header[ARCHIVE_HEADER_SIZE];
+  memcpy(header, ARCHIVE_MAGIC, 4);
+  put_le32(header + 4, WIDTH);
+  put_le32(header + 8, HEIGHT);
+  put_le32(header + 12, ARCHIVE_TILE_SIZE);
+  put_le32(header + 16, ARCHIVE_KEYFRAME_INTERVAL);
+  if (write_bytes(header, sizeof(header)) != 0)
+  {
+    archive_close();
+    return -1;
+  }
+
+  printf("Writing images into archive %s\n", name);
+  return 0;
+}
+
+/*
+ * encode_band() encodes the rows of tiles first_row .. first_row + rows - 1
+ * (counted in tiles) into strip->out.
+ */
+
+static void *encode_band(void *ptr)
+{
+  struct strip *strip = (struct strip *) ptr;
+  unsigned char *pixels = strip->frame->pixels;
+  size_t stride = (size_t) WIDTH * 3;
+  unsigned char *out = strip->out;
+
+  for (int ty = strip->first_row; ty < strip->first_row + strip->rows; ty++)
+  {
+    int y = ty * ARCHIVE_TILE_SIZE;
+    int tile_height = HEIGHT - y < ARCHIVE_TILE_SIZE ? HEIGHT - y :
+                      ARCHIVE_TILE_SIZE;
+
+    for (int tx = 0; tx < tiles_x(); tx++)
+    {
+      int x = tx * ARCHIVE_TILE_SIZE;
+      int tile_width = WIDTH - x < ARCHIVE_TILE_SIZE ? WIDTH - x :
+                       ARCHIVE_TILE_SIZE;
+      size_t offset = y * stride + (size_t) x * 3;
+
+      out += encode_tile(pixels + offset, g_delta ? g_reference + offset : NULL,
+                         WIDTH, tile_width, tile_height, out);
+    }
+
+/*
+ * The rows of this band are not needed by other bands.
+ */
+
+    for (int row = y; row < y + tile_height; row++)
+    {
+      memcpy(g_reference + row * stride, pixels + row * stride, stride);
+    }
+  }
+
+  strip->length = out - strip->out;
+  strip->result = 0;
+  return NULL;
+}
+
+static int add_to_index(unsigned long long framenumber,
+                        unsigned long long offset, int type)
+{
+  if (g_frames == g_index_size)
+  {
+    unsigned long size = g_index_size ? 2 * g_index_size : 1024;
+    struct index_entry *index = (struct index_entry *)
+                                realloc(g_index, size * sizeof(struct index_entry));
+    if (index == NULL)
+    {
+      perror("realloc");
+      return -1;
+    }
+    g_index = index;
+    g_index_size = size;
+  }
+
+  g_index[g_frames].framenumber = framenumber;
+  g_index[g_frames].offset = offset;
+  g_index[g_frames].type = type;
+  g_frames++;
+  return 0;
+}
+
+int archive_write_frame(struct frame *frame)
+{
+  struct strip strips[MAX_BANDS];
+  int rows_per_band = (tiles_y() + g_number_of_bands - 1) / g_number_of_bands;
+  int number_of_strips = 0;
+
+  if (g_frames % ARCHIVE_KEYFRAME_INTERVAL == 0)
+  {
+    g_delta = 0;
+  }
+
+  for (int b = 0; b < g_number_of_bands; b++)
+  {
+    int first_row = b * rows_per_band;
+    if (first_row >= tiles_y())
+    {
+      break;
+    }
+    strips[b].frame = frame;
+    strips[b].first_row = first_row;
+    strips[b].rows = tiles_y() - first_row < rows_per_band ?
+                     tiles_y() - first_row : rows_per_band;
+    strips[b].out = g_band_buffer[b];
+    strips[b].length = 0;
+    strips[b].result = 0;
+    number_of_strips++;
+  }
+
+  if (encode_strips(strips, number_of_strips, encode_band) != 0)
+  {
+    return -1;
+  }
+
+  unsigned long long length = 0;
+  for (int s = 0; s < number_of_strips; s++)
+  {
+    length += strips[s].length;
+  }
+
+  int type = g_delta ? FRAME_DELTA : FRAME_KEY;
+  unsigned char record[ARCHIVE_RECORD_SIZE];
+  memset(record, 0, sizeof(record));
+  record[0] = type;
+  put_le64(record + 4, frame->framenumber);
+  put_le64(record + 12, length);
+
+  if (add_to_index(frame->framenumber, g_bytes, type) != 0 ||
+      write_bytes(record, sizeof(record)) != 0)
+  {
+    return -1;
+  }
+  for (int s = 0; s < number_of_strips; s++)
+  {
+    if (write_bytes(strips[s].out, strips[s].length) != 0)
+    {
+      return -1;
+    }
+  }
+
+  if (type == FRAME_KEY)
+  {
+    g_keyframes++;
+  }
+  g_delta = 1;
+  return 0;
+}
+
+static int write_index(void)
+{
+  unsigned long long offset = g_bytes;
+  unsigned char entry[ARCHIVE_INDEX_ENTRY_SIZE];
+
+  for (unsigned long i = 0; i < g_frames; i++)
+  {
+    memset(entry, 0, sizeof(entry));
+    put_le64(entry, g_index[i].framenumber);
+    put_le64(entry + 8, g_index[i].offset);
+    entry[16] = g_index[i].type;
+    if (write_bytes(entry, sizeof(entry)) != 0)
+    {
+      return -1;
+    }
+  }
+
+  unsigned char trailer[ARCHIVE_TRAILER_SIZE];
+  put_le64(trailer, offset);
+  put_le32(trailer + 8, g_frames);
+  memcpy(trailer + 12, ARCHIVE_INDEX_MAGIC, 4);
+  return write_bytes(trailer, sizeof(trailer));
+}
+
+int archive_close(void)
+{
+  int ret = 0;
+
+  if (g_archive != NULL)
+  {
+    unsigned long long images = g_bytes;
+    if (write_index() != 0)
+    {
+      ret = -1;
+    }
+    if (fclose(g_archive) != 0)
+    {
+      printf("Error: archive could not be closed.\n");
+      ret = -1;
+    }
+    g_archive = NULL;
+
+    if (g_frames > 0)
+    {
+      printf("Archive: %lu images (%lu keyframes), %.1f MB instead of "
+             "%.1f MB\n", g_frames, g_keyframes, images / 1e6,
+             (double) g_frames * MAX_DATA / 1e6);
+    }
+  }
+
+  free(g_reference);
+  g_reference = NULL;
+  for (int b = 0; b < g_number_of_bands; b++)
+  {
+    free(g_band_buffer[b]);
+    g_band_buffer[b] = NULL;
+  }
+  g_number_of_bands = 0;
+  free(g_index);
+  g_index = NULL;
+  g_index_size = 0;
+  g_frames = 0;
+
+  return ret;
+}
@@ -0,0 +1,64 @@
+/*
+ * FILE =  /src/cleanupWriter.c
+ *
+ * This function stops the pipeline threads, frees allocated memory segments,
+ * releases a claimed slot of the shared memory segment, detaches the shared
+ * memory segment and closes open imagefiles.
+ *
+ * Copyright (c) 2016 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details. 
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/shm.h>
+#include "global_ids_W.h"
+#include "sharedSegment.h"
+#include "pipeline.h"
+#include "trace.h"
+
+void cleanupW(void)
+{
+
+/*
+ * free_pipeline() (defined in pipeline.c) stops the pipeline threads and
+ * frees the local image buffers.
+ */
+
+  free_pipeline();
+  write_trace("imageWriter");
+
+/*
+ * A slot claimed but not yet released would never be written by the
+ * pixelGenerator again.
+ */
+
+  if (g_slot != -1)
+  {
+    if (release_slot(g_semid, g_slot) < 0)
+    {
+      perror("semop");
+    }
+    g_slot = -1;
+  }
+  if (g_membuf != NULL)
+  {
+    if (shmdt(g_membuf) < 0)
+    {
+      perror("shmdt");
+    }
+  }
+  if (g_pIMAGE != NULL)
+  {
+    if (fclose(g_pIMAGE) == 0)
+    {
+      g_pIMAGE = NULL;
+    }
+    else
+    {
+      printf("Error: IMAGE File could not be closed.\n");
+    }
+  }
+}
@@ -0,0 +1,43 @@
+/*
+ * FILE =  /src/cntrl_c_handler_Writer.c
+ *
+ * This file holds the function that will be delivered to the signal handler
+ * It invokes the cleanupW() defined in /src/cleanupW.c
+ *
+ * Once the pipeline is running (see pipeline.c) ctrl-c only sets
+ * g_interrupted. The main thread then stops claiming images and waits until
+ * the images already claimed have been written, so no image number gets lost.
+ * Pressing ctrl-c a second time terminates the program right away. The slot
+ * claimed by the main thread is released first, the pixelGenerator would
+ * wait for it forever otherwise (see sharedSegment.c). release_slot() is a
+ * single semop(), which may be called inside a signal handler.
+ *
+ * Copyright (c) 2016 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include "cleanupWriter.h"
+#include "global_ids_W.h"
+#include "sharedSegment.h"
+
+void cntrl_c_handler_W(int signum)
+{
+  if (g_pipeline_running == 0)
+  {
+    cleanupW();
+    exit(EXIT_SUCCESS);
+  }
+  if (g_interrupted != 0)
+  {
+    if (g_slot != -1)
+    {
+      release_slot(g_semid, g_slot);
+    }
+    _exit(EXIT_FAILURE);
+  }
+  g_interrupted = 1;
+}
@@ -0,0 +1,22 @@
+/*
+ * FILE =  /src/global_ids_W.c
+ *
+ * This file holds variables that need to be accessed by the SIGINT handler.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include "global_ids_W.h"
+#include <stdio.h>
+#include <signal.h>
+
+int g_shmid;
+int g_semid;
+int g_slot;
+unsigned char *g_membuf;
+FILE *g_pIMAGE;
+volatile sig_atomic_t g_interrupted;
+volatile sig_atomic_t g_pipeline_running;
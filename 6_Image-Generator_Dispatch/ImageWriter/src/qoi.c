@@ -0,0 +1,212 @@
+/*
+ * FILE = /src/qoi.c
+ *
+ * Encoder for the "Quite OK Image Format" (https://qoiformat.org).
+ *
+ * A QOI stream is encoded pixel by pixel. The decoder keeps the previous
+ * pixel and an index of 64 recently seen pixels. The strips of an image can
+ * still be encoded independently:
+ *
+ * - The encoder of a strip starts with the last pixel of the strip before
+ *   as previous pixel. The encoder knows this pixel from the image.
+ * - The encoder of a strip starts with an empty index and only uses entries
+ *   it has written itself. The decoder holds the same pixel in these
+ *   entries, because it has decoded the same pixels since then. An empty
+ *   entry never matches a pixel, all pixels have an alpha value of 255.
+ * - Runs end at the end of a strip.
+ *
+ * The strips joined together are exactly the stream a single encoder would
+ * write, except that some runs are split and some index operations are
+ * replaced by other operations.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "numberOfPixel.h"
+#include "encoder.h"
+#include "qoi.h"
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF 0x40
+#define QOI_OP_LUMA 0x80
+#define QOI_OP_RUN 0xc0
+#define QOI_OP_RGB 0xfe
+
+#define QOI_HEADER_SIZE 14
+#define QOI_MAX_RUN 62
+
+static const unsigned char QOI_END[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+
+/*
+ * The worst case are QOI_OP_RGB operations of 4 bytes for every pixel.
+ */
+
+static size_t strip_bound(int rows)
+{
+  return (size_t) rows * WIDTH * 4;
+}
+
+static void *encode_strip(void *ptr)
+{
+  struct strip *strip = (struct strip *) ptr;
+  unsigned char *pixel = strip->frame->pixels +
+                         (size_t) strip->first_row * WIDTH * 3;
+  unsigned char *end = pixel + (size_t) strip->rows * WIDTH * 3;
+  unsigned char *out = strip->out;
+
+  unsigned char index[64][3];
+  int used[64];
+  memset(used, 0, sizeof(used));
+
+  unsigned char prev[3] = { 0, 0, 0 };
+  if (strip->first_row > 0)
+  {
+    memcpy(prev, pixel - 3, 3);
+  }
+
+  int run = 0;
+
+  for (; pixel < end; pixel += 3)
+  {
+    unsigned char r = pixel[0];
+    unsigned char g = pixel[1];
+    unsigned char b = pixel[2];
+
+    if (r == prev[0] && g == prev[1] && b == prev[2])
+    {
+      run++;
+      if (run == QOI_MAX_RUN)
+      {
+        *out++ = QOI_OP_RUN | (run - 1);
+        run = 0;
+      }
+      continue;
+    }
+
+    if (run > 0)
+    {
+      *out++ = QOI_OP_RUN | (run - 1);
+      run = 0;
+    }
+
+    int hash = (r * 3 + g * 5 + b * 7 + 255 * 11) % 64;
+
+    if (used[hash] && index[hash][0] == r && index[hash][1] == g &&
+        index[hash][2] == b)
+    {
+      *out++ = QOI_OP_INDEX | hash;
+    }
+    else
+    {
+      index[hash][0] = r;
+      index[hash][1] = g;
+      index[hash][2] = b;
+      used[hash] = 1;
+
+      signed char dr = (signed char) (r - prev[0]);
+      signed char dg = (signed char) (g - prev[1]);
+      signed char db = (signed char) (b - prev[2]);
+      signed char dr_dg = (signed char) (dr - dg);
+      signed char db_dg = (signed char) (db - dg);
+
+      if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+      {
+        *out++ = QOI_OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2);
+      }
+      else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 &&
+               db_dg >= -8 && db_dg <= 7)
+      {
+        *out++ = QOI_OP_LUMA | (dg + 32);
+        *out++ = (dr_dg + 8) << 4 | (db_dg + 8);
+      }
+      else
+      {
+        *out++ = QOI_OP_RGB;
+        *out++ = r;
+        *out++ = g;
+        *out++ = b;
+      }
+    }
+
+    prev[0] = r;
+    prev[1] = g;
+    prev[2] = b;
+  }
+
+  if (run > 0)
+  {
+    *out++ = QOI_OP_RUN | (run - 1);
+  }
+
+  strip->length = out - strip->out;
+  strip->result = 0;
+  return NULL;
+}
+
+static void put_be32(unsigned char *out, unsigned long value)
+{
+  out[0] = (value >> 24) & 0xff;
+  out[1] = (value >> 16) & 0xff;
+  out[2] = (value >> 8) & 0xff;
+  out[3] = value & 0xff;
+}
+
+int encode_qoi(struct frame *frame)
+{
+  struct strip strips[MAX_STRIPS];
+  int number_of_strips = split_into_strips(frame, strips);
+
+/*
+ * Every strip writes into its own part of the work buffer. The parts are
+ * moved together afterwards.
+ */
+
+  size_t bound = strip_bound(strips[number_of_strips - 1].rows);
+  for (int s = 0; s < number_of_strips; s++)
+  {
+    if (strip_bound(strips[s].rows) > bound)
+    {
+      bound = strip_bound(strips[s].rows);
+    }
+  }
+  if (reserve_buffer(frame, number_of_strips * bound + sizeof(QOI_END)) != 0)
+  {
+    return -1;
+  }
+  for (int s = 0; s < number_of_strips; s++)
+  {
+    strips[s].out = frame->buffer + s * bound;
+  }
+
+  if (encode_strips(strips, number_of_strips, encode_strip) != 0)
+  {
+    return -1;
+  }
+
+  size_t length = 0;
+  for (int s = 0; s < number_of_strips; s++)
+  {
+    memmove(frame->buffer + length, strips[s].out, strips[s].length);
+    length += strips[s].length;
+  }
+  memcpy(frame->buffer + length, QOI_END, sizeof(QOI_END));
+  length += sizeof(QOI_END);
+
+  memcpy(frame->header, "qoif", 4);
+  put_be32((unsigned char *) frame->header + 4, WIDTH);
+  put_be32((unsigned char *) frame->header + 8, HEIGHT);
+  frame->header[12] = 3;           // RGB
+  frame->header[13] = 0;           // sRGB with linear alpha
+  frame->headerlength = QOI_HEADER_SIZE;
+
+  frame->data = frame->buffer;
+  frame->datalength = length;
+
+  return 0;
+}
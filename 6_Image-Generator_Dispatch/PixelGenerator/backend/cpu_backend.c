@@ -0,0 +1,113 @@
+/*
+ * FILE = /backend/cpu_backend.c
+ *
+ * Wraps the mandelbrot.c of an image generator running on the cpu in a
+ * struct generator_backend (see backend.h). The makefile compiles this file
+ * once per backend with the sources and headers of its image generator and
+ * these defines:
+ *
+ * BACKEND_ENTRY        name of the struct generator_backend, <backend>_backend
+ * BACKEND_THREADS      1 if the image generator starts its own threads
+ *                      (thread_handler.h), 0 for OpenMP
+ * BACKEND_CPU_FEATURE  the cpu feature the kernel is compiled for ("avx"),
+ *                      not defined if every cpu can run it
+ *
+ * generate_image() and the globals of the image generator are renamed to
+ * <backend>_generate_image() ... by the makefile, so the names below refer
+ * to the ones of this backend.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <signal.h>
+
+#include "mandelbrot.h"
+#include "backend.h"
+
+#if BACKEND_THREADS
+  #include <pthread.h>
+  #include "thread_handler.h"
+#endif
+
+static int open_backend(void)
+{
+  #ifdef BACKEND_CPU_FEATURE
+  if (!__builtin_cpu_supports(BACKEND_CPU_FEATURE))
+  {
+    return -1;
+  }
+  #endif
+
+/*
+ * As there is know way of knowing if a pthread_t id is valid a second variable
+ * is necessary to determine if a thread is alive or if it has terminated.
+ */
+
+  #if BACKEND_THREADS
+  for (int t = 0; t < number_of_threads; t++)
+  {
+    g_thread_aliveness[t] = -1;
+  }
+  #endif
+
+  return 0;
+}
+
+/*
+ * threads 0 keeps the number of threads the image generator starts by
+ * default.
+ */
+
+static int tune_backend(const struct tuning *tuning)
+{
+  if (tuning->threads > 0)
+  {
+    return set_number_of_threads(tuning->threads);
+  }
+  return 0;
+}
+
+/*
+ * The threads still running when ctrl-c is pressed are killed before the
+ * image buffer is freed, see cleanup.c of the pthread image generator.
+ * OpenMP threads do not access the buffer after the program has ended.
+ */
+
+static void close_backend(void)
+{
+  #if BACKEND_THREADS
+  for (int j = 0; j < number_of_threads; j++)
+  {
+    if (g_thread_aliveness[j] == 0)
+    {
+      if (pthread_kill(g_thread[j], SIGUSR1) != 0)
+      {
+        if (errno == ESRCH)
+        {
+          printf("\nThread has already terminated.\n");
+        }
+        else
+        {
+          perror("pthread_kill");
+        }
+      }
+    }
+  }
+  #endif
+}
+
+struct generator_backend BACKEND_ENTRY =
+{
+  GENERATOR_BACKEND,
+  open_backend,
+  generate_image,
+  last_thread_stats,
+  set_number_of_threads,
+  tune_backend,
+  close_backend
+};
@@ -0,0 +1,113 @@
+/*
+ * FILE = /backend/opencl_backend.c
+ *
+ * Wraps the generate_image.c of the OpenCL image generator in a struct
+ * generator_backend (see backend.h), built with "make OPENCL=1". The makefile
+ * renames generate_image() of the image generator to opencl_generate_image().
+ *
+ * The OpenCL device is set up when the backends are opened, the table of
+ * pixels is copied to the device when the pixel format changes.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "numberOfPixel.h"
+#include "tiles.h"
+#include "setup_OpenCL.h"
+#include "mem_cleanup_opencl.h"
+#include "generate_image.h"
+#include "backend.h"
+
+static struct cl_mem_data g_data;
+static int g_opened = 0;
+static unsigned char *g_pixels = NULL;
+static int g_bpp = 0;
+static struct thread_stats g_device;
+
+static int open_backend(void)
+{
+  if (setup_OpenCL(&g_data) == -1)
+  {
+    printf("OpenCL backend not available\n");
+    return -1;
+  }
+  g_opened = 1;
+  return 0;
+}
+
+/*
+ * The device counts as one thread in the stats page (see statsPage.h).
+ */
+
+static int generate(unsigned char *pixels, int bpp, unsigned char *imagebuffer,
+                    struct viewport *view)
+{
+  if (pixels != g_pixels || bpp != g_bpp)
+  {
+    if (set_pixel_format(pixels, bpp, &g_data) != 0)
+    {
+      return -1;
+    }
+    g_pixels = pixels;
+    g_bpp = bpp;
+  }
+
+  long long start = stats_clock();
+  if (generate_image(imagebuffer, &g_data, view) != EXIT_SUCCESS)
+  {
+    return -1;
+  }
+
+  memset(&g_device, 0, sizeof(g_device));
+  g_device.pixels = (unsigned long long) WIDTH * HEIGHT;
+  g_device.tiles = 1;
+  g_device.busy_ns = stats_clock() - start;
+  return number_of_tiles();
+}
+
+static int device_stats(struct thread_stats **stats)
+{
+  *stats = &g_device;
+  return 1;
+}
+
+/*
+ * The device picks the number of work items itself.
+ */
+
+static int set_number_of_work_items(int threads)
+{
+  return -1;
+}
+
+static int tune_backend(const struct tuning *tuning)
+{
+  return set_local_size(&g_data, tuning->local_x, tuning->local_y);
+}
+
+static void close_backend(void)
+{
+  if (g_opened)
+  {
+    mem_cleanup_opencl(&g_data);
+    g_opened = 0;
+  }
+}
+
+struct generator_backend opencl_backend =
+{
+  GENERATOR_BACKEND,
+  open_backend,
+  generate,
+  device_stats,
+  set_number_of_work_items,
+  tune_backend,
+  close_backend
+};
@@ -0,0 +1,79 @@
+/*
+ * FILE = HEADER: /include/backend.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _backend_
+#define _backend_
+
+#include "viewCommand.h"
+#include "statsPage.h"
+#include "tuning.h"
+
+/*
+ * The image generators of the other directories (pthread, OpenMP, SSE, AVX
+ * and with "make OPENCL=1" OpenCL) built into one pixelGenerator. The
+ * makefile compiles the sources of each image generator with its functions
+ * and globals renamed to <backend>_..., backend/cpu_backend.c and
+ * backend/opencl_backend.c wrap them in a struct generator_backend.
+ *
+ * open()            prepares the backend, returns -1 if it can not run on
+ *                   this host (cpu without AVX, no OpenCL device)
+ * generate_image()  as in mandelbrot.h, returns the number of tiles generated
+ * thread_stats()    last_thread_stats() of mandelbrot.h
+ * set_number_of_threads()
+ *                   as in mandelbrot.h, -1 if the backend picks the number
+ * tune()            applies the settings of the kernel autotuner for the
+ *                   backend (see tuning.h) but the tile size, -1 on error
+ * close()           stops the threads still running, frees the backend
+ *
+ * The tiles are shared by all backends, the tile size of a backend is set
+ * whenever it is selected.
+ */
+
+struct generator_backend
+{
+  const char *name;
+  int (*open)(void);
+  int (*generate_image)(unsigned char *pixels, int bpp,
+                        unsigned char *imagebuffer, struct viewport *view);
+  int (*thread_stats)(struct thread_stats **stats);
+  int (*set_number_of_threads)(int threads);
+  int (*tune)(const struct tuning *tuning);
+  void (*close)(void);
+};
+
+/*
+ * BACKEND_AUTO generates the calibration section (seahorse valley, most
+ * pixels close to the boundary) once to warm up and CALIBRATION_RUNS times
+ * with every backend the host can run and takes the fastest. The result is
+ * kept in the file BACKEND_CACHE of the host (see hostCache.h) and used
+ * again until the image size, the backends built in or their tuning change.
+ * Remove the file to calibrate again.
+ */
+
+#define BACKEND_AUTO "auto"
+#define BACKEND_CACHE "backend"
+#define CALIBRATION_RUNS 3
+
+int open_backends(void);
+void close_backends(void);
+void list_backends(void);
+struct generator_backend *select_backend(const char *name,
+                                         unsigned char *pixels, int bpp,
+                                         unsigned char *imagebuffer);
+
+/*
+ * SIGUSR2 switches to the next backend the host can run before the next
+ * image, to compare backends under the same load:
+ *   kill -USR2 $(pidof pixelGenerator.out)
+ */
+
+void switch_backend_handler(int signum);
+struct generator_backend *switch_backend(struct generator_backend *backend);
+
+#endif
@@ -0,0 +1,15 @@
+/*
+ * FILE = HEADER: /include/cleanup.h
+ *
+ * Copyright (c) 2016 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _cleanup_
+#define _cleanup_
+
+void cleanup(void);
+
+#endif
@@ -0,0 +1,15 @@
+/*
+ * FILE = HEADER: /include/cntrl_c_handler.h
+ *
+ * Copyright (c) 2016 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _cntrl_c_handler_
+#define _cntrl_c_handler_
+
+void cntrl_c_handler(int signum);
+
+#endif
@@ -0,0 +1,15 @@
+/*
+ * FILE = HEADER: /include/colorpalette.h
+ *
+ * Copyright (c) 2016 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _colorpalette_
+#define _colorpalette_
+
+int create_color_palette(unsigned char palette[][3]);
+
+#endif
@@ -0,0 +1,23 @@
+/*
+ * FILE = HEADER: /include/global_ids.h
+ *
+ * Copyright (c) 2016 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _global_ids_
+#define _global_ids_
+
+#include <stdio.h>
+#include "statsPage.h"
+
+extern int g_shmid;
+extern int g_semid;
+extern unsigned char *g_buffer;
+extern unsigned char *g_membuf;
+extern int g_statsid;
+extern struct stats_page *g_stats;
+
+#endif
@@ -0,0 +1,518 @@
+/*
+ * FILE = MAIN:       /src/PixelGenerator.c
+ *
+ * RELATED FILES:     *.c                              *.h
+ *                    generateKey.c                    generateKey.h
+ *                    numberOfPixel.c                  numberOfPixel.h
+ *                    cleanup.c                        cleanup.h
+ *                    cntrl_c_handler.c                cntrl_c_handler.h
+ *                    colorpalette.c                   colorpalette.h
+ *                    backend.c                        backend.h
+ *                    install_signal_handler.c         install_signal_handler.h
+ *                    global_ids.c                     global_ids.h
+ *                    sharedSegment.c                  sharedSegment.h
+ *                    pixelFormat.c                    pixelFormat.h
+ *                    viewCommand.c                    viewCommand.h
+ *                    tiles.c                          tiles.h
+ *                    statsPage.c                      statsPage.h
+ *                    latency.c                        latency.h
+ *                    generator_latency.c              generator_latency.h
+ *                    hostCache.c                      hostCache.h
+ *                    tuning.c                         tuning.h
+ *                                                     universalSettings.h
+ *
+ * DEPENDS ON:        imageWriter program
+ *
+ * A program that generates images of the mandelbrot set and writes them to a
+ * shared memory segment. It depends on the imageWriter program to read the
+ * image data out of the shared memory segment.
+ *
+ * The images are generated by one of the backends built in (see backend.h),
+ * given on the command line or the fastest one on this host.
+ *
+ * Copyright (c) 2016 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/sem.h>
+#include <signal.h>
+#include <errno.h>
+
+#include "generateKey.h"
+#include "global_ids.h"
+#include "numberOfPixel.h"
+#include "sharedSegment.h"
+#include "pixelFormat.h"
+#include "viewCommand.h"
+#include "statsPage.h"
+#include "cntrl_c_handler.h"
+#include "universalSettings.h"
+#include "install_signal_handler.h"
+#include "colorpalette.h"
+#include "backend.h"
+#include "cleanup.h"
+#include "generator_latency.h"
+#include "trace.h"
+#include "tiles.h"
+
+#if OS_FEDORA
+
+/*
+ * necessary on Fedora
+ * unecessary on OSX 10.9 -> redefinition of semun
+ */
+
+union semun {
+  int val;
+  struct semid_ds *buf;
+  unsigned short int *array;
+  struct seminfo *__buf;
+} semunion;
+
+#endif
+
+int main(int argc, char *argv[])
+{
+  const char *backend_name = BACKEND_AUTO;
+
+  if (argc > 1)
+  {
+    if ((strncmp(argv[1], "help", 4) == 0) || (strncmp(argv[1], "-h", 2) == 0))
+    {
+      printf("\nThis program generates an image of the mandlebrot set and\n"
+             "writes the picture into a shared memory segmet. This program\n"
+             "depends on the imageWriter program reading from the shared memory"
+             "\nsegment and writing the image into a .png, .qoi or .ppm file\n"
+             "\nusage: ./pixelGenerator.out [backend]\n"
+             "\nbackend is pthread, openmp, sse, avx, opencl (if built in) or\n"
+             "auto, the fastest one on this host (default). SIGUSR2 switches\n"
+             "to the next backend.\n\n");
+      exit(EXIT_SUCCESS);
+    }
+    else if (argc > 2)
+    {
+      printf("\nThis program takes the backend as only cmdline argument.\n\n");
+      exit(EXIT_FAILURE);
+    }
+    backend_name = argv[1];
+  }
+
+/*
+ * Initalize values for global variables (declared in global_ids.h)
+ * to determine if a segment should be freed or removed from inside
+ * the cleanup() function.
+ */
+
+  g_shmid = -1;
+  g_semid = -1;
+  g_membuf = NULL;
+  g_buffer = NULL;
+  g_statsid = -1;
+  g_stats = NULL;
+
+/*
+ * The image generating threads record into the buffers from 1 on (see
+ * trace.h).
+ */
+
+  trace_thread(0, "main");
+
+/*
+ * The perf counters of the main thread (see perfCounters.h), the image
+ * generating threads open their own.
+ */
+
+  struct perf_counters counters;
+  struct perf_sample perf_generate, perf_generated, perf_published;
+
+  open_perf_counters(&counters);
+
+/*---------------------------------------------------------------------------*/
+/* I N S T A L L  S I G N A L  H A N D L E R                                 */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * The init_signal_handler() function is defind in install_signal_handler.c
+ * It takes a SIGNAL and a signal handler callback funciton as arguments.
+ *
+ * The cntrl_c_handler function is defined in cntrl_c_handler.c
+ * If a SIGINT signal is sent by pressing ctrl+c this function invokes the
+ * cleanup() function and termiates the program.
+ */
+
+  if (init_signal_handler(SIGINT, cntrl_c_handler) == EXIT_FAILURE)
+  {
+    printf("Error Installing Singnal Handler\n");
+    return EXIT_FAILURE;
+  }
+
+/*
+ * The switch_backend_handler() function is defined in backend.c
+ * A SIGUSR2 signal switches to the next backend before the next image.
+ */
+
+  if (init_signal_handler(SIGUSR2, switch_backend_handler) == EXIT_FAILURE)
+  {
+    printf("Error Installing Singnal Handler\n");
+    return EXIT_FAILURE;
+  }
+
+/*---------------------------------------------------------------------------*/
+/* G E N E R A T E  S H A R E D  M E M O R Y  S E G M E N T                  */
+/*---------------------------------------------------------------------------*/
+
+  key_t key = -1;
+
+/*
+ * The generateKey() functions is defined in generateKey.c
+ * This function is used by the imageWriter and pixelGenerator to receive a key.
+ */
+
+  key = generateKey();
+  if (key == -1)
+  {
+    printf("Error generating key\n");
+    return EXIT_FAILURE;
+  }
+
+/*
+ * Generating a shared memory segment holding NUMBER_OF_SLOTS images of
+ * up to WIDTH * HEIGHT * MAX_BYTES_PER_PIXEL (see numberOfPixel.c and
+ * pixelFormat.h) bytes each (see sharedSegment.c).
+ */
+
+  g_shmid = shmget(key, segment_size(), IPC_CREAT | 0600);
+  if (g_shmid >= 0)
+  {
+    g_membuf = shmat(g_shmid, 0, 0);
+    if (g_membuf == (unsigned char *) -1)
+    {
+      perror("shmat");
+      cleanup();
+      return EXIT_FAILURE;
+    }
+  }
+  else
+  {
+    perror("shmget");
+    cleanup();
+    return EXIT_FAILURE;
+  }
+
+/*---------------------------------------------------------------------------*/
+/* G E N E R A T E  S E M A P H O R E S                                      */
+/*---------------------------------------------------------------------------*/
+
+  if ((g_semid = semget(key, NUMBER_OF_SEMAPHORES, IPC_CREAT | 0600)) < 0)
+  {
+    perror("semget");
+    cleanup();
+    return EXIT_FAILURE;
+  }
+
+  union semun semunion;
+
+/*
+ * Setting start values for the semaphores (see sharedSegment.h).
+ * Every slot is free at first. The semaphore counting the images ready to be
+ * claimed gets set to 0 which blocks the consumers from reading data out of
+ * the shared memory segment.
+ */
+
+  for (int slot = 0; slot < NUMBER_OF_SLOTS; slot++)
+  {
+    semunion.val = 1;
+    if ((semctl(g_semid, SEM_SLOT_FREE(slot), SETVAL, semunion)) < 0)
+    {
+      perror("semctl");
+      cleanup();
+      return EXIT_FAILURE;
+    }
+  }
+
+  semunion.val = 0;
+  if ((semctl(g_semid, SEM_FRAMES_READY, SETVAL, semunion)) < 0)
+  {
+    perror("semctl");
+    cleanup();
+    return EXIT_FAILURE;
+  }
+
+/*
+ * An old segment left behind by a crashed pixelGenerator would still hold
+ * its image counters.
+ */
+
+  segment_header(g_membuf)->next_frame = 0;
+  segment_header(g_membuf)->next_claim = 0;
+  reset_view_commands(g_membuf);
+
+/*---------------------------------------------------------------------------*/
+/* G E N E R A T E  C O L O R  P A L E T T E  &  I M A G E  B U F F E R      */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Creating a very primitive colorpalette. The maximum value of iterations
+ * for calculating the mandelbrot set (see thread_handler.c) is set to 1023
+ * (starts at 0)
+ * Each iteration gets assigned a color (RGB values).
+ */
+
+  static unsigned char PALETTE[PALETTE_SIZE][3];
+
+  if (create_color_palette(PALETTE) != 0)
+  {
+    printf("Error creating colorpalette\n");
+    cleanup();
+    return EXIT_FAILURE;
+  }
+
+/*
+ * The consumers colorize PIXEL_INDEX16 images with the palette in the shared
+ * memory segment. Until a consumer asks for another pixel format the images
+ * are generated as PIXEL_RGB24 (see pixelFormat.h).
+ */
+
+  memcpy(segment_header(g_membuf)->palette, PALETTE, sizeof(PALETTE));
+  request_pixel_format(g_membuf, PIXEL_RGB24);
+
+  static unsigned char PIXELS[PALETTE_SIZE * MAX_BYTES_PER_PIXEL];
+  int format = -1;
+
+/*
+ * Generating a local image buffer where the image is stored before it is
+ * written to the shared memory segment. It is large enough for every pixel
+ * format.
+ */
+
+  g_buffer = (unsigned char *) calloc(pixel_data_size(PIXEL_XRGB8888),
+                                      sizeof(unsigned char));
+  if (g_buffer == NULL)
+  {
+    perror("calloc");
+    cleanup();
+    return EXIT_FAILURE;
+  }
+
+/*
+ * The section of the mandelbrot set, changed by generate_image() (automatic
+ * zoom) or by the view_commands of a consumer (see viewCommand.h).
+ */
+
+  static struct viewport view;
+  init_viewport(&view);
+
+/*
+ * An image is cancelled as soon as a view_command arrives and published with
+ * the tiles finished so far, the tiles around the center (see mandelbrot.c).
+ */
+
+  view.cancellable = 1;
+  int slot;
+
+/*---------------------------------------------------------------------------*/
+/* S E L E C T  B A C K E N D                                                */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * open_backends() and select_backend() are defined in backend.c
+ * The calibration of BACKEND_AUTO generates PIXEL_RGB24 images into the
+ * local buffer.
+ */
+
+  if (open_backends() == 0)
+  {
+    printf("No backend can run on this host\n");
+    cleanup();
+    return EXIT_FAILURE;
+  }
+  list_backends();
+
+  if (make_pixel_table(PIXEL_RGB24, PALETTE, PIXELS) != 0)
+  {
+    cleanup();
+    return EXIT_FAILURE;
+  }
+
+  struct generator_backend *backend;
+
+  backend = select_backend(backend_name, PIXELS, bytes_per_pixel(PIXEL_RGB24),
+                           g_buffer);
+  if (backend == NULL)
+  {
+    cleanup();
+    return EXIT_FAILURE;
+  }
+  printf("Generating images with the %s backend\n", backend->name);
+
+/*
+ * The counters of the threads are published after every image in a shared
+ * memory segment of their own (see statsPage.h), read by generatorTop.
+ * Without it the images are generated all the same.
+ */
+
+  g_stats = create_stats_page(backend->name, &g_statsid);
+  if (g_stats == NULL)
+  {
+    printf("Error creating the stats page, continuing without stats\n");
+  }
+
+/*---------------------------------------------------------------------------*/
+/* G E N E R A T E  I M A G E  D A T A                                       */
+/*                                                                           */
+/* W R I T E  I M A G E  T O  S H A R E D  M E M O R Y                       */
+/*---------------------------------------------------------------------------*/
+
+  while (1)
+  {
+
+/*
+ * The stages of every image are timed (see generator_latency.c), the
+ * timestamps are passed on to the consumers in the frame_header.
+ */
+
+    struct frame_times times;
+
+/*
+ * Fill the table of pixels with the format the consumers asked for, the
+ * image is generated in this format.
+ */
+
+    if (requested_pixel_format(g_membuf) != format)
+    {
+      format = requested_pixel_format(g_membuf);
+      if (make_pixel_table(format, PALETTE, PIXELS) != 0)
+      {
+        cleanup();
+        return EXIT_FAILURE;
+      }
+      printf("Generating images as %s\n", pixel_format_name(format));
+    }
+
+/*
+ * wait until the slot of the next image is free, before the image is
+ * generated, so it shows the latest view_commands sent while waiting.
+ * SIGUSR2 interrupts the wait.
+ */
+
+    times.acquire = stats_clock();
+    while (acquire_slot(g_semid, g_membuf, &slot) == -1)
+    {
+      if (errno != EINTR)
+      {
+        perror("semop");
+        cleanup();
+        return EXIT_FAILURE;
+      }
+    }
+    times.generate = stats_clock();
+    read_perf_counters(&counters, &perf_generate);
+
+/*
+ * Apply the view_commands a consumer has sent since the last image.
+ */
+
+    struct view_command command;
+
+    while (receive_view_command(g_membuf, &command) == 0)
+    {
+      apply_view_command(&view, &command);
+    }
+
+/*
+ * Switch the backend between two images if SIGUSR2 has arrived. The next
+ * image shows the same section.
+ */
+
+    struct generator_backend *next = switch_backend(backend);
+
+    if (next != backend)
+    {
+      backend = next;
+      if (g_stats != NULL)
+      {
+        set_stats_backend(g_stats, backend->name);
+      }
+    }
+
+/*
+ * generate_image() of the backend creates image data and writes it to the
+ * local buffer.
+ */
+
+    long long image_start = stats_clock();
+    int generated = backend->generate_image(PIXELS, bytes_per_pixel(format),
+                                            g_buffer, &view);
+    if (generated == -1)
+    {
+      printf("Error generating image data\n");
+      cleanup();
+      return EXIT_FAILURE;
+    }
+
+    if (g_stats != NULL)
+    {
+      struct thread_stats *stats;
+      int threads = backend->thread_stats(&stats);
+      publish_stats(g_stats, stats, threads, stats_clock() - image_start);
+    }
+
+    times.generated = stats_clock();
+    read_perf_counters(&counters, &perf_generated);
+
+/*
+ * Writing the local buffer to the slot in the shared memory segment
+ */
+
+    unsigned char *slotbuf = slot_data(g_membuf, slot);
+    size_t size = pixel_data_size(format);
+
+    for (int i = 0; i < size; i++)
+    {
+        slotbuf[i] = g_buffer[i];
+    }
+    slot_header(g_membuf, slot)->pixel_format = format;
+    slot_header(g_membuf, slot)->input_time = view.input_time;
+    slot_header(g_membuf, slot)->commands_applied = view.commands;
+    slot_header(g_membuf, slot)->tiles_done = generated;
+    slot_header(g_membuf, slot)->tile_size = tile_size();
+    slot_header(g_membuf, slot)->partial = (generated < number_of_tiles());
+    view.input_time = 0;
+    times.published = stats_clock();
+    read_perf_counters(&counters, &perf_published);
+    slot_header(g_membuf, slot)->times = times;
+
+/*
+ * hand the image to the consumers
+ */
+
+    if (publish_slot(g_semid, g_membuf, slot) == -1)
+    {
+      perror("semop");
+      cleanup();
+      return EXIT_FAILURE;
+    }
+    record_generator_perf(PERF_STAGE_COMPUTE, &counters, &perf_generate,
+                          &perf_generated, 1);
+    record_generator_perf(PERF_STAGE_COPY, &counters, &perf_generated,
+                          &perf_published, 1);
+    record_generator_latency(&times);
+
+    unsigned long framenumber = slot_header(g_membuf, slot)->framenumber;
+    trace_event("slot wait", times.acquire, times.generate, framenumber);
+    trace_event("compute", times.generate, times.generated, framenumber);
+    trace_event("copy", times.generated, times.published, framenumber);
+  }
+
+/*
+ * END OF while (1)
+ */
+  return EXIT_SUCCESS;
+}
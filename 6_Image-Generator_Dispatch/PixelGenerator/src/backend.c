@@ -0,0 +1,400 @@
+/*
+ * FILE = /src/backend.c
+ *
+ * RELATED FILES:     *.c                              *.h
+ *                    hostCache.c                      hostCache.h
+ *                    tuning.c                         tuning.h
+ *                    tiles.c                          tiles.h
+ *                                                     backend.h
+ *
+ * This file holds the table of the backends built into the pixelGenerator,
+ * selects one of them by name or by calibration (see backend.h) and switches
+ * between them.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+
+#include "numberOfPixel.h"
+#include "hostCache.h"
+#include "tiles.h"
+#include "backend.h"
+
+/*
+ * The backends, defined by backend/cpu_backend.c and backend/opencl_backend.c
+ * (see the makefile).
+ */
+
+extern struct generator_backend pthread_backend;
+extern struct generator_backend openmp_backend;
+extern struct generator_backend sse_backend;
+extern struct generator_backend avx_backend;
+#if BACKEND_OPENCL
+extern struct generator_backend opencl_backend;
+#endif
+
+static struct generator_backend *g_backends[] =
+{
+  &pthread_backend,
+  &openmp_backend,
+  &sse_backend,
+  &avx_backend,
+  #if BACKEND_OPENCL
+  &opencl_backend,
+  #endif
+};
+
+#define NUMBER_OF_BACKENDS (sizeof(g_backends) / sizeof(g_backends[0]))
+#define MAX_LINE 256
+
+static int g_usable[NUMBER_OF_BACKENDS];
+static struct tuning g_tuning[NUMBER_OF_BACKENDS];
+static volatile sig_atomic_t g_switch = 0;
+
+/*
+ * open_backends() opens every backend, loads the settings of the kernel
+ * autotuner for it (see tuning.h) and returns the number the host can run.
+ * A backend whose settings do not fit is not used.
+ */
+
+int open_backends(void)
+{
+  int usable = 0;
+
+  for (int b = 0; b < NUMBER_OF_BACKENDS; b++)
+  {
+    g_usable[b] = (g_backends[b]->open() == 0);
+    if (g_usable[b])
+    {
+      load_tuning(g_backends[b]->name, &g_tuning[b]);
+      if (g_backends[b]->tune(&g_tuning[b]) != 0)
+      {
+        printf("Error applying the tuning of %s, run the autotuner again\n",
+               g_backends[b]->name);
+        g_backends[b]->close();
+        g_usable[b] = 0;
+      }
+    }
+    usable += g_usable[b];
+  }
+  return usable;
+}
+
+/*
+ * use_backend() sets the tile size of the backend, the image generators
+ * share the tiles.
+ */
+
+static int use_backend(int backend)
+{
+  return set_tile_size(g_tuning[backend].tile_size);
+}
+
+void close_backends(void)
+{
+  for (int b = 0; b < NUMBER_OF_BACKENDS; b++)
+  {
+    if (g_usable[b])
+    {
+      g_backends[b]->close();
+    }
+  }
+}
+
+void list_backends(void)
+{
+  printf("Backends:");
+  for (int b = 0; b < NUMBER_OF_BACKENDS; b++)
+  {
+    printf(" %s%s", g_backends[b]->name, g_usable[b] ? "" : " (not available)");
+  }
+  printf("\n");
+}
+
+static int backend_index(const char *name)
+{
+  for (int b = 0; b < NUMBER_OF_BACKENDS; b++)
+  {
+    if (strcmp(g_backends[b]->name, name) == 0)
+    {
+      return b;
+    }
+  }
+  return -1;
+}
+
+/*
+ * The cache file holds the names of all backends built in, so a
+ * pixelGenerator built with OpenCL calibrates again.
+ */
+
+static void backend_names(char *names, size_t size)
+{
+  names[0] = '\0';
+  for (int b = 0; b < NUMBER_OF_BACKENDS; b++)
+  {
+    snprintf(names + strlen(names), size - strlen(names), "%s%s",
+             (b > 0) ? "," : "", g_backends[b]->name);
+  }
+}
+
+/*
+ * The settings of the kernel autotuner change the speed of the backends, the
+ * cache file holds them to calibrate again after the autotuner has run.
+ */
+
+static void backend_tunings(char *tunings, size_t size)
+{
+  tunings[0] = '\0';
+  for (int b = 0; b < NUMBER_OF_BACKENDS; b++)
+  {
+    struct tuning *t = &g_tuning[b];
+    snprintf(tunings + strlen(tunings), size - strlen(tunings),
+             "%s%d/%d/%dx%d", (b > 0) ? "," : "", t->tile_size, t->threads,
+             t->local_x, t->local_y);
+  }
+}
+
+/*
+ * read_cache() returns the index of the backend in the cache file, -1 if
+ * there is none or it does not fit this pixelGenerator.
+ */
+
+static int read_cache(void)
+{
+  char path[HOST_CACHE_PATH];
+  char line[MAX_LINE];
+  char value[MAX_LINE];
+  char names[MAX_LINE];
+  char cached_names[MAX_LINE] = "";
+  char tunings[MAX_LINE];
+  char cached_tunings[MAX_LINE] = "";
+  int backend = -1;
+  int width = 0;
+  int height = 0;
+
+  if (host_cache_path(BACKEND_CACHE, path, sizeof(path)) != 0)
+  {
+    return -1;
+  }
+  FILE *file = fopen(path, "r");
+  if (file == NULL)
+  {
+    return -1;
+  }
+
+  while (fgets(line, sizeof(line), file) != NULL)
+  {
+    if (sscanf(line, "tunings %255s", value) == 1)
+    {
+      snprintf(cached_tunings, sizeof(cached_tunings), "%s", value);
+    }
+    else if (sscanf(line, "backends %255s", value) == 1)
+    {
+      snprintf(cached_names, sizeof(cached_names), "%s", value);
+    }
+    else if (sscanf(line, "backend %255s", value) == 1)
+    {
+      backend = backend_index(value);
+    }
+    else
+    {
+      sscanf(line, "image %dx%d", &width, &height);
+    }
+  }
+  fclose(file);
+
+  backend_names(names, sizeof(names));
+  backend_tunings(tunings, sizeof(tunings));
+  if (backend == -1 || !g_usable[backend] || width != WIDTH ||
+      height != HEIGHT || strcmp(names, cached_names) != 0 ||
+      strcmp(tunings, cached_tunings) != 0)
+  {
+    return -1;
+  }
+  printf("Using the %s backend calibrated before (%s)\n",
+         g_backends[backend]->name, path);
+  return backend;
+}
+
+static void write_cache(int backend)
+{
+  char path[HOST_CACHE_PATH];
+  char names[MAX_LINE];
+  char tunings[MAX_LINE];
+
+  if (host_cache_path(BACKEND_CACHE, path, sizeof(path)) != 0)
+  {
+    return;
+  }
+  FILE *file = fopen(path, "w");
+  if (file == NULL)
+  {
+    perror(path);
+    return;
+  }
+
+  backend_names(names, sizeof(names));
+  backend_tunings(tunings, sizeof(tunings));
+  fprintf(file, "backend %s\nimage %dx%d\nbackends %s\ntunings %s\n",
+          g_backends[backend]->name, WIDTH, HEIGHT, names, tunings);
+  if (fclose(file) != 0)
+  {
+    perror(path);
+  }
+}
+
+/*
+ * calibration_view() shows seahorse valley, the same section for every
+ * image size.
+ */
+
+static void calibration_view(struct viewport *view)
+{
+  const double center_x = -0.7435;
+  const double center_y = 0.1314;
+  const double width = 0.03;
+  double height = width * HEIGHT / WIDTH;
+
+  memset(view, 0, sizeof(struct viewport));
+  view->xmin = center_x - width / 2;
+  view->xmax = center_x + width / 2;
+  view->ymin = center_y - height / 2;
+  view->ymax = center_y + height / 2;
+  view->zoom = 1.0;
+}
+
+/*
+ * calibrate() returns the index of the fastest backend, -1 on error.
+ */
+
+static int calibrate(unsigned char *pixels, int bpp, unsigned char *imagebuffer)
+{
+  struct viewport view;
+  int fastest = -1;
+  long long fastest_ns = 0;
+
+  printf("Calibrating the backends with %dx%d images\n", WIDTH, HEIGHT);
+  calibration_view(&view);
+
+  for (int b = 0; b < NUMBER_OF_BACKENDS; b++)
+  {
+    if (!g_usable[b])
+    {
+      continue;
+    }
+
+    long long best_ns = 0;
+
+    if (use_backend(b) != 0)
+    {
+      return -1;
+    }
+    for (int run = 0; run <= CALIBRATION_RUNS; run++)
+    {
+      long long start = stats_clock();
+      if (g_backends[b]->generate_image(pixels, bpp, imagebuffer, &view) == -1)
+      {
+        printf("Error generating image data with %s\n", g_backends[b]->name);
+        return -1;
+      }
+      long long ns = stats_clock() - start;
+
+      // run 0 warms up caches and thread pools
+      if (run > 0 && (best_ns == 0 || ns < best_ns))
+      {
+        best_ns = ns;
+      }
+    }
+
+    printf("  %-8s %8.2f ms\n", g_backends[b]->name, best_ns / 1e6);
+    if (fastest == -1 || best_ns < fastest_ns)
+    {
+      fastest = b;
+      fastest_ns = best_ns;
+    }
+  }
+  return fastest;
+}
+
+/*
+ * select_backend() returns the backend called name or, for BACKEND_AUTO, the
+ * fastest one. pixels, bpp and imagebuffer are used for the calibration.
+ * Returns NULL if there is no such backend or the host can not run it.
+ */
+
+struct generator_backend *select_backend(const char *name,
+                                         unsigned char *pixels, int bpp,
+                                         unsigned char *imagebuffer)
+{
+  int backend;
+
+  if (strcmp(name, BACKEND_AUTO) != 0)
+  {
+    backend = backend_index(name);
+    if (backend == -1 || !g_usable[backend])
+    {
+      printf("Backend %s is not available\n", name);
+      list_backends();
+      return NULL;
+    }
+  }
+  else
+  {
+    backend = read_cache();
+    if (backend == -1)
+    {
+      backend = calibrate(pixels, bpp, imagebuffer);
+      if (backend == -1)
+      {
+        return NULL;
+      }
+      write_cache(backend);
+    }
+  }
+
+  if (use_backend(backend) != 0)
+  {
+    return NULL;
+  }
+  return g_backends[backend];
+}
+
+void switch_backend_handler(int signum)
+{
+  g_switch = 1;
+}
+
+/*
+ * switch_backend() returns the backend for the next image: the next one the
+ * host can run if SIGUSR2 has arrived, backend otherwise.
+ */
+
+struct generator_backend *switch_backend(struct generator_backend *backend)
+{
+  if (!g_switch)
+  {
+    return backend;
+  }
+  g_switch = 0;
+
+  int current = backend_index(backend->name);
+
+  for (int b = 1; b <= NUMBER_OF_BACKENDS; b++)
+  {
+    int next = (current + b) % NUMBER_OF_BACKENDS;
+    if (g_usable[next] && use_backend(next) == 0)
+    {
+      printf("Switching from %s to %s\n", backend->name,
+             g_backends[next]->name);
+      return g_backends[next];
+    }
+  }
+  return backend;
+}
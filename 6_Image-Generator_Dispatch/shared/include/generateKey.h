@@ -0,0 +1,17 @@
+/*
+ * FILE = HEADER: /include/generateKey.h
+ * 
+ * Copyright (c) 2016 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _generateKey_
+#define _generateKey_
+
+#include <sys/ipc.h>
+
+key_t generateKey(void);
+
+#endif
@@ -0,0 +1,51 @@
+/*
+ * FILE = HEADER: /include/latency.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _latency_
+#define _latency_
+
+/*
+ * A latency histogram in the style of HdrHistogram: every power of two is
+ * split into LATENCY_SUB_BUCKETS / 2 buckets of equal width, so every value
+ * is recorded with an error of less than 1 / 16 (6%) no matter if it takes
+ * microseconds or seconds. Values are nanoseconds, values from
+ * 2^LATENCY_MAX_BITS ns (about 18 minutes) on land in the last bucket.
+ *
+ * Recording is a few shifts and one increment, the histograms are not
+ * thread safe. The timestamps are taken with CLOCK_MONOTONIC, which is the
+ * same clock in every process, so the pixelGenerator and the imageWriter can
+ * measure the time between stages of each other (see struct frame_times).
+ */
+
+#define LATENCY_SUB_BITS 5
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+#define LATENCY_MAX_BITS 40
+#define LATENCY_BUCKETS ((LATENCY_MAX_BITS - LATENCY_SUB_BITS + 2) * \
+                         (LATENCY_SUB_BUCKETS / 2))
+
+struct latency_histogram
+{
+  unsigned long long counts[LATENCY_BUCKETS];
+  unsigned long long count;
+  long long max;
+};
+
+void record_latency(struct latency_histogram *histogram, long long ns);
+long long latency_percentile(const struct latency_histogram *histogram,
+                             double percentile);
+
+/*
+ * print_latency() prints one line per stage: count, p50, p99, p99.9 and max
+ * in milliseconds.
+ */
+
+void print_latency(const char *title, const char *names[],
+                   const struct latency_histogram *histograms, int stages);
+
+#endif
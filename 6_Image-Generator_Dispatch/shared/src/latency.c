@@ -0,0 +1,113 @@
+/*
+ * FILE = /src/latency.c
+ *
+ * This file holds the latency histograms of the stages an image passes
+ * (see latency.h).
+ * This file is used by the pixelGenerator and the imageWriter program.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+
+#include "latency.h"
+
+/*
+ * Values below LATENCY_SUB_BUCKETS get a bucket each. Above, the highest
+ * LATENCY_SUB_BITS bits of a value select the bucket: shift is the number of
+ * lower bits dropped, value >> shift lies between LATENCY_SUB_BUCKETS / 2 and
+ * LATENCY_SUB_BUCKETS - 1.
+ */
+
+static int bucket_index(long long ns)
+{
+  if (ns < LATENCY_SUB_BUCKETS)
+  {
+    return (ns < 0) ? 0 : (int) ns;
+  }
+  if (ns >> LATENCY_MAX_BITS)
+  {
+    return LATENCY_BUCKETS - 1;
+  }
+
+  int shift = 63 - __builtin_clzll((unsigned long long) ns) -
+              (LATENCY_SUB_BITS - 1);
+  return shift * (LATENCY_SUB_BUCKETS / 2) + (int) (ns >> shift);
+}
+
+/*
+ * the highest value recorded in a bucket
+ */
+
+static long long bucket_value(int index)
+{
+  if (index < LATENCY_SUB_BUCKETS)
+  {
+    return index;
+  }
+
+  int shift = index / (LATENCY_SUB_BUCKETS / 2) - 1;
+  long long sub = index - shift * (LATENCY_SUB_BUCKETS / 2);
+  return ((sub + 1) << shift) - 1;
+}
+
+void record_latency(struct latency_histogram *histogram, long long ns)
+{
+  histogram->counts[bucket_index(ns)]++;
+  histogram->count++;
+  if (ns > histogram->max)
+  {
+    histogram->max = ns;
+  }
+}
+
+/*
+ * latency_percentile() returns the value percentile percent of all values
+ * are less than or equal to, 0 if nothing has been recorded.
+ */
+
+long long latency_percentile(const struct latency_histogram *histogram,
+                             double percentile)
+{
+  if (histogram->count == 0)
+  {
+    return 0;
+  }
+
+  unsigned long long rank = (unsigned long long)
+                            (percentile / 100.0 * histogram->count + 0.5);
+  unsigned long long seen = 0;
+
+  if (rank < 1)
+  {
+    rank = 1;
+  }
+  for (int i = 0; i < LATENCY_BUCKETS; i++)
+  {
+    seen += histogram->counts[i];
+    if (seen >= rank)
+    {
+      long long value = bucket_value(i);
+      return (value < histogram->max) ? value : histogram->max;
+    }
+  }
+  return histogram->max;
+}
+
+void print_latency(const char *title, const char *names[],
+                   const struct latency_histogram *histograms, int stages)
+{
+  printf("\n%s latency in ms:\n", title);
+  printf("%-11s %8s %9s %9s %9s %9s\n", "stage", "images", "p50", "p99",
+         "p99.9", "max");
+  for (int s = 0; s < stages; s++)
+  {
+    const struct latency_histogram *h = &histograms[s];
+    printf("%-11s %8llu %9.3f %9.3f %9.3f %9.3f\n", names[s], h->count,
+           latency_percentile(h, 50.0) / 1e6, latency_percentile(h, 99.0) / 1e6,
+           latency_percentile(h, 99.9) / 1e6, h->max / 1e6);
+  }
+}
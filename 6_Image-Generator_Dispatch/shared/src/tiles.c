@@ -0,0 +1,149 @@
+/*
+ * FILE = /src/tiles.c
+ *
+ * This file splits the image into tiles (see tiles.h) and sorts them by the
+ * distance of their center to the center of the image.
+ * Generating the tiles in this order finishes the part of the image the user
+ * is looking at first. If the generation of an image is cancelled by a
+ * view_command (see viewCommand.h) the finished tiles form a rectangle
+ * around the center of the image.
+ * This file is used by the pixelGenerator and the SDL_Viewer, which puts the
+ * finished tiles of a cancelled image over its preview.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "numberOfPixel.h"
+#include "tiles.h"
+
+static int g_tile_size = TILE_SIZE;
+static int *g_tile_order = NULL;
+static int g_tiles_x;
+static int g_tiles_y;
+
+static double distance_to_center(int tile)
+{
+  double x = (tile % g_tiles_x + 0.5) * g_tile_size - WIDTH / 2.0;
+  double y = (tile / g_tiles_x + 0.5) * g_tile_size - HEIGHT / 2.0;
+
+  return x * x + y * y;
+}
+
+static int compare_tiles(const void *a, const void *b)
+{
+  double da = distance_to_center(*(const int *) a);
+  double db = distance_to_center(*(const int *) b);
+
+  if (da != db)
+  {
+    return (da < db) ? -1 : 1;
+  }
+  return *(const int *) a - *(const int *) b;
+}
+
+/*
+ * set_tile_size() drops the order of the old size, the next init_tiles()
+ * builds the new one. Not called while an image is generated.
+ */
+
+int set_tile_size(int size)
+{
+  if (size < 4 || size % 4 != 0)
+  {
+    printf("Tile size %d is not a multiple of 4\n", size);
+    return -1;
+  }
+  if (size != g_tile_size)
+  {
+    free(g_tile_order);
+    g_tile_order = NULL;
+    g_tile_size = size;
+  }
+  return 0;
+}
+
+int tile_size(void)
+{
+  return g_tile_size;
+}
+
+/*
+ * init_tiles() builds the center-out order once, it returns -1 if the
+ * memory can not be allocated.
+ */
+
+int init_tiles(void)
+{
+  if (g_tile_order != NULL)
+  {
+    return 0;
+  }
+
+  g_tiles_x = (WIDTH + g_tile_size - 1) / g_tile_size;
+  g_tiles_y = (HEIGHT + g_tile_size - 1) / g_tile_size;
+
+  g_tile_order = (int *) malloc(sizeof(int) * g_tiles_x * g_tiles_y);
+  if (g_tile_order == NULL)
+  {
+    perror("malloc");
+    return -1;
+  }
+
+  for (int tile = 0; tile < g_tiles_x * g_tiles_y; tile++)
+  {
+    g_tile_order[tile] = tile;
+  }
+  qsort(g_tile_order, g_tiles_x * g_tiles_y, sizeof(int), compare_tiles);
+
+  return 0;
+}
+
+int number_of_tiles(void)
+{
+  return ((WIDTH + g_tile_size - 1) / g_tile_size) *
+         ((HEIGHT + g_tile_size - 1) / g_tile_size);
+}
+
+void reset_tiles(struct tile_queue *queue)
+{
+  queue->next = 0;
+}
+
+/*
+ * next_tile() returns the position of the next tile in the center-out order
+ * or -1 if all tiles have been taken. Called by all threads at once.
+ */
+
+int next_tile(struct tile_queue *queue)
+{
+  int order = __sync_fetch_and_add(&queue->next, 1);
+
+  if (order >= number_of_tiles())
+  {
+    return -1;
+  }
+  return order;
+}
+
+/*
+ * tile_bounds() returns the pixels covered by the tile at position order of
+ * the center-out order, stop_x and stop_y are not included. init_tiles() has
+ * to be called before.
+ */
+
+void tile_bounds(int order, int *start_x, int *stop_x, int *start_y,
+                 int *stop_y)
+{
+  int tile = g_tile_order[order];
+
+  *start_x = (tile % g_tiles_x) * g_tile_size;
+  *start_y = (tile / g_tiles_x) * g_tile_size;
+  *stop_x = *start_x + g_tile_size < WIDTH ? *start_x + g_tile_size : WIDTH;
+  *stop_y = *start_y + g_tile_size < HEIGHT ? *start_y + g_tile_size : HEIGHT;
+}
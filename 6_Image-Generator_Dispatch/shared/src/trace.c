@@ -0,0 +1,178 @@
+/*
+ * FILE = /src/trace.c
+ *
+ * This file records the timeline of the threads of a program and writes it
+ * as Chrome trace file (see trace.h).
+ * This file is used by the pixelGenerator and the imageWriter program.
+ *
+ * Every thread selects its buffer with trace_thread() once. Threads which
+ * are started again for every image (the threads of the pthread versions)
+ * take the same id every time, so they reuse the buffer of their
+ * predecessor, which has been joined before.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+#define TRACE_NAME_LENGTH 32
+#define MAX_PATH 64
+
+struct trace_record
+{
+  const char *name;
+  long long begin;
+  long long end;
+  long arg;
+};
+
+struct trace_buffer
+{
+  char name[TRACE_NAME_LENGTH];    // name of the thread
+  unsigned long count;             // events recorded, TRACE_EVENTS are kept
+  struct trace_record records[TRACE_EVENTS];
+};
+
+static struct trace_buffer *g_buffers[TRACE_MAX_THREADS];
+static int g_next_thread = 0;
+static __thread struct trace_buffer *g_buffer = NULL;
+
+/*
+ * trace_thread() selects the buffer id (0 to TRACE_MAX_THREADS - 1) for the
+ * calling thread, TRACE_NEXT_THREAD takes the next id not given out by
+ * TRACE_NEXT_THREAD before. Explicit ids and TRACE_NEXT_THREAD should not be
+ * mixed in one program. Selecting the buffer already selected costs nothing.
+ * Returns the id or -1 if tracing is off or there is no buffer left.
+ */
+
+int trace_thread(int id, const char *name)
+{
+  if (!TRACE_OUTPUT)
+  {
+    return -1;
+  }
+  if (id == TRACE_NEXT_THREAD)
+  {
+    id = __sync_fetch_and_add(&g_next_thread, 1);
+  }
+  if (id < 0 || id >= TRACE_MAX_THREADS)
+  {
+    g_buffer = NULL;
+    return -1;
+  }
+
+  if (g_buffer != NULL && g_buffer == g_buffers[id])
+  {
+    return id;
+  }
+  if (g_buffers[id] == NULL)
+  {
+    g_buffers[id] = calloc(1, sizeof(struct trace_buffer));
+    if (g_buffers[id] == NULL)
+    {
+      perror("calloc");
+      g_buffer = NULL;
+      return -1;
+    }
+  }
+  snprintf(g_buffers[id]->name, TRACE_NAME_LENGTH, "%s", name);
+  g_buffer = g_buffers[id];
+  return id;
+}
+
+void record_trace_event(const char *name, long long begin, long long end,
+                        long arg)
+{
+  struct trace_buffer *buffer = g_buffer;
+
+  if (buffer == NULL)
+  {
+    return;
+  }
+
+  struct trace_record *record = &buffer->records[buffer->count % TRACE_EVENTS];
+  record->name = name;
+  record->begin = begin;
+  record->end = end;
+  record->arg = arg;
+  buffer->count++;
+}
+
+/*
+ * write_trace() writes the events of all threads to trace-<program>.json,
+ * called when the program terminates. Timestamps are microseconds.
+ */
+
+int write_trace(const char *program)
+{
+  if (!TRACE_OUTPUT)
+  {
+    return 0;
+  }
+
+  char path[MAX_PATH];
+  snprintf(path, sizeof(path), "trace-%s.json", program);
+
+  FILE *file = fopen(path, "w");
+  if (file == NULL)
+  {
+    perror(path);
+    return -1;
+  }
+
+  int pid = getpid();
+  unsigned long dropped = 0;
+
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+          "\"args\":{\"name\":\"%s\"}}", pid, program);
+
+  for (int t = 0; t < TRACE_MAX_THREADS; t++)
+  {
+    struct trace_buffer *buffer = g_buffers[t];
+    if (buffer == NULL)
+    {
+      continue;
+    }
+
+    fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+            "\"tid\":%d,\"args\":{\"name\":\"%s\"}}", pid, t, buffer->name);
+    fprintf(file, ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":%d,"
+            "\"tid\":%d,\"args\":{\"sort_index\":%d}}", pid, t, t);
+
+    unsigned long count = buffer->count;
+    unsigned long first = (count > TRACE_EVENTS) ? count - TRACE_EVENTS : 0;
+    dropped += first;
+
+    for (unsigned long e = first; e < count; e++)
+    {
+      struct trace_record *record = &buffer->records[e % TRACE_EVENTS];
+      fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+              "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"n\":%ld}}", record->name,
+              pid, t, record->begin / 1000.0,
+              (record->end - record->begin) / 1000.0, record->arg);
+    }
+  }
+  fprintf(file, "\n]}\n");
+
+  if (fclose(file) != 0)
+  {
+    perror(path);
+    return -1;
+  }
+  printf("Trace written to %s", path);
+  if (dropped > 0)
+  {
+    printf(" (%lu older events overwritten)", dropped);
+  }
+  printf("\n");
+  return 0;
+}
@@ -0,0 +1,129 @@
+/*
+ * FILE = /src/tuning.c
+ *
+ * RELATED FILES:     *.c                              *.h
+ *                    hostCache.c                      hostCache.h
+ *                                                     tuning.h
+ *
+ * This file reads and writes the settings measured by the kernel autotuner
+ * (see tuning.h). The file holds one "name value" line per setting, lines
+ * with an unknown name are skipped.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "numberOfPixel.h"
+#include "hostCache.h"
+#include "tiles.h"
+#include "tuning.h"
+
+#define MAX_LINE 256
+
+void default_tuning(struct tuning *tuning)
+{
+  memset(tuning, 0, sizeof(struct tuning));
+  tuning->tile_size = TILE_SIZE;
+}
+
+static int tuning_path(const char *backend, char *path, size_t size)
+{
+  char name[MAX_LINE];
+
+  snprintf(name, sizeof(name), "%s-%s-%dx%d", TUNING_CACHE, backend, WIDTH,
+           HEIGHT);
+  return host_cache_path(name, path, size);
+}
+
+/*
+ * load_tuning() returns -1 and the defaults if there is no file for the
+ * backend and image size.
+ */
+
+int load_tuning(const char *backend, struct tuning *tuning)
+{
+  char path[HOST_CACHE_PATH];
+  char line[MAX_LINE];
+
+  default_tuning(tuning);
+  if (tuning_path(backend, path, sizeof(path)) != 0)
+  {
+    return -1;
+  }
+  FILE *file = fopen(path, "r");
+  if (file == NULL)
+  {
+    return -1;
+  }
+
+  while (fgets(line, sizeof(line), file) != NULL)
+  {
+    if (sscanf(line, "tile_size %d", &tuning->tile_size) != 1 &&
+        sscanf(line, "threads %d", &tuning->threads) != 1)
+    {
+      sscanf(line, "local %dx%d", &tuning->local_x, &tuning->local_y);
+    }
+  }
+  fclose(file);
+
+  printf("Using the tuning of %s:", path);
+  print_tuning(tuning);
+  return 0;
+}
+
+int save_tuning(const char *backend, const struct tuning *tuning)
+{
+  char path[HOST_CACHE_PATH];
+
+  if (tuning_path(backend, path, sizeof(path)) != 0)
+  {
+    printf("Error: No directory for the tuning\n");
+    return -1;
+  }
+  FILE *file = fopen(path, "w");
+  if (file == NULL)
+  {
+    perror(path);
+    return -1;
+  }
+
+  fprintf(file, "tile_size %d\nthreads %d\nlocal %dx%d\n", tuning->tile_size,
+          tuning->threads, tuning->local_x, tuning->local_y);
+  if (fclose(file) != 0)
+  {
+    perror(path);
+    return -1;
+  }
+  printf("Tuning written to %s\n", path);
+  return 0;
+}
+
+/*
+ * print_tuning() prints the settings in one line, 0 as "default".
+ */
+
+void print_tuning(const struct tuning *tuning)
+{
+  printf(" tile size %d,", tuning->tile_size);
+  if (tuning->threads > 0)
+  {
+    printf(" %d threads,", tuning->threads);
+  }
+  else
+  {
+    printf(" default threads,");
+  }
+  if (tuning->local_x > 0)
+  {
+    printf(" work group %dx%d\n", tuning->local_x, tuning->local_y);
+  }
+  else
+  {
+    printf(" default work group\n");
+  }
+}
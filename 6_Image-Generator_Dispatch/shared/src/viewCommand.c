@@ -0,0 +1,183 @@
+/*
+ * FILE = /src/viewCommand.c
+ *
+ * This file holds the command channel from the consumers back to the
+ * pixelGenerator (see viewCommand.h) and the section of the mandelbrot set
+ * the commands change.
+ * This file is used by the pixelGenerator and the SDL_Viewer.
+ *
+ * The queue is a single producer, single consumer ring buffer. The sender
+ * writes the command before it publishes it by incrementing head, the
+ * pixelGenerator reads the command before it hands the entry back by
+ * incrementing tail.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include "numberOfPixel.h"
+#include "sharedSegment.h"
+#include "viewCommand.h"
+
+/*
+ * view_clock() returns a monotonic time in nanoseconds which is the same in
+ * every process, so the latency of a command can be measured by the
+ * consumer.
+ */
+
+long long view_clock(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (long long) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static struct command_queue *command_queue(unsigned char *segment)
+{
+  return &segment_header(segment)->commands;
+}
+
+/*
+ * reset_view_commands() empties the queue. Only used by the pixelGenerator
+ * when it creates the segment.
+ */
+
+void reset_view_commands(unsigned char *segment)
+{
+  struct command_queue *queue = command_queue(segment);
+
+  queue->head = 0;
+  queue->tail = 0;
+  __sync_synchronize();
+}
+
+/*
+ * send_view_command() returns -1 if the queue is full.
+ */
+
+int send_view_command(unsigned char *segment, struct view_command *command)
+{
+  struct command_queue *queue = command_queue(segment);
+  unsigned long head = queue->head;
+  unsigned long tail = *(volatile unsigned long *) &queue->tail;
+
+  if (head - tail >= COMMAND_QUEUE_SIZE)
+  {
+    return -1;
+  }
+
+  queue->command[head % COMMAND_QUEUE_SIZE] = *command;
+  __sync_synchronize();
+  *(volatile unsigned long *) &queue->head = head + 1;
+
+  return 0;
+}
+
+/*
+ * receive_view_command() returns -1 if there is no command.
+ */
+
+int receive_view_command(unsigned char *segment, struct view_command *command)
+{
+  struct command_queue *queue = command_queue(segment);
+  unsigned long tail = queue->tail;
+  unsigned long head = *(volatile unsigned long *) &queue->head;
+
+  if (head == tail)
+  {
+    return -1;
+  }
+
+  __sync_synchronize();
+  *command = queue->command[tail % COMMAND_QUEUE_SIZE];
+  __sync_synchronize();
+  *(volatile unsigned long *) &queue->tail = tail + 1;
+
+  return 0;
+}
+
+int view_commands_pending(unsigned char *segment)
+{
+  struct command_queue *queue = command_queue(segment);
+
+  return *(volatile unsigned long *) &queue->head !=
+         *(volatile unsigned long *) &queue->tail;
+}
+
+/*
+ * reset_section() goes back to the section the pixelGenerator starts with and
+ * to the automatic zoom. The bookkeeping of the commands and cancellable
+ * (set by the pixelGenerator) are not part of the section.
+ */
+
+static void reset_section(struct viewport *view)
+{
+  view->xmin = -2.5;
+  view->xmax = 1.5;
+  view->ymin = -1.5;
+  view->ymax = 1.5;
+  view->zoom = 1;
+  view->e = 1;
+  view->automatic = 1;
+}
+
+void init_viewport(struct viewport *view)
+{
+  reset_section(view);
+  view->input_time = 0;
+  view->commands = 0;
+  view->cancellable = 0;
+}
+
+/*
+ * apply_view_command() keeps the size of a pixel in xmin ... ymax and changes
+ * zoom, so the automatic zoom can continue from the new section.
+ */
+
+void apply_view_command(struct viewport *view, struct view_command *command)
+{
+  double xp = (view->xmax - view->xmin) / WIDTH;
+  double yp = (view->ymax - view->ymin) / HEIGHT;
+
+  view->commands++;
+
+  if (command->type == VIEW_PAN)
+  {
+    view->xmin -= command->x * xp;
+    view->xmax -= command->x * xp;
+    view->ymin += command->y * yp;
+    view->ymax += command->y * yp;
+    view->automatic = 0;
+  }
+  else if (command->type == VIEW_ZOOM && command->factor > 0)
+  {
+    double f = command->factor;
+
+    view->xmin = f * view->xmin + (f - 1) * command->x * xp;
+    view->xmax = view->xmin + WIDTH * xp;
+    view->ymax = f * view->ymax - (f - 1) * command->y * yp;
+    view->ymin = view->ymax - HEIGHT * yp;
+    view->zoom *= f;
+    view->automatic = 0;
+  }
+  else if (command->type == VIEW_AUTO)
+  {
+    reset_section(view);
+  }
+  else
+  {
+    printf("Error: unknown view command %d\n", command->type);
+    return;
+  }
+
+  if (view->input_time == 0 || command->sent < view->input_time)
+  {
+    view->input_time = command->sent;
+  }
+}
@@ -0,0 +1,50 @@
+/*
+ * FILE = HEADER: /include/kernel.h
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#ifndef _kernel_
+#define _kernel_
+
+#include "viewCommand.h"
+#include "tuning.h"
+
+/*
+ * The kernel benchmark and check are built once for every image generator
+ * (backend), KERNEL_BACKEND names it, KERNEL_OPENCL is set for the OpenCL
+ * version (see makefile).
+ */
+
+#ifndef KERNEL_BACKEND
+#define KERNEL_BACKEND "unknown"
+#endif
+
+#define MAX_ITERATION 1023
+
+/*
+ * A fixed section of the mandelbrot set, given by its center and width, the
+ * height follows from the aspect ratio of the image (see kernel.c).
+ */
+
+struct fixed_viewport
+{
+  const char *name;
+  double x;
+  double y;
+  double width;
+};
+
+extern const struct fixed_viewport g_viewports[];
+extern const int g_number_of_viewports;
+
+int init_kernel(void);
+int set_kernel_threads(int threads);
+int set_kernel_tuning(const struct tuning *tuning);
+void set_viewport(struct viewport *view, const struct fixed_viewport *v);
+int generate_iterations(unsigned char *image, struct viewport *view);
+
+#endif
@@ -0,0 +1,137 @@
+/*
+ * FILE = /src/kernel.c
+ *
+ * This file runs the generate_image() function of the image generator the
+ * program has been built with (see kernel.h).
+ * This file is used by the kernelBenchmark and kernelCheck program.
+ *
+ * The images are generated as PIXEL_INDEX16 (see pixelFormat.h), so every
+ * pixel holds its number of iterations.
+ *
+ * The fixed viewports have different costs:
+ *
+ * overview  the whole set, many pixels escape at once or are found by the
+ *           cardioid and bulb check
+ * boundary  seahorse valley, most pixels close to the boundary
+ * interior  the period-3 bulb, most pixels reach MAX_ITERATION and the
+ *           cardioid and bulb check does not help
+ * deep      a zoom by about 10^9 into a spiral, long escape times and
+ *           coordinates close to the precision of double
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "numberOfPixel.h"
+#include "pixelFormat.h"
+#include "viewCommand.h"
+#include "tiles.h"
+#include "kernel.h"
+
+#if KERNEL_OPENCL
+#include "setup_OpenCL.h"
+#include "generate_image.h"
+#include "global_ids.h"
+#else
+#include "mandelbrot.h"
+#endif
+
+const struct fixed_viewport g_viewports[] =
+{
+  { "overview", -0.75, 0.0, 3.5 },
+  { "boundary", -0.7453, 0.1127, 0.006 },
+  { "interior", -0.1226, 0.7449, 0.08 },
+  { "deep", -0.743643887037151, 0.131825904205330, 3.0e-9 },
+};
+
+const int g_number_of_viewports = sizeof(g_viewports) / sizeof(g_viewports[0]);
+
+static unsigned char g_palette[PALETTE_SIZE][3];
+static unsigned char g_pixels[PALETTE_SIZE * MAX_BYTES_PER_PIXEL];
+
+int init_kernel(void)
+{
+  if (make_pixel_table(PIXEL_INDEX16, g_palette, g_pixels) != 0)
+  {
+    return -1;
+  }
+
+  #if KERNEL_OPENCL
+
+  if (setup_OpenCL(&g_data) == -1 ||
+      set_pixel_format(g_pixels, bytes_per_pixel(PIXEL_INDEX16), &g_data) != 0)
+  {
+    printf("Error setting up OpenCL\n");
+    return -1;
+  }
+
+  #endif
+
+  return 0;
+}
+
+/*
+ * The OpenCL device decides itself how many work items run at once, it only
+ * takes 0 threads.
+ */
+
+int set_kernel_threads(int threads)
+{
+  #if KERNEL_OPENCL
+  return (threads == 0) ? 0 : -1;
+  #else
+  return set_number_of_threads(threads);
+  #endif
+}
+
+/*
+ * set_kernel_tuning() applies the settings of the kernel autotuner (see
+ * tuning.h) the backend has: the work group size for OpenCL, the tile size
+ * and number of threads for the others. Returns -1 if they are not possible.
+ */
+
+int set_kernel_tuning(const struct tuning *tuning)
+{
+  #if KERNEL_OPENCL
+  return set_local_size(&g_data, tuning->local_x, tuning->local_y);
+  #else
+  if (set_tile_size(tuning->tile_size) != 0)
+  {
+    return -1;
+  }
+  return (tuning->threads > 0) ? set_number_of_threads(tuning->threads) : 0;
+  #endif
+}
+
+void set_viewport(struct viewport *view, const struct fixed_viewport *v)
+{
+  double height = v->width * HEIGHT / WIDTH;
+
+  init_viewport(view);
+  view->xmin = v->x - v->width / 2;
+  view->xmax = v->x + v->width / 2;
+  view->ymin = v->y - height / 2;
+  view->ymax = v->y + height / 2;
+  view->zoom = 1.0;
+  view->automatic = 0;
+  view->cancellable = 0;
+}
+
+/*
+ * generate_iterations() writes the iterations of every pixel of the view
+ * into image (pixel_data_size(PIXEL_INDEX16) bytes), returns -1 on error.
+ */
+
+int generate_iterations(unsigned char *image, struct viewport *view)
+{
+  #if KERNEL_OPENCL
+  return (generate_image(image, &g_data, view) == EXIT_SUCCESS) ? 0 : -1;
+  #else
+  return (generate_image(g_pixels, 2, image, view) == -1) ? -1 : 0;
+  #endif
+}
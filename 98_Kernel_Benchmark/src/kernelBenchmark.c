@@ -0,0 +1,315 @@
+/*
+ * FILE = /src/kernelBenchmark.c
+ *
+ * Measures the generate_image() function of one image generator (kernel
+ * backend, see kernel.h). The makefile builds this file once for every
+ * backend and image size (see README.md).
+ *
+ * usage: ./kernelBenchmark-<backend>.out [repetitions] [output prefix]
+ *                                        [threads ...]
+ *
+ * Every viewport (a fixed section of the mandelbrot set, see kernel.c)
+ * is generated once to warm up and then repetitions times with every number
+ * of threads. The time is wall clock time (CLOCK_MONOTONIC), not the cpu
+ * time of clock(), which adds up the time of all threads.
+ *
+ * Every pixel of the images holds its number of iterations (see kernel.c),
+ * their sum gives the iterations per second. Pixels found in the cardioid
+ * or the period-2 bulb count as MAX_ITERATION like in the image, although
+ * they take no iterations.
+ *
+ * The results are printed and written to <output prefix>.json and
+ * <output prefix>.csv (default: kernel-<backend>-<width>x<height>).
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "numberOfPixel.h"
+#include "pixelFormat.h"
+#include "viewCommand.h"
+#include "kernel.h"
+
+#define DEFAULT_REPETITIONS 5
+#define MAX_THREAD_COUNTS 16
+#define MAX_PREFIX 256
+
+/*
+ * the result of one viewport with one number of threads
+ */
+
+struct benchmark_result
+{
+  const char *viewport;
+  int threads;
+  unsigned long long iterations;
+  double mean_ms;
+  double stddev_ms;
+  double min_ms;
+  double max_ms;
+  double mpixel;                   // Mpixel/s of the mean time
+  double mpixel_stddev;            // standard deviation of the runs' Mpixel/s
+  double giter;                    // Giterations/s of the mean time
+};
+
+static double now_ms(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static unsigned long long count_iterations(const unsigned char *image)
+{
+  unsigned long long sum = 0;
+  size_t number_of_pixels = (size_t) WIDTH * HEIGHT;
+
+  for (size_t i = 0; i < number_of_pixels; i++)
+  {
+    uint16_t iterations;
+    memcpy(&iterations, image + i * 2, 2);
+    sum += iterations;
+  }
+  return sum;
+}
+
+static int run_viewport(const struct fixed_viewport *v, int threads,
+                        int repetitions, unsigned char *image,
+                        struct benchmark_result *result)
+{
+  struct viewport view;
+  double sum = 0.0;
+  double sum_squares = 0.0;
+  double rate_sum = 0.0;
+  double rate_squares = 0.0;
+  double pixels = (double) WIDTH * HEIGHT;
+
+  memset(result, 0, sizeof(*result));
+  result->viewport = v->name;
+  result->threads = threads;
+  result->min_ms = INFINITY;
+
+  set_viewport(&view, v);
+  if (generate_iterations(image, &view) != 0)
+  {
+    return -1;
+  }
+  result->iterations = count_iterations(image);
+
+  for (int r = 0; r < repetitions; r++)
+  {
+    double start = now_ms();
+    if (generate_iterations(image, &view) != 0)
+    {
+      return -1;
+    }
+    double ms = now_ms() - start;
+    double rate = pixels / ms / 1000.0;
+
+    sum += ms;
+    sum_squares += ms * ms;
+    rate_sum += rate;
+    rate_squares += rate * rate;
+    if (ms < result->min_ms)
+    {
+      result->min_ms = ms;
+    }
+    if (ms > result->max_ms)
+    {
+      result->max_ms = ms;
+    }
+  }
+
+  result->mean_ms = sum / repetitions;
+  result->mpixel = pixels / result->mean_ms / 1000.0;
+  result->giter = result->iterations / result->mean_ms / 1000000.0;
+  if (repetitions > 1)
+  {
+    double variance = (sum_squares - sum * sum / repetitions) / (repetitions - 1);
+    double rate_variance = (rate_squares - rate_sum * rate_sum / repetitions) /
+                           (repetitions - 1);
+    result->stddev_ms = (variance > 0) ? sqrt(variance) : 0.0;
+    result->mpixel_stddev = (rate_variance > 0) ? sqrt(rate_variance) : 0.0;
+  }
+  return 0;
+}
+
+/*
+ * write_results() writes the results as JSON and as CSV, the CSV file
+ * starts with a header line, so files of several backends can be joined.
+ */
+
+static int write_results(const char *prefix, struct benchmark_result *results,
+                         int number_of_results, int repetitions)
+{
+  char path[MAX_PREFIX + 8];
+
+  snprintf(path, sizeof(path), "%s.json", prefix);
+  FILE *json = fopen(path, "w");
+  if (json == NULL)
+  {
+    perror(path);
+    return -1;
+  }
+  fprintf(json, "{\n  \"backend\": \"%s\",\n  \"width\": %d,\n  \"height\": %d,\n"
+          "  \"repetitions\": %d,\n  \"cpus\": %ld,\n  \"results\": [\n",
+          KERNEL_BACKEND, WIDTH, HEIGHT, repetitions, sysconf(_SC_NPROCESSORS_ONLN));
+  for (int i = 0; i < number_of_results; i++)
+  {
+    struct benchmark_result *r = &results[i];
+    fprintf(json, "    { \"viewport\": \"%s\", \"threads\": %d, \"iterations\": %llu, "
+            "\"mean_ms\": %.3f, \"stddev_ms\": %.3f, \"min_ms\": %.3f, "
+            "\"max_ms\": %.3f, \"mpixel_per_s\": %.3f, \"mpixel_per_s_stddev\": %.3f, "
+            "\"giter_per_s\": %.4f }%s\n",
+            r->viewport, r->threads, r->iterations, r->mean_ms, r->stddev_ms,
+            r->min_ms, r->max_ms, r->mpixel, r->mpixel_stddev, r->giter,
+            (i < number_of_results - 1) ? "," : "");
+  }
+  fprintf(json, "  ]\n}\n");
+  if (fclose(json) != 0)
+  {
+    perror(path);
+    return -1;
+  }
+
+  snprintf(path, sizeof(path), "%s.csv", prefix);
+  FILE *csv = fopen(path, "w");
+  if (csv == NULL)
+  {
+    perror(path);
+    return -1;
+  }
+  fprintf(csv, "backend,width,height,viewport,threads,repetitions,iterations,"
+          "mean_ms,stddev_ms,min_ms,max_ms,mpixel_per_s,mpixel_per_s_stddev,"
+          "giter_per_s\n");
+  for (int i = 0; i < number_of_results; i++)
+  {
+    struct benchmark_result *r = &results[i];
+    fprintf(csv, "%s,%d,%d,%s,%d,%d,%llu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.4f\n",
+            KERNEL_BACKEND, WIDTH, HEIGHT, r->viewport, r->threads, repetitions,
+            r->iterations, r->mean_ms, r->stddev_ms, r->min_ms, r->max_ms,
+            r->mpixel, r->mpixel_stddev, r->giter);
+  }
+  if (fclose(csv) != 0)
+  {
+    perror(path);
+    return -1;
+  }
+  printf("Results written to %s.json and %s.csv\n", prefix, prefix);
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  int repetitions = DEFAULT_REPETITIONS;
+  char prefix[MAX_PREFIX];
+  int threads[MAX_THREAD_COUNTS];
+  int number_of_thread_counts = 0;
+
+  if (argc > 1 && atoi(argv[1]) > 0)
+  {
+    repetitions = atoi(argv[1]);
+  }
+  if (argc > 2)
+  {
+    snprintf(prefix, sizeof(prefix), "%s", argv[2]);
+  }
+  else
+  {
+    snprintf(prefix, sizeof(prefix), "kernel-%s-%dx%d", KERNEL_BACKEND, WIDTH, HEIGHT);
+  }
+
+/*
+ * The OpenCL device decides itself how many work items run at once, it is
+ * listed with 0 threads. The other backends run with the numbers of threads
+ * given or 1, 2, 4, ... up to twice the number of cpus.
+ */
+
+  #if KERNEL_OPENCL
+
+  threads[number_of_thread_counts++] = 0;
+
+  #else
+
+  for (int a = 3; a < argc && number_of_thread_counts < MAX_THREAD_COUNTS; a++)
+  {
+    if (atoi(argv[a]) > 0)
+    {
+      threads[number_of_thread_counts++] = atoi(argv[a]);
+    }
+  }
+  if (number_of_thread_counts == 0)
+  {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    for (int t = 1; t <= 2 * cpus && number_of_thread_counts < MAX_THREAD_COUNTS;
+         t *= 2)
+    {
+      threads[number_of_thread_counts++] = t;
+    }
+  }
+
+  #endif
+
+  unsigned char *image = malloc(pixel_data_size(PIXEL_INDEX16));
+  struct benchmark_result *results = malloc(sizeof(struct benchmark_result) *
+                                            g_number_of_viewports *
+                                            number_of_thread_counts);
+  if (image == NULL || results == NULL)
+  {
+    perror("malloc");
+    return EXIT_FAILURE;
+  }
+
+  if (init_kernel() != 0)
+  {
+    return EXIT_FAILURE;
+  }
+
+  printf("%s backend, %dx%d pixels, %d repetitions\n", KERNEL_BACKEND, WIDTH,
+         HEIGHT, repetitions);
+  printf("%-10s %7s %10s %10s %10s %10s %12s %10s\n", "viewport", "threads",
+         "mean ms", "stddev ms", "min ms", "max ms", "Mpixel/s", "Giter/s");
+
+  int number_of_results = 0;
+
+  for (int v = 0; v < g_number_of_viewports; v++)
+  {
+    for (int t = 0; t < number_of_thread_counts; t++)
+    {
+      if (set_kernel_threads(threads[t]) == -1)
+      {
+        printf("%-10s %7d not possible with this backend\n",
+               g_viewports[v].name, threads[t]);
+        continue;
+      }
+
+      struct benchmark_result *r = &results[number_of_results];
+      if (run_viewport(&g_viewports[v], threads[t], repetitions, image, r) != 0)
+      {
+        printf("Error generating image data\n");
+        return EXIT_FAILURE;
+      }
+      number_of_results++;
+
+      printf("%-10s %7d %10.2f %10.2f %10.2f %10.2f %7.2f+-%-4.2f %10.3f\n",
+             r->viewport, r->threads, r->mean_ms, r->stddev_ms, r->min_ms,
+             r->max_ms, r->mpixel, r->mpixel_stddev, r->giter);
+    }
+  }
+
+  int rv = write_results(prefix, results, number_of_results, repetitions);
+
+  free(results);
+  free(image);
+  return (rv == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,251 @@
+/*
+ * FILE = /src/kernelCheck.c
+ *
+ * Compares the images of one image generator (kernel backend, see kernel.h)
+ * with a plain scalar reference, so a faster kernel can not change the image
+ * unnoticed. The makefile builds this file once for every backend.
+ *
+ * usage: ./kernelCheck-<backend>.out [output prefix]
+ *
+ * Every viewport (see kernel.c) is generated by the backend and by
+ * reference_iterations(), the loop from
+ * https://en.wikipedia.org/wiki/Mandelbrot_set without cardioid and bulb
+ * checking. Both give the number of iterations of every pixel, which are
+ * compared with these rules:
+ *
+ *   exact     the same number of iterations
+ *   near      both pixels escape, at most CHECK_TOLERANCE iterations apart.
+ *             Rounding differently (-ffast-math, the order of the SIMD
+ *             operations) moves the escape by an iteration or two.
+ *   mismatch  everything else, especially one pixel escaping and the other
+ *             not
+ *
+ * A viewport passes with at most CHECK_MAX_MISMATCH mismatches per million
+ * pixels, for pixels so close to the boundary that any rounding changes
+ * them. The program returns EXIT_FAILURE if a viewport fails.
+ *
+ * Viewports with differences get a mismatch map <output prefix>-<viewport>.ppm
+ * (default prefix: check-<backend>). It shows the reference image in dark
+ * gray, near pixels yellow, mismatches with more iterations than the
+ * reference red and with less blue.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "numberOfPixel.h"
+#include "pixelFormat.h"
+#include "viewCommand.h"
+#include "kernel.h"
+
+#define CHECK_TOLERANCE 2
+#define CHECK_MAX_MISMATCH 100     // per million pixels
+#define MAX_PREFIX 256
+
+struct check_result
+{
+  size_t exact;
+  size_t near;
+  size_t mismatch;
+  int max_difference;
+  int first_x;                     // first mismatch, -1 if there is none
+  int first_y;
+};
+
+static int reference_iterations(const struct viewport *view, int pixel_x,
+                                int pixel_y)
+{
+  double xp = (view->xmax - view->xmin) / WIDTH;
+  double yp = (view->ymax - view->ymin) / HEIGHT;
+  double x0 = (view->xmin + pixel_x * xp) / view->zoom;
+  double y0 = (view->ymax - pixel_y * yp) / view->zoom;
+  double x = 0.0;
+  double y = 0.0;
+  int iteration = 0;
+
+  while (x * x + y * y < 4 && iteration < MAX_ITERATION)
+  {
+    double xtemp = x * x - y * y + x0;
+    y = 2 * x * y + y0;
+    x = xtemp;
+    iteration++;
+  }
+  return iteration;
+}
+
+static void generate_reference(uint16_t *reference, const struct viewport *view)
+{
+  for (int y = 0; y < HEIGHT; y++)
+  {
+    for (int x = 0; x < WIDTH; x++)
+    {
+      reference[(size_t) y * WIDTH + x] = reference_iterations(view, x, y);
+    }
+  }
+}
+
+/*
+ * compare() fills result and the mismatch map (3 bytes per pixel).
+ */
+
+static void compare(const uint16_t *reference, const unsigned char *image,
+                    unsigned char *map, struct check_result *result)
+{
+  memset(result, 0, sizeof(*result));
+  result->first_x = -1;
+  result->first_y = -1;
+
+  for (size_t i = 0; i < (size_t) WIDTH * HEIGHT; i++)
+  {
+    uint16_t iterations;
+    memcpy(&iterations, image + i * 2, 2);
+    int difference = iterations - reference[i];
+    int distance = (difference < 0) ? -difference : difference;
+    unsigned char *rgb = map + i * 3;
+
+    if (distance > result->max_difference)
+    {
+      result->max_difference = distance;
+    }
+
+    if (difference == 0)
+    {
+      result->exact++;
+      rgb[0] = rgb[1] = rgb[2] = 32 + reference[i] * 64 / MAX_ITERATION;
+    }
+    else if (distance <= CHECK_TOLERANCE && iterations < MAX_ITERATION &&
+             reference[i] < MAX_ITERATION)
+    {
+      result->near++;
+      rgb[0] = 255;
+      rgb[1] = 255;
+      rgb[2] = 0;
+    }
+    else
+    {
+      if (result->mismatch == 0)
+      {
+        result->first_x = i % WIDTH;
+        result->first_y = i / WIDTH;
+      }
+      result->mismatch++;
+      rgb[0] = (difference > 0) ? 255 : 0;
+      rgb[1] = 0;
+      rgb[2] = (difference > 0) ? 0 : 255;
+    }
+  }
+}
+
+static int write_map(const char *path, const unsigned char *map)
+{
+  FILE *file = fopen(path, "wb");
+  if (file == NULL)
+  {
+    perror(path);
+    return -1;
+  }
+  fprintf(file, "P6\n%d %d\n255\n", WIDTH, HEIGHT);
+  if (fwrite(map, 3, (size_t) WIDTH * HEIGHT, file) != (size_t) WIDTH * HEIGHT)
+  {
+    perror(path);
+    fclose(file);
+    return -1;
+  }
+  if (fclose(file) != 0)
+  {
+    perror(path);
+    return -1;
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  char prefix[MAX_PREFIX];
+  int failed = 0;
+
+  if (argc > 1)
+  {
+    snprintf(prefix, sizeof(prefix), "%s", argv[1]);
+  }
+  else
+  {
+    snprintf(prefix, sizeof(prefix), "check-%s", KERNEL_BACKEND);
+  }
+
+  unsigned char *image = malloc(pixel_data_size(PIXEL_INDEX16));
+  uint16_t *reference = malloc((size_t) WIDTH * HEIGHT * sizeof(uint16_t));
+  unsigned char *map = malloc((size_t) WIDTH * HEIGHT * 3);
+  if (image == NULL || reference == NULL || map == NULL)
+  {
+    perror("malloc");
+    return EXIT_FAILURE;
+  }
+
+  if (init_kernel() != 0)
+  {
+    return EXIT_FAILURE;
+  }
+
+  printf("%s backend against the scalar reference, %dx%d pixels\n",
+         KERNEL_BACKEND, WIDTH, HEIGHT);
+  printf("%-10s %10s %10s %10s %8s  %s\n", "viewport", "exact", "near",
+         "mismatch", "max diff", "first mismatch");
+
+  for (int v = 0; v < g_number_of_viewports; v++)
+  {
+    struct viewport view;
+    struct check_result result;
+
+    set_viewport(&view, &g_viewports[v]);
+    if (generate_iterations(image, &view) != 0)
+    {
+      printf("Error generating image data\n");
+      return EXIT_FAILURE;
+    }
+    generate_reference(reference, &view);
+    compare(reference, image, map, &result);
+
+    int pass = result.mismatch * 1000000 <=
+               (size_t) CHECK_MAX_MISMATCH * WIDTH * HEIGHT;
+    if (!pass)
+    {
+      failed = 1;
+    }
+
+    printf("%-10s %10zu %10zu %10zu %8d  ", g_viewports[v].name, result.exact,
+           result.near, result.mismatch, result.max_difference);
+    if (result.mismatch > 0)
+    {
+      size_t i = (size_t) result.first_y * WIDTH + result.first_x;
+      uint16_t iterations;
+      memcpy(&iterations, image + i * 2, 2);
+      printf("%d,%d: %d instead of %d ", result.first_x, result.first_y,
+             iterations, reference[i]);
+    }
+    printf("%s\n", pass ? "PASS" : "FAIL");
+
+    if (result.exact < (size_t) WIDTH * HEIGHT)
+    {
+      char path[MAX_PREFIX + 32];
+      snprintf(path, sizeof(path), "%s-%s.ppm", prefix, g_viewports[v].name);
+      if (write_map(path, map) != 0)
+      {
+        return EXIT_FAILURE;
+      }
+      printf("%-10s mismatch map written to %s\n", "", path);
+    }
+  }
+
+  free(map);
+  free(reference);
+  free(image);
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,227 @@
+/*
+ * FILE = /src/kernelTune.c
+ *
+ * The kernel autotuner: measures the generate_image() function of one image
+ * generator (kernel backend, see kernel.h) with every setting of the search
+ * space and writes the fastest to the tuning file of the host (see tuning.h),
+ * which the pixelGenerator of the backend loads at startup. The makefile
+ * builds this file once for every backend and image size (see README.md).
+ *
+ * usage: ./kernelTune-<backend>.out [repetitions]
+ *
+ * The search space of the backends on the cpu is every tile size of
+ * g_tile_sizes with 1, 2, 4, ... up to twice the number of cpus threads,
+ * the one of OpenCL every work group size of g_local_sizes the image can be
+ * split into. The defaults of the backend are measured first, so the gain of
+ * the tuning is known.
+ *
+ * Every setting generates every viewport (see kernel.c) once to warm up and
+ * then repetitions times. The minimum time of the viewports is taken, their
+ * sum rates the setting: the viewports are the mix of cheap and expensive
+ * images a zoom goes through.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "numberOfPixel.h"
+#include "pixelFormat.h"
+#include "viewCommand.h"
+#include "tiles.h"
+#include "tuning.h"
+#include "kernel.h"
+
+#define DEFAULT_REPETITIONS 3
+#define MAX_SETTINGS 128
+
+#if KERNEL_OPENCL
+static const int g_local_sizes[][2] =
+{
+  { 32, 1 }, { 64, 1 }, { 128, 1 }, { 256, 1 },
+  { 8, 8 }, { 16, 8 }, { 16, 16 }, { 32, 8 },
+};
+#else
+static const int g_tile_sizes[] = { 8, 16, 32, 64, 128 };
+#endif
+
+static double now_ms(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/*
+ * search_space() writes the settings to measure into settings, the defaults
+ * first, and returns their number.
+ */
+
+static int search_space(struct tuning *settings)
+{
+  int number_of_settings = 0;
+
+  default_tuning(&settings[number_of_settings++]);
+
+  #if KERNEL_OPENCL
+
+  for (int l = 0; l < sizeof(g_local_sizes) / sizeof(g_local_sizes[0]); l++)
+  {
+    int local_x = g_local_sizes[l][0];
+    int local_y = g_local_sizes[l][1];
+
+    if (WIDTH % local_x == 0 && HEIGHT % local_y == 0)
+    {
+      struct tuning *s = &settings[number_of_settings++];
+      default_tuning(s);
+      s->local_x = local_x;
+      s->local_y = local_y;
+    }
+  }
+
+  #else
+
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+  for (int i = 0; i < sizeof(g_tile_sizes) / sizeof(g_tile_sizes[0]); i++)
+  {
+    for (int t = 1; t <= 2 * cpus && number_of_settings < MAX_SETTINGS;
+         t *= 2)
+    {
+      struct tuning *s = &settings[number_of_settings++];
+      default_tuning(s);
+      s->tile_size = g_tile_sizes[i];
+      s->threads = t;
+    }
+  }
+
+  #endif
+
+  return number_of_settings;
+}
+
+/*
+ * measure() returns the sum of the minimum times of all viewports in ms,
+ * -1 on error.
+ */
+
+static double measure(int repetitions, unsigned char *image)
+{
+  double sum = 0.0;
+
+  for (int v = 0; v < g_number_of_viewports; v++)
+  {
+    struct viewport view;
+    double min_ms = 0.0;
+
+    set_viewport(&view, &g_viewports[v]);
+    for (int r = 0; r <= repetitions; r++)
+    {
+      double start = now_ms();
+      if (generate_iterations(image, &view) != 0)
+      {
+        return -1;
+      }
+      double ms = now_ms() - start;
+
+      // run 0 warms up caches and threads
+      if (r == 1 || (r > 1 && ms < min_ms))
+      {
+        min_ms = ms;
+      }
+    }
+    printf(" %10.2f", min_ms);
+    sum += min_ms;
+  }
+  return sum;
+}
+
+int main(int argc, char *argv[])
+{
+  int repetitions = DEFAULT_REPETITIONS;
+  struct tuning settings[MAX_SETTINGS];
+
+  if (argc > 1 && atoi(argv[1]) > 0)
+  {
+    repetitions = atoi(argv[1]);
+  }
+
+  unsigned char *image = malloc(pixel_data_size(PIXEL_INDEX16));
+  if (image == NULL)
+  {
+    perror("malloc");
+    return EXIT_FAILURE;
+  }
+
+  if (init_kernel() != 0)
+  {
+    return EXIT_FAILURE;
+  }
+
+  int number_of_settings = search_space(settings);
+  int best = -1;
+  double best_ms = 0.0;
+  double default_ms = 0.0;
+
+  printf("Tuning the %s backend, %dx%d pixels, %d repetitions\n",
+         KERNEL_BACKEND, WIDTH, HEIGHT, repetitions);
+  printf("%5s %7s %9s", "tile", "threads", "group");
+  for (int v = 0; v < g_number_of_viewports; v++)
+  {
+    printf(" %10s", g_viewports[v].name);
+  }
+  printf(" %10s\n", "sum ms");
+
+  for (int s = 0; s < number_of_settings; s++)
+  {
+    struct tuning *t = &settings[s];
+    char group[16];
+
+    snprintf(group, sizeof(group), "%dx%d", t->local_x, t->local_y);
+    printf("%5d %7d %9s", t->tile_size, t->threads, group);
+    if (set_kernel_tuning(t) != 0)
+    {
+      printf(" not possible with this backend\n");
+      continue;
+    }
+
+    double ms = measure(repetitions, image);
+    if (ms < 0)
+    {
+      printf("\nError generating image data\n");
+      free(image);
+      return EXIT_FAILURE;
+    }
+    printf(" %10.2f\n", ms);
+
+    if (s == 0)
+    {
+      default_ms = ms;
+    }
+    if (best == -1 || ms < best_ms)
+    {
+      best = s;
+      best_ms = ms;
+    }
+  }
+  free(image);
+
+  if (best == -1)
+  {
+    printf("Error: No setting is possible with this backend\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("Fastest:");
+  print_tuning(&settings[best]);
+  printf("%.2f ms, %.2fx the defaults\n", best_ms, default_ms / best_ms);
+
+  return (save_tuning(KERNEL_BACKEND, &settings[best]) == 0) ? EXIT_SUCCESS :
+         EXIT_FAILURE;
+}
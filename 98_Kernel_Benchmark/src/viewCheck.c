@@ -0,0 +1,84 @@
+/*
+ * FILE = /src/viewCheck.c
+ *
+ * Checks apply_view_command() (see viewCommand.h) of the shared sources, the
+ * same for every image generator: a command changes the section and its
+ * bookkeeping, but never what the pixelGenerator has set up itself.
+ *
+ * usage: ./viewCheck.out
+ *
+ * Every check prints one line, the program returns EXIT_FAILURE if one
+ * fails.
+ *
+ * Copyright (c) 2017 Bernhard Lindner
+ *
+ * This file is licensed under the terms of the MIT License.
+ * See /LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "viewCommand.h"
+
+static int g_failed = 0;
+
+static void check(const char *name, int passed)
+{
+  printf("%-48s %s\n", name, passed ? "ok" : "FAILED");
+  if (!passed)
+  {
+    g_failed = 1;
+  }
+}
+
+static int same_section(const struct viewport *a, const struct viewport *b)
+{
+  return a->xmin == b->xmin && a->xmax == b->xmax && a->ymin == b->ymin &&
+         a->ymax == b->ymax && a->zoom == b->zoom && a->e == b->e;
+}
+
+int main(void)
+{
+  struct viewport start;
+  struct viewport view;
+  struct view_command command;
+
+  init_viewport(&start);
+  init_viewport(&view);
+  check("init_viewport() is not cancellable", view.cancellable == 0);
+
+/*
+ * The pixelGenerator sets cancellable once after init_viewport().
+ */
+
+  view.cancellable = 1;
+
+  memset(&command, 0, sizeof(command));
+  command.type = VIEW_PAN;
+  command.x = 10;
+  command.y = -5;
+  command.sent = 100;
+  apply_view_command(&view, &command);
+  check("VIEW_PAN moves the section", !same_section(&view, &start));
+  check("VIEW_PAN ends the automatic zoom", view.automatic == 0);
+
+  command.type = VIEW_AUTO;
+  command.sent = 200;
+  apply_view_command(&view, &command);
+  check("VIEW_AUTO restores the start section", same_section(&view, &start));
+  check("VIEW_AUTO restarts the automatic zoom", view.automatic == 1);
+  check("VIEW_AUTO keeps cancellable", view.cancellable == 1);
+  check("VIEW_AUTO counts the commands", view.commands == 2);
+  check("VIEW_AUTO keeps the oldest input_time", view.input_time == 100);
+
+  command.type = VIEW_ZOOM;
+  command.factor = 0.5;
+  command.sent = 300;
+  apply_view_command(&view, &command);
+  check("VIEW_ZOOM after VIEW_AUTO keeps cancellable", view.cancellable == 1);
+  check("VIEW_ZOOM ends the automatic zoom", view.automatic == 0);
+
+  return g_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
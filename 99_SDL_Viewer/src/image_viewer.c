@@ -4,6 +4,27 @@
  * A program that continuously shows images generated by the pixelGenerator
  * using libSDL
  *
+ * An ingest thread claims the images, copies them into local buffers and
+ * releases the slot of the shared memory segment right away, so the
+ * pixelGenerator never waits for the display. The main thread handles the
+ * window events and shows the newest image once per display refresh in one
+ * streaming texture. Images arriving faster than the display refreshes are
+ * dropped, the window title shows how many.
+ *
+ * Dragging with the left mouse button moves the image, the mouse wheel zooms
+ * and the space key restarts the automatic zoom. The changes are sent to the
+ * pixelGenerator once per display refresh (see viewCommand.h), the time from
+ * the input to the image showing it is printed as input-to-photon latency.
+ *
+ * Until the pixelGenerator has generated the requested section, the display
+ * thread predicts it by resampling the last image (see preview.h), so input
+ * shows with the next display refresh. Partial images (see sharedSegment.h)
+ * replace the prediction tile by tile. The p key turns the prediction off and
+ * on again.
+ *
+ * Without a display the viewer runs with the SDL dummy video driver:
+ *   SDL_VIDEODRIVER=dummy ./image_viewer 100
+ *
  * 05/2016 Bernhard Lindner
  * 11/2016, 01/2017 Christian Fibich
  */
@@ -17,30 +38,143 @@
 #include <sys/sem.h>
 #include <signal.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <SDL.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#define VIEWER_SIMD 1
+#include <tmmintrin.h>
+#else
+#define VIEWER_SIMD 0
+#endif
+
 #include "numberOfPixel.h"
+#include "sharedSegment.h"
 #include "generateKey.h"
+#include "preview.h"
 
 /* SHM/SEM globals */
 int g_shmid;
 int g_semid;
+int g_slot = -1;
 unsigned char *g_buffer;
 unsigned char *g_membuf;
 
 /* SDL globals */
 
-SDL_Surface *g_surface = NULL,*g_screen = NULL;
 SDL_Window *g_window = NULL;
+SDL_Renderer *g_renderer = NULL;
+SDL_Texture *g_texture = NULL;
+
+/* print the statistics every STATS_INTERVAL images shown */
+#define STATS_INTERVAL 100
+
+/* refresh rate if the display does not tell */
+#define DEFAULT_REFRESH_RATE 60
+
+/* zoom factor per step of the mouse wheel */
+#define ZOOM_STEP 1.25
+
+/* number of commands sent that are kept to predict the sections requested */
+#define SENT_HISTORY 256
+
+/*
+ * Images handed from the ingest thread to the display thread (triple
+ * buffering). The ingest thread writes into back and swaps it with ready,
+ * the display thread swaps ready with front if fresh is set. If the display
+ * thread has not taken the image in ready yet it is dropped.
+ */
+#define NUMBER_OF_BUFFERS 3
+
+struct exchange {
+    pthread_mutex_t lock;
+    int back;
+    int ready;
+    int front;
+    int fresh;
+    unsigned long framenumber[NUMBER_OF_BUFFERS];
+    long long input_time[NUMBER_OF_BUFFERS];
+    unsigned long commands_applied[NUMBER_OF_BUFFERS];
+    int tiles_done[NUMBER_OF_BUFFERS];
+    int tile_size[NUMBER_OF_BUFFERS];
+    int partial[NUMBER_OF_BUFFERS];
+    unsigned long ingested;
+    unsigned long dropped;
+    Uint64 held;        /* time the slots were held, performance counter */
+    int done;           /* the ingest thread has terminated */
+    int status;         /* exit status of the ingest thread */
+};
+
+static struct exchange g_exchange = {
+    .lock = PTHREAD_MUTEX_INITIALIZER, .back = 0, .ready = 1, .front = 2
+};
+static unsigned long g_number_of_images = 0;
+static volatile sig_atomic_t g_quit = 0;
+static pthread_t g_ingest;
+
+/*
+ * Input not yet sent to the pixelGenerator, collected between two display
+ * refreshes. input_time is the view_clock() time of the first input.
+ */
+struct pending_input {
+    double pan_x;
+    double pan_y;
+    double zoom;
+    double zoom_x;
+    double zoom_y;
+    int restart;
+    long long input_time;
+    long long preview_time;     /* first input not shown by a prediction */
+};
+
+static struct pending_input g_input = { .zoom = 1.0 };
+
+/* input-to-photon latency, only used by the display thread */
+struct latency {
+    unsigned long count;
+    double sum;         /* milliseconds */
+    double max;
+};
+
+static struct latency g_latency;
+static struct latency g_preview_latency;
+
+/*
+ * Commands sent to the pixelGenerator, command i of the queue is
+ * g_sent[i % SENT_HISTORY]. Commands sent before g_first_sent (by another
+ * consumer) are unknown. Only used by the display thread.
+ */
+static struct view_command g_sent[SENT_HISTORY];
+static unsigned long g_first_sent;
+
+/* the last image received and the prediction made from it */
+static uint32_t *g_base = NULL;
+static uint32_t *g_preview = NULL;
+static int g_predict = 1;
     
 /* free buffers */
 static void cleanup(void)
 {
-    SDL_FreeSurface(g_surface);
-    g_surface = NULL;
+    if (g_texture != NULL) SDL_DestroyTexture(g_texture);
+    g_texture = NULL;
+
+    if (g_renderer != NULL) SDL_DestroyRenderer(g_renderer);
+    g_renderer = NULL;
     
     free(g_buffer);
     g_buffer = NULL;
+    free(g_base);
+    g_base = NULL;
+    free(g_preview);
+    g_preview = NULL;
+
+    /* hand a claimed slot back, the pixelGenerator would wait for it forever */
+    if (g_slot != -1) {
+        if (release_slot(g_semid, g_slot) < 0) {
+            perror("semop");
+        }
+        g_slot = -1;
+    }
 
     if (g_membuf != NULL) {
         if (shmdt(g_membuf) < 0) {
@@ -54,28 +188,361 @@ static void cleanup(void)
     SDL_Quit();
 }
 
+#if VIEWER_SIMD
+/*
+ * 4 RGB24 pixels (12 of the 16 bytes loaded) per step, pshufb moves R, G and
+ * B of every pixel into place and zeroes the X byte. Reads 16 bytes, so the
+ * last pixels of a row are left to the scalar loop.
+ */
+__attribute__((target("ssse3")))
+static int rgb24_row_ssse3(uint32_t *row, const unsigned char *rgb)
+{
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1,
+                                          8, 7, 6, -1, 11, 10, 9, -1);
+    int x = 0;
+
+    for (; x + 6 <= WIDTH; x += 4) {
+        __m128i in = _mm_loadu_si128((const __m128i *) &rgb[x*3]);
+        _mm_storeu_si128((__m128i *) &row[x], _mm_shuffle_epi8(in, shuffle));
+    }
+    return x;
+}
+#endif
+
+/*
+ * copy an image into a texture row by row (pitch in bytes). Images that are
+ * not PIXEL_XRGB8888 have been generated for another consumer (ImageWriter)
+ * or before our request has been seen by the pixelGenerator.
+ */
+static void to_xrgb8888(unsigned char *texture, int pitch, unsigned char *pixels,
+                        int format, unsigned char palette[][3])
+{
+#if VIEWER_SIMD
+    int simd = __builtin_cpu_supports("ssse3");
+#endif
+
+    for (int y = 0; y < HEIGHT; y++) {
+        uint32_t *row = (uint32_t *) (texture + (size_t) y * pitch);
+        int x = 0;
+
+        if (format == PIXEL_XRGB8888) {
+            memcpy(row, &pixels[(size_t) y * WIDTH * 4], WIDTH * 4);
+            continue;
+        }
+
+        if (format == PIXEL_INDEX16) {
+            const unsigned char *index = &pixels[(size_t) y * WIDTH * 2];
+            for (; x < WIDTH; x++) {
+                uint16_t i;
+                memcpy(&i, &index[x*2], 2);
+                unsigned char *rgb = palette[i < PALETTE_SIZE ? i : PALETTE_SIZE - 1];
+                row[x] = (rgb[0] << 16) | (rgb[1] << 8) | (rgb[2]);
+            }
+            continue;
+        }
+
+        const unsigned char *rgb = &pixels[(size_t) y * WIDTH * 3];
+#if VIEWER_SIMD
+        if (simd) {
+            x = rgb24_row_ssse3(row, rgb);
+        }
+#endif
+        for (; x < WIDTH; x++) {
+            row[x] = (rgb[x*3] << 16) | (rgb[x*3+1] << 8) | (rgb[x*3+2]);
+        }
+    }
+}
+
+/*
+ * SIGINT ends both threads, SIGUSR1 is sent to the ingest thread to
+ * interrupt a semop() waiting for the next image.
+ */
 static void sigint_handler(int signum)
 {
     (void)signum;
-    cleanup();
-    exit(EXIT_SUCCESS);
+    g_quit = 1;
+}
+
+static unsigned char *image_buffer(int buffer)
+{
+    return g_buffer + (size_t) buffer * WIDTH * HEIGHT * 4;
+}
+
+static int semaphore_error(const char *function)
+{
+    if (errno == EIDRM) {
+        printf("\nSemaphore has been removed\n");
+        printf("Check if the pixelGenerator program has terminated\n\n");
+        return EXIT_SUCCESS;
+    }
+    fprintf(stderr,"%s(): %s\n", function, strerror(errno));
+    return EXIT_FAILURE;
+}
+
+static void *ingest_thread(void *arg)
+{
+    (void)arg;
+    int rv = EXIT_SUCCESS;
+
+    while (!g_quit && (g_number_of_images == 0 ||
+                       g_exchange.ingested < g_number_of_images)) {
+
+        /*
+         * claim the oldest unclaimed image, the pixelGenerator does not write
+         * to its slot until the slot is released again.
+         */
+
+        if (claim_frame(g_semid, g_membuf, &g_slot) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            rv = semaphore_error("semop");
+            break;
+        }
+        Uint64 claimed = SDL_GetPerformanceCounter();
+
+        /*
+         * Read from shared memory into the local buffer, only this thread
+         * uses the back buffer.
+         */
+
+        to_xrgb8888(image_buffer(g_exchange.back), WIDTH * 4,
+                    slot_data(g_membuf, g_slot),
+                    slot_header(g_membuf, g_slot)->pixel_format,
+                    segment_header(g_membuf)->palette);
+        unsigned long imagenumber = slot_header(g_membuf, g_slot)->framenumber;
+        long long input_time = slot_header(g_membuf, g_slot)->input_time;
+        unsigned long commands_applied = slot_header(g_membuf, g_slot)->commands_applied;
+        int tiles_done = slot_header(g_membuf, g_slot)->tiles_done;
+        int tile_size = slot_header(g_membuf, g_slot)->tile_size;
+        int partial = slot_header(g_membuf, g_slot)->partial;
+
+        /*
+         * Release the slot to allow the pixelGenerator to write to it again.
+         */
+        int slot = g_slot;
+        g_slot = -1;
+
+        if (release_slot(g_semid, slot) == -1) {
+            rv = semaphore_error("semop");
+            break;
+        }
+        Uint64 held = SDL_GetPerformanceCounter() - claimed;
+
+        /*
+         * hand the image to the display thread
+         */
+        pthread_mutex_lock(&g_exchange.lock);
+        int ready = g_exchange.ready;
+        g_exchange.ready = g_exchange.back;
+        g_exchange.back = ready;
+        g_exchange.framenumber[g_exchange.ready] = imagenumber;
+        if (g_exchange.fresh) {
+            g_exchange.dropped++;
+            /* the input shown first by the dropped image is shown by this one */
+            long long dropped_input = g_exchange.input_time[ready];
+            if (dropped_input != 0 && (input_time == 0 || dropped_input < input_time)) {
+                input_time = dropped_input;
+            }
+        }
+        g_exchange.input_time[g_exchange.ready] = input_time;
+        g_exchange.commands_applied[g_exchange.ready] = commands_applied;
+        g_exchange.tiles_done[g_exchange.ready] = tiles_done;
+        g_exchange.tile_size[g_exchange.ready] = tile_size;
+        g_exchange.partial[g_exchange.ready] = partial;
+        g_exchange.fresh = 1;
+        g_exchange.ingested++;
+        g_exchange.held += held;
+        pthread_mutex_unlock(&g_exchange.lock);
+    }
+
+    pthread_mutex_lock(&g_exchange.lock);
+    g_exchange.done = 1;
+    g_exchange.status = rv;
+    pthread_mutex_unlock(&g_exchange.lock);
+    return NULL;
+}
+
+/* collect mouse and keyboard input, window coordinates to image pixels */
+static void handle_input(SDL_Event *e)
+{
+    int w, h;
+    SDL_GetWindowSize(g_window, &w, &h);
+    if (w <= 0 || h <= 0) {
+        return;
+    }
+    double sx = (double) WIDTH / w;
+    double sy = (double) HEIGHT / h;
+
+    if (e->type == SDL_MOUSEMOTION && (e->motion.state & SDL_BUTTON_LMASK)) {
+        g_input.pan_x += e->motion.xrel * sx;
+        g_input.pan_y += e->motion.yrel * sy;
+    } else if (e->type == SDL_MOUSEWHEEL && e->wheel.y != 0) {
+        int x, y;
+        SDL_GetMouseState(&x, &y);
+        for (int i = 0; i < abs(e->wheel.y); i++) {
+            g_input.zoom *= (e->wheel.y > 0) ? ZOOM_STEP : 1.0 / ZOOM_STEP;
+        }
+        g_input.zoom_x = x * sx;
+        g_input.zoom_y = y * sy;
+    } else if (e->type == SDL_KEYDOWN && e->key.keysym.sym == SDLK_SPACE) {
+        g_input.restart = 1;
+    } else {
+        if (e->type == SDL_KEYDOWN && e->key.keysym.sym == SDLK_p) {
+            g_predict = !g_predict;
+            printf("Prediction %s.\n", g_predict ? "on" : "off");
+        }
+        return;
+    }
+
+    if (g_input.input_time == 0) {
+        g_input.input_time = view_clock();
+    }
+    if (g_input.preview_time == 0) {
+        g_input.preview_time = g_input.input_time;
+    }
+}
+
+/* send a command and keep it for the prediction */
+static int send_command(struct view_command *command)
+{
+    unsigned long index = segment_header(g_membuf)->commands.head;
+
+    if (send_view_command(g_membuf, command) == -1) {
+        return -1;
+    }
+    g_sent[index % SENT_HISTORY] = *command;
+    return 0;
+}
+
+/*
+ * Send the collected input as view_commands. Input which does not fit into
+ * the queue stays pending until the next refresh.
+ */
+static void send_input(void)
+{
+    struct view_command command = { .sent = g_input.input_time };
+
+    if (g_input.restart) {
+        command.type = VIEW_AUTO;
+        if (send_command(&command) == -1) {
+            return;
+        }
+        g_input.restart = 0;
+    }
+    if (g_input.pan_x != 0 || g_input.pan_y != 0) {
+        command.type = VIEW_PAN;
+        command.x = g_input.pan_x;
+        command.y = g_input.pan_y;
+        if (send_command(&command) == -1) {
+            return;
+        }
+        g_input.pan_x = 0;
+        g_input.pan_y = 0;
+    }
+    if (g_input.zoom != 1.0) {
+        command.type = VIEW_ZOOM;
+        command.x = g_input.zoom_x;
+        command.y = g_input.zoom_y;
+        command.factor = g_input.zoom;
+        if (send_command(&command) == -1) {
+            return;
+        }
+        g_input.zoom = 1.0;
+    }
+    g_input.input_time = 0;
+}
+
+/*
+ * The prediction of the section showing commands from to to - 1, relative to
+ * an image showing the commands before from.
+ */
+static void sent_transform(struct view_transform *t, unsigned long from, unsigned long to)
+{
+    identity_transform(t);
+    if (from < g_first_sent || to < from || to - from > SENT_HISTORY) {
+        t->valid = 0;
+        return;
+    }
+    for (unsigned long i = from; i < to && t->valid; i++) {
+        add_view_command(t, &g_sent[i % SENT_HISTORY]);
+    }
+}
+
+/* input not sent yet is part of the prediction as well */
+static void add_pending_input(struct view_transform *t)
+{
+    struct view_command command = { .type = VIEW_PAN };
+
+    if (g_input.restart) {
+        t->valid = 0;
+        return;
+    }
+    if (g_input.pan_x != 0 || g_input.pan_y != 0) {
+        command.x = g_input.pan_x;
+        command.y = g_input.pan_y;
+        add_view_command(t, &command);
+    }
+    if (g_input.zoom != 1.0) {
+        command.type = VIEW_ZOOM;
+        command.x = g_input.zoom_x;
+        command.y = g_input.zoom_y;
+        command.factor = g_input.zoom;
+        add_view_command(t, &command);
+    }
+}
+
+static void add_latency(struct latency *l, long long input_time)
+{
+    double ms = (view_clock() - input_time) / 1e6;
+
+    l->count++;
+    l->sum += ms;
+    if (ms > l->max) {
+        l->max = ms;
+    }
+}
+
+static void print_stats(unsigned long imagenumber, unsigned long shown)
+{
+    pthread_mutex_lock(&g_exchange.lock);
+    unsigned long ingested = g_exchange.ingested;
+    unsigned long dropped = g_exchange.dropped;
+    Uint64 held = g_exchange.held;
+    pthread_mutex_unlock(&g_exchange.lock);
+
+    printf("Displaying image %lu, %lu shown, %lu dropped, slot held for "
+           "%.3f ms per image.\n", imagenumber, shown, dropped,
+           ingested ? 1000.0 * held / SDL_GetPerformanceFrequency() / ingested : 0.0);
+    if (g_latency.count > 0) {
+        printf("Input-to-photon latency %.1f ms average, %.1f ms max "
+               "(%lu inputs).\n", g_latency.sum / g_latency.count,
+               g_latency.max, g_latency.count);
+    }
+    if (g_preview_latency.count > 0) {
+        printf("Input-to-prediction latency %.1f ms average, %.1f ms max "
+               "(%lu inputs).\n", g_preview_latency.sum / g_preview_latency.count,
+               g_preview_latency.max, g_preview_latency.count);
+    }
 }
 
 int main(int argc, char *argv[])
 {
     if (argc > 1) {
-        printf("Usage: %s\n",argv[0]);
         if ((strncmp(argv[1], "help", 4) == 0) || (strncmp(argv[1], "-h", 2) == 0)) {
+            printf("Usage: %s [number of images]\n",argv[0]);
             printf("\nThis program reads image data (RGB pixels) out of an shared\n"
-                   "memory segment and writes pictures into p6 .ppm file.\n"
+                   "memory segment and shows the pictures in a window.\n"
                    "This program depends on the pixelGenerator program generating\n"
                    "image data and writing it into a shared memory segment\n"
-                   "\nThis program does not take any cmdline arguments.\n\n");
+                   "\nWith a number of images the program terminates after showing\n"
+                   "them (e.g. with SDL_VIDEODRIVER=dummy).\n\n");
             exit(EXIT_SUCCESS);
-        } else {
-            fprintf(stderr,"\nThis program does not take any cmdline arguments.\n\n");
+        } else if (argc > 2 || atol(argv[1]) <= 0) {
+            fprintf(stderr,"Usage: %s [number of images]\n",argv[0]);
             exit(EXIT_FAILURE);
         }
+        g_number_of_images = atol(argv[1]);
     }
 
     /*
@@ -83,13 +550,6 @@ int main(int argc, char *argv[])
      */
     SDL_Event e;
 
-    Uint32 rmask, gmask, bmask, amask;
-
-    rmask = 0x00ff0000;
-    gmask = 0x0000ff00;
-    bmask = 0x000000ff;
-    amask = 0x00000000;
-
     /* FIXME: Valgrind says some of the memory allocated here (through X11)
      *        is leaked when leaving via SIGINT or by closing the window
      *        Our bug? SDL bug? X11 bug?
@@ -106,7 +566,7 @@ int main(int argc, char *argv[])
                  SDL_WINDOWPOS_UNDEFINED,           // initial y position
                  WIDTH,                             // width, in pixels
                  HEIGHT,                            // height, in pixels
-                 SDL_WINDOW_OPENGL                  // flags
+                 0                                  // flags
              );
     if (g_window == NULL) {
         fprintf(stderr,"%s: SDL_CreateWindow failed: %s\n", argv[0], SDL_GetError());
@@ -114,6 +574,28 @@ int main(int argc, char *argv[])
         exit(EXIT_FAILURE);
     }
 
+    /*
+     * One texture for all images, SDL_PIXELFORMAT_RGB888 is PIXEL_XRGB8888.
+     * The dummy video driver only has the software renderer.
+     */
+    g_renderer = SDL_CreateRenderer(g_window, -1, SDL_RENDERER_PRESENTVSYNC);
+    if (g_renderer == NULL) {
+        g_renderer = SDL_CreateRenderer(g_window, -1, SDL_RENDERER_SOFTWARE);
+    }
+    if (g_renderer == NULL) {
+        fprintf(stderr,"%s: SDL_CreateRenderer failed: %s\n", argv[0], SDL_GetError());
+        cleanup();
+        exit(EXIT_FAILURE);
+    }
+
+    g_texture = SDL_CreateTexture(g_renderer, SDL_PIXELFORMAT_RGB888,
+                                  SDL_TEXTUREACCESS_STREAMING, WIDTH, HEIGHT);
+    if (g_texture == NULL) {
+        fprintf(stderr,"%s: SDL_CreateTexture failed: %s\n", argv[0], SDL_GetError());
+        cleanup();
+        exit(EXIT_FAILURE);
+    }
+
     /*
      * Initalize values for global variables (declared in global_ids_W.h)
      * to determine if a segment should be freed or removed from inside
@@ -137,9 +619,9 @@ int main(int argc, char *argv[])
     sigemptyset(&act.sa_mask);
 
     /*
-     * The sigint_handler function is defined in sigint_handler.
-     * If a SIGINT signal is sent by pressing ctrl+c this function invokes the
-     * cleanup() function and termiates the program.
+     * The sigint_handler function is defined above.
+     * If a SIGINT signal is sent by pressing ctrl+c this function lets both
+     * threads terminate. No SA_RESTART, semop() has to be interrupted.
      */
 
     act.sa_handler = sigint_handler;
@@ -154,7 +636,8 @@ int main(int argc, char *argv[])
     act.sa_restorer = NULL;
 #endif
 
-    if ((sigaction(SIGINT, &act, NULL)) < 0) {
+    if ((sigaction(SIGINT, &act, NULL)) < 0 ||
+        (sigaction(SIGUSR1, &act, NULL)) < 0) {
         fprintf(stderr,"%s: sigaction(): %s\n",argv[0], strerror(errno));
         cleanup();
         exit(EXIT_FAILURE);
@@ -188,7 +671,7 @@ int main(int argc, char *argv[])
      * pixelGenerator does not get started in time.
      */
 
-    if ((g_shmid = shmget(key, MAX_DATA, 0)) < 0) {
+    if ((g_shmid = shmget(key, segment_size(), 0)) < 0) {
         if (errno == ENOENT) {
             printf("\nShared Memory Segment does not exist\n");
             printf("Please start the pixelGenerator program\n");
@@ -210,7 +693,7 @@ int main(int argc, char *argv[])
         int counter = 10;
 
         while (counter != 0) {
-            if ((g_shmid = shmget(key, MAX_DATA, 0)) < 0) {
+            if ((g_shmid = shmget(key, segment_size(), 0)) < 0) {
                 if (errno == ENOENT) {
                     if (counter == 1) {
                         fprintf(stderr,"%s: Shared Memory Segment does not exist\n",argv[0]);
@@ -249,130 +732,220 @@ int main(int argc, char *argv[])
         exit(EXIT_FAILURE);
     }
 
+    /*
+     * Let the pixelGenerator write the pixels the way the surface stores
+     * them, so they can simply be copied (see pixelFormat.h).
+     */
+
+    request_pixel_format(g_membuf, PIXEL_XRGB8888);
+    g_first_sent = segment_header(g_membuf)->commands.head;
+
     /*---------------------------------------------------------------------------*/
     /* C H E C K  F O R  E X I S T I N G  S E M A P H O R E S                    */
     /*---------------------------------------------------------------------------*/
 
     /*
-     * Both semaphores are created and removed by the pixelGenerator program.
+     * All semaphores are created and removed by the pixelGenerator program.
      */
 
-    if ((g_semid = semget(key, 2 ,0)) < 0) {
+    if ((g_semid = semget(key, NUMBER_OF_SEMAPHORES, 0)) < 0) {
         fprintf(stderr,"%s: semget(): %s\n",argv[0], strerror(errno));
         cleanup();
         exit(EXIT_FAILURE);
     }
 
-    /*
-     * prepare semaphore flags
-     */
-
-    struct sembuf s1;
-    struct sembuf s2;
+    /*---------------------------------------------------------------------------*/
+    /* R E A D  F R O M  S H A R E D  M E M O R Y                                */
+    /*---------------------------------------------------------------------------*/
 
-    s1.sem_num = 0;
-    s1.sem_flg = SEM_UNDO;
+    g_buffer = malloc((size_t) NUMBER_OF_BUFFERS * WIDTH * HEIGHT * 4);
+    g_base = calloc((size_t) WIDTH * HEIGHT, 4);
+    g_preview = calloc((size_t) WIDTH * HEIGHT, 4);
+    if (g_buffer == NULL || g_base == NULL || g_preview == NULL) {
+        perror("malloc");
+        cleanup();
+        exit(EXIT_FAILURE);
+    }
 
-    s2.sem_num = 1;
-    s2.sem_flg = SEM_UNDO;
+    if (pthread_create(&g_ingest, NULL, ingest_thread, NULL) != 0) {
+        perror("pthread_create");
+        cleanup();
+        exit(EXIT_FAILURE);
+    }
 
     /*---------------------------------------------------------------------------*/
-    /* R E A D  F R O M  S H A R E D  M E M O R Y                                */
+    /* W R I T E  I M A G E  T O  S D L                                          */
     /*---------------------------------------------------------------------------*/
 
     /*
-     * Initalize values for image name. Allocate memory for the imagename.
+     * Show at most one image per display refresh. With vsync
+     * SDL_RenderPresent() waits for the refresh as well, without (dummy
+     * driver) the loop keeps the pace on its own.
      */
+    SDL_DisplayMode mode;
+    int refresh_rate = DEFAULT_REFRESH_RATE;
+    if (SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(g_window), &mode) == 0 &&
+        mode.refresh_rate > 0) {
+        refresh_rate = mode.refresh_rate;
+    }
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 period = frequency / refresh_rate;
+    Uint64 next = SDL_GetPerformanceCounter();
+    Uint64 title_time = next;
 
-    int imagenumber = 1;
+    unsigned long imagenumber = 0;
+    unsigned long shown = 0;
+    unsigned long base_commands = g_first_sent;
+    struct view_transform shown_transform = { .valid = 0 };
 
-    while(1) {
+    while (!g_quit) {
 
         /*
-         * lock the ImageWriter semaphore do prevent reading from the shared memory
-         * segment while the pixelGenerator is writing to it at the same time.
+         * Handle events until the next refresh, the window stays responsive
+         * however fast images arrive.
          */
-
-        s2.sem_op = -1;
-
-        if (semop(g_semid, &s2, 1) == -1) {
-            int rv = EXIT_FAILURE;
-            if (errno == EIDRM) {
-                printf("\nSemaphore has been removed\n");
-                printf("Check if the pixelGenerator program has terminated\n\n");
-                rv = EXIT_SUCCESS;
-            } else {
-                fprintf(stderr,"%s: semop(): %s\n",argv[0], strerror(errno));
+        Uint64 now;
+        for (;;) {
+            while (SDL_PollEvent(&e) != 0) {
+                if (e.type == SDL_QUIT) {
+                    g_quit = 1;
+                }
+                handle_input(&e);
             }
-            cleanup();
-            exit(rv);
+            now = SDL_GetPerformanceCounter();
+            if (g_quit || now >= next) {
+                break;
+            }
+            SDL_WaitEventTimeout(NULL, (int) ((next - now) * 1000 / frequency) + 1);
         }
-        /*
-         * S D L   S U R F A C E
-         */
-        g_surface = SDL_CreateRGBSurface(SDL_SWSURFACE, WIDTH, HEIGHT, 32,
-                                       rmask, gmask, bmask, amask);
-        if(g_surface == NULL) {
-            fprintf(stderr, "CreateRGBSurface failed: %s\n", SDL_GetError());
-            cleanup();
-            exit(EXIT_FAILURE);
+        next += period;
+        if (next < now) {
+            next = now + period;
+        }
+
+        if (g_input.input_time != 0) {
+            send_input();
         }
-        uint32_t *image = g_surface->pixels;
 
         /*
-         * Read from shared memory into the local buffer
+         * take the newest image
          */
-
-        for (int i = 0; i < WIDTH*HEIGHT; i++) {
-            image[i] = (g_membuf[i*3] << 16) | (g_membuf[i*3+1] << 8) | (g_membuf[i*3+2]) ;
+        pthread_mutex_lock(&g_exchange.lock);
+        int fresh = g_exchange.fresh;
+        if (fresh) {
+            int ready = g_exchange.ready;
+            g_exchange.ready = g_exchange.front;
+            g_exchange.front = ready;
+            g_exchange.fresh = 0;
+            imagenumber = g_exchange.framenumber[ready];
         }
+        int front = g_exchange.front;
+        long long input_time = fresh ? g_exchange.input_time[front] : 0;
+        unsigned long commands_applied = g_exchange.commands_applied[front];
+        int tiles_done = g_exchange.tiles_done[front];
+        int tile_size = g_exchange.tile_size[front];
+        int partial = g_exchange.partial[front];
+        int done = g_exchange.done;
+        pthread_mutex_unlock(&g_exchange.lock);
 
         /*
-         * Unlock the pixelGenerator semaphore to allow the pixelGenerator to write to
-         * the shared memory segment.
+         * A partial image replaces the prediction of its section tile by
+         * tile, a complete one replaces it all.
          */
-        s1.sem_op = 1;
-
-        if (semop(g_semid, &s1, 1) == -1) {
-            int rv = EXIT_FAILURE;
-            if (errno == EIDRM) {
-                printf("\nSemaphore has been removed\n");
-                printf("Check if the pixelGenerator program has terminated\n\n");
-                rv = EXIT_SUCCESS;
+        struct view_transform t;
+        uint32_t *image = (uint32_t *) image_buffer(front);
+        if (fresh) {
+            if (partial && g_predict) {
+                sent_transform(&t, base_commands, commands_applied);
+                if (t.valid) {
+                    resample_xrgb8888(g_preview, g_base, &t);
+                } else {
+                    memcpy(g_preview, image, (size_t) WIDTH * HEIGHT * 4);
+                }
+                paste_tiles(g_preview, image, tiles_done, tile_size);
+                uint32_t *base = g_base;
+                g_base = g_preview;
+                g_preview = base;
             } else {
-                fprintf(stderr,"%s: semop(): %s\n",argv[0], strerror(errno));
+                memcpy(g_base, image, (size_t) WIDTH * HEIGHT * 4);
             }
-            cleanup();
-            exit(rv);
+            base_commands = commands_applied;
         }
 
-        /*---------------------------------------------------------------------------*/
-        /* W R I T E  I M A G E  T O  S D L                                          */
-        /*---------------------------------------------------------------------------*/
-
-        printf("Displaying image %d.\n",imagenumber);
-
-        g_screen = SDL_GetWindowSurface(g_window);
-        SDL_BlitSurface(g_surface, NULL, g_screen, NULL);
-        SDL_FreeSurface(g_surface);
-        g_surface = NULL;
-        SDL_UpdateWindowSurface(g_window);
-
-        //Handle events on queue
-        while( SDL_PollEvent( &e ) != 0 ) {
-            //User requests quit
-            if( e.type == SDL_QUIT ) {
-                goto END;
+        /*
+         * Predict the section of the commands sent (and the input not sent
+         * yet) the image does not show.
+         */
+        if (g_predict) {
+            sent_transform(&t, base_commands, segment_header(g_membuf)->commands.head);
+            add_pending_input(&t);
+        } else {
+            identity_transform(&t);
+        }
+        int changed = t.valid != shown_transform.valid || t.scale != shown_transform.scale ||
+                      t.x != shown_transform.x || t.y != shown_transform.y;
+
+        if (fresh || (t.valid && changed)) {
+            uint32_t *show = g_base;
+            if (t.valid && !is_identity(&t)) {
+                resample_xrgb8888(g_preview, g_base, &t);
+                show = g_preview;
+            }
+            SDL_UpdateTexture(g_texture, NULL, show, WIDTH * 4);
+            SDL_RenderCopy(g_renderer, g_texture, NULL, NULL);
+            SDL_RenderPresent(g_renderer);
+            shown_transform = t;
+            if (fresh && input_time != 0) {
+                add_latency(&g_latency, input_time);
             }
         }
+        if (g_input.preview_time != 0 && g_input.input_time == 0) {
+            /* all input sent, shown by the prediction if it is valid */
+            if (g_predict && t.valid) {
+                add_latency(&g_preview_latency, g_input.preview_time);
+            }
+            g_input.preview_time = 0;
+        }
 
-        imagenumber++;
+        if (fresh) {
+            shown++;
+            if (shown % STATS_INTERVAL == 0) {
+                print_stats(imagenumber, shown);
+            }
+        } else if (done) {
+            break;
+        }
 
+        if (now - title_time >= frequency) {
+            char title[128];
+            pthread_mutex_lock(&g_exchange.lock);
+            snprintf(title, sizeof(title),
+                     "Mandelbrot Demo Image Viewer - image %lu, %lu dropped",
+                     imagenumber, g_exchange.dropped);
+            pthread_mutex_unlock(&g_exchange.lock);
+            SDL_SetWindowTitle(g_window, title);
+            title_time = now;
+        }
     }
 
-END:
+    /*
+     * Wake the ingest thread until it has seen g_quit.
+     */
+    g_quit = 1;
+    for (;;) {
+        pthread_mutex_lock(&g_exchange.lock);
+        int done = g_exchange.done;
+        pthread_mutex_unlock(&g_exchange.lock);
+        if (done) {
+            break;
+        }
+        pthread_kill(g_ingest, SIGUSR1);
+        SDL_Delay(10);
+    }
+    pthread_join(g_ingest, NULL);
 
+    print_stats(imagenumber, shown);
     cleanup();
 
-    return EXIT_SUCCESS;
+    return g_exchange.status;
 }
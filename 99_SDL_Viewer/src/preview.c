@@ -0,0 +1,209 @@
+/*
+ * Preview of a section of the mandelbrot set that has been requested from
+ * the pixelGenerator but not generated yet.
+ *
+ * Every view_command (see viewCommand.h) moves or scales the image, so the
+ * requested section can be predicted from the last image received by
+ * resampling it. resample_xrgb8888() scales bilinearly with 8.8 fixed point
+ * weights, with SSE2 two pixels at once (all channels of both pixels in one
+ * register). Pixels outside of the received image are black.
+ *
+ * 01/2017 Christian Fibich
+ */
+
+#include <string.h>
+
+#ifdef __SSE2__
+#define PREVIEW_SIMD 1
+#include <emmintrin.h>
+#else
+#define PREVIEW_SIMD 0
+#endif
+
+#include "numberOfPixel.h"
+#include "tiles.h"
+#include "preview.h"
+
+void identity_transform(struct view_transform *t)
+{
+    t->scale = 1.0;
+    t->x = 0.0;
+    t->y = 0.0;
+    t->valid = 1;
+}
+
+int is_identity(const struct view_transform *t)
+{
+    return t->valid && t->scale == 1.0 && t->x == 0.0 && t->y == 0.0;
+}
+
+/*
+ * Append a command: the section after the command maps to the section
+ * before, see apply_view_command() in viewCommand.c.
+ */
+void add_view_command(struct view_transform *t, const struct view_command *command)
+{
+    double scale, x, y;
+
+    if (command->type == VIEW_PAN) {
+        scale = 1.0;
+        x = -command->x;
+        y = -command->y;
+    } else if (command->type == VIEW_ZOOM && command->factor > 0) {
+        scale = 1.0 / command->factor;
+        x = command->x * (1.0 - scale);
+        y = command->y * (1.0 - scale);
+    } else {
+        t->valid = 0;
+        return;
+    }
+
+    t->x += t->scale * x;
+    t->y += t->scale * y;
+    t->scale *= scale;
+}
+
+static inline uint32_t bilinear(const uint32_t *r0, const uint32_t *r1,
+                                int x0, int x1, int fx, int fy)
+{
+    uint32_t c = 0;
+
+    for (int shift = 0; shift < 32; shift += 8) {
+        int a = (r0[x0] >> shift) & 0xff, b = (r0[x1] >> shift) & 0xff;
+        int d = (r1[x0] >> shift) & 0xff, e = (r1[x1] >> shift) & 0xff;
+        int left = (a * (256 - fy) + d * fy) >> 8;
+        int right = (b * (256 - fy) + e * fy) >> 8;
+        c |= (uint32_t) ((left * (256 - fx) + right * fx) >> 8) << shift;
+    }
+    return c;
+}
+
+/*
+ * The pixel at the 16.16 fixed point column sx of the rows r0 and r1.
+ */
+static inline uint32_t resample_pixel(const uint32_t *r0, const uint32_t *r1,
+                                      int64_t sx, int fy)
+{
+    int xi = (int) (sx >> 16);
+
+    if (sx < 0 || xi >= WIDTH) {
+        return 0;
+    }
+    int x1 = xi < WIDTH - 1 ? xi + 1 : xi;
+    return bilinear(r0, r1, xi, x1, (int) (sx >> 8) & 0xff, fy);
+}
+
+#if PREVIEW_SIMD
+/*
+ * Two destination pixels a and b per step: the left and right source pixels
+ * of both are loaded from the upper and the lower row (4 pixels, 16 bytes
+ * each), widened to 16 bit and mixed vertically, 8 words at once for each
+ * pixel. The horizontal mix weights the left pixel in the lower and the right
+ * pixel in the upper 4 words, adding the halves leaves a in the lower and b
+ * in the upper 4 words. All sums stay below 65536. Pairs touching the
+ * border of the received image are mixed by resample_pixel().
+ */
+static void resample_row_sse2(uint32_t *dst, const uint32_t *r0, const uint32_t *r1,
+                              int64_t sx, int64_t step, int fy)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i wy0 = _mm_set1_epi16(256 - fy);
+    const __m128i wy1 = _mm_set1_epi16(fy);
+    int x;
+
+    for (x = 0; x + 1 < WIDTH; x += 2, sx += 2 * step) {
+        int64_t sb = sx + step;
+        int xa = (int) (sx >> 16);
+        int xb = (int) (sb >> 16);
+
+        if (sx < 0 || xb >= WIDTH - 1) {
+            dst[x] = resample_pixel(r0, r1, sx, fy);
+            dst[x + 1] = resample_pixel(r0, r1, sb, fy);
+            continue;
+        }
+        int fa = (int) (sx >> 8) & 0xff;
+        int fb = (int) (sb >> 8) & 0xff;
+
+        __m128i top = _mm_set_epi32((int) r0[xb + 1], (int) r0[xb],
+                                    (int) r0[xa + 1], (int) r0[xa]);
+        __m128i bottom = _mm_set_epi32((int) r1[xb + 1], (int) r1[xb],
+                                       (int) r1[xa + 1], (int) r1[xa]);
+
+        __m128i a = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(top, zero), wy0),
+                                  _mm_mullo_epi16(_mm_unpacklo_epi8(bottom, zero), wy1));
+        __m128i b = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(top, zero), wy0),
+                                  _mm_mullo_epi16(_mm_unpackhi_epi8(bottom, zero), wy1));
+        a = _mm_srli_epi16(a, 8);
+        b = _mm_srli_epi16(b, 8);
+
+        a = _mm_mullo_epi16(a, _mm_unpacklo_epi64(_mm_set1_epi16(256 - fa),
+                                                  _mm_set1_epi16(fa)));
+        b = _mm_mullo_epi16(b, _mm_unpacklo_epi64(_mm_set1_epi16(256 - fb),
+                                                  _mm_set1_epi16(fb)));
+        __m128i v = _mm_add_epi16(_mm_unpacklo_epi64(a, b), _mm_unpackhi_epi64(a, b));
+        v = _mm_srli_epi16(v, 8);
+
+        _mm_storel_epi64((__m128i *) (dst + x), _mm_packus_epi16(v, zero));
+    }
+
+    if (x < WIDTH) {
+        dst[x] = resample_pixel(r0, r1, sx, fy);
+    }
+}
+#endif
+
+/*
+ * dst and src hold WIDTH x HEIGHT XRGB8888 pixels, dst pixel p is src pixel
+ * t->scale * p + (t->x, t->y).
+ */
+void resample_xrgb8888(uint32_t *dst, const uint32_t *src, const struct view_transform *t)
+{
+    int64_t step = (int64_t) (t->scale * 65536.0);
+
+    for (int y = 0; y < HEIGHT; y++) {
+        uint32_t *row = dst + (size_t) y * WIDTH;
+        double sy = t->scale * y + t->y;
+        int yi = (int) sy;
+
+        if (sy < 0 || yi >= HEIGHT) {
+            memset(row, 0, WIDTH * 4);
+            continue;
+        }
+        int fy = (int) ((sy - yi) * 256.0);
+        const uint32_t *r0 = src + (size_t) yi * WIDTH;
+        const uint32_t *r1 = yi < HEIGHT - 1 ? r0 + WIDTH : r0;
+        int64_t sx = (int64_t) (t->x * 65536.0);
+        if (t->x < 0 && (double) sx != t->x * 65536.0) {
+            sx--;    /* round towards -infinity like sx >> 16 */
+        }
+
+#if PREVIEW_SIMD
+        resample_row_sse2(row, r0, r1, sx, step, fy);
+        continue;
+#endif
+        for (int x = 0; x < WIDTH; x++, sx += step) {
+            row[x] = resample_pixel(r0, r1, sx, fy);
+        }
+    }
+}
+
+/*
+ * Copy the first tiles_done tiles of the center-out order (see tiles.h) of a
+ * partial image over the preview, tile_size is the one of the pixelGenerator.
+ */
+void paste_tiles(uint32_t *dst, const uint32_t *src, int tiles_done, int tile_size)
+{
+    if (set_tile_size(tile_size) != 0 || init_tiles() != 0) {
+        return;
+    }
+
+    for (int order = 0; order < tiles_done && order < number_of_tiles(); order++) {
+        int start_x, stop_x, start_y, stop_y;
+        tile_bounds(order, &start_x, &stop_x, &start_y, &stop_y);
+
+        for (int y = start_y; y < stop_y; y++) {
+            memcpy(dst + (size_t) y * WIDTH + start_x, src + (size_t) y * WIDTH + start_x,
+                   (size_t) (stop_x - start_x) * 4);
+        }
+    }
+}
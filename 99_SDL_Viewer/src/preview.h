@@ -0,0 +1,34 @@
+/*
+ * Preview of a section of the mandelbrot set that has been requested from
+ * the pixelGenerator but not generated yet (see preview.c).
+ *
+ * 01/2017 Christian Fibich
+ */
+
+#ifndef _preview_
+#define _preview_
+
+#include <stdint.h>
+
+#include "viewCommand.h"
+
+/*
+ * Maps a pixel p of the requested section to the pixel scale * p + (x, y)
+ * of an image already received. valid is 0 if the requested section can not
+ * be predicted (VIEW_AUTO, commands no longer known).
+ */
+struct view_transform {
+    double scale;
+    double x;
+    double y;
+    int valid;
+};
+
+void identity_transform(struct view_transform *t);
+int is_identity(const struct view_transform *t);
+void add_view_command(struct view_transform *t, const struct view_command *command);
+
+void resample_xrgb8888(uint32_t *dst, const uint32_t *src, const struct view_transform *t);
+void paste_tiles(uint32_t *dst, const uint32_t *src, int tiles_done, int tile_size);
+
+#endif